@@ -0,0 +1,52 @@
+/**
+ * @file adcSampler.h
+ * @brief Abstract interface for sampling the analog inputs (joystick X, joystick Y and eyelid pot).
+ *
+ * The InputHandler only ever calls poll() and read(), so the backend can be swapped between blocking
+ * analogRead() calls, the ESP32 ADC continuous (DMA) mode, or a synthetic source on the host.
+ */
+
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "snapshots.h"
+
+// Analog input indexes
+#define ADC_INPUT_JOYSTICK_X 0
+#define ADC_INPUT_JOYSTICK_Y 1
+#define ADC_INPUT_EYELIDS_POT 2
+#define ADC_INPUT_COUNT 3
+
+static_assert(ADC_INPUT_COUNT == RAW_INPUT_ADC_COUNT, "RawInputs must hold every analog input");
+
+// Pins for each analog input index
+const uint8_t ADC_INPUT_PINS[ADC_INPUT_COUNT] = {PIN_JOYSTICK_X, PIN_JOYSTICK_Y, PIN_EYELIDS_POT};
+
+class AdcSampler {
+public:
+    virtual ~AdcSampler() {}
+
+    /**
+     * @brief Configures the ADC and starts sampling.
+     *
+     * @return true if sampling started, false otherwise.
+     */
+    virtual bool begin() = 0;
+
+    /**
+     * @brief Collects any new samples. Continuous backends never block here.
+     */
+    virtual void poll() = 0;
+
+    /**
+     * @brief Gets the latest filtered value of an analog input in O(1).
+     *
+     * @param input The analog input index (ADC_INPUT_*).
+     * @return the latest value (0 -> 4095).
+     */
+    virtual int read(uint8_t input) const = 0;
+};
+
+#endif // ADC_SAMPLER_H
@@ -0,0 +1,45 @@
+/**
+ * @file analogReadSampler.cpp
+ * @brief Samples the analog inputs with one blocking analogRead() per input on every poll.
+ *
+ * This is the default backend and the fallback when continuous sampling is not available.
+ */
+
+#include "analogReadSampler.h"
+
+/**
+ * @brief Constructs a new AnalogReadSampler object.
+ */
+AnalogReadSampler::AnalogReadSampler() {
+    for (uint8_t input = 0; input < ADC_INPUT_COUNT; input++) {
+        values[input] = 0;
+    }
+}
+
+/**
+ * @brief Nothing to configure, analogRead() sets the ADC up on first use.
+ *
+ * @return true.
+ */
+bool AnalogReadSampler::begin() {
+    return true;
+}
+
+/**
+ * @brief Reads every analog input once.
+ */
+void AnalogReadSampler::poll() {
+    for (uint8_t input = 0; input < ADC_INPUT_COUNT; input++) {
+        values[input] = analogRead(ADC_INPUT_PINS[input]);
+    }
+}
+
+/**
+ * @brief Gets the value read on the last poll.
+ *
+ * @param input The analog input index (ADC_INPUT_*).
+ * @return the latest value (0 -> 4095).
+ */
+int AnalogReadSampler::read(uint8_t input) const {
+    return values[input];
+}
@@ -0,0 +1,25 @@
+/**
+ * @file analogReadSampler.h
+ * @brief Samples the analog inputs with one blocking analogRead() per input on every poll.
+ *
+ * This is the default backend and the fallback when continuous sampling is not available.
+ */
+
+#ifndef ANALOG_READ_SAMPLER_H
+#define ANALOG_READ_SAMPLER_H
+
+#include "adcSampler.h"
+
+class AnalogReadSampler : public AdcSampler {
+public:
+    AnalogReadSampler();
+
+    bool begin() override;
+    void poll() override;
+    int read(uint8_t input) const override;
+
+private:
+    int values[ADC_INPUT_COUNT];
+};
+
+#endif // ANALOG_READ_SAMPLER_H
@@ -0,0 +1,128 @@
+/**
+ * @file behaviourModel.cpp
+ * @brief The autonomous behaviour as a table of weighted outcomes, sampled with a single draw.
+ *
+ * The outcomes happen at an average of one per getMeanIntervalMillis() (the StateManager times them
+ * with a PoissonTimer). When one is due, the StateManager draws one number below getOutcomeWeight()
+ * and the model maps it through a cumulative weight table to an outcome (a combination of
+ * BEHAVIOUR_* actions). Where the outcome picks a position
+ * (a new look direction, a squint), the position comes from the same draw: each outcome's weight is
+ * rounded to a multiple of its number of variants, so the offset within the outcome is uniform over them.
+ */
+
+#include "behaviourModel.h"
+
+/**
+ * @brief The default chances, from the AUTO_CHANCE_* settings.
+ */
+constexpr BehaviourChances AUTO_BEHAVIOUR_CHANCES = {
+    AUTO_CHANCE_OF_BLINK,
+    AUTO_CHANCE_OF_EYELID_CHANGE,
+    AUTO_CHANCE_OF_MAJOR_LOOK_CHANGE,
+    AUTO_CHANCE_OF_LOOK_RETURN_CENTRE,
+    AUTO_CHANCE_OF_BLINK_WHILE_LOOK,
+};
+
+/**
+ * @brief The default autonomous behaviour, built by the compiler.
+ */
+constexpr BehaviourTable AUTO_BEHAVIOUR_TABLE = buildBehaviourTable(AUTO_BEHAVIOUR_CHANCES);
+
+static_assert(totalBehaviourWeight(AUTO_BEHAVIOUR_TABLE) <= BEHAVIOUR_WEIGHT_SCALE, "The AUTO_CHANCE_* settings add up to more than one outcome per AUTO_UPDATE_INTERVAL");
+
+/**
+ * @brief Constructs a new BehaviourModel object and precomputes the cumulative weights.
+ *
+ * @param outcomes The outcome table (must outlive the model).
+ * @param outcomeCount The number of outcomes (at most BEHAVIOUR_MAX_OUTCOMES).
+ */
+BehaviourModel::BehaviourModel(const BehaviourOutcome* outcomes, uint8_t outcomeCount) {
+    setOutcomes(outcomes, outcomeCount);
+}
+
+/**
+ * @brief Switches to another outcome table and recomputes the cumulative weights.
+ *
+ * @param outcomes The outcome table (must outlive the model).
+ * @param outcomeCount The number of outcomes (at most BEHAVIOUR_MAX_OUTCOMES).
+ */
+void BehaviourModel::setOutcomes(const BehaviourOutcome* outcomes, uint8_t outcomeCount) {
+    this->outcomes = outcomes;
+    this->outcomeCount = min(outcomeCount, (uint8_t)BEHAVIOUR_MAX_OUTCOMES);
+
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < this->outcomeCount; i++) {
+        // Round down so every variant of the outcome is equally likely
+        cumulative += outcomes[i].weight - outcomes[i].weight % getVariantCount(outcomes[i].actions);
+        cumulativeWeights[i] = cumulative;
+    }
+}
+
+/**
+ * @brief Gets the range to draw from when an outcome is due.
+ *
+ * @return the total weight of the outcomes (draw from 0 to this value - 1).
+ */
+uint32_t BehaviourModel::getOutcomeWeight() const {
+    return outcomeCount == 0 ? 0 : cumulativeWeights[outcomeCount - 1];
+}
+
+/**
+ * @brief Gets the average time between outcomes, from their combined chance per AUTO_UPDATE_INTERVAL.
+ *
+ * @return the mean interval (ms), or 0 if no outcome can happen.
+ */
+uint32_t BehaviourModel::getMeanIntervalMillis() const {
+    uint32_t outcomeWeight = getOutcomeWeight();
+    return outcomeWeight == 0 ? 0 : (uint64_t)AUTO_UPDATE_INTERVAL * BEHAVIOUR_WEIGHT_SCALE / outcomeWeight;
+}
+
+/**
+ * @brief Gets the number of equally likely positions an outcome chooses between.
+ *
+ * @param actions The outcome's BEHAVIOUR_* actions.
+ * @return the number of variants.
+ */
+uint32_t BehaviourModel::getVariantCount(uint8_t actions) {
+    uint32_t variants = 1;
+    if (actions & (BEHAVIOUR_LOOK_CENTRE | BEHAVIOUR_LOOK_AROUND)) {
+        // A return to centre needs a direction in case the eyes are already centred
+        variants *= AUTO_LOOK_PAN_POSITION_COUNT * AUTO_LOOK_TILT_POSITION_COUNT;
+    }
+    if (actions & BEHAVIOUR_SQUINT) {
+        variants *= AUTO_SQUINT_POSITION_COUNT;
+    }
+    return variants;
+}
+
+/**
+ * @brief Maps a single draw to an outcome and its positions.
+ *
+ * @param draw A uniform random number from 0 to getOutcomeWeight() - 1.
+ * @return the decision (actions 0 if the draw is out of range).
+ */
+BehaviourDecision BehaviourModel::decide(uint32_t draw) const {
+    BehaviourDecision decision = {0, 0, 0, 0};
+
+    uint32_t previous = 0;
+    for (uint8_t i = 0; i < outcomeCount; i++) {
+        if (draw < cumulativeWeights[i]) {
+            decision.actions = outcomes[i].actions;
+
+            // The offset into the outcome is uniform over its variants, so it picks the positions
+            uint32_t variant = draw - previous;
+            if (decision.actions & (BEHAVIOUR_LOOK_CENTRE | BEHAVIOUR_LOOK_AROUND)) {
+                decision.panIndex = variant % AUTO_LOOK_PAN_POSITION_COUNT;
+                variant /= AUTO_LOOK_PAN_POSITION_COUNT;
+                decision.tiltIndex = variant % AUTO_LOOK_TILT_POSITION_COUNT;
+                variant /= AUTO_LOOK_TILT_POSITION_COUNT;
+            }
+            if (decision.actions & BEHAVIOUR_SQUINT) {
+                decision.squintIndex = variant % AUTO_SQUINT_POSITION_COUNT;
+            }
+            return decision;
+        }
+        previous = cumulativeWeights[i];
+    }
+    return decision;
+}
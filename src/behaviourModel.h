@@ -0,0 +1,120 @@
+/**
+ * @file behaviourModel.h
+ * @brief The autonomous behaviour as a table of weighted outcomes, sampled with a single draw.
+ *
+ * The outcomes happen at an average of one per getMeanIntervalMillis() (the StateManager times them
+ * with a PoissonTimer). When one is due, the StateManager draws one number below getOutcomeWeight()
+ * and the model maps it through a cumulative weight table to an outcome (a combination of
+ * BEHAVIOUR_* actions). Where the outcome picks a position
+ * (a new look direction, a squint), the position comes from the same draw: each outcome's weight is
+ * rounded to a multiple of its number of variants, so the offset within the outcome is uniform over them.
+ *
+ * The table is built from the AUTO_CHANCE_* settings by buildBehaviourTable(), at compile time for the
+ * defaults and again whenever the runtime config changes them. To add a behaviour, add a row there
+ * rather than another roll.
+ */
+
+#ifndef BEHAVIOUR_MODEL_H
+#define BEHAVIOUR_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define BEHAVIOUR_LOOK_CENTRE 0x01  // Return the eyes to the centre (or look around if they are already there)
+#define BEHAVIOUR_LOOK_AROUND 0x02  // Look in a new direction from AUTO_LOOK_PAN_POSITIONS/AUTO_LOOK_TILT_POSITIONS
+#define BEHAVIOUR_SQUINT      0x04  // Change the eyelids to a position from AUTO_SQUINT_POSITIONS
+#define BEHAVIOUR_BLINK       0x08  // Blink
+
+#define BEHAVIOUR_MAX_OUTCOMES 16
+#define BEHAVIOUR_TABLE_ROWS 6      // Rows built by buildBehaviourTable()
+
+// Weights are chances per AUTO_UPDATE_INTERVAL in units of 1 / BEHAVIOUR_WEIGHT_SCALE
+#define BEHAVIOUR_WEIGHT_SCALE ((uint32_t)AUTO_MAX_CHANCE * AUTO_MAX_CHANCE)
+
+struct BehaviourOutcome {
+    uint8_t actions;    // BEHAVIOUR_*
+    uint32_t weight;    // Chance per AUTO_UPDATE_INTERVAL (1 / BEHAVIOUR_WEIGHT_SCALE)
+};
+
+/**
+ * @brief The per-roll chances the behaviour table is built from (AUTO_CHANCE_*, 0 -> AUTO_MAX_CHANCE).
+ */
+struct BehaviourChances {
+    uint32_t blink;
+    uint32_t eyelidChange;
+    uint32_t majorLookChange;
+    uint32_t lookReturnCentre;
+    uint32_t blinkWhileLook;
+};
+
+struct BehaviourTable {
+    BehaviourOutcome outcomes[BEHAVIOUR_TABLE_ROWS];
+};
+
+static_assert(BEHAVIOUR_TABLE_ROWS <= BEHAVIOUR_MAX_OUTCOMES, "The behaviour table has more than BEHAVIOUR_MAX_OUTCOMES rows");
+
+/**
+ * @brief Combines the per-roll chances into the chance of each outcome per AUTO_UPDATE_INTERVAL.
+ *
+ * @param chances The chances (each at most AUTO_MAX_CHANCE).
+ * @return the behaviour table.
+ */
+constexpr BehaviourTable buildBehaviourTable(const BehaviourChances& chances) {
+    // A major look change that returns to the centre (or not) and blinks (or not)
+    const uint32_t centre = chances.lookReturnCentre;
+    const uint32_t around = AUTO_MAX_CHANCE - chances.lookReturnCentre;
+    const uint32_t blink = chances.blinkWhileLook;
+    const uint32_t noBlink = AUTO_MAX_CHANCE - chances.blinkWhileLook;
+    return BehaviourTable{{
+        {BEHAVIOUR_LOOK_CENTRE,                   chances.majorLookChange * centre * noBlink / AUTO_MAX_CHANCE},
+        {BEHAVIOUR_LOOK_CENTRE | BEHAVIOUR_BLINK, chances.majorLookChange * centre * blink / AUTO_MAX_CHANCE},
+        {BEHAVIOUR_LOOK_AROUND,                   chances.majorLookChange * around * noBlink / AUTO_MAX_CHANCE},
+        {BEHAVIOUR_LOOK_AROUND | BEHAVIOUR_BLINK, chances.majorLookChange * around * blink / AUTO_MAX_CHANCE},
+        {BEHAVIOUR_SQUINT,                        chances.eyelidChange * AUTO_MAX_CHANCE},
+        {BEHAVIOUR_BLINK,                         chances.blink * AUTO_MAX_CHANCE},
+    }};
+}
+
+/**
+ * @brief Totals the weights of a behaviour table.
+ *
+ * @param table The behaviour table.
+ * @return the total weight (at most BEHAVIOUR_WEIGHT_SCALE for a usable table).
+ */
+constexpr uint64_t totalBehaviourWeight(const BehaviourTable& table) {
+    uint64_t total = 0;
+    for (const BehaviourOutcome& outcome : table.outcomes) {
+        total += outcome.weight;
+    }
+    return total;
+}
+
+struct BehaviourDecision {
+    uint8_t actions;    // BEHAVIOUR_*
+    uint8_t panIndex;   // Into AUTO_LOOK_PAN_POSITIONS (when looking)
+    uint8_t tiltIndex;  // Into AUTO_LOOK_TILT_POSITIONS (when looking)
+    uint8_t squintIndex; // Into AUTO_SQUINT_POSITIONS (when squinting)
+};
+
+class BehaviourModel {
+public:
+    BehaviourModel(const BehaviourOutcome* outcomes, uint8_t outcomeCount);
+
+    void setOutcomes(const BehaviourOutcome* outcomes, uint8_t outcomeCount);
+
+    uint32_t getOutcomeWeight() const;
+    uint32_t getMeanIntervalMillis() const;
+    BehaviourDecision decide(uint32_t draw) const;
+
+    static uint32_t getVariantCount(uint8_t actions);
+
+private:
+    const BehaviourOutcome* outcomes;
+    uint8_t outcomeCount;
+    uint32_t cumulativeWeights[BEHAVIOUR_MAX_OUTCOMES];
+};
+
+extern const BehaviourChances AUTO_BEHAVIOUR_CHANCES;
+extern const BehaviourTable AUTO_BEHAVIOUR_TABLE;
+
+#endif // BEHAVIOUR_MODEL_H
@@ -0,0 +1,191 @@
+/**
+ * @file buttonEvents.cpp
+ * @brief Reads the buttons with GPIO interrupts instead of polling them on every input update.
+ *
+ * Each button interrupt timestamps the new level and pushes it into a lock-free queue, so an edge is
+ * never missed between input updates and its time is known to the microsecond. The input task drains
+ * the queue through a debouncer per button. The interrupts are the only producer (they do not nest)
+ * and the input task is the only consumer.
+ */
+
+#include "buttonEvents.h"
+
+#ifdef BUTTON_INTERRUPTS
+
+#include <driver/gpio.h>
+#include "snapshots.h"
+
+static const uint8_t BUTTON_PINS[BUTTON_COUNT] = {PIN_BLINK_BUTTON, PIN_BLINK_BUTTON_2, PIN_POWER_BUTTON};
+static const uint8_t BUTTON_RAW_FLAGS[BUTTON_COUNT] = {RAW_BUTTON_BLINK, RAW_BUTTON_BLINK_2, RAW_BUTTON_POWER};
+
+static void IRAM_ATTR onBlinkButtonInterrupt() {
+    buttonEvents.onInterrupt(BUTTON_INDEX_BLINK);
+}
+
+static void IRAM_ATTR onBlinkButton2Interrupt() {
+    buttonEvents.onInterrupt(BUTTON_INDEX_BLINK_2);
+}
+
+static void IRAM_ATTR onPowerButtonInterrupt() {
+    buttonEvents.onInterrupt(BUTTON_INDEX_POWER);
+}
+
+static const voidFuncPtr BUTTON_INTERRUPT_HANDLERS[BUTTON_COUNT] = {onBlinkButtonInterrupt, onBlinkButton2Interrupt, onPowerButtonInterrupt};
+
+/**
+ * @brief Constructs a new ButtonEvents object, with every button released.
+ */
+ButtonEvents::ButtonEvents():
+    interruptLevels(),
+    overflowCount(0),
+    overflowsSeen(0)
+{}
+
+/**
+ * @brief Queues the current level of any button that is already pressed, then attaches the interrupts.
+ * The button pins must already be configured as inputs.
+ */
+void ButtonEvents::begin() {
+    queueLevels();
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        attachInterrupt(digitalPinToInterrupt(BUTTON_PINS[button]), BUTTON_INTERRUPT_HANDLERS[button], CHANGE);
+    }
+}
+
+/**
+ * @brief Queues a button's level if it differs from the last one queued (runs in the interrupt).
+ *
+ * @param button The button (BUTTON_INDEX_*).
+ */
+void IRAM_ATTR ButtonEvents::onInterrupt(uint8_t button) {
+    // The buttons are pulled up, so they read low when pressed
+    bool pressed = !digitalRead(BUTTON_PINS[button]);
+    if (pressed == interruptLevels[button]) {
+        return;
+    }
+    interruptLevels[button] = pressed;
+
+    ButtonEdge edge = {micros(), button, pressed};
+    if (!queue.push(edge)) {
+        // read() catches up by reading the pins
+        overflowCount.store(overflowCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief Queues the level of every button. Only call this while the interrupts are not attached or are disabled.
+ */
+void ButtonEvents::queueLevels() {
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        onInterrupt(button);
+    }
+}
+
+/**
+ * @brief Gets the next debounced edge, in the order they happened.
+ *
+ * @param edge Receives the edge.
+ * @param currentMicros The current time (us), used to accept a level that was held by the debouncer.
+ * @return true if there was an edge, false once there are none left.
+ */
+bool ButtonEvents::read(ButtonEdge& edge, unsigned long currentMicros) {
+    ButtonEdge raw;
+    while (queue.pop(raw)) {
+        if (readDebounced(raw.button, raw.pressed, raw.timestampMicros, edge)) {
+            return true;
+        }
+    }
+
+    // If the queue overflowed, some edges were lost, so take the levels from the pins instead
+    unsigned long overflows = overflowCount.load(std::memory_order_acquire);
+    if (overflows != overflowsSeen) {
+        overflowsSeen = overflows;
+        for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+            if (readDebounced(button, !digitalRead(BUTTON_PINS[button]), currentMicros, edge)) {
+                return true;
+            }
+        }
+    }
+
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        unsigned long edgeMicros;
+        if (debouncers[button].settle(currentMicros, edgeMicros)) {
+            edge = {edgeMicros, button, debouncers[button].isPressed()};
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Feeds a raw level to a button's debouncer.
+ *
+ * @param button The button (BUTTON_INDEX_*).
+ * @param pressed The raw level.
+ * @param timestampMicros When the level was seen (us).
+ * @param edge Receives the debounced edge.
+ * @return true if the debounced level changed.
+ */
+bool ButtonEvents::readDebounced(uint8_t button, bool pressed, unsigned long timestampMicros, ButtonEdge& edge) {
+    unsigned long edgeMicros;
+    if (!debouncers[button].feed(pressed, timestampMicros, edgeMicros)) {
+        return false;
+    }
+    edge = {edgeMicros, button, pressed};
+    return true;
+}
+
+/**
+ * @brief Gets the debounced levels of the buttons, as of the last edge read.
+ *
+ * @return the pressed buttons (RAW_BUTTON_*).
+ */
+uint8_t ButtonEvents::getButtons() const {
+    uint8_t buttons = 0;
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        if (debouncers[button].isPressed()) {
+            buttons |= BUTTON_RAW_FLAGS[button];
+        }
+    }
+    return buttons;
+}
+
+/**
+ * @brief Gets the number of edges dropped because the queue was full.
+ *
+ * @return the overflow count.
+ */
+unsigned long ButtonEvents::getOverflowCount() const {
+    return overflowCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Switches the buttons from edge interrupts to light sleep wakeup (call before a light sleep).
+ *
+ * A wakeup pin is level triggered, which would keep interrupting while a button is held, so the
+ * edge interrupts are disabled until resume().
+ */
+void ButtonEvents::suspend() {
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        gpio_intr_disable((gpio_num_t)BUTTON_PINS[button]);
+        // The buttons are pulled up, so they wake the chip when pressed (low)
+        gpio_wakeup_enable((gpio_num_t)BUTTON_PINS[button], GPIO_INTR_LOW_LEVEL);
+    }
+}
+
+/**
+ * @brief Switches the buttons back to edge interrupts after a light sleep, queueing any level
+ * that changed while they were disabled (such as the press that woke the chip).
+ */
+void ButtonEvents::resume() {
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        gpio_wakeup_disable((gpio_num_t)BUTTON_PINS[button]);
+        gpio_set_intr_type((gpio_num_t)BUTTON_PINS[button], GPIO_INTR_ANYEDGE);
+    }
+    queueLevels();
+    for (uint8_t button = 0; button < BUTTON_COUNT; button++) {
+        gpio_intr_enable((gpio_num_t)BUTTON_PINS[button]);
+    }
+}
+
+#endif // BUTTON_INTERRUPTS
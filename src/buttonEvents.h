@@ -0,0 +1,64 @@
+/**
+ * @file buttonEvents.h
+ * @brief Reads the buttons with GPIO interrupts instead of polling them on every input update.
+ *
+ * Each button interrupt timestamps the new level and pushes it into a lock-free queue, so an edge is
+ * never missed between input updates and its time is known to the microsecond. The input task drains
+ * the queue through a debouncer per button. The interrupts are the only producer (they do not nest)
+ * and the input task is the only consumer.
+ */
+
+#ifndef BUTTON_EVENTS_H
+#define BUTTON_EVENTS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "spscQueue.h"
+#include "buttonGestures.h"
+
+#define BUTTON_INDEX_BLINK 0    // The blink button (RAW_BUTTON_BLINK)
+#define BUTTON_INDEX_BLINK_2 1  // The second blink button (RAW_BUTTON_BLINK_2)
+#define BUTTON_INDEX_POWER 2    // The power button (RAW_BUTTON_POWER)
+#define BUTTON_COUNT 3
+
+/**
+ * @brief A button level change and when it happened.
+ */
+struct ButtonEdge {
+    unsigned long timestampMicros;
+    uint8_t button;     // BUTTON_INDEX_*
+    uint8_t pressed;
+};
+
+class ButtonEvents {
+public:
+    ButtonEvents();
+
+    void begin();
+    bool read(ButtonEdge& edge, unsigned long currentMicros);
+    uint8_t getButtons() const;
+    unsigned long getOverflowCount() const;
+
+    void suspend();
+    void resume();
+
+    void onInterrupt(uint8_t button);
+
+private:
+    SpscQueue<ButtonEdge, BUTTON_EVENT_QUEUE_SIZE> queue;
+    bool interruptLevels[BUTTON_COUNT];         // The last level queued for each button (interrupt side)
+    std::atomic<unsigned long> overflowCount;   // Edges dropped because the queue was full (interrupt side)
+
+    ButtonDebouncer debouncers[BUTTON_COUNT];   // Consumer side, owned by read()
+    unsigned long overflowsSeen;
+
+    void queueLevels();
+    bool readDebounced(uint8_t button, bool pressed, unsigned long timestampMicros, ButtonEdge& edge);
+};
+
+#ifdef BUTTON_INTERRUPTS
+extern ButtonEvents buttonEvents;
+#endif
+
+#endif // BUTTON_EVENTS_H
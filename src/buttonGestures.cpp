@@ -0,0 +1,190 @@
+/**
+ * @file buttonGestures.cpp
+ * @brief Debouncing and press recognition for the buttons, driven by timestamped edges.
+ *
+ * Both classes take the time of each edge from the caller rather than reading the clock, so they
+ * work the same whether the edges come from the button interrupts or from polling the pins, and a
+ * replay recognises the same gestures as the bot did.
+ */
+
+#include "buttonGestures.h"
+
+#define BUTTON_DOUBLE_PRESS_MIN_MICROS ((unsigned long)BUTTON_DOUBLE_PRESS_MIN * 1000UL)
+#define BUTTON_DOUBLE_PRESS_MAX_MICROS ((unsigned long)BUTTON_DOUBLE_PRESS_MAX * 1000UL)
+#define BUTTON_LONG_PRESS_MICROS ((unsigned long)BUTTON_LONG_PRESS * 1000UL)
+
+/**
+ * @brief Constructs a new ButtonDebouncer object, released and ready to accept an edge straight away.
+ */
+ButtonDebouncer::ButtonDebouncer():
+    pressed(false),
+    pending(false),
+    acceptMicros(0UL - BUTTON_DEBOUNCE_MICROS),
+    pendingMicros(0)
+{}
+
+/**
+ * @brief Feeds a raw edge. An edge outside the debounce time of the last accepted one is accepted
+ * straight away; one inside it is held until settle() finds the contact has stopped bouncing.
+ *
+ * @param pressed The raw level after the edge.
+ * @param timestampMicros When the edge happened (us).
+ * @param edgeMicros Receives the time of the accepted edge.
+ * @return true if the debounced level changed.
+ */
+bool ButtonDebouncer::feed(bool pressed, unsigned long timestampMicros, unsigned long& edgeMicros) {
+    if (pressed == this->pressed) {
+        // Bounced back to the debounced level
+        pending = false;
+        return false;
+    }
+    if (timestampMicros - acceptMicros >= BUTTON_DEBOUNCE_MICROS) {
+        this->pressed = pressed;
+        pending = false;
+        acceptMicros = timestampMicros;
+        edgeMicros = timestampMicros;
+        return true;
+    }
+    pending = true;
+    pendingMicros = timestampMicros;
+    return false;
+}
+
+/**
+ * @brief Accepts a level that was held during the debounce time, once that time has passed.
+ *
+ * @param currentMicros The current time (us).
+ * @param edgeMicros Receives the time of the edge that set the level.
+ * @return true if the debounced level changed.
+ */
+bool ButtonDebouncer::settle(unsigned long currentMicros, unsigned long& edgeMicros) {
+    if (!pending || currentMicros - acceptMicros < BUTTON_DEBOUNCE_MICROS) {
+        return false;
+    }
+    pressed = !pressed;
+    pending = false;
+    acceptMicros = pendingMicros;
+    edgeMicros = pendingMicros;
+    return true;
+}
+
+/**
+ * @brief Gets the debounced level.
+ *
+ * @return true if the button is pressed.
+ */
+bool ButtonDebouncer::isPressed() const {
+    return pressed;
+}
+
+/**
+ * @brief Constructs a new ButtonGesture object.
+ */
+ButtonGesture::ButtonGesture():
+    pressed(false),
+    hasPressed(false),
+    completedDouble(false),
+    longReported(false),
+    singlePending(false),
+    pressMicros(0),
+    pressCount(0),
+    singlePressCount(0),
+    doublePressCount(0),
+    longPressCount(0)
+{}
+
+/**
+ * @brief Counts the gestures started or ended by a debounced edge.
+ *
+ * @param pressed The level after the edge.
+ * @param timestampMicros When the edge happened (us).
+ */
+void ButtonGesture::onEdge(bool pressed, unsigned long timestampMicros) {
+    if (pressed == this->pressed) {
+        return;
+    }
+    this->pressed = pressed;
+
+    if (!pressed) {
+        // A short press becomes a single press unless a second press follows in time
+        singlePending = !longReported && !completedDouble;
+        return;
+    }
+
+    unsigned long gapMicros = timestampMicros - pressMicros;
+    completedDouble = hasPressed && gapMicros >= BUTTON_DOUBLE_PRESS_MIN_MICROS && gapMicros <= BUTTON_DOUBLE_PRESS_MAX_MICROS;
+    if (completedDouble) {
+        doublePressCount++;
+    } else {
+        if (singlePending) {
+            // update() was not called between the release and this press
+            singlePressCount++;
+        }
+        pressCount++;
+    }
+    singlePending = false;
+    longReported = false;
+    hasPressed = true;
+    pressMicros = timestampMicros;
+}
+
+/**
+ * @brief Counts the gestures that are recognised by time passing rather than by an edge (long and single presses).
+ *
+ * @param currentMicros The current time (us).
+ */
+void ButtonGesture::update(unsigned long currentMicros) {
+    if (pressed && !longReported && currentMicros - pressMicros >= BUTTON_LONG_PRESS_MICROS) {
+        longPressCount++;
+        longReported = true;
+    }
+    if (singlePending && currentMicros - pressMicros > BUTTON_DOUBLE_PRESS_MAX_MICROS) {
+        singlePressCount++;
+        singlePending = false;
+    }
+}
+
+/**
+ * @brief Gets the debounced level.
+ *
+ * @return true if the button is pressed.
+ */
+bool ButtonGesture::isPressed() const {
+    return pressed;
+}
+
+/**
+ * @brief Gets the number of presses that did not complete a double press.
+ *
+ * @return the running press count.
+ */
+uint16_t ButtonGesture::getPressCount() const {
+    return pressCount;
+}
+
+/**
+ * @brief Gets the number of short presses that were not followed by a second press in time.
+ *
+ * @return the running single press count.
+ */
+uint16_t ButtonGesture::getSinglePressCount() const {
+    return singlePressCount;
+}
+
+/**
+ * @brief Gets the number of double presses.
+ *
+ * @return the running double press count.
+ */
+uint16_t ButtonGesture::getDoublePressCount() const {
+    return doublePressCount;
+}
+
+/**
+ * @brief Gets the number of presses held for at least BUTTON_LONG_PRESS.
+ *
+ * @return the running long press count.
+ */
+uint16_t ButtonGesture::getLongPressCount() const {
+    return longPressCount;
+}
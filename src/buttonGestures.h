@@ -0,0 +1,75 @@
+/**
+ * @file buttonGestures.h
+ * @brief Debouncing and press recognition for the buttons, driven by timestamped edges.
+ *
+ * Both classes take the time of each edge from the caller rather than reading the clock, so they
+ * work the same whether the edges come from the button interrupts or from polling the pins, and a
+ * replay recognises the same gestures as the bot did.
+ */
+
+#ifndef BUTTON_GESTURES_H
+#define BUTTON_GESTURES_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * @brief Debounces a button from its raw edges.
+ *
+ * The first edge is accepted straight away (so a press costs no debounce latency) and the contact is
+ * then ignored for the debounce time. If the contact ends up at a different level once that time has
+ * passed, the new level is accepted then, with the time of the edge that set it.
+ */
+class ButtonDebouncer {
+public:
+    ButtonDebouncer();
+
+    bool feed(bool pressed, unsigned long timestampMicros, unsigned long& edgeMicros);
+    bool settle(unsigned long currentMicros, unsigned long& edgeMicros);
+    bool isPressed() const;
+
+private:
+    bool pressed;                   // The debounced level
+    bool pending;                   // The raw level changed away from the debounced level while locked out
+    unsigned long acceptMicros;     // When the debounced level last changed
+    unsigned long pendingMicros;    // When the raw level last changed while locked out
+};
+
+/**
+ * @brief Recognises presses, double presses, single presses and long presses from debounced edges.
+ *
+ * Each gesture is published as a running count, like the InputSnapshot counts:
+ * - A press is counted as soon as the button goes down, unless it completes a double press.
+ * - A double press is a press that starts BUTTON_DOUBLE_PRESS_MIN to BUTTON_DOUBLE_PRESS_MAX after the previous one.
+ * - A single press is a short press with no second press within BUTTON_DOUBLE_PRESS_MAX, so it is only
+ *   known once that window has passed.
+ * - A long press is counted once the button has been held for BUTTON_LONG_PRESS.
+ */
+class ButtonGesture {
+public:
+    ButtonGesture();
+
+    void onEdge(bool pressed, unsigned long timestampMicros);
+    void update(unsigned long currentMicros);
+
+    bool isPressed() const;
+    uint16_t getPressCount() const;
+    uint16_t getSinglePressCount() const;
+    uint16_t getDoublePressCount() const;
+    uint16_t getLongPressCount() const;
+
+private:
+    bool pressed;
+    bool hasPressed;            // There has been a press to measure the double press gap from
+    bool completedDouble;       // The current press completed a double press
+    bool longReported;          // The current press has been counted as a long press
+    bool singlePending;         // A short press that may still turn out to be the start of a double press
+    unsigned long pressMicros;  // When the last press started
+
+    uint16_t pressCount;
+    uint16_t singlePressCount;
+    uint16_t doublePressCount;
+    uint16_t longPressCount;
+};
+
+#endif // BUTTON_GESTURES_H
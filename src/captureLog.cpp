@@ -0,0 +1,158 @@
+/**
+ * @file captureLog.cpp
+ * @brief The compact, delta-encoded log format for recorded raw inputs.
+ *
+ * A log is a CaptureHeader followed by one record per InputHandler update:
+ *  - a flags byte: the RAW_BUTTON_* levels in bits 0-2 and, in bits 3-5, which ADC inputs changed
+ *  - the time since the previous record (us), as a varint
+ *  - for each ADC input that changed, the difference from its previous value as a zigzag varint
+ */
+
+#include <string.h>
+#include "captureLog.h"
+
+/**
+ * @brief Writes an unsigned LEB128 varint.
+ *
+ * @param value The value.
+ * @param output Receives the bytes (up to 5).
+ * @return the number of bytes written.
+ */
+static size_t writeVarint(uint32_t value, uint8_t* output) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        output[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    output[length++] = value;
+    return length;
+}
+
+/**
+ * @brief Reads an unsigned LEB128 varint.
+ *
+ * @param data The bytes to read from.
+ * @param length The number of bytes available.
+ * @param value Receives the value.
+ * @return the number of bytes read, or 0 if the varint is truncated or too long.
+ */
+static size_t readVarint(const uint8_t* data, size_t length, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < length && i < 5; i++) {
+        value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Constructs a new CaptureEncoder object.
+ */
+CaptureEncoder::CaptureEncoder() {
+    reset(0);
+}
+
+/**
+ * @brief Starts a new log. The decoder starts from zero, so every timestamp is relative to startMicros.
+ *
+ * @param startMicros The time the log starts (us).
+ */
+void CaptureEncoder::reset(uint32_t startMicros) {
+    previousMicros = startMicros;
+    memset(&previousInputs, 0, sizeof(previousInputs));
+}
+
+/**
+ * @brief Encodes one update.
+ *
+ * @param timestampMicros When the inputs were read (us).
+ * @param inputs The raw inputs.
+ * @param output Receives the record (at least CAPTURE_MAX_RECORD_SIZE bytes).
+ * @return the record length.
+ */
+size_t CaptureEncoder::encode(uint32_t timestampMicros, const RawInputs& inputs, uint8_t* output) {
+    uint8_t flags = inputs.buttons & CAPTURE_FLAG_BUTTONS_MASK;
+    for (uint8_t input = 0; input < RAW_INPUT_ADC_COUNT; input++) {
+        if (inputs.adc[input] != previousInputs.adc[input]) {
+            flags |= 1 << (CAPTURE_FLAG_ADC_SHIFT + input);
+        }
+    }
+
+    size_t length = 0;
+    output[length++] = flags;
+    length += writeVarint(timestampMicros - previousMicros, output + length);
+
+    for (uint8_t input = 0; input < RAW_INPUT_ADC_COUNT; input++) {
+        if (flags & (1 << (CAPTURE_FLAG_ADC_SHIFT + input))) {
+            int32_t delta = (int32_t)inputs.adc[input] - (int32_t)previousInputs.adc[input];
+            length += writeVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31), output + length);
+        }
+    }
+
+    previousMicros = timestampMicros;
+    previousInputs = inputs;
+    return length;
+}
+
+/**
+ * @brief Constructs a new CaptureDecoder object.
+ */
+CaptureDecoder::CaptureDecoder() {
+    reset();
+}
+
+/**
+ * @brief Starts decoding a new log.
+ */
+void CaptureDecoder::reset() {
+    previousMicros = 0;
+    memset(&previousInputs, 0, sizeof(previousInputs));
+}
+
+/**
+ * @brief Decodes the next record.
+ *
+ * @param data The bytes to decode from.
+ * @param length The number of bytes available.
+ * @param timestampMicros Receives the time since the start of the log (us).
+ * @param inputs Receives the raw inputs.
+ * @return the number of bytes consumed, or 0 if the record is truncated or malformed.
+ */
+size_t CaptureDecoder::decode(const uint8_t* data, size_t length, uint32_t& timestampMicros, RawInputs& inputs) {
+    if (length == 0 || (data[0] >> (CAPTURE_FLAG_ADC_SHIFT + RAW_INPUT_ADC_COUNT)) != 0) {
+        return 0;
+    }
+
+    uint8_t flags = data[0];
+    size_t offset = 1;
+
+    uint32_t deltaMicros;
+    size_t used = readVarint(data + offset, length - offset, deltaMicros);
+    if (used == 0) {
+        return 0;
+    }
+    offset += used;
+
+    RawInputs decoded = previousInputs;
+    decoded.buttons = flags & CAPTURE_FLAG_BUTTONS_MASK;
+    for (uint8_t input = 0; input < RAW_INPUT_ADC_COUNT; input++) {
+        if (flags & (1 << (CAPTURE_FLAG_ADC_SHIFT + input))) {
+            uint32_t zigzag;
+            used = readVarint(data + offset, length - offset, zigzag);
+            if (used == 0) {
+                return 0;
+            }
+            offset += used;
+            int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            decoded.adc[input] = previousInputs.adc[input] + delta;
+        }
+    }
+
+    previousMicros += deltaMicros;
+    previousInputs = decoded;
+    timestampMicros = previousMicros;
+    inputs = decoded;
+    return offset;
+}
@@ -11,11 +11,138 @@
 // Uncomment the following line to enable debug output
 // #define SERIAL_DEBUG
 
+// Uncomment the following line to run the input, state and servo stages as separate FreeRTOS tasks
+// #define PIPELINED_TASKS
+
+// Uncomment the following line to read the buttons with timestamped GPIO interrupts instead of polling them (see buttonEvents.h)
+// #define BUTTON_INTERRUPTS
+
+// Uncomment the following line to send the servo frames from their own I2C bus task so no stage waits for the bus (see servoFrameQueue.h)
+// #define ASYNC_SERVO_OUTPUT
+
+// Uncomment the following line to stream binary telemetry frames over serial (decode with tools/telemetry_decode.py)
+// #define TELEMETRY_STREAM
+
+// Uncomment the following line to record the raw inputs to LittleFS for replay on the host (see inputCapture.h)
+// #define INPUT_CAPTURE
+
+// Uncomment the following line to seed the behaviour with a fixed value so it repeats every boot (otherwise it is seeded from the hardware RNG)
+// #define RNG_SEED 1
+
+// Uncomment the following line to scale the CPU clock with activity and light sleep while soft-powered off (see powerManager.h)
+// #define POWER_MANAGEMENT
+
+// Uncomment the following line to switch settled lid servos off and put the PCA9685 to sleep while soft-powered off (see servoPowerGate.h)
+// #define SERVO_POWER_GATING
+
+// Uncomment the following line to load the tuning settings from NVS and accept new ones over serial without reflashing (see runtimeConfig.h)
+// #define RUNTIME_CONFIG
+
+// Uncomment the following line to accept streamed gaze setpoints from a host over serial (remote control, see remoteControl.h)
+// #define REMOTE_CONTROL
+
+// Uncomment the following line to also accept remote control setpoints as Wi-Fi UDP datagrams (needs REMOTE_CONTROL, see remoteTransport.h)
+// #define REMOTE_UDP
+
+// Uncomment the following line to compile in the loop profiler (per-stage cycle histograms, see loopProfiler.h)
+// #define LOOP_PROFILER
+
 // Debug Config
 #define DEBUG_INTERVAL  100     // How often the debug information should be printed to the serial monitor (ms)
 #define DEBUG_STATE     0       // Output the state values to the serial monitor
 #define DEBUG_INPUT     0       // Output the input values to the serial monitor
 #define DEBUG_SERVOS    0       // Output the servo values to the serial monitor
+#define DEBUG_SCHEDULER 0       // Output the scheduler task timing to the serial monitor
+
+// Scheduler task periods (us)
+#define TASK_PERIOD_INPUT 1000                          // Sample the inputs at 1 kHz
+#define TASK_PERIOD_STATE 10000                         // Update the behaviour at 100 Hz
+#define TASK_PERIOD_SERVOS (1000000 / SERVO_PWM_FREQ)   // Write the servos once per PWM frame
+#define TASK_PERIOD_DEBUG (DEBUG_INTERVAL * 1000UL)     // Print the debug output every DEBUG_INTERVAL
+#define TASK_PERIOD_CONSOLE 100000                      // Check for serial console keys (profiler, capture) at 10 Hz
+#define TASK_PERIOD_CAPTURE 100000                      // Save the captured inputs to flash at 10 Hz
+#define TASK_PERIOD_TELEMETRY 10000                     // Stream a telemetry sample at 100 Hz (~4 KB/s, within 115200 baud)
+#define TASK_PERIOD_POWER 100000                        // Choose the power mode at 10 Hz
+#define TASK_PERIOD_REMOTE 1000                         // Check the serial console at 1 kHz instead when REMOTE_CONTROL is defined, so setpoints are not held in the UART
+
+// Pipelined task settings (when PIPELINED_TASKS is defined)
+// A stage must never run at a higher priority than the stage it reads its snapshot from
+#define PIPELINE_PRIORITY_INPUT 4       // FreeRTOS priority of the input sampling task
+#define PIPELINE_PRIORITY_STATE 3       // FreeRTOS priority of the behaviour task
+#define PIPELINE_PRIORITY_SERVOS 2      // FreeRTOS priority of the servo output task (the Arduino loop task runs at 1)
+#define PIPELINE_TASK_STACK_SIZE 4096   // Stack size of each pipelined task (bytes)
+
+// I2C bus task settings (when ASYNC_SERVO_OUTPUT is defined)
+// The bus task spends its transactions blocked in the I2C driver and never waits for a stage, so it can run above them
+#define I2C_BUS_TASK_PRIORITY 5         // FreeRTOS priority of the I2C bus task
+
+// Button settings
+#define BUTTON_DOUBLE_PRESS_MIN 100     // Shortest time between two presses that counts as a double press (ms)
+#define BUTTON_DOUBLE_PRESS_MAX 500     // Longest time between two presses that counts as a double press (ms)
+#define BUTTON_LONG_PRESS 1000          // How long a button must be held to count as a long press (ms)
+#define BUTTON_DEBOUNCE_MICROS 5000     // Edges this soon after an accepted edge are contact bounce (us, when BUTTON_INTERRUPTS is defined)
+#define BUTTON_EVENT_QUEUE_SIZE 32      // Button edges queued by the interrupts (power of two, when BUTTON_INTERRUPTS is defined)
+
+// Telemetry settings (when TELEMETRY_STREAM is defined)
+#define TELEMETRY_BUFFER_SIZE 1024  // Bytes queued for the UART (power of two). Frames that do not fit are dropped
+
+// Input capture settings (when INPUT_CAPTURE is defined)
+#define CAPTURE_PATH "/capture.bin"                 // The capture of this boot
+#define CAPTURE_PREVIOUS_PATH "/capture.prev.bin"   // The capture of the previous boot
+#define CAPTURE_BUFFER_SIZE 4096        // Bytes queued for flash (power of two). Recording stops if it overruns
+#define CAPTURE_MAX_BYTES 1048576       // Stop recording at this size (~3 minutes of input at 1 kHz)
+#define CAPTURE_SYNC_INTERVAL 1000      // How often the capture file is committed to flash (ms)
+#define CAPTURE_DUMP_KEY 'd'            // Send this character over serial to stop recording and send the capture
+#define CAPTURE_DUMP_PREVIOUS_KEY 'D'   // Send this character over serial to send the previous boot's capture
+
+// Power management settings (when POWER_MANAGEMENT is defined)
+// Below 80 MHz the ESP32-C3 also slows the APB clock that times I2C and the UART, so 80 MHz is the floor
+#define POWER_CPU_FREQ_ACTIVE 160           // CPU clock under manual or remote control, or while the eyes move (MHz)
+#define POWER_CPU_FREQ_IDLE 80              // CPU clock while autonomous and the eyes are still (MHz)
+#define POWER_CPU_FREQ_OFF 80               // CPU clock while soft-powered off (MHz)
+#define POWER_IDLE_DELAY 500                // How long the eyes must be still before dropping to the idle clock (ms)
+#define POWER_OFF_TASK_PERIOD 20000         // Input and state task period while soft-powered off, leaving time to light sleep (us)
+#define POWER_LIGHT_SLEEP_MIN_MICROS 2000   // Only light sleep if the next task is at least this far away (us)
+#define POWER_CURRENT_AWAKE_BASE_UA 11000   // Estimated ESP32-C3 current while awake, fixed part (uA)
+#define POWER_CURRENT_AWAKE_PER_MHZ_UA 100  // Estimated ESP32-C3 current while awake, per MHz of CPU clock (uA)
+#define POWER_CURRENT_LIGHT_SLEEP_UA 350    // Estimated ESP32-C3 current in light sleep (uA)
+#define BATTERY_CAPACITY_MAH 2400           // Battery capacity, for the battery life estimate (mAh)
+#define POWER_REPORT_KEY 'e'                // Send this character over serial to print the energy report (and the servo power report)
+
+// Runtime config settings (when RUNTIME_CONFIG is defined)
+// The settings listed in RuntimeConfigValues (runtimeConfig.h) are then only defaults, used until a valid config is stored
+#define RUNTIME_CONFIG_NAMESPACE "blinkenstein"   // NVS namespace
+#define RUNTIME_CONFIG_KEY "config"               // NVS key of the config blob
+#define RUNTIME_CONFIG_SWAP_GRACE 1000          // Shortest time between two config changes, so no stage is still reading the buffer that is reused (ms)
+#define RUNTIME_CONFIG_RECEIVE_TIMEOUT 1000     // Give up on an upload that has not finished in this time (ms)
+#define RUNTIME_CONFIG_PRINT_KEY 'c'            // Send this character over serial to print the active config
+#define RUNTIME_CONFIG_UPLOAD_KEY 'C'           // Send this character over serial, followed by a config frame, to apply and store a new config
+#define RUNTIME_CONFIG_RESET_KEY 'x'            // Send this character over serial to erase the stored config and go back to the defaults
+
+// Remote control settings (when REMOTE_CONTROL is defined)
+#define REMOTE_QUEUE_SIZE 16                // Setpoints queued from the console task to the state task (power of two)
+#define REMOTE_JITTER_BUFFER_SIZE 8         // Setpoints held until they are due
+#define REMOTE_JITTER_DELAY 20000           // How long after its fastest possible arrival a setpoint is played, to smooth uneven delivery (us)
+#define REMOTE_JITTER_WINDOW 100            // Setpoints per window when tracking the fastest arrival (~1 s at 100 Hz)
+#define REMOTE_CONTROL_TIMEOUT 500          // Hand back to autonomous control when no setpoint has been played for this long (ms)
+#define REMOTE_CONSOLE_LOCKOUT 1000         // Ignore console keys for this long after the last frame byte, so a damaged frame is never read as keys (ms)
+#define REMOTE_STREAM_IDLE 1000             // Keep sending reports over a link until this long after its last frame (ms)
+#define REMOTE_REPORT_INTERVAL 1000         // How often the latency report frame is sent while setpoints are streaming (ms)
+#define REMOTE_REPORT_KEY 'l'               // Send this character over serial to print the remote control latency report
+
+// Remote UDP settings (when REMOTE_UDP is defined)
+// Each datagram carries one frame, encoded as on the serial port
+#define REMOTE_WIFI_SSID "blinkenstein"     // Wi-Fi network to join
+#define REMOTE_WIFI_PASSWORD ""             // Its password
+#define REMOTE_UDP_PORT 4210                // UDP port the setpoints are sent to (on 127.0.0.1 in the native build)
+#define REMOTE_UDP_MAX_PACKETS 8            // Most datagrams read per console task run, so a flood cannot stall the loop
+
+// Loop profiler settings (when LOOP_PROFILER is defined)
+#define PROFILER_REPORT_KEY 'p'     // Send this character over serial to print the profiler report
+#define PROFILER_RESET_KEY 'r'      // Send this character over serial to clear the profiler histograms
+#define PROFILER_FILTER_BENCH_KEY 'f'   // Send this character over serial to time the input filters (blocks the loop for a few ms)
+#define PROFILER_BENCH_SAMPLES 256  // Samples run through each filter per benchmark run
+#define PROFILER_BENCH_RUNS 3       // Benchmark runs per filter, of which the fastest is reported
 
 // ESP Pin definitions
 #define PIN_POWER_BUTTON 6      // Digital pin for Software Power (when charging, the ESP will be powered on, sotware power state prevents autonomous control)
@@ -29,8 +156,27 @@
 
 // Servo PWM settings
 #define SERVO_I2C_ADDRESS 0x40  // Default PCA9685 I2C address
+#define SERVO_BOARD_COUNT 1                     // Number of PCA9685 boards (1 -> 15), each driving one eye rig on the SERVO_CHANNEL_* channels
+#define SERVO_BOARD_ADDRESSES SERVO_I2C_ADDRESS // The I2C address of each board, comma separated (e.g. SERVO_I2C_ADDRESS, 0x41)
 #define SERVO_PWM_FREQ 60       // Analog servos run at ~60 Hz
 
+// Servo power gating (the gating needs SERVO_POWER_GATING, the current estimate is always kept)
+#define SERVO_SETTLE_TIME 300                   // How long after its last new pulse a servo is assumed to have reached it (ms)
+#define SERVO_LID_OFF_DELAY 1000                // How long a lid pulse must be unchanged before its channel is switched off (ms)
+#define SERVO_CURRENT_MOVING_UA 150000          // Estimated current of a servo while it moves (uA)
+#define SERVO_CURRENT_HOLDING_UA 10000          // Estimated current of a driven servo holding its position (uA)
+#define SERVO_CURRENT_PCA9685_UA 6000           // Estimated current of the PCA9685 while awake (uA)
+#define SERVO_CURRENT_PCA9685_SLEEP_UA 2        // Estimated current of the PCA9685 in SLEEP mode (uA)
+
+// I2C link supervision
+#define I2C_HEALTH_CHECK_INTERVAL 1000  // How often to probe the PCA9685 while the link is healthy (ms)
+#define I2C_REINIT_BACKOFF_MIN 50       // Initial delay before retrying a failed reinitialization (ms)
+#define I2C_REINIT_BACKOFF_MAX 5000     // Maximum delay between reinitialization attempts (ms)
+
+// Pulse width limits checked against every servo calibration at compile time
+#define SERVO_PULSE_LIMIT_MIN_US 500
+#define SERVO_PULSE_LIMIT_MAX_US 2500
+
 // Minimum and maximum pulse width for servos
 #define SERVO_PAN_MIN 270                   // Lower = more left, Higher = more right
 #define SERVO_PAN_MAX 520                   // Lower = more left, Higher = more right
@@ -45,6 +191,23 @@
 #define SERVO_RIGHT_LID_BOTTOM_OPEN 250     // Lower = more open, Higher = more closed
 #define SERVO_RIGHT_LID_BOTTOM_CLOSED 500   // Lower = more open, Higher = more closed
 
+// Per-board trim of the pulses above, so eye rigs that are not mechanically identical can each be calibrated
+// One row per board (SERVO_BOARD_ADDRESSES order) of pan, tilt, left lid top, left lid bottom, right lid top, right lid bottom (ticks)
+// Boards without a row use the pulses above unchanged
+#define SERVO_RIG_TRIM_AT_STATE_MIN {{0, 0, 0, 0, 0, 0}}  // Added to the pulse at the lowest state (-100 pan/tilt, 0 lids)
+#define SERVO_RIG_TRIM_AT_STATE_MAX {{0, 0, 0, 0, 0, 0}}  // Added to the pulse at the highest state (100)
+
+// Servo motion profiles (MOTION_TRAPEZOIDAL or MOTION_SCURVE)
+// Velocities are in state units per second, accelerations in state units per second per second
+#define MOTION_PROFILE_LOOK MOTION_SCURVE       // Profile used by the pan and tilt servos
+#define MOTION_PROFILE_LIDS MOTION_TRAPEZOIDAL  // Profile used by the eyelid servos
+#define MOTION_PAN_MAX_VELOCITY 800             // Full pan sweep (200 units) in ~0.3s
+#define MOTION_PAN_MAX_ACCELERATION 8000
+#define MOTION_TILT_MAX_VELOCITY 600
+#define MOTION_TILT_MAX_ACCELERATION 6000
+#define MOTION_LID_MAX_VELOCITY 1500            // Lids need to be quick enough to blink within AUTO_BLINK_DURATION
+#define MOTION_LID_MAX_ACCELERATION 30000
+
 // Servo PWM channels
 #define SERVO_CHANNEL_PAN 4
 #define SERVO_CHANNEL_TILT 5
@@ -53,33 +216,54 @@
 #define SERVO_CHANNEL_RIGHT_LID_TOP 10
 #define SERVO_CHANNEL_RIGHT_LID_BOTTOM 11
 
-// Smoothing factor for exponential moving average (0 < alpha <= 1)
+// ADC sampling
+// Uncomment the following line to sample the analog inputs with the ADC in continuous (DMA) mode instead of analogRead()
+// #define ADC_CONTINUOUS_SAMPLING
+#define ADC_CONTINUOUS_SAMPLE_FREQ 48000    // Total conversions per second across all analog inputs (611 -> 83333 Hz)
+#define ADC_OVERSAMPLE_COUNT 16             // Conversions averaged into each filtered value (per input)
+#define ADC_DMA_BUFFER_SIZE 1024            // Size of the DMA ring buffer the driver fills in the background (bytes)
+
+// Smoothing factor for exponential moving average (0 < alpha <= 1, converted to Q15 at compile time)
 #define SMOOTHING_FACTOR 0.05
 
+// Analog input filtering (applied to the joystick axes and the eyelid pot)
+#define INPUT_MEDIAN_WINDOW 3                   // Number of samples in the spike rejecting median filter
+#define INPUT_FILTER_MIN_CUTOFF 1000            // One Euro filter cutoff when the input is still (mHz). Lower = less jitter
+#define INPUT_FILTER_BETA 2                     // One Euro filter cutoff increase with speed (mHz per ADC unit per second). Higher = less lag
+#define INPUT_FILTER_DERIVATIVE_CUTOFF 1000     // One Euro filter cutoff for the speed estimate (mHz)
+
 // Compensate for joystick drift (the joystick may not center at 0)
 #define JOYSTICK_DRIFT_ADUSTMENT_X 100  // -2048 -> 2048
 #define JOYSTICK_DRIFT_ADUSTMENT_Y 125  // -2048 -> 2048
 #define JOYSTICK_DEADZONE 100           // (0 -> 2048) Any value below this threshold will be ignored
+#define JOYSTICK_DEADZONE_HYSTERESIS 30 // How far past the deadzone the joystick must move to leave it again
 
 // When should manual control be enabled
 #define MANUAL_CONTROL_ENABLED_DEFAULT 0         // Enable manual control by default
-#define MANUAL_CONTROL_INTERRUPT_THRESHOLD 1000  // What change in value on the analog inputs will trigger manual control
 #define MANUAL_CONTROL_TIMEOUT 10000             // How long to wait before reverting to autonomous control (ms)
 
+// Manual takeover detection, per median filtered analog input (ADC units). Keep the displacements above the noise at rest
+#define TAKEOVER_JOYSTICK_DISPLACEMENT 64       // How far a joystick axis must move from where it was last touched
+#define TAKEOVER_POT_DISPLACEMENT 64            // How far the eyelid pot must move from where it was last touched
+#define TAKEOVER_DRIFT_WINDOW 1000              // Input samples averaged to measure drift (1 s at 1 kHz)
+#define TAKEOVER_DRIFT_VELOCITY 16              // A change between window averages this large is a person, not drift (the anchor stops following)
+#define TAKEOVER_DRIFT_RELEASE_VELOCITY 8       // The anchor follows again once the change between window averages falls below this
+
 #define AUTO_POWER_OFF_TIMEOUT 300000            // How long to wait before powering down the bot (ms) due to inactivity
 
-#define AUTO_UPDATE_INTERVAL 100               // How often the autonomous control should consider changing the states (ms)
+#define AUTO_UPDATE_INTERVAL 100               // The period the AUTO_CHANCE_* settings are the chance of happening within (ms)
 #define AUTO_MAX_CHANCE 1000                   // The maximum chance value for random events
+// #define PRNG_PCG32                          // Draw the behaviour from PCG32 instead of xoshiro128** (see randomGenerator.h)
 #define AUTO_CHANCE_OF_BLINK 15                // The chance of performing a blink (0 -> AUTO_MAX_CHANCE)
 #define AUTO_CHANCE_OF_EYELID_CHANGE 10        // The chance of the eyelids changing (0 -> AUTO_MAX_CHANCE)
 #define AUTO_CHANCE_OF_MAJOR_LOOK_CHANGE 20    // The chance of the eyeballs changing direction in a large way (0 -> AUTO_MAX_CHANCE)
-#define AUTO_CHANCE_OF_LOOK_RETURN_CENTRE 100  // The chance of the eyeballs returning to the centre (0 -> AUTO_MAX_CHANCE)
+#define AUTO_CHANCE_OF_LOOK_RETURN_CENTRE 100  // The chance of a major look change returning to the centre (0 -> AUTO_MAX_CHANCE)
 #define AUTO_CHANCE_OF_BLINK_WHILE_LOOK 500    // The chance of blinking while looking around (0 -> AUTO_MAX_CHANCE)
 #define AUTO_SQUINT_POSITION_COUNT 5           // The number of eyelid squint positions to choose from
 #define AUTO_LOOK_PAN_POSITION_COUNT 7         // The number of eye pan positions to choose from
 #define AUTO_LOOK_TILT_POSITION_COUNT 5        // The number of eye tilt positions to choose from
 #define AUTO_BLINK_DURATION 150                // How long the blink should last (when under autonomous control) (ms)
-#define AUTO_CHANCE_OF_LOOK_TWITCH 10          // The chance of the eyeballs changing direction slightly to emulate realism (0 -> AUTO_MAX_CHANCE)
+#define AUTO_LOOK_TWITCH_INTERVAL 1000         // The average time between the eyeballs changing direction slightly to emulate realism (ms)
 #define AUTO_LOOK_TWITCH_AMOUNT 15             // The amount of twitch to apply to the eyeballs (0 -> 100)
 
 // Define auto positions
@@ -87,8 +271,10 @@ const int AUTO_SQUINT_POSITIONS[AUTO_SQUINT_POSITION_COUNT] = {10, 35, 50, 65, 1
 const int AUTO_LOOK_PAN_POSITIONS[AUTO_LOOK_PAN_POSITION_COUNT] = {-100, -75, -30, 0, 30, 75, 100};
 const int AUTO_LOOK_TILT_POSITIONS[AUTO_LOOK_TILT_POSITION_COUNT] = {-90, -50, 0, 50, 90};
 
-// Prevent the pupil from be obscured by the eyelids
+// Prevent the pupil from be obscured by the eyelids (see gazeLidModel.h)
+// A lid below PUPIL_REVEAL_LID_MAX_AMOUNT opens by up to MAX - MIN as the gaze turns fully towards it
 #define PUPIL_REVEAL_LID_MIN_AMOUNT 20
 #define PUPIL_REVEAL_LID_MAX_AMOUNT 58
+#define PUPIL_REVEAL_PAN_GAIN 25        // How much more the lids open when also looking fully to the side (%, 0 = follow the tilt only)
 
 #endif // CONFIG_H
\ No newline at end of file
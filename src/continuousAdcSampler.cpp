@@ -0,0 +1,161 @@
+/**
+ * @file continuousAdcSampler.cpp
+ * @brief Samples the analog inputs with the ESP32-C3 ADC in continuous (DMA) mode.
+ *
+ * The ADC digital controller converts every analog input in turn at ADC_CONTINUOUS_SAMPLE_FREQ and
+ * the driver DMAs the results into a ring buffer in the background. poll() drains whatever has
+ * arrived without blocking, averages ADC_OVERSAMPLE_COUNT conversions per input and keeps the
+ * latest decimated value, so read() is O(1).
+ *
+ * analogRead() must not be used on ADC1 while continuous sampling is running.
+ */
+
+#include "continuousAdcSampler.h"
+
+#ifdef ESP_PLATFORM
+
+/**
+ * @brief Constructs a new ContinuousAdcSampler object.
+ */
+ContinuousAdcSampler::ContinuousAdcSampler():
+    conversionCount(0),
+    overflowCount(0)
+{
+    for (uint8_t channel = 0; channel < SOC_ADC_MAX_CHANNEL_NUM; channel++) {
+        channelInputs[channel] = -1;
+    }
+    for (uint8_t input = 0; input < ADC_INPUT_COUNT; input++) {
+        sums[input] = 0;
+        counts[input] = 0;
+        values[input] = 0;
+    }
+}
+
+/**
+ * @brief Configures the ADC digital controller to convert every analog input in a repeating pattern and starts it.
+ *
+ * @return true if continuous sampling started, false otherwise.
+ */
+bool ContinuousAdcSampler::begin() {
+    uint32_t channelMask = 0;
+    adc_digi_pattern_config_t pattern[ADC_INPUT_COUNT] = {};
+    for (uint8_t input = 0; input < ADC_INPUT_COUNT; input++) {
+        int8_t channel = digitalPinToAnalogChannel(ADC_INPUT_PINS[input]);
+        if (channel < 0 || channel >= SOC_ADC_MAX_CHANNEL_NUM) {
+            return false;
+        }
+        channelInputs[channel] = input;
+        channelMask |= (1 << channel);
+
+        pattern[input].atten = ADC_ATTEN_DB_11;
+        pattern[input].channel = channel;
+        pattern[input].unit = 0; // ADC1
+        pattern[input].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_digi_init_config_t initConfig = {};
+    initConfig.max_store_buf_size = ADC_DMA_BUFFER_SIZE;
+    initConfig.conv_num_each_intr = ADC_READ_CHUNK_SIZE;
+    initConfig.adc1_chan_mask = channelMask;
+    initConfig.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&initConfig) != ESP_OK) {
+        return false;
+    }
+
+    adc_digi_configuration_t digitalConfig = {};
+    digitalConfig.conv_limit_en = false;
+    digitalConfig.conv_limit_num = 250;
+    digitalConfig.pattern_num = ADC_INPUT_COUNT;
+    digitalConfig.adc_pattern = pattern;
+    digitalConfig.sample_freq_hz = ADC_CONTINUOUS_SAMPLE_FREQ;
+    digitalConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    digitalConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&digitalConfig) != ESP_OK) {
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    return adc_digi_start() == ESP_OK;
+}
+
+/**
+ * @brief Drains the conversions the DMA has completed since the last poll without waiting for more.
+ */
+void ContinuousAdcSampler::poll() {
+    uint8_t buffer[ADC_READ_CHUNK_SIZE];
+
+    for (uint8_t reads = 0; reads < ADC_MAX_READS_PER_POLL; reads++) {
+        uint32_t length = 0;
+        esp_err_t result = adc_digi_read_bytes(buffer, sizeof(buffer), &length, 0);
+        if (result == ESP_ERR_INVALID_STATE) {
+            // The ring buffer filled up before it was drained, the data returned is still valid
+            overflowCount++;
+        } else if (result != ESP_OK) {
+            return;
+        }
+
+        for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; offset += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t* conversion = reinterpret_cast<const adc_digi_output_data_t*>(&buffer[offset]);
+            if (conversion->type2.unit == 0) {
+                processConversion(conversion->type2.channel, conversion->type2.data);
+            }
+        }
+
+        if (length < sizeof(buffer)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Accumulates a conversion and publishes the average once ADC_OVERSAMPLE_COUNT conversions have been collected.
+ *
+ * @param channel The ADC1 channel that was converted.
+ * @param data The raw conversion result (0 -> 4095).
+ */
+void ContinuousAdcSampler::processConversion(uint8_t channel, uint16_t data) {
+    if (channel >= SOC_ADC_MAX_CHANNEL_NUM || channelInputs[channel] < 0) {
+        return;
+    }
+
+    uint8_t input = channelInputs[channel];
+    sums[input] += data;
+    counts[input]++;
+    conversionCount++;
+
+    if (counts[input] >= ADC_OVERSAMPLE_COUNT) {
+        values[input] = sums[input] / counts[input];
+        sums[input] = 0;
+        counts[input] = 0;
+    }
+}
+
+/**
+ * @brief Gets the latest averaged value of an analog input.
+ *
+ * @param input The analog input index (ADC_INPUT_*).
+ * @return the latest value (0 -> 4095).
+ */
+int ContinuousAdcSampler::read(uint8_t input) const {
+    return values[input];
+}
+
+/**
+ * @brief Gets the number of conversions processed.
+ *
+ * @return the number of conversions.
+ */
+unsigned long ContinuousAdcSampler::getConversionCount() const {
+    return conversionCount;
+}
+
+/**
+ * @brief Gets the number of times the DMA ring buffer overflowed before it was drained.
+ *
+ * @return the number of overflows.
+ */
+unsigned long ContinuousAdcSampler::getOverflowCount() const {
+    return overflowCount;
+}
+
+#endif // ESP_PLATFORM
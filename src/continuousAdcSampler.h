@@ -0,0 +1,49 @@
+/**
+ * @file continuousAdcSampler.h
+ * @brief Samples the analog inputs with the ESP32-C3 ADC in continuous (DMA) mode.
+ *
+ * The ADC digital controller converts every analog input in turn at ADC_CONTINUOUS_SAMPLE_FREQ and
+ * the driver DMAs the results into a ring buffer in the background. poll() drains whatever has
+ * arrived without blocking, averages ADC_OVERSAMPLE_COUNT conversions per input and keeps the
+ * latest decimated value, so read() is O(1).
+ *
+ * analogRead() must not be used on ADC1 while continuous sampling is running.
+ */
+
+#ifndef CONTINUOUS_ADC_SAMPLER_H
+#define CONTINUOUS_ADC_SAMPLER_H
+
+#ifdef ESP_PLATFORM
+
+#include <driver/adc.h>
+#include "adcSampler.h"
+
+#define ADC_READ_CHUNK_SIZE 256     // Bytes pulled from the DMA ring buffer per read
+#define ADC_MAX_READS_PER_POLL 4    // Upper bound on the reads made by a single poll()
+
+class ContinuousAdcSampler : public AdcSampler {
+public:
+    ContinuousAdcSampler();
+
+    bool begin() override;
+    void poll() override;
+    int read(uint8_t input) const override;
+
+    unsigned long getConversionCount() const;
+    unsigned long getOverflowCount() const;
+
+private:
+    int8_t channelInputs[SOC_ADC_MAX_CHANNEL_NUM];
+    uint32_t sums[ADC_INPUT_COUNT];
+    uint16_t counts[ADC_INPUT_COUNT];
+    int values[ADC_INPUT_COUNT];
+
+    unsigned long conversionCount;
+    unsigned long overflowCount;
+
+    void processConversion(uint8_t channel, uint16_t data);
+};
+
+#endif // ESP_PLATFORM
+
+#endif // CONTINUOUS_ADC_SAMPLER_H
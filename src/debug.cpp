@@ -11,33 +11,39 @@
 #include "servoController.h"
 #include "inputHandler.h"
 #include "stateManager.h"
+#include "scheduler.h"
+#include "periodicTask.h"
 
 #ifdef SERIAL_DEBUG
-unsigned long previousDebugMillis;
-
 /**
  * @brief Prints the current debug values for the application.
+ *
+ * This runs as a scheduler task every DEBUG_INTERVAL.
  */
 void printDebugValues() {
-    unsigned long currentMillis = millis();
-    if (currentMillis - previousDebugMillis >= DEBUG_INTERVAL) {
-        previousDebugMillis = currentMillis;
+    #if (DEBUG_INPUT == 1)
+    inputHandler.printDebugValues();
+    #endif
 
-        #if (DEBUG_INPUT == 1)
-        inputHandler.printDebugValues();
-        #endif
+    #if (DEBUG_STATE == 1)
+    stateManager.printDebugValues();
+    #endif
 
-        #if (DEBUG_STATE == 1)
-        stateManager.printDebugValues();
-        #endif
+    #if (DEBUG_SERVOS == 1)
+    servoController.printDebugValues();
+    #endif
 
-        #if (DEBUG_SERVOS == 1)
-        servoController.printDebugValues();
-        #endif
+    #if (DEBUG_SCHEDULER == 1)
+    scheduler.printDebugValues();
+    #ifdef PIPELINED_TASKS
+    printTaskDebugValues(inputTask.getStats());
+    printTaskDebugValues(stateTask.getStats());
+    printTaskDebugValues(servoTask.getStats());
+    #endif
+    #endif
 
-        #if (DEBUG_INPUT == 1 || DEBUG_STATE == 1 || DEBUG_SERVOS == 1)
-        Serial.println();
-        #endif
-    }
+    #if (DEBUG_INPUT == 1 || DEBUG_STATE == 1 || DEBUG_SERVOS == 1 || DEBUG_SCHEDULER == 1)
+    Serial.println();
+    #endif
 }
 #endif
\ No newline at end of file
@@ -14,7 +14,6 @@
 
 #ifdef SERIAL_DEBUG
 
-extern unsigned long previousDebugMillis;
 void printDebugValues();
 
 #endif // SERIAL_DEBUG
@@ -0,0 +1,142 @@
+/**
+ * @file frameCodec.cpp
+ * @brief Framing for binary messages over a byte stream: CRC-16 plus COBS encoding.
+ *
+ * A frame on the wire is a delimiter, the COBS-encoded payload followed by its CRC-16/CCITT-FALSE
+ * (little endian), and another delimiter. COBS removes every 0x00 from the encoded bytes, so a
+ * receiver can always resynchronise on the next delimiter and the CRC rejects anything damaged or
+ * interleaved with other serial output.
+ */
+
+#include "frameCodec.h"
+
+#define FRAME_MAX_PAYLOAD 250   // Frames stay within a single COBS block
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021) one nibble at a time, so the table costs 32 bytes
+static const uint16_t CRC16_NIBBLE_TABLE[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/**
+ * @brief Calculates a CRC-16/CCITT-FALSE.
+ *
+ * @param data The bytes to check.
+ * @param length The number of bytes.
+ * @param crc The CRC so far (CRC16_INITIAL to start a new CRC).
+ * @return the CRC.
+ */
+uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ CRC16_NIBBLE_TABLE[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS-encodes a block of bytes so the output contains no zero bytes.
+ *
+ * @param input The bytes to encode.
+ * @param length The number of bytes.
+ * @param output Receives the encoded bytes (at least COBS_ENCODED_SIZE(length) bytes).
+ * @return the number of encoded bytes.
+ */
+size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output) {
+    size_t codeIndex = 0;
+    size_t outputIndex = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (input[i] != 0) {
+            output[outputIndex++] = input[i];
+            code++;
+        }
+        if (input[i] == 0 || code == 0xFF) {
+            output[codeIndex] = code;
+            codeIndex = outputIndex++;
+            code = 1;
+        }
+    }
+    output[codeIndex] = code;
+    return outputIndex;
+}
+
+/**
+ * @brief Decodes a COBS-encoded block (without delimiters).
+ *
+ * @param input The encoded bytes.
+ * @param length The number of encoded bytes.
+ * @param output Receives the decoded bytes (at least length bytes).
+ * @return the number of decoded bytes, or 0 if the input is malformed.
+ */
+size_t cobsDecode(const uint8_t* input, size_t length, uint8_t* output) {
+    size_t inputIndex = 0;
+    size_t outputIndex = 0;
+
+    while (inputIndex < length) {
+        uint8_t code = input[inputIndex++];
+        if (code == 0 || inputIndex + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (input[inputIndex] == 0) {
+                return 0;
+            }
+            output[outputIndex++] = input[inputIndex++];
+        }
+        if (code != 0xFF && inputIndex < length) {
+            output[outputIndex++] = 0;
+        }
+    }
+    return outputIndex;
+}
+
+/**
+ * @brief Builds a complete frame: delimiter, COBS(payload + CRC), delimiter.
+ *
+ * @param payload The payload.
+ * @param length The payload length (at most 250 bytes).
+ * @param output Receives the frame (at least FRAME_ENCODED_SIZE(length) bytes).
+ * @return the number of bytes in the frame, or 0 if the payload is too long.
+ */
+size_t frameEncode(const uint8_t* payload, size_t length, uint8_t* output) {
+    if (length > FRAME_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    uint8_t raw[FRAME_MAX_PAYLOAD + 2];
+    for (size_t i = 0; i < length; i++) {
+        raw[i] = payload[i];
+    }
+    uint16_t crc = crc16(payload, length);
+    raw[length] = crc & 0xFF;
+    raw[length + 1] = crc >> 8;
+
+    output[0] = FRAME_DELIMITER;
+    size_t encodedLength = cobsEncode(raw, length + 2, output + 1);
+    output[encodedLength + 1] = FRAME_DELIMITER;
+    return encodedLength + 2;
+}
+
+/**
+ * @brief Decodes and checks the bytes received between two delimiters.
+ *
+ * @param encoded The encoded bytes (without delimiters).
+ * @param length The number of encoded bytes.
+ * @param payload Receives the payload (at least length bytes).
+ * @return the payload length, or 0 if the frame is malformed or fails its CRC.
+ */
+size_t frameDecode(const uint8_t* encoded, size_t length, uint8_t* payload) {
+    size_t decodedLength = cobsDecode(encoded, length, payload);
+    if (decodedLength < 3) {
+        return 0;
+    }
+
+    size_t payloadLength = decodedLength - 2;
+    uint16_t crc = payload[payloadLength] | (payload[payloadLength + 1] << 8);
+    if (crc16(payload, payloadLength) != crc) {
+        return 0;
+    }
+    return payloadLength;
+}
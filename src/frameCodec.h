@@ -0,0 +1,32 @@
+/**
+ * @file frameCodec.h
+ * @brief Framing for binary messages over a byte stream: CRC-16 plus COBS encoding.
+ *
+ * A frame on the wire is a delimiter, the COBS-encoded payload followed by its CRC-16/CCITT-FALSE
+ * (little endian), and another delimiter. COBS removes every 0x00 from the encoded bytes, so a
+ * receiver can always resynchronise on the next delimiter and the CRC rejects anything damaged or
+ * interleaved with other serial output.
+ */
+
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_DELIMITER 0x00
+#define CRC16_INITIAL 0xFFFF
+
+// Worst-case sizes for a payload of n bytes
+#define COBS_ENCODED_SIZE(n) ((n) + (n) / 254 + 1)
+#define FRAME_ENCODED_SIZE(n) (COBS_ENCODED_SIZE((n) + 2) + 2)
+
+uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = CRC16_INITIAL);
+
+size_t cobsEncode(const uint8_t* input, size_t length, uint8_t* output);
+size_t cobsDecode(const uint8_t* input, size_t length, uint8_t* output);
+
+size_t frameEncode(const uint8_t* payload, size_t length, uint8_t* output);
+size_t frameDecode(const uint8_t* encoded, size_t length, uint8_t* payload);
+
+#endif // FRAME_CODEC_H
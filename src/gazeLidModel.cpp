@@ -0,0 +1,102 @@
+/**
+ * @file gazeLidModel.cpp
+ * @brief How far the eyelids open to keep the pupil visible, for any gaze direction.
+ *
+ * The lid offsets are baked into a grid over pan and tilt at compile time, and looked up with
+ * bilinear interpolation, so following the gaze costs a few integer multiplies per update. To change
+ * the shape of the coupling, change gazeLidReveal() rather than the lookup.
+ */
+
+#include "gazeLidModel.h"
+
+static_assert(200 % GAZE_LID_GRID_STEP == 0, "GAZE_LID_GRID_STEP must divide the -100 -> 100 range evenly");
+static_assert(PUPIL_REVEAL_LID_MIN_AMOUNT <= PUPIL_REVEAL_LID_MAX_AMOUNT, "PUPIL_REVEAL_LID_MIN_AMOUNT must not be above PUPIL_REVEAL_LID_MAX_AMOUNT");
+
+#define GAZE_LID_ONE (1 << GAZE_LID_FRACTION_BITS)
+#define GAZE_LID_WEIGHT_TOTAL (GAZE_LID_GRID_STEP * GAZE_LID_GRID_STEP)
+
+/**
+ * @brief How far a lid opens as the pupil turns towards it (evaluated by the compiler).
+ *
+ * The lid opens by up to PUPIL_REVEAL_LID_MAX_AMOUNT - PUPIL_REVEAL_LID_MIN_AMOUNT as the gaze turns
+ * fully towards it, and by PUPIL_REVEAL_PAN_GAIN percent more when the eye also looks fully to the
+ * side (where the lid curves down towards the corner of the eye).
+ *
+ * @param towards How far the gaze is turned towards the lid (0 -> 100).
+ * @param pan The pan of the gaze (-100 -> 100).
+ * @return the lid offset in 1/GAZE_LID_ONE lid units, rounded to the nearest.
+ */
+constexpr long gazeLidReveal(long towards, long pan) {
+    long travel = PUPIL_REVEAL_LID_MAX_AMOUNT - PUPIL_REVEAL_LID_MIN_AMOUNT;
+    long panScale = 100 * 100 + PUPIL_REVEAL_PAN_GAIN * (pan < 0 ? -pan : pan);
+    long denominator = 100L * 100 * 100;
+    return (GAZE_LID_ONE * travel * towards * panScale + denominator / 2) / denominator;
+}
+
+struct GazeLidCell {
+    int16_t top;        // 1/GAZE_LID_ONE lid units
+    int16_t bottom;     // 1/GAZE_LID_ONE lid units
+};
+
+struct GazeLidTable {
+    GazeLidCell cells[GAZE_LID_GRID_SIZE][GAZE_LID_GRID_SIZE];  // [tilt][pan], from -100
+};
+
+/**
+ * @brief Builds the lid offset grid (evaluated by the compiler).
+ * Positive tilt is down, so looking up opens the top lid and looking down opens the bottom lid.
+ *
+ * @return the lid offsets at every grid point.
+ */
+constexpr GazeLidTable buildGazeLidTable() {
+    GazeLidTable table = {};
+    for (int row = 0; row < GAZE_LID_GRID_SIZE; row++) {
+        long tilt = row * GAZE_LID_GRID_STEP - 100;
+        for (int column = 0; column < GAZE_LID_GRID_SIZE; column++) {
+            long pan = column * GAZE_LID_GRID_STEP - 100;
+            table.cells[row][column].top = (int16_t)gazeLidReveal(tilt < 0 ? -tilt : 0, pan);
+            table.cells[row][column].bottom = (int16_t)gazeLidReveal(tilt > 0 ? tilt : 0, pan);
+        }
+    }
+    return table;
+}
+
+constexpr GazeLidTable GAZE_LID_TABLE = buildGazeLidTable();
+
+static_assert(gazeLidReveal(100, 100) <= 100 * GAZE_LID_ONE, "PUPIL_REVEAL_* would open a lid by more than 100");
+
+/**
+ * @brief Gets how far to open the lids for a gaze direction, interpolated between the grid points.
+ *
+ * @param pan The pan state (-100 -> 100, clamped).
+ * @param tilt The tilt state (-100 -> 100, clamped, positive is down).
+ * @return the top and bottom lid offsets.
+ */
+GazeLidOffsets getGazeLidOffsets(int pan, int tilt) {
+    int x = constrain(pan, -100, 100) + 100;
+    int y = constrain(tilt, -100, 100) + 100;
+    int column = min(x / GAZE_LID_GRID_STEP, GAZE_LID_GRID_SIZE - 2);
+    int row = min(y / GAZE_LID_GRID_STEP, GAZE_LID_GRID_SIZE - 2);
+    int32_t fractionX = x - column * GAZE_LID_GRID_STEP;
+    int32_t fractionY = y - row * GAZE_LID_GRID_STEP;
+
+    // Weights of the four surrounding grid points (they add up to GAZE_LID_WEIGHT_TOTAL)
+    int32_t weight00 = (GAZE_LID_GRID_STEP - fractionX) * (GAZE_LID_GRID_STEP - fractionY);
+    int32_t weight01 = fractionX * (GAZE_LID_GRID_STEP - fractionY);
+    int32_t weight10 = (GAZE_LID_GRID_STEP - fractionX) * fractionY;
+    int32_t weight11 = fractionX * fractionY;
+
+    const GazeLidCell& cell00 = GAZE_LID_TABLE.cells[row][column];
+    const GazeLidCell& cell01 = GAZE_LID_TABLE.cells[row][column + 1];
+    const GazeLidCell& cell10 = GAZE_LID_TABLE.cells[row + 1][column];
+    const GazeLidCell& cell11 = GAZE_LID_TABLE.cells[row + 1][column + 1];
+
+    const int32_t scale = GAZE_LID_WEIGHT_TOTAL * GAZE_LID_ONE;
+    int32_t top = weight00 * cell00.top + weight01 * cell01.top + weight10 * cell10.top + weight11 * cell11.top;
+    int32_t bottom = weight00 * cell00.bottom + weight01 * cell01.bottom + weight10 * cell10.bottom + weight11 * cell11.bottom;
+
+    GazeLidOffsets offsets;
+    offsets.top = (int8_t)((top + scale / 2) / scale);
+    offsets.bottom = (int8_t)((bottom + scale / 2) / scale);
+    return offsets;
+}
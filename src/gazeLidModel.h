@@ -0,0 +1,30 @@
+/**
+ * @file gazeLidModel.h
+ * @brief How far the eyelids open to keep the pupil visible, for any gaze direction.
+ *
+ * The lid offsets are baked into a grid over pan and tilt at compile time, and looked up with
+ * bilinear interpolation, so following the gaze costs a few integer multiplies per update. To change
+ * the shape of the coupling, change gazeLidReveal() (gazeLidModel.cpp) rather than the lookup.
+ */
+
+#ifndef GAZE_LID_MODEL_H
+#define GAZE_LID_MODEL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define GAZE_LID_GRID_STEP 25                               // Pan and tilt between grid points (-100 -> 100)
+#define GAZE_LID_GRID_SIZE (200 / GAZE_LID_GRID_STEP + 1)   // Grid points along each axis
+#define GAZE_LID_FRACTION_BITS 4                            // The grid holds the offsets in 1/16ths of a lid unit
+
+/**
+ * @brief How far to open each lid (0 -> 100 lid units) for a gaze direction.
+ */
+struct GazeLidOffsets {
+    int8_t top;
+    int8_t bottom;
+};
+
+GazeLidOffsets getGazeLidOffsets(int pan, int tilt);
+
+#endif // GAZE_LID_MODEL_H
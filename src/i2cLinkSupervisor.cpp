@@ -0,0 +1,167 @@
+/**
+ * @file i2cLinkSupervisor.cpp
+ * @brief Supervises the I2C link to a device and schedules reinitialization with exponential backoff.
+ *
+ * Health probes run on a fixed interval or after a failed write rather than before every frame,
+ * so servo frames never wait behind a probe. When the link is down, reinitialization attempts are
+ * spaced out with an exponential backoff so a missing board does not stall the loop.
+ */
+
+#include "i2cLinkSupervisor.h"
+
+/**
+ * @brief Constructs a new I2CLinkSupervisor object.
+ *
+ * @param address The I2C address of the supervised device.
+ * @param wire The I2C bus the device is attached to.
+ */
+I2CLinkSupervisor::I2CLinkSupervisor(uint8_t address, TwoWire& wire):
+    wire(wire),
+    address(address),
+    linkUp(true),
+    lastProbeMillis(0),
+    nextRetryMillis(0),
+    backoffMillis(I2C_REINIT_BACKOFF_MIN),
+    errorCount(0),
+    retryCount(0),
+    reinitCount(0),
+    probeCount(0)
+{}
+
+/**
+ * @brief Probes the device by addressing it and checking for an ACK. No register data is transferred.
+ *
+ * @return true if the device acknowledged its address, false otherwise.
+ */
+bool I2CLinkSupervisor::probe() {
+    probeCount++;
+    wire.beginTransmission(address);
+    return wire.endTransmission() == 0;
+}
+
+/**
+ * @brief Runs the scheduled health probe and decides whether a reinitialization attempt is due.
+ *
+ * Call this after the frame has been written so the probe never delays servo output.
+ *
+ * @param currentMillis The current time (ms).
+ * @return true if the caller should reinitialize the device now and report the result with reportReinitResult().
+ */
+bool I2CLinkSupervisor::service(unsigned long currentMillis) {
+    if (linkUp) {
+        if (currentMillis - lastProbeMillis < I2C_HEALTH_CHECK_INTERVAL) {
+            return false;
+        }
+        lastProbeMillis = currentMillis;
+        if (probe()) {
+            return false;
+        }
+        errorCount++;
+        markLinkDown(currentMillis);
+    }
+
+    if ((long)(currentMillis - nextRetryMillis) < 0) {
+        return false;
+    }
+
+    retryCount++;
+    return true;
+}
+
+/**
+ * @brief Reports the status of a write to the device. A failed write takes the link down immediately.
+ *
+ * @param status The Wire::endTransmission() status (0 = success).
+ * @param currentMillis The current time (ms).
+ */
+void I2CLinkSupervisor::reportWriteResult(uint8_t status, unsigned long currentMillis) {
+    if (status == 0 || !linkUp) {
+        return;
+    }
+
+    #ifdef SERIAL_DEBUG
+    Serial.println("I2C Link: Write failed (status " + String(status) + ")");
+    #endif
+
+    errorCount++;
+    markLinkDown(currentMillis);
+}
+
+/**
+ * @brief Reports the outcome of a reinitialization attempt requested by service().
+ *
+ * @param success Whether the device was reinitialized successfully.
+ * @param currentMillis The current time (ms).
+ */
+void I2CLinkSupervisor::reportReinitResult(bool success, unsigned long currentMillis) {
+    if (success) {
+        #ifdef SERIAL_DEBUG
+        Serial.println("I2C Link: Reinitialized");
+        #endif
+
+        reinitCount++;
+        linkUp = true;
+        lastProbeMillis = currentMillis;
+        backoffMillis = I2C_REINIT_BACKOFF_MIN;
+        return;
+    }
+
+    nextRetryMillis = currentMillis + backoffMillis;
+    backoffMillis = min(backoffMillis * 2, (unsigned long)I2C_REINIT_BACKOFF_MAX);
+}
+
+/**
+ * @brief Marks the link as down and schedules an immediate reinitialization attempt.
+ *
+ * @param currentMillis The current time (ms).
+ */
+void I2CLinkSupervisor::markLinkDown(unsigned long currentMillis) {
+    linkUp = false;
+    nextRetryMillis = currentMillis;
+    backoffMillis = I2C_REINIT_BACKOFF_MIN;
+}
+
+/**
+ * @brief Gets whether the link is currently considered healthy.
+ *
+ * @return true if the link is up, false otherwise.
+ */
+bool I2CLinkSupervisor::isLinkUp() const {
+    return linkUp;
+}
+
+/**
+ * @brief Gets the number of failed writes and probes.
+ *
+ * @return the number of link errors.
+ */
+unsigned long I2CLinkSupervisor::getErrorCount() const {
+    return errorCount;
+}
+
+/**
+ * @brief Gets the number of reinitialization attempts.
+ *
+ * @return the number of reinitialization attempts.
+ */
+unsigned long I2CLinkSupervisor::getRetryCount() const {
+    return retryCount;
+}
+
+/**
+ * @brief Gets the number of successful reinitializations.
+ *
+ * @return the number of successful reinitializations.
+ */
+unsigned long I2CLinkSupervisor::getReinitCount() const {
+    return reinitCount;
+}
+
+/**
+ * @brief Gets the number of health probes sent.
+ *
+ * @return the number of health probes.
+ */
+unsigned long I2CLinkSupervisor::getProbeCount() const {
+    return probeCount;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file i2cLinkSupervisor.h
+ * @brief Supervises the I2C link to a device and schedules reinitialization with exponential backoff.
+ *
+ * Health probes run on a fixed interval or after a failed write rather than before every frame,
+ * so servo frames never wait behind a probe. When the link is down, reinitialization attempts are
+ * spaced out with an exponential backoff so a missing board does not stall the loop.
+ */
+
+#ifndef I2C_LINK_SUPERVISOR_H
+#define I2C_LINK_SUPERVISOR_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "config.h"
+
+class I2CLinkSupervisor {
+public:
+    I2CLinkSupervisor(uint8_t address, TwoWire& wire = Wire);
+
+    bool probe();
+    bool service(unsigned long currentMillis);
+    void reportWriteResult(uint8_t status, unsigned long currentMillis);
+    void reportReinitResult(bool success, unsigned long currentMillis);
+
+    bool isLinkUp() const;
+    unsigned long getErrorCount() const;
+    unsigned long getRetryCount() const;
+    unsigned long getReinitCount() const;
+    unsigned long getProbeCount() const;
+
+private:
+    TwoWire& wire;
+    uint8_t address;
+
+    bool linkUp;
+    unsigned long lastProbeMillis;
+    unsigned long nextRetryMillis;
+    unsigned long backoffMillis;
+
+    unsigned long errorCount;
+    unsigned long retryCount;
+    unsigned long reinitCount;
+    unsigned long probeCount;
+
+    void markLinkDown(unsigned long currentMillis);
+};
+
+#endif // I2C_LINK_SUPERVISOR_H
@@ -0,0 +1,214 @@
+/**
+ * @file inputCapture.cpp
+ * @brief Records the raw inputs and the random seed to LittleFS so field behaviour can be replayed.
+ *
+ * The input stage encodes every update into a RAM ring buffer (see captureLog.h), which never
+ * blocks. A low priority scheduler task writes the buffer to flash. Each boot starts a new capture
+ * and keeps the previous one, so a misbehaving run survives a reboot. Replay a capture with the
+ * native runner: `program replay capture.bin`.
+ */
+
+#include "inputCapture.h"
+
+static_assert((CAPTURE_BUFFER_SIZE & (CAPTURE_BUFFER_SIZE - 1)) == 0, "CAPTURE_BUFFER_SIZE must be a power of two");
+
+/**
+ * @brief Constructs a new InputCapture object. Nothing is recorded until begin().
+ */
+InputCapture::InputCapture():
+    head(0),
+    tail(0),
+    recording(false),
+    overrun(false),
+    recordCount(0),
+    byteCount(0),
+    lastSyncMillis(0)
+{}
+
+/**
+ * @brief Mounts LittleFS, keeps the previous capture and starts a new one.
+ *
+ * @param randomSeed The seed the StateManager was started with (replayed with the inputs).
+ * @return true if recording started, false otherwise.
+ */
+bool InputCapture::begin(uint32_t randomSeed) {
+    if (!LittleFS.begin(true)) {
+        #ifdef SERIAL_DEBUG
+        Serial.println("Input Capture: Failed to mount LittleFS");
+        #endif
+        return false;
+    }
+
+    if (LittleFS.exists(CAPTURE_PREVIOUS_PATH)) {
+        LittleFS.remove(CAPTURE_PREVIOUS_PATH);
+    }
+    if (LittleFS.exists(CAPTURE_PATH)) {
+        LittleFS.rename(CAPTURE_PATH, CAPTURE_PREVIOUS_PATH);
+    }
+
+    file = LittleFS.open(CAPTURE_PATH, FILE_WRITE);
+    if (!file) {
+        #ifdef SERIAL_DEBUG
+        Serial.println("Input Capture: Failed to create " CAPTURE_PATH);
+        #endif
+        return false;
+    }
+
+    CaptureHeader header = {};
+    header.magic = CAPTURE_MAGIC;
+    header.version = CAPTURE_VERSION;
+    header.adcInputCount = RAW_INPUT_ADC_COUNT;
+    header.randomSeed = randomSeed;
+    header.inputPeriodMicros = TASK_PERIOD_INPUT;
+    byteCount = file.write((const uint8_t*)&header, sizeof(header));
+
+    encoder.reset(micros());
+    lastSyncMillis = millis();
+    recording = true;
+    return true;
+}
+
+/**
+ * @brief Queues one update. Called by the input stage, never blocks. If the buffer is full the
+ * capture stops rather than leaving a gap that would make the replay diverge.
+ *
+ * @param timestampMicros When the inputs were read (us).
+ * @param inputs The raw inputs.
+ */
+void InputCapture::record(uint32_t timestampMicros, const RawInputs& inputs) {
+    if (!recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    uint8_t encoded[CAPTURE_MAX_RECORD_SIZE];
+    size_t length = encoder.encode(timestampMicros, inputs, encoded);
+
+    size_t writeIndex = head.load(std::memory_order_relaxed);
+    if (length > CAPTURE_BUFFER_SIZE - (writeIndex - tail.load(std::memory_order_acquire))) {
+        overrun = true;
+        recording = false;
+        return;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        buffer[(writeIndex + i) & (CAPTURE_BUFFER_SIZE - 1)] = encoded[i];
+    }
+    head.store(writeIndex + length, std::memory_order_release);
+    recordCount++;
+}
+
+/**
+ * @brief Writes the queued records to flash and syncs the file every CAPTURE_SYNC_INTERVAL.
+ * Runs as a scheduler task every TASK_PERIOD_CAPTURE. Closes the file once recording has stopped
+ * or the capture reaches CAPTURE_MAX_BYTES.
+ */
+void InputCapture::flush() {
+    if (!file) {
+        return;
+    }
+
+    size_t readIndex = tail.load(std::memory_order_relaxed);
+    size_t writeIndex = head.load(std::memory_order_acquire);
+    while (readIndex != writeIndex && byteCount < CAPTURE_MAX_BYTES) {
+        size_t offset = readIndex & (CAPTURE_BUFFER_SIZE - 1);
+        size_t chunk = min(min(writeIndex - readIndex, CAPTURE_BUFFER_SIZE - offset), (size_t)(CAPTURE_MAX_BYTES - byteCount));
+        size_t written = file.write(buffer + offset, chunk);
+        byteCount += written;
+        readIndex += written;
+        tail.store(readIndex, std::memory_order_release);
+        if (written < chunk) {
+            // The filesystem is full
+            break;
+        }
+    }
+
+    // Stop once the capture is full, rather than leaving a gap
+    bool full = readIndex != writeIndex || byteCount >= CAPTURE_MAX_BYTES;
+    if (full) {
+        recording = false;
+    }
+
+    if (!recording.load(std::memory_order_relaxed) && (full || readIndex == head.load(std::memory_order_acquire))) {
+        file.close();
+        #ifdef SERIAL_DEBUG
+        Serial.println(overrun ? "Input Capture: Stopped (buffer overrun)" : "Input Capture: Stopped");
+        #endif
+    } else if (millis() - lastSyncMillis >= CAPTURE_SYNC_INTERVAL) {
+        // Commit what has been written so far in case the bot loses power
+        file.flush();
+        lastSyncMillis = millis();
+    }
+}
+
+/**
+ * @brief Stops recording and saves everything queued so far.
+ */
+void InputCapture::stop() {
+    recording = false;
+    flush();
+}
+
+/**
+ * @brief Sends a capture over serial as "CAPTURE <size>\n" followed by the raw bytes.
+ * Stops the current recording first if it is the file being sent. Blocks until sent.
+ *
+ * @param path The capture to send (CAPTURE_PATH or CAPTURE_PREVIOUS_PATH).
+ */
+void InputCapture::dump(const char* path) {
+    if (strcmp(path, CAPTURE_PATH) == 0) {
+        stop();
+    }
+
+    File capture = LittleFS.open(path, FILE_READ);
+    if (!capture) {
+        Serial.println("CAPTURE 0");
+        return;
+    }
+
+    char line[32];
+    snprintf(line, sizeof(line), "CAPTURE %lu", (unsigned long)capture.size());
+    Serial.println(line);
+
+    uint8_t chunk[256];
+    size_t length;
+    while ((length = capture.read(chunk, sizeof(chunk))) > 0) {
+        Serial.write(chunk, length);
+    }
+    capture.close();
+}
+
+/**
+ * @brief Gets whether updates are being recorded.
+ *
+ * @return true if recording.
+ */
+bool InputCapture::isRecording() const {
+    return recording;
+}
+
+/**
+ * @brief Gets whether recording stopped because the flash could not keep up.
+ *
+ * @return true if the buffer overran.
+ */
+bool InputCapture::hasOverrun() const {
+    return overrun;
+}
+
+/**
+ * @brief Gets the number of updates recorded.
+ *
+ * @return the record count.
+ */
+unsigned long InputCapture::getRecordCount() const {
+    return recordCount;
+}
+
+/**
+ * @brief Gets the number of bytes saved to flash (including the header).
+ *
+ * @return the byte count.
+ */
+unsigned long InputCapture::getByteCount() const {
+    return byteCount;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file inputCapture.h
+ * @brief Records the raw inputs and the random seed to LittleFS so field behaviour can be replayed.
+ *
+ * The input stage encodes every update into a RAM ring buffer (see captureLog.h), which never
+ * blocks. A low priority scheduler task writes the buffer to flash. Each boot starts a new capture
+ * and keeps the previous one, so a misbehaving run survives a reboot. Replay a capture with the
+ * native runner: `program replay capture.bin`.
+ */
+
+#ifndef INPUT_CAPTURE_H
+#define INPUT_CAPTURE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <atomic>
+#include "config.h"
+#include "captureLog.h"
+
+class InputCapture {
+public:
+    InputCapture();
+
+    bool begin(uint32_t randomSeed);
+    void record(uint32_t timestampMicros, const RawInputs& inputs);
+    void flush();
+    void stop();
+    void dump(const char* path);
+
+    bool isRecording() const;
+    bool hasOverrun() const;
+    unsigned long getRecordCount() const;
+    unsigned long getByteCount() const;
+
+private:
+    CaptureEncoder encoder;
+    File file;
+
+    uint8_t buffer[CAPTURE_BUFFER_SIZE];
+    std::atomic<size_t> head;       // Next byte to write (owned by record())
+    std::atomic<size_t> tail;       // Next byte to save (owned by flush())
+    std::atomic<bool> recording;
+    std::atomic<bool> overrun;
+
+    unsigned long recordCount;
+    unsigned long byteCount;
+    unsigned long lastSyncMillis;
+};
+
+extern InputCapture inputCapture;
+
+#endif // INPUT_CAPTURE_H
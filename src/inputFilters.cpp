@@ -0,0 +1,234 @@
+/**
+ * @file inputFilters.cpp
+ * @brief Integer / Q15 fixed-point filters for the analog inputs.
+ *
+ * The ESP32-C3 has no FPU, so every filter here works on integers only. Coefficients are Q15
+ * (32768 = 1.0) and filter state is kept in Q16 so that small steps are not lost to rounding.
+ */
+
+#include "inputFilters.h"
+
+#define TWO_PI_Q15 205887   // 2 * pi in Q15
+
+/**
+ * @brief Constructs a new EmaFilter object. The first sample primes the filter.
+ *
+ * @param alphaQ15 The smoothing factor in Q15 (0 < alpha <= 32768).
+ */
+EmaFilter::EmaFilter(int32_t alphaQ15):
+    alphaQ15(alphaQ15),
+    stateQ16(0),
+    primed(false)
+{}
+
+/**
+ * @brief Adds a sample to the moving average.
+ *
+ * @param value The new sample (0 -> 32767).
+ * @return the filtered value.
+ */
+int EmaFilter::update(int value) {
+    if (!primed) {
+        reset(value);
+        return value;
+    }
+    int32_t errorQ16 = ((int32_t)value << 16) - stateQ16;
+    stateQ16 += (int32_t)(((int64_t)alphaQ15 * errorQ16) >> 15);
+    return getValue();
+}
+
+/**
+ * @brief Resets the filter to a value.
+ *
+ * @param value The value to reset to.
+ */
+void EmaFilter::reset(int value) {
+    stateQ16 = (int32_t)value << 16;
+    primed = true;
+}
+
+/**
+ * @brief Changes the smoothing factor without disturbing the filter state.
+ *
+ * @param alphaQ15 The smoothing factor in Q15 (0 < alpha <= 32768).
+ */
+void EmaFilter::setAlpha(int32_t alphaQ15) {
+    this->alphaQ15 = alphaQ15;
+}
+
+/**
+ * @brief Gets the current filtered value (rounded to the nearest integer).
+ *
+ * @return the filtered value.
+ */
+int EmaFilter::getValue() const {
+    return (stateQ16 + (1 << 15)) >> 16;
+}
+
+/**
+ * @brief Constructs a new OneEuroFilter object.
+ *
+ * @param sampleRateHz How often update() is called (Hz).
+ * @param minCutoffMilliHz The cutoff frequency when the signal is still (mHz). Lower = less jitter.
+ * @param beta How much the cutoff rises with speed (mHz per input unit per second). Higher = less lag.
+ * @param derivativeCutoffMilliHz The cutoff frequency used to smooth the speed estimate (mHz).
+ */
+OneEuroFilter::OneEuroFilter(uint32_t sampleRateHz, uint32_t minCutoffMilliHz, uint32_t beta, uint32_t derivativeCutoffMilliHz):
+    sampleRateHz(sampleRateHz),
+    minCutoffMilliHz(minCutoffMilliHz),
+    beta(beta),
+    valueFilter(Q15_ONE),
+    speedFilter(Q15_ONE),
+    previousValue(0),
+    primed(false)
+{
+    valueFilter.setAlpha(alphaForCutoff(minCutoffMilliHz));
+    speedFilter.setAlpha(alphaForCutoff(derivativeCutoffMilliHz));
+}
+
+/**
+ * @brief Adds a sample to the filter.
+ *
+ * @param value The new sample (0 -> 32767).
+ * @return the filtered value.
+ */
+int OneEuroFilter::update(int value) {
+    if (!primed) {
+        primed = true;
+        previousValue = value;
+        speedFilter.reset(0);
+        valueFilter.reset(value);
+        return value;
+    }
+
+    // Estimate how fast the signal is moving (input units per sample)
+    int speed = speedFilter.update(abs(value - previousValue));
+    previousValue = value;
+
+    // Raise the cutoff with the speed (converted to input units per second)
+    uint64_t cutoffMilliHz = minCutoffMilliHz + (uint64_t)beta * speed * sampleRateHz;
+    valueFilter.setAlpha(alphaForCutoff(cutoffMilliHz > UINT32_MAX ? UINT32_MAX : (uint32_t)cutoffMilliHz));
+
+    return valueFilter.update(value);
+}
+
+/**
+ * @brief Calculates the EMA smoothing factor for a first order low-pass filter at this sample rate.
+ *
+ * alpha = r / (r + 1) where r = 2 * pi * cutoff / sampleRate.
+ *
+ * @param cutoffMilliHz The cutoff frequency (mHz).
+ * @return the smoothing factor in Q15.
+ */
+int32_t OneEuroFilter::alphaForCutoff(uint32_t cutoffMilliHz) const {
+    uint64_t rQ15 = (uint64_t)TWO_PI_Q15 * cutoffMilliHz / (1000ULL * sampleRateHz);
+    return (int32_t)((rQ15 << 15) / (rQ15 + Q15_ONE));
+}
+
+/**
+ * @brief Constructs a new HysteresisDeadzone object.
+ *
+ * @param centre The value the output snaps to inside the deadzone.
+ * @param deadzone Distance from the centre that enters the deadzone.
+ * @param hysteresis Extra distance the input must move before it leaves the deadzone again.
+ */
+HysteresisDeadzone::HysteresisDeadzone(int centre, int deadzone, int hysteresis):
+    centre(centre),
+    deadzone(deadzone),
+    hysteresis(hysteresis),
+    inDeadzone(true)
+{}
+
+/**
+ * @brief Applies the deadzone to a sample.
+ *
+ * @param value The new sample.
+ * @return the centre while in the deadzone, otherwise the sample.
+ */
+int HysteresisDeadzone::update(int value) {
+    int distance = abs(value - centre);
+    if (inDeadzone) {
+        inDeadzone = distance <= deadzone + hysteresis;
+    } else {
+        inDeadzone = distance < deadzone;
+    }
+    return inDeadzone ? centre : value;
+}
+
+/**
+ * @brief Changes the size of the deadzone. Takes effect from the next sample.
+ *
+ * @param deadzone The distance from the centre that is treated as the centre.
+ * @param hysteresis How far past the deadzone a sample must be to leave it.
+ */
+void HysteresisDeadzone::setDeadzone(int deadzone, int hysteresis) {
+    this->deadzone = deadzone;
+    this->hysteresis = hysteresis;
+}
+
+/**
+ * @brief Constructs a new TakeoverDetector object. The first sample sets where the input rests.
+ *
+ * @param displacement How far the input must move from where it was last touched (input units).
+ * @param driftWindow How many samples are averaged to measure drift.
+ * @param driftVelocity The change between window averages at which the anchor stops following (input units).
+ * @param driftReleaseVelocity The change between window averages below which it follows again (input units).
+ */
+TakeoverDetector::TakeoverDetector(int displacement, uint16_t driftWindow, int driftVelocity, int driftReleaseVelocity):
+    displacement(displacement),
+    driftWindow(driftWindow),
+    driftVelocity(driftVelocity),
+    driftReleaseVelocity(driftReleaseVelocity),
+    anchor(0),
+    previousValue(0),
+    windowSum(0),
+    windowCount(0),
+    previousWindowMean(0),
+    pendingDrift(0),
+    moving(false),
+    primed(false)
+{}
+
+/**
+ * @brief Checks a sample for a person moving the input.
+ *
+ * @param value The new (median filtered) sample.
+ * @return true if the input was touched on this sample.
+ */
+bool TakeoverDetector::update(int value) {
+    if (!primed) {
+        primed = true;
+        anchor = value;
+        previousValue = value;
+        previousWindowMean = value;
+        return false;
+    }
+
+    // Let the anchor follow drift that stays too slow to be a person
+    windowSum += value;
+    if (++windowCount >= driftWindow) {
+        int windowMean = windowSum / windowCount;
+        int change = windowMean - previousWindowMean;
+        moving = abs(change) >= (moving ? driftReleaseVelocity : driftVelocity);
+        if (!moving) {
+            anchor += pendingDrift;
+        }
+        pendingDrift = moving ? 0 : change;
+        previousWindowMean = windowMean;
+        windowSum = 0;
+        windowCount = 0;
+    }
+
+    int offset = value - anchor;
+    int previousOffset = previousValue - anchor;
+    previousValue = value;
+
+    // Both samples must be out on the same side, so jitter between samples cannot take over
+    bool sameSide = (offset > 0) == (previousOffset > 0);
+    if (abs(offset) >= displacement && abs(previousOffset) >= displacement / 2 && sameSide) {
+        anchor = value;
+        pendingDrift = 0;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file inputFilters.h
+ * @brief Integer / Q15 fixed-point filters for the analog inputs.
+ *
+ * The ESP32-C3 has no FPU, so every filter here works on integers only. Coefficients are Q15
+ * (32768 = 1.0) and filter state is kept in Q16 so that small steps are not lost to rounding.
+ */
+
+#ifndef INPUT_FILTERS_H
+#define INPUT_FILTERS_H
+
+#include <Arduino.h>
+
+#define Q15_ONE 32768
+
+/**
+ * @brief Converts a floating point coefficient to Q15 at compile time.
+ */
+#define TO_Q15(value) ((int32_t)((value) * Q15_ONE + 0.5))
+
+/**
+ * @brief Exponential moving average with a Q15 smoothing factor.
+ */
+class EmaFilter {
+public:
+    EmaFilter(int32_t alphaQ15);
+
+    int update(int value);
+    void reset(int value);
+    void setAlpha(int32_t alphaQ15);
+    int getValue() const;
+
+private:
+    int32_t alphaQ15;
+    int32_t stateQ16;
+    bool primed;
+};
+
+/**
+ * @brief Running median of the last N samples, useful for rejecting single-sample spikes.
+ *
+ * @tparam N The window size (odd values give a true median).
+ */
+template <uint8_t N>
+class MedianFilter {
+public:
+    MedianFilter(): count(0), head(0) {}
+
+    /**
+     * @brief Adds a sample and returns the median of the window. Runs in O(N).
+     *
+     * @param value The new sample.
+     * @return the median of the last N samples.
+     */
+    int update(int value) {
+        if (count < N) {
+            history[count] = value;
+            insertSorted(value, count);
+            count++;
+        } else {
+            int oldest = history[head];
+            history[head] = value;
+            head = (head + 1) % N;
+
+            // Remove the oldest sample from the sorted window, then insert the new one
+            uint8_t index = 0;
+            while (index < N - 1 && sorted[index] != oldest) {
+                index++;
+            }
+            for (; index < N - 1; index++) {
+                sorted[index] = sorted[index + 1];
+            }
+            insertSorted(value, N - 1);
+        }
+        return sorted[count / 2];
+    }
+
+private:
+    int history[N];
+    int sorted[N];
+    uint8_t count;
+    uint8_t head;
+
+    void insertSorted(int value, uint8_t length) {
+        uint8_t index = length;
+        while (index > 0 && sorted[index - 1] > value) {
+            sorted[index] = sorted[index - 1];
+            index--;
+        }
+        sorted[index] = value;
+    }
+};
+
+/**
+ * @brief One Euro adaptive low-pass filter (Casiez et al.) in fixed point.
+ *
+ * The cutoff rises with the speed of the signal: slow movements are smoothed heavily to remove
+ * jitter, fast movements are passed through with little lag.
+ */
+class OneEuroFilter {
+public:
+    OneEuroFilter(uint32_t sampleRateHz, uint32_t minCutoffMilliHz, uint32_t beta, uint32_t derivativeCutoffMilliHz);
+
+    int update(int value);
+
+private:
+    uint32_t sampleRateHz;
+    uint32_t minCutoffMilliHz;
+    uint32_t beta;
+
+    EmaFilter valueFilter;
+    EmaFilter speedFilter;
+    int previousValue;
+    bool primed;
+
+    int32_t alphaForCutoff(uint32_t cutoffMilliHz) const;
+};
+
+/**
+ * @brief Deadzone around a centre point with hysteresis.
+ *
+ * The output snaps to the centre once the input comes within the deadzone, and only leaves it once
+ * the input moves further than the deadzone plus the hysteresis, so noise at the edge of the
+ * deadzone does not make the output chatter.
+ */
+class HysteresisDeadzone {
+public:
+    HysteresisDeadzone(int centre, int deadzone, int hysteresis);
+
+    int update(int value);
+    void setDeadzone(int deadzone, int hysteresis);
+
+private:
+    int centre;
+    int deadzone;
+    int hysteresis;
+    bool inDeadzone;
+};
+
+/**
+ * @brief Detects a person moving one analog input, from its spike-rejected (median) value.
+ *
+ * The input is touched once it is the displacement threshold from where it was last touched, with
+ * the previous sample at least half that far out on the same side. Jitter that flips from one side
+ * to the other between samples never takes over, and a movement of any speed is detected on the
+ * sample after it reaches the threshold at the latest. The low-pass filters are left out, as they
+ * would hold a movement back by tens of samples.
+ *
+ * So that slow drift never adds up to a takeover, the input is also averaged over windows of samples.
+ * While the change between window averages stays below the drift velocity, the anchor follows it,
+ * one window late so the start of a slow deliberate movement is not absorbed. Once a change reaches
+ * the drift velocity the anchor stays put until the changes fall below the (lower) release velocity.
+ */
+class TakeoverDetector {
+public:
+    TakeoverDetector(int displacement, uint16_t driftWindow, int driftVelocity, int driftReleaseVelocity);
+
+    bool update(int value);
+
+private:
+    int displacement;
+    uint16_t driftWindow;
+    int driftVelocity;
+    int driftReleaseVelocity;
+    int anchor;         // The value when the input was last touched, moved on by drift
+    int previousValue;
+    int32_t windowSum;
+    uint16_t windowCount;
+    int previousWindowMean;
+    int pendingDrift;   // The last window's change, applied once the next window is slow as well
+    bool moving;        // The window averages are changing faster than drift
+    bool primed;
+};
+
+#endif // INPUT_FILTERS_H
@@ -8,20 +8,40 @@
 
 #include <Arduino.h>
 #include "inputHandler.h"
+#include "inputCapture.h"
+#include "buttonEvents.h"
+#include "runtimeConfig.h"
 
-InputHandler::InputHandler():
+/**
+ * @brief Constructs a new InputHandler object.
+ *
+ * @param adcSampler The backend used to sample the analog inputs.
+ */
+InputHandler::InputHandler(AdcSampler& adcSampler):
+    adcSampler(adcSampler),
     joystickXValue(0),
     joystickYValue(0),
     potValue(0),
-    buttonValue(false),
     smoothedPotValue(0),
+    buttonValue(false),
+    manualControlEnabled(MANUAL_CONTROL_ENABLED_DEFAULT),
     timeSinceLastInput(0),
+    manualControlDisabledSinceMillis(0),
     lastInputMillis(0),
-    lastAnalogInputChecksum(0),
-    powerButtonState(false),
-    lastPowerButtonPressTime(0),
-    powerButtonDoublePressed(false),
-    manualControlEnabled(MANUAL_CONTROL_ENABLED_DEFAULT)
+    powerButtonLevel(false),
+    joystickXFilter(1000000 / TASK_PERIOD_INPUT, INPUT_FILTER_MIN_CUTOFF, INPUT_FILTER_BETA, INPUT_FILTER_DERIVATIVE_CUTOFF),
+    joystickYFilter(1000000 / TASK_PERIOD_INPUT, INPUT_FILTER_MIN_CUTOFF, INPUT_FILTER_BETA, INPUT_FILTER_DERIVATIVE_CUTOFF),
+    potFilter(1000000 / TASK_PERIOD_INPUT, INPUT_FILTER_MIN_CUTOFF, INPUT_FILTER_BETA, INPUT_FILTER_DERIVATIVE_CUTOFF),
+    joystickXDeadzone(2048, JOYSTICK_DEADZONE, JOYSTICK_DEADZONE_HYSTERESIS),
+    joystickYDeadzone(2048, JOYSTICK_DEADZONE, JOYSTICK_DEADZONE_HYSTERESIS),
+    potSmoothing(TO_Q15(SMOOTHING_FACTOR)),
+    joystickXTakeover(TAKEOVER_JOYSTICK_DISPLACEMENT, TAKEOVER_DRIFT_WINDOW, TAKEOVER_DRIFT_VELOCITY, TAKEOVER_DRIFT_RELEASE_VELOCITY),
+    joystickYTakeover(TAKEOVER_JOYSTICK_DISPLACEMENT, TAKEOVER_DRIFT_WINDOW, TAKEOVER_DRIFT_VELOCITY, TAKEOVER_DRIFT_RELEASE_VELOCITY),
+    potTakeover(TAKEOVER_POT_DISPLACEMENT, TAKEOVER_DRIFT_WINDOW, TAKEOVER_DRIFT_VELOCITY, TAKEOVER_DRIFT_RELEASE_VELOCITY),
+    configGeneration(0),
+    latchedSnapshot(),
+    powerButtonPressesSeen(0),
+    powerButtonDoublePressesSeen(0)
 {
     // This pin is attached tothe CKCS module K pin which when grounded will power off the charge module.
     // However, when charging, the CKCS module will not power off the ESP32
@@ -36,94 +56,195 @@ InputHandler::InputHandler():
     pinMode(PIN_EYELIDS_POT, INPUT);
 }
 
+/**
+ * @brief Starts sampling the analog inputs.
+ */
+void InputHandler::begin() {
+    if (!adcSampler.begin()) {
+        #ifdef SERIAL_DEBUG
+        Serial.println("Input Handler: Failed to start the ADC sampler");
+        #endif
+    }
+
+    #ifdef BUTTON_INTERRUPTS
+    // Timestamp the button edges as they happen rather than on the next update
+    buttonEvents.begin();
+    #endif
+}
+
 /**
  * @brief Update the input values and return true if any input has changed.
  */
 void InputHandler::update() {
-    readInputValues();
-    readPowerButton();
+    // Pick up a new runtime config before using any of it
+    uint32_t generation = runtimeConfig.getGeneration();
+    const RuntimeConfigValues& config = runtimeConfig.get();
+    if (generation != configGeneration) {
+        configGeneration = generation;
+        joystickXDeadzone.setDeadzone(config.joystickDeadzone, config.joystickDeadzoneHysteresis);
+        joystickYDeadzone.setDeadzone(config.joystickDeadzone, config.joystickDeadzoneHysteresis);
+    }
+
+    unsigned long currentMicros = micros();
+    RawInputs raw = readRawInputs(currentMicros);
+
+    #ifdef INPUT_CAPTURE
+    inputCapture.record(currentMicros, raw);
+    #endif
+
+    bool inputTouched = processInputValues(raw);
+    processPowerButton(raw, currentMicros);
 
     // Determine whether the user is manually controlling the input
-    // by checking if any analog input has changed within the manual control interrupt threshold
-    // or if the button is pressed
-    if (buttonValue || (abs(joystickXValue + joystickYValue + potValue - lastAnalogInputChecksum) > MANUAL_CONTROL_INTERRUPT_THRESHOLD)
-    ) {
-        lastAnalogInputChecksum = joystickXValue + joystickYValue + potValue;
+    // by checking whether an analog input was touched or the button is pressed
+    if (buttonValue || inputTouched) {
         lastInputMillis = millis();
     }
     timeSinceLastInput = millis() - lastInputMillis;
 
-    if (!manualControlEnabled && (timeSinceLastInput <= MANUAL_CONTROL_TIMEOUT)) {
+    if (!manualControlEnabled && (timeSinceLastInput <= config.manualControlTimeout)) {
         #ifdef SERIAL_DEBUG
         Serial.println("Input Handler: Manual Control");
         #endif
         manualControlEnabled = true;
         manualControlDisabledSinceMillis = 0;
-    } else if (manualControlEnabled && (timeSinceLastInput > MANUAL_CONTROL_TIMEOUT)) {
+    } else if (manualControlEnabled && (timeSinceLastInput > config.manualControlTimeout)) {
         #ifdef SERIAL_DEBUG
         Serial.println("Input Handler: Autonomous Control");
         #endif
         manualControlEnabled = false;
         manualControlDisabledSinceMillis = millis();
     }
+
+    publish();
+}
+
+/**
+ * @brief Publishes the processed input values so they can be latched by the consumer (possibly in another task).
+ */
+void InputHandler::publish() {
+    InputSnapshot snapshot;
+    snapshot.joystickXValue = joystickXValue;
+    snapshot.joystickYValue = joystickYValue;
+    snapshot.potValue = potValue;
+    snapshot.smoothedPotValue = smoothedPotValue;
+    snapshot.buttonPressed = buttonValue;
+    snapshot.manualControlEnabled = manualControlEnabled;
+    snapshot.powerButtonPressCount = powerButtonGesture.getPressCount();
+    snapshot.powerButtonDoublePressCount = powerButtonGesture.getDoublePressCount();
+    snapshot.powerButtonLongPressCount = powerButtonGesture.getLongPressCount();
+    snapshot.manualControlDisabledSinceMillis = manualControlDisabledSinceMillis;
+    publishedSnapshot.write(snapshot);
+}
+
+/**
+ * @brief Latches the most recently published input values. The getters return the latched values
+ * so that a consumer sees a consistent set of inputs for the whole of its update.
+ */
+void InputHandler::latch() {
+    latchedSnapshot = publishedSnapshot.read();
+}
+
+/**
+ * @brief Gets the most recently published input values without latching them. Safe to call from another task.
+ *
+ * @return InputSnapshot The latest input snapshot.
+ */
+InputSnapshot InputHandler::getSnapshot() const {
+    return publishedSnapshot.read();
+}
+
+/**
+ * @brief Reads the analog inputs and buttons from the hardware.
+ * With BUTTON_INTERRUPTS the buttons are the debounced levels after the queued edges, and the power
+ * button edges are passed to its gesture recogniser with the time they happened.
+ *
+ * @param currentMicros The time of the update (us).
+ * @return the raw readings.
+ */
+RawInputs InputHandler::readRawInputs(unsigned long currentMicros) {
+    // Collect any new samples from the ADC backend
+    adcSampler.poll();
+
+    RawInputs raw;
+    for (uint8_t input = 0; input < ADC_INPUT_COUNT; input++) {
+        raw.adc[input] = constrain(adcSampler.read(input), 0, 4095);
+    }
+    #ifdef BUTTON_INTERRUPTS
+    ButtonEdge edge;
+    while (buttonEvents.read(edge, currentMicros)) {
+        if (edge.button == BUTTON_INDEX_POWER) {
+            powerButtonGesture.onEdge(edge.pressed, edge.timestampMicros);
+        }
+    }
+    raw.buttons = buttonEvents.getButtons();
+    #else
+    (void)currentMicros;
+    raw.buttons = (!digitalRead(PIN_BLINK_BUTTON) ? RAW_BUTTON_BLINK : 0)
+                | (!digitalRead(PIN_BLINK_BUTTON_2) ? RAW_BUTTON_BLINK_2 : 0)
+                | (!digitalRead(PIN_POWER_BUTTON) ? RAW_BUTTON_POWER : 0);
+    #endif
+    return raw;
 }
 
 /**
- * @brief Reads the input values from the hardware and updates the internal state.
+ * @brief Processes the raw readings and updates the internal state.
+ *
+ * @param raw The raw readings.
+ * @return true if a person moved one of the analog inputs.
  */
-void InputHandler::readInputValues() {
+bool InputHandler::processInputValues(const RawInputs& raw) {
     // Read the Joystick Values
-    int newJoystickXValue = constrain(analogRead(PIN_JOYSTICK_X) + JOYSTICK_DRIFT_ADUSTMENT_X, 0, 4095);
-    int newJoystickYValue = constrain(analogRead(PIN_JOYSTICK_Y) + JOYSTICK_DRIFT_ADUSTMENT_Y, 0, 4095);
-    // Apply deadzone
-    newJoystickXValue = applyDeadzone(newJoystickXValue, JOYSTICK_DEADZONE);
-    newJoystickYValue = applyDeadzone(newJoystickYValue, JOYSTICK_DEADZONE);
+    const RuntimeConfigValues& config = runtimeConfig.get();
+    int newJoystickXValue = constrain(raw.adc[ADC_INPUT_JOYSTICK_X] + config.joystickDriftX, 0, 4095);
+    int newJoystickYValue = constrain(raw.adc[ADC_INPUT_JOYSTICK_Y] + config.joystickDriftY, 0, 4095);
+    // Reject spikes
+    int joystickXMedianValue = joystickXMedian.update(newJoystickXValue);
+    int joystickYMedianValue = joystickYMedian.update(newJoystickYValue);
+    // Smooth out jitter and apply the deadzone
+    newJoystickXValue = joystickXDeadzone.update(joystickXFilter.update(joystickXMedianValue));
+    newJoystickYValue = joystickYDeadzone.update(joystickYFilter.update(joystickYMedianValue));
 
     // Reat the Potentiometer Value
-    int newPotValue = constrain(analogRead(PIN_EYELIDS_POT), 0, 4095);
-    int previousSmoothedPotValue = smoothedPotValue;
-    smoothedPotValue = (SMOOTHING_FACTOR * newPotValue) + ((1 - SMOOTHING_FACTOR) * smoothedPotValue);
+    int rawPotValue = raw.adc[ADC_INPUT_EYELIDS_POT];
+    int potMedianValue = potMedian.update(rawPotValue);
+    int newPotValue = potFilter.update(potMedianValue);
+    smoothedPotValue = potSmoothing.update(rawPotValue);
+
+    // Check each analog input on its own (so movements on two of them cannot cancel out), ahead of the
+    // low-pass filters so a touch is seen straight away
+    bool inputTouched = joystickXTakeover.update(joystickXMedianValue);
+    inputTouched |= joystickYTakeover.update(joystickYMedianValue);
+    inputTouched |= potTakeover.update(potMedianValue);
 
     // Read the Button Value
-    int newButtonValue = !digitalRead(PIN_BLINK_BUTTON) || !digitalRead(PIN_BLINK_BUTTON_2);
+    int newButtonValue = (raw.buttons & (RAW_BUTTON_BLINK | RAW_BUTTON_BLINK_2)) != 0;
 
     // Update the input values
     joystickXValue = newJoystickXValue;
     joystickYValue = newJoystickYValue;
     potValue = newPotValue;
     buttonValue = newButtonValue;
-}
-
-/**
- * @brief Reads the power button state and updates the internal state of the powerButtonPressed and powerButtonDoublePressed flags.
- */
-void InputHandler::readPowerButton() {
-    bool newPowerButtonState = !digitalRead(PIN_POWER_BUTTON);
-    if (newPowerButtonState && !powerButtonState) {
-        powerButtonPressed = true;
 
-        unsigned long currentTime = millis();
-        if (currentTime - lastPowerButtonPressTime >= 100 && currentTime - lastPowerButtonPressTime <= 500) {
-            powerButtonDoublePressed = true;
-            powerButtonPressed = false;
-        }
-        lastPowerButtonPressTime = currentTime;
-    }
-    powerButtonState = newPowerButtonState;
+    return inputTouched;
 }
 
 /**
- * @brief Applies a deadzone to the joystick value.
+ * @brief Updates the power button press, double press and long press counts.
  *
- * @param value The joystick value.
- * @param deadzone The deadzone threshold.
- * @return The joystick value with the deadzone applied.
+ * @param raw The raw readings.
+ * @param currentMicros The time of the update (us).
  */
-int InputHandler::applyDeadzone(int value, int deadzone) {
-    if (abs(value - 2048) < deadzone) {
-        return 2048;
+void InputHandler::processPowerButton(const RawInputs& raw, unsigned long currentMicros) {
+    bool newPowerButtonLevel = (raw.buttons & RAW_BUTTON_POWER) != 0;
+    #ifndef BUTTON_INTERRUPTS
+    // Polled, so the edge is timed by the update that saw it
+    if (newPowerButtonLevel != powerButtonLevel) {
+        powerButtonGesture.onEdge(newPowerButtonLevel, currentMicros);
     }
-    return value;
+    #endif
+    powerButtonLevel = newPowerButtonLevel;
+    powerButtonGesture.update(currentMicros);
 }
 
 /**
@@ -132,7 +253,7 @@ int InputHandler::applyDeadzone(int value, int deadzone) {
  * @return the current joystick X value.
  */
 int InputHandler::getJoystickXValue() const {
-    return joystickXValue;
+    return latchedSnapshot.joystickXValue;
 }
 
 /**
@@ -141,7 +262,7 @@ int InputHandler::getJoystickXValue() const {
  * @return the current joystick X value as a percentage.
  */
 int InputHandler::getJoystickXPercent() const {
-    return map(joystickXValue, 0, 4095, -100, 100);
+    return map(latchedSnapshot.joystickXValue, 0, 4095, -100, 100);
 }
 
 /**
@@ -150,7 +271,7 @@ int InputHandler::getJoystickXPercent() const {
  * @return the current joystick Y value.
  */
 int InputHandler::getJoystickYValue() const {
-    return joystickYValue;
+    return latchedSnapshot.joystickYValue;
 }
 
 /**
@@ -159,7 +280,7 @@ int InputHandler::getJoystickYValue() const {
  * @return the current joystick Y value as a percentage.
  */
 int InputHandler::getJoystickYPercent() const {
-    return map(joystickYValue, 0, 4095, -100, 100);
+    return map(latchedSnapshot.joystickYValue, 0, 4095, -100, 100);
 }
 
 /**
@@ -168,7 +289,7 @@ int InputHandler::getJoystickYPercent() const {
  * @return the current potentiometer value.
  */
 int InputHandler::getPotValue() const {
-    return potValue;
+    return latchedSnapshot.potValue;
 }
 
 /**
@@ -177,7 +298,7 @@ int InputHandler::getPotValue() const {
  * @return the current potentiometer value as a percentage.
  */
 int InputHandler::getPotPercent() const {
-    return map(potValue, 0, 4095, 0, 100);
+    return map(latchedSnapshot.potValue, 0, 4095, 0, 100);
 }
 
 /**
@@ -186,7 +307,7 @@ int InputHandler::getPotPercent() const {
  * @return true if the button is pressed, false otherwise.
  */
 bool InputHandler::getButtonPressed() const {
-    return buttonValue;
+    return latchedSnapshot.buttonPressed;
 }
 
 /**
@@ -195,7 +316,7 @@ bool InputHandler::getButtonPressed() const {
  * @return the smoothed potentiometer value.
  */
 int InputHandler::getSmoothedPotValue() const {
-    return smoothedPotValue;
+    return latchedSnapshot.smoothedPotValue;
 }
 
 /**
@@ -204,30 +325,32 @@ int InputHandler::getSmoothedPotValue() const {
  * @return true if manual control is enabled, false otherwise.
  */
 bool InputHandler::isManualControlEnabled() const {
-    return manualControlEnabled;
+    return latchedSnapshot.manualControlEnabled;
 }
 
 /**
- * @brief Checks if the power button is pressed. Resets the pressed state after reading.
+ * @brief Checks if the power button has been pressed since the last check (or the last double press).
  *
  * @return true if the power button is pressed, false otherwise.
  */
 bool InputHandler::isPowerButtonPressed() {
-    if (powerButtonPressed) {
-        powerButtonPressed = false;
+    if (latchedSnapshot.powerButtonPressCount != powerButtonPressesSeen) {
+        powerButtonPressesSeen = latchedSnapshot.powerButtonPressCount;
         return true;
     }
     return false;
 }
 
 /**
- * @brief Checks if the power button is double pressed. Resets the double pressed state after reading.
+ * @brief Checks if the power button has been double pressed since the last check.
+ * A double press also consumes the single press that started it.
  *
  * @return true if the power button is double pressed, false otherwise.
  */
 bool InputHandler::isPowerButtonDoublePressed() {
-    if (powerButtonDoublePressed) {
-        powerButtonDoublePressed = false;
+    if (latchedSnapshot.powerButtonDoublePressCount != powerButtonDoublePressesSeen) {
+        powerButtonDoublePressesSeen = latchedSnapshot.powerButtonDoublePressCount;
+        powerButtonPressesSeen = latchedSnapshot.powerButtonPressCount;
         return true;
     }
     return false;
@@ -237,7 +360,7 @@ bool InputHandler::isPowerButtonDoublePressed() {
  * @brief Gets the time since the last input was received.
  */
 int InputHandler::getManualControlDisabledSinceMillis() const {
-    return manualControlDisabledSinceMillis;
+    return latchedSnapshot.manualControlDisabledSinceMillis;
 }
 
 #ifdef SERIAL_DEBUG
@@ -247,8 +370,9 @@ int InputHandler::getManualControlDisabledSinceMillis() const {
 void InputHandler::printDebugValues() {
     char inputBuffer[256];
     snprintf(inputBuffer, sizeof(inputBuffer),
-            "INPUT: [JOY_X: %4d | JOY_Y: %4d | POT: %4d | BUTTON: %d | PWR: %d | PWR2: %d | TSLI : %6d] ",
-            joystickXValue, joystickYValue, potValue, buttonValue, powerButtonPressed, powerButtonDoublePressed, timeSinceLastInput);
+            "INPUT: [JOY_X: %4d | JOY_Y: %4d | POT: %4d | BUTTON: %d | PWR: %u | PWR2: %u | PWRL: %u | TSLI : %6lu] ",
+            joystickXValue, joystickYValue, potValue, buttonValue, powerButtonGesture.getPressCount(), powerButtonGesture.getDoublePressCount(),
+            powerButtonGesture.getLongPressCount(), timeSinceLastInput);
     Serial.print(inputBuffer);
 }
 #endif
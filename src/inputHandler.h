@@ -11,12 +11,20 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "seqLock.h"
+#include "snapshots.h"
+#include "adcSampler.h"
+#include "inputFilters.h"
+#include "buttonGestures.h"
 
 class InputHandler {
 public:
-    InputHandler();
+    InputHandler(AdcSampler& adcSampler);
 
+    void begin();
     void update();
+    void latch();
+    InputSnapshot getSnapshot() const;
 
     int getJoystickXValue() const;
     int getJoystickXPercent() const;
@@ -38,6 +46,9 @@ public:
     #endif
 
 private:
+    AdcSampler& adcSampler;
+
+    // Producer side, owned by update()
     int joystickXValue;
     int joystickYValue;
     int potValue;
@@ -48,16 +59,35 @@ private:
     unsigned long timeSinceLastInput;
     unsigned long manualControlDisabledSinceMillis;
     unsigned long lastInputMillis;
-    int lastAnalogInputChecksum;
 
-    bool powerButtonState;
-    unsigned long lastPowerButtonPressTime;
-    bool powerButtonPressed;
-    bool powerButtonDoublePressed;
+    bool powerButtonLevel;
+    ButtonGesture powerButtonGesture;
+
+    MedianFilter<INPUT_MEDIAN_WINDOW> joystickXMedian;
+    MedianFilter<INPUT_MEDIAN_WINDOW> joystickYMedian;
+    MedianFilter<INPUT_MEDIAN_WINDOW> potMedian;
+    OneEuroFilter joystickXFilter;
+    OneEuroFilter joystickYFilter;
+    OneEuroFilter potFilter;
+    HysteresisDeadzone joystickXDeadzone;
+    HysteresisDeadzone joystickYDeadzone;
+    EmaFilter potSmoothing;
+    TakeoverDetector joystickXTakeover;
+    TakeoverDetector joystickYTakeover;
+    TakeoverDetector potTakeover;
+    uint32_t configGeneration;      // The runtime config generation the deadzones were set from
+
+    SeqLock<InputSnapshot> publishedSnapshot;
+
+    // Consumer side, owned by latch() and the getters
+    InputSnapshot latchedSnapshot;
+    uint16_t powerButtonPressesSeen;
+    uint16_t powerButtonDoublePressesSeen;
 
-    void readInputValues();
-    void readPowerButton();
-    int applyDeadzone(int value, int deadzone);
+    void publish();
+    RawInputs readRawInputs(unsigned long currentMicros);
+    bool processInputValues(const RawInputs& raw);
+    void processPowerButton(const RawInputs& raw, unsigned long currentMicros);
 };
 
 extern InputHandler inputHandler;
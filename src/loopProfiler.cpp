@@ -0,0 +1,288 @@
+/**
+ * @file loopProfiler.cpp
+ * @brief On-device loop profiler with per-stage cycle histograms.
+ *
+ * Wrap a stage in PROFILE_SCOPE(stage) to time it with the CPU cycle counter. Each stage keeps a
+ * log-bucketed histogram (four buckets per power of two, so percentiles are accurate to within 25%)
+ * from which min/p50/p99/max are reported. Send PROFILER_REPORT_KEY over serial to print the report
+ * and PROFILER_RESET_KEY to clear it. PROFILER_FILTER_BENCH_KEY times the input filters in cycles per sample.
+ */
+
+#include "loopProfiler.h"
+
+#ifdef LOOP_PROFILER
+
+#include "inputFilters.h"
+
+static const char* PROFILE_STAGE_NAMES[PROFILE_STAGE_COUNT] = {"loop", "input", "state", "motion", "servos"};
+
+/**
+ * @brief Constructs a new LoopProfiler object with empty histograms.
+ */
+LoopProfiler::LoopProfiler() {
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        clear(histograms[stage]);
+        histograms[stage].resetRequested.store(false, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Maps a cycle count to its histogram bucket.
+ *
+ * Values below 4 get a bucket each. Above that, each power of two is split into four buckets
+ * by the two bits below the most significant bit.
+ *
+ * @param cycles The cycle count.
+ * @return the bucket index.
+ */
+uint8_t LoopProfiler::getBucket(uint32_t cycles) {
+    if (cycles < (1U << PROFILER_SUB_BUCKET_BITS)) {
+        return cycles;
+    }
+    uint8_t msb = 31 - __builtin_clz(cycles);
+    uint8_t shift = msb - PROFILER_SUB_BUCKET_BITS;
+    return ((shift + 1) << PROFILER_SUB_BUCKET_BITS) | ((cycles >> shift) & ((1U << PROFILER_SUB_BUCKET_BITS) - 1));
+}
+
+/**
+ * @brief Gets the smallest cycle count that falls in a bucket.
+ *
+ * @param bucket The bucket index.
+ * @return the lower bound of the bucket (cycles).
+ */
+uint32_t LoopProfiler::getBucketLowerBound(uint8_t bucket) {
+    if (bucket < (1U << PROFILER_SUB_BUCKET_BITS)) {
+        return bucket;
+    }
+    uint8_t shift = (bucket >> PROFILER_SUB_BUCKET_BITS) - 1;
+    uint32_t mantissa = (1U << PROFILER_SUB_BUCKET_BITS) | (bucket & ((1U << PROFILER_SUB_BUCKET_BITS) - 1));
+    return mantissa << shift;
+}
+
+/**
+ * @brief Records one sample against a stage. Must only be called from the task that runs the stage.
+ *
+ * @param stage The stage.
+ * @param cycles How long the stage took (cycles).
+ */
+void LoopProfiler::record(ProfileStage stage, uint32_t cycles) {
+    StageHistogram& histogram = histograms[stage];
+
+    if (histogram.resetRequested.load(std::memory_order_relaxed)) {
+        clear(histogram);
+        histogram.resetRequested.store(false, std::memory_order_relaxed);
+    }
+
+    if (cycles < histogram.minCycles.load(std::memory_order_relaxed)) {
+        histogram.minCycles.store(cycles, std::memory_order_relaxed);
+    }
+    if (cycles > histogram.maxCycles.load(std::memory_order_relaxed)) {
+        histogram.maxCycles.store(cycles, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t>& bucket = histogram.buckets[getBucket(cycles)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    histogram.count.store(histogram.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Asks every stage to clear its histogram. Each stage clears on its next sample, so the
+ * recording tasks remain the only writers.
+ */
+void LoopProfiler::reset() {
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        histograms[stage].resetRequested.store(true, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Clears a histogram.
+ *
+ * @param histogram The histogram to clear.
+ */
+void LoopProfiler::clear(StageHistogram& histogram) {
+    histogram.count.store(0, std::memory_order_relaxed);
+    histogram.minCycles.store(UINT32_MAX, std::memory_order_relaxed);
+    histogram.maxCycles.store(0, std::memory_order_relaxed);
+    for (int bucket = 0; bucket < PROFILER_BUCKET_COUNT; bucket++) {
+        histogram.buckets[bucket].store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Gets the number of samples recorded for a stage.
+ *
+ * @param stage The stage.
+ * @return the sample count.
+ */
+uint32_t LoopProfiler::getCount(ProfileStage stage) const {
+    return histograms[stage].count.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the shortest sample recorded for a stage.
+ *
+ * @param stage The stage.
+ * @return the minimum (cycles), or 0 if there are no samples.
+ */
+uint32_t LoopProfiler::getMinCycles(ProfileStage stage) const {
+    return getCount(stage) == 0 ? 0 : histograms[stage].minCycles.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the longest sample recorded for a stage.
+ *
+ * @param stage The stage.
+ * @return the maximum (cycles).
+ */
+uint32_t LoopProfiler::getMaxCycles(ProfileStage stage) const {
+    return histograms[stage].maxCycles.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Estimates a percentile from a stage's histogram.
+ *
+ * @param stage The stage.
+ * @param permille The percentile in tenths of a percent (e.g. 500 for p50, 990 for p99).
+ * @return the upper bound of the bucket holding the percentile, clamped to the recorded min/max (cycles).
+ */
+uint32_t LoopProfiler::getPercentileCycles(ProfileStage stage, uint32_t permille) const {
+    const StageHistogram& histogram = histograms[stage];
+
+    // Total the buckets rather than trusting count, which may be a sample ahead or behind while recording
+    uint32_t counts[PROFILER_BUCKET_COUNT];
+    uint64_t total = 0;
+    for (int bucket = 0; bucket < PROFILER_BUCKET_COUNT; bucket++) {
+        counts[bucket] = histogram.buckets[bucket].load(std::memory_order_relaxed);
+        total += counts[bucket];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = max((uint64_t)1, (total * permille + 999) / 1000);
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < PROFILER_BUCKET_COUNT; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            uint32_t upperBound = bucket + 1 < PROFILER_BUCKET_COUNT ? getBucketLowerBound(bucket + 1) - 1 : UINT32_MAX;
+            return constrain(upperBound, getMinCycles(stage), getMaxCycles(stage));
+        }
+    }
+    return getMaxCycles(stage);
+}
+
+/**
+ * @brief Prints min/p50/p99/max for every stage followed by its non-empty histogram buckets.
+ */
+void LoopProfiler::printReport() {
+    char buffer[256];
+    uint32_t cyclesPerMicro = getCpuFrequencyMhz();
+
+    snprintf(buffer, sizeof(buffer), "PROF: %-7s %10s %10s %10s %10s %10s  (cycles @ %lu MHz)",
+             "stage", "count", "min", "p50", "p99", "max", (unsigned long)cyclesPerMicro);
+    Serial.println(buffer);
+
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        ProfileStage profileStage = (ProfileStage)stage;
+        snprintf(buffer, sizeof(buffer), "PROF: %-7s %10lu %10lu %10lu %10lu %10lu  (p99 %lu us)",
+                 PROFILE_STAGE_NAMES[stage],
+                 (unsigned long)getCount(profileStage),
+                 (unsigned long)getMinCycles(profileStage),
+                 (unsigned long)getPercentileCycles(profileStage, 500),
+                 (unsigned long)getPercentileCycles(profileStage, 990),
+                 (unsigned long)getMaxCycles(profileStage),
+                 (unsigned long)(getPercentileCycles(profileStage, 990) / max(cyclesPerMicro, (uint32_t)1)));
+        Serial.println(buffer);
+
+        // Buckets as "lowerBound:count", wrapped so each line fits the buffer
+        int length = snprintf(buffer, sizeof(buffer), "PROF:   ");
+        for (int bucket = 0; bucket < PROFILER_BUCKET_COUNT; bucket++) {
+            uint32_t count = histograms[stage].buckets[bucket].load(std::memory_order_relaxed);
+            if (count == 0) {
+                continue;
+            }
+            if (length > (int)sizeof(buffer) - 32) {
+                Serial.println(buffer);
+                length = snprintf(buffer, sizeof(buffer), "PROF:   ");
+            }
+            length += snprintf(buffer + length, sizeof(buffer) - length, " %lu:%lu",
+                               (unsigned long)getBucketLowerBound(bucket), (unsigned long)count);
+        }
+        Serial.println(buffer);
+    }
+}
+
+static volatile int filterBenchmarkSink;
+
+/**
+ * @brief Gets a pseudo-random 12-bit sample for the filter benchmark, so the median window is reordered by every sample.
+ *
+ * @param index The sample number.
+ * @return the sample (0 to 4095).
+ */
+static inline int getBenchmarkSample(uint32_t index) {
+    return (int)((index * 2654435761u) >> 20);
+}
+
+/**
+ * @brief Runs PROFILER_BENCH_SAMPLES samples through a filter PROFILER_BENCH_RUNS times.
+ *
+ * @param update Filters one sample and returns the result.
+ * @return the cycles taken by the fastest run.
+ */
+template <typename Update>
+static uint32_t timeFilter(Update update) {
+    uint32_t fastestCycles = UINT32_MAX;
+    for (int run = 0; run < PROFILER_BENCH_RUNS; run++) {
+        uint32_t startCycles = LoopProfiler::getCycleCount();
+        for (uint32_t index = 0; index < PROFILER_BENCH_SAMPLES; index++) {
+            filterBenchmarkSink = update(getBenchmarkSample(index));
+        }
+        uint32_t cycles = LoopProfiler::getCycleCount() - startCycles;
+        if (cycles < fastestCycles) {
+            fastestCycles = cycles;
+        }
+    }
+    return fastestCycles;
+}
+
+/**
+ * @brief Times the fixed point input filters and the floating point EMA they replaced, and prints the
+ * cycles per sample. The cost of generating and storing each sample is measured on its own and taken off.
+ */
+void LoopProfiler::printFilterBenchmark() {
+    EmaFilter ema(TO_Q15(SMOOTHING_FACTOR));
+    MedianFilter<INPUT_MEDIAN_WINDOW> median;
+    OneEuroFilter oneEuro(1000000 / TASK_PERIOD_INPUT, INPUT_FILTER_MIN_CUTOFF, INPUT_FILTER_BETA, INPUT_FILTER_DERIVATIVE_CUTOFF);
+    int smoothed = 0;
+
+    uint32_t overheadCycles = timeFilter([](int value) { return value; });
+    struct {
+        const char* name;
+        uint32_t cycles;
+    } results[] = {
+        // The previous smoothing path: a double expression on every sample (the ESP32-C3 has no FPU)
+        {"double EMA", timeFilter([&](int value) {
+            smoothed = (SMOOTHING_FACTOR * value) + ((1 - SMOOTHING_FACTOR) * smoothed);
+            return smoothed;
+        })},
+        {"EmaFilter (Q15)", timeFilter([&](int value) { return ema.update(value); })},
+        {"MedianFilter", timeFilter([&](int value) { return median.update(value); })},
+        {"OneEuroFilter", timeFilter([&](int value) { return oneEuro.update(value); })},
+    };
+
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "PROF: %-16s %13s  (fastest of %d runs of %d samples @ %lu MHz)",
+             "filter", "cycles/sample", PROFILER_BENCH_RUNS, PROFILER_BENCH_SAMPLES, (unsigned long)getCpuFrequencyMhz());
+    Serial.println(buffer);
+    for (const auto& result : results) {
+        uint32_t cycles = result.cycles > overheadCycles ? result.cycles - overheadCycles : 0;
+        snprintf(buffer, sizeof(buffer), "PROF: %-16s %9lu.%02lu", result.name,
+                 (unsigned long)(cycles / PROFILER_BENCH_SAMPLES),
+                 (unsigned long)(cycles % PROFILER_BENCH_SAMPLES * 100 / PROFILER_BENCH_SAMPLES));
+        Serial.println(buffer);
+    }
+}
+
+#endif // LOOP_PROFILER
@@ -0,0 +1,125 @@
+/**
+ * @file loopProfiler.h
+ * @brief On-device loop profiler with per-stage cycle histograms.
+ *
+ * Wrap a stage in PROFILE_SCOPE(stage) to time it with the CPU cycle counter. Each stage keeps a
+ * log-bucketed histogram (four buckets per power of two, so percentiles are accurate to within 25%)
+ * from which min/p50/p99/max are reported. Send PROFILER_REPORT_KEY over serial to print the report
+ * and PROFILER_RESET_KEY to clear it. PROFILER_FILTER_BENCH_KEY times the input filters in cycles per sample.
+ *
+ * Everything is compiled out unless LOOP_PROFILER is defined. When compiled in, recording a sample
+ * is a cycle counter read, a count-leading-zeros and a few loads and stores, so it is cheap enough
+ * for production builds.
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum ProfileStage {
+    PROFILE_STAGE_LOOP,
+    PROFILE_STAGE_INPUT,
+    PROFILE_STAGE_STATE,
+    PROFILE_STAGE_MOTION,
+    PROFILE_STAGE_SERVOS,
+    PROFILE_STAGE_COUNT
+};
+
+#ifdef LOOP_PROFILER
+
+#include <atomic>
+
+#define PROFILER_SUB_BUCKET_BITS 2
+#define PROFILER_BUCKET_COUNT ((32 - PROFILER_SUB_BUCKET_BITS + 1) << PROFILER_SUB_BUCKET_BITS)
+
+/**
+ * @brief A log-bucketed histogram of cycle counts for one stage.
+ *
+ * Only the stage's own task records into it, so every counter is a plain relaxed load and store
+ * (the ESP32-C3 has no atomic read-modify-write instructions). Readers may see a report that is
+ * a few samples out of date, never a torn value.
+ */
+struct StageHistogram {
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> minCycles;
+    std::atomic<uint32_t> maxCycles;
+    std::atomic<uint32_t> buckets[PROFILER_BUCKET_COUNT];
+    std::atomic<bool> resetRequested;
+};
+
+class LoopProfiler {
+public:
+    LoopProfiler();
+
+    /**
+     * @brief Reads the CPU cycle counter.
+     *
+     * @return the current cycle count (wraps).
+     */
+    static inline uint32_t getCycleCount() {
+        return ESP.getCycleCount();
+    }
+
+    void record(ProfileStage stage, uint32_t cycles);
+    void reset();
+    void printReport();
+    static void printFilterBenchmark();
+
+    uint32_t getCount(ProfileStage stage) const;
+    uint32_t getMinCycles(ProfileStage stage) const;
+    uint32_t getMaxCycles(ProfileStage stage) const;
+    uint32_t getPercentileCycles(ProfileStage stage, uint32_t permille) const;
+
+    static uint8_t getBucket(uint32_t cycles);
+    static uint32_t getBucketLowerBound(uint8_t bucket);
+
+private:
+    StageHistogram histograms[PROFILE_STAGE_COUNT];
+
+    void clear(StageHistogram& histogram);
+};
+
+/**
+ * @brief Times the enclosing scope and records it against a stage when the scope ends.
+ */
+class ProfileScope {
+public:
+    /**
+     * @brief Starts timing a stage.
+     *
+     * @param stage The stage being timed.
+     */
+    inline explicit ProfileScope(ProfileStage stage):
+        stage(stage),
+        startCycles(LoopProfiler::getCycleCount())
+    {}
+
+    /**
+     * @brief Records the elapsed cycles.
+     */
+    inline ~ProfileScope();
+
+private:
+    ProfileStage stage;
+    uint32_t startCycles;
+};
+
+extern LoopProfiler loopProfiler;
+
+inline ProfileScope::~ProfileScope() {
+    loopProfiler.record(stage, LoopProfiler::getCycleCount() - startCycles);
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(stage)
+
+#else
+
+#define PROFILE_SCOPE(stage)
+
+#endif // LOOP_PROFILER
+
+#endif // LOOP_PROFILER_H
@@ -13,28 +13,364 @@
 
 #include "config.h"
 #include "inputHandler.h"
+#include "buttonEvents.h"
+#include "analogReadSampler.h"
+#include "continuousAdcSampler.h"
 #include "servoController.h"
 #include "stateManager.h"
+#include "motionProfile.h"
+#include "scheduler.h"
+#include "periodicTask.h"
+#include "loopProfiler.h"
+#include "telemetry.h"
+#include "inputCapture.h"
+#include "powerManager.h"
+#include "runtimeConfig.h"
+#include "remoteControl.h"
+#include "wifiUdpTransport.h"
+#if defined(REMOTE_UDP) && !defined(ESP_PLATFORM)
+#include "loopbackUdpTransport.h"
+#endif
 #include "debug.h"
 
-InputHandler inputHandler;
+#if defined(ADC_CONTINUOUS_SAMPLING) && defined(ESP_PLATFORM)
+ContinuousAdcSampler adcSampler;
+#else
+AnalogReadSampler adcSampler;
+#endif
+
+RuntimeConfig runtimeConfig;
+InputHandler inputHandler(adcSampler);
+#ifdef BUTTON_INTERRUPTS
+ButtonEvents buttonEvents;
+#endif
 ServoController servoController;
 StateManager stateManager(inputHandler);
+MotionPlanner motionPlanner;
+Scheduler scheduler;
+
+#ifdef LOOP_PROFILER
+LoopProfiler loopProfiler;
+#endif
+
+#ifdef TELEMETRY_STREAM
+TelemetryStream telemetryStream;
+#endif
+
+#ifdef INPUT_CAPTURE
+InputCapture inputCapture;
+#endif
+
+#ifdef REMOTE_CONTROL
+RemoteControl remoteControl;
+#ifdef REMOTE_UDP
+#ifdef ESP_PLATFORM
+WifiUdpTransport remoteTransport(REMOTE_WIFI_SSID, REMOTE_WIFI_PASSWORD, REMOTE_UDP_PORT);
+#else
+LoopbackUdpTransport remoteTransport(REMOTE_UDP_PORT);
+#endif
+#endif
+#endif
+
+#ifdef POWER_MANAGEMENT
+PowerManager powerManager;
+int inputTaskIndex = -1;
+int stateTaskIndex = -1;
+#ifdef REMOTE_CONTROL
+int consoleTaskIndex = -1;
+#endif
+#endif
+
+void runInputTask();
+void runStateTask();
+void runServoTask();
+
+#ifdef PIPELINED_TASKS
+PeriodicTask inputTask("input", runInputTask, TASK_PERIOD_INPUT, PIPELINE_PRIORITY_INPUT);
+PeriodicTask stateTask("state", runStateTask, TASK_PERIOD_STATE, PIPELINE_PRIORITY_STATE);
+PeriodicTask servoTask("servos", runServoTask, TASK_PERIOD_SERVOS, PIPELINE_PRIORITY_SERVOS);
+#endif
+
+/**
+ * @brief Samples the inputs (needs to be done outside the stateManager to enable power control).
+ */
+void runInputTask() {
+    PROFILE_SCOPE(PROFILE_STAGE_INPUT);
+    inputHandler.update();
+}
+
+/**
+ * @brief Updates the state manager.
+ */
+void runStateTask() {
+    PROFILE_SCOPE(PROFILE_STAGE_STATE);
+    stateManager.update();
+}
+
+/**
+ * @brief Moves the servos one frame along their motion profiles towards the latest published state.
+ */
+void runServoTask() {
+    StateSnapshot state = stateManager.getSnapshot();
+    {
+        PROFILE_SCOPE(PROFILE_STAGE_MOTION);
+        motionPlanner.update(state.pan, state.tilt, state.topLid, state.bottomLid);
+    }
+
+    PROFILE_SCOPE(PROFILE_STAGE_SERVOS);
+    servoController.setPowerState(state.flags & STATE_FLAG_POWER);
+    servoController.update(motionPlanner.getPan(), motionPlanner.getTilt(), motionPlanner.getTopLid(), motionPlanner.getBottomLid());
+
+    #ifdef REMOTE_CONTROL
+    // Measure how long a new remote setpoint took to reach the servos
+    remoteControl.recordOutput(state, micros());
+    #endif
+}
+
+#ifdef ASYNC_SERVO_OUTPUT
+/**
+ * @brief Sends the newest servo frame to the PCA9685 boards (runs in the bus task).
+ */
+void runBusTask() {
+    servoController.transmit();
+}
+#endif
+
+#ifdef TELEMETRY_STREAM
+/**
+ * @brief Streams a telemetry sample of the latest snapshots.
+ */
+void runTelemetryTask() {
+    telemetryStream.update();
+}
+#endif
+
+#ifdef INPUT_CAPTURE
+/**
+ * @brief Saves the captured inputs to flash.
+ */
+void runCaptureTask() {
+    inputCapture.flush();
+}
+#endif
+
+#ifdef POWER_MANAGEMENT
+/**
+ * @brief Picks the power mode, slowing the input and state tasks while soft-powered off.
+ */
+void runPowerTask() {
+    if (powerManager.update(stateManager.getSnapshot(), servoController.getSnapshot())) {
+        bool off = powerManager.getMode() == POWER_MODE_OFF;
+        scheduler.setTaskPeriod(inputTaskIndex, off ? POWER_OFF_TASK_PERIOD : TASK_PERIOD_INPUT);
+        scheduler.setTaskPeriod(stateTaskIndex, off ? POWER_OFF_TASK_PERIOD : TASK_PERIOD_STATE);
+        #ifdef REMOTE_CONTROL
+        scheduler.setTaskPeriod(consoleTaskIndex, off ? TASK_PERIOD_CONSOLE : TASK_PERIOD_REMOTE);
+        #endif
+    }
+}
+#endif
+
+#if defined(LOOP_PROFILER) || defined(INPUT_CAPTURE) || defined(POWER_MANAGEMENT) || defined(SERVO_POWER_GATING) || defined(RUNTIME_CONFIG) || defined(REMOTE_CONTROL)
+/**
+ * @brief Handles single-key serial commands (profiler report/reset, capture download, energy report, runtime config)
+ * and remote control frames.
+ */
+void runConsoleTask() {
+    #ifdef REMOTE_CONTROL
+    unsigned long currentMillis = millis();
+    unsigned long currentMicros = micros();
+    #ifdef REMOTE_UDP
+    remoteControl.poll(currentMillis, currentMicros);
+    #endif
+    #endif
+    while (Serial.available() > 0) {
+        int key = Serial.read();
+        #ifdef RUNTIME_CONFIG
+        // The bytes after RUNTIME_CONFIG_UPLOAD_KEY are a config frame, not keys
+        if (runtimeConfig.isReceiving(millis())) {
+            runtimeConfig.receive(key);
+            continue;
+        }
+        #endif
+        #ifdef REMOTE_CONTROL
+        // Bytes inside a frame (or soon after one, in case a delimiter was lost) are not keys
+        if (remoteControl.receive(key, currentMillis, currentMicros) || remoteControl.isConsoleLocked(currentMillis)) {
+            continue;
+        }
+        if (key == REMOTE_REPORT_KEY) {
+            remoteControl.printReport();
+        }
+        #endif
+        #ifdef RUNTIME_CONFIG
+        if (key == RUNTIME_CONFIG_PRINT_KEY) {
+            runtimeConfig.print();
+        } else if (key == RUNTIME_CONFIG_UPLOAD_KEY) {
+            runtimeConfig.startReceiving(millis());
+        } else if (key == RUNTIME_CONFIG_RESET_KEY) {
+            RuntimeConfigResult result = runtimeConfig.reset();
+            Serial.println(result == RUNTIME_CONFIG_OK ? "CONFIG: reset to the defaults" : "CONFIG: reset failed");
+        }
+        #endif
+        #ifdef LOOP_PROFILER
+        if (key == PROFILER_REPORT_KEY) {
+            loopProfiler.printReport();
+        } else if (key == PROFILER_RESET_KEY) {
+            loopProfiler.reset();
+        } else if (key == PROFILER_FILTER_BENCH_KEY) {
+            LoopProfiler::printFilterBenchmark();
+        }
+        #endif
+        #ifdef INPUT_CAPTURE
+        if (key == CAPTURE_DUMP_KEY) {
+            inputCapture.dump(CAPTURE_PATH);
+        } else if (key == CAPTURE_DUMP_PREVIOUS_KEY) {
+            inputCapture.dump(CAPTURE_PREVIOUS_PATH);
+        }
+        #endif
+        #if defined(POWER_MANAGEMENT) || defined(SERVO_POWER_GATING)
+        if (key == POWER_REPORT_KEY) {
+            #ifdef POWER_MANAGEMENT
+            powerManager.printReport();
+            #endif
+            servoController.printPowerReport();
+        }
+        #endif
+    }
+
+    #ifdef REMOTE_CONTROL
+    remoteControl.sendReport(currentMillis);
+    #endif
+}
+#endif
+
+/**
+ * @brief Registers a task with the scheduler, reporting it if the task table is full.
+ *
+ * @param name The name shown in the debug output.
+ * @param callback The function to call.
+ * @param periodMicros How often the task should run (us).
+ * @return the task index, or -1 if it was not registered.
+ */
+int registerTask(const char* name, TaskCallback callback, unsigned long periodMicros) {
+    int index = scheduler.addTask(name, callback, periodMicros);
+    if (index < 0) {
+        // Raise SCHEDULER_MAX_TASKS
+        Serial.print("Scheduler full, task not registered: ");
+        Serial.println(name);
+    }
+    return index;
+}
+
+/**
+ * @brief Blocks until the next task is due, so the loop does not spin between tasks.
+ *
+ * Whole milliseconds are given to the RTOS with delay(), which lets the idle task run, and
+ * the remainder is busy-waited with delayMicroseconds() so the task is not started late.
+ *
+ * @param idleMicros The time until the next task is due (us).
+ */
+void waitForNextTask(unsigned long idleMicros) {
+    // The scheduler reports ULONG_MAX when no tasks are registered
+    idleMicros = min(idleMicros, (unsigned long)TASK_PERIOD_DEBUG);
+    if (idleMicros >= 1000) {
+        delay(idleMicros / 1000);
+    }
+    if (idleMicros % 1000 > 0) {
+        delayMicroseconds(idleMicros % 1000);
+    }
+}
 
 /**
  * @brief Setup function for the Blinkenstein control code.
  */
 void setup() {
-    #ifdef SERIAL_DEBUG
+    #if defined(SERIAL_DEBUG) || defined(LOOP_PROFILER) || defined(TELEMETRY_STREAM) || defined(INPUT_CAPTURE) || defined(POWER_MANAGEMENT) || defined(SERVO_POWER_GATING) || defined(RUNTIME_CONFIG) || defined(REMOTE_CONTROL)
     Serial.begin(115200);
     #endif
 
+    // Load the stored tuning settings before anything reads them
+    runtimeConfig.begin();
+
     // Initialize the PCA9685 board
     servoController.begin();
 
-    // Initialize the state
+    // Initialize the state (seeds the random number generator)
     stateManager.begin();
 
+    #ifdef INPUT_CAPTURE
+    // Record the inputs from here on, along with the seed needed to replay them
+    inputCapture.begin(stateManager.getRandomSeed());
+    #endif
+
+    // Start sampling the inputs
+    inputHandler.begin();
+
+    #ifdef POWER_MANAGEMENT
+    // Set the CPU clock and the light sleep wakeup buttons (after the input pins are configured)
+    powerManager.begin();
+    #endif
+
+    #if defined(REMOTE_CONTROL) && defined(REMOTE_UDP)
+    // Listen for setpoint datagrams (the network is joined in the background)
+    if (remoteTransport.begin()) {
+        remoteControl.setTransport(&remoteTransport);
+    } else {
+        #ifdef SERIAL_DEBUG
+        Serial.println("Remote UDP transport failed to start");
+        #endif
+    }
+    #endif
+
+    #ifdef ASYNC_SERVO_OUTPUT
+    // Send the servo frames from their own task so no stage waits for the I2C bus
+    servoController.startOutputTask(runBusTask);
+    #endif
+
+    #ifdef PIPELINED_TASKS
+    // Run each stage in its own task, passing snapshots between them
+    inputTask.start();
+    stateTask.start();
+    servoTask.start();
+    #else
+    // Register the tasks in priority order
+    int inputIndex = registerTask("input", runInputTask, TASK_PERIOD_INPUT);
+    int stateIndex = registerTask("state", runStateTask, TASK_PERIOD_STATE);
+    registerTask("servos", runServoTask, TASK_PERIOD_SERVOS);
+    #ifdef POWER_MANAGEMENT
+    inputTaskIndex = inputIndex;
+    stateTaskIndex = stateIndex;
+    #else
+    (void)inputIndex;
+    (void)stateIndex;
+    #endif
+    #endif
+    #ifdef SERIAL_DEBUG
+    registerTask("debug", printDebugValues, TASK_PERIOD_DEBUG);
+    #endif
+    #ifdef TELEMETRY_STREAM
+    registerTask("telemetry", runTelemetryTask, TASK_PERIOD_TELEMETRY);
+    #endif
+    #ifdef INPUT_CAPTURE
+    registerTask("capture", runCaptureTask, TASK_PERIOD_CAPTURE);
+    #endif
+    #ifdef POWER_MANAGEMENT
+    registerTask("power", runPowerTask, TASK_PERIOD_POWER);
+    #endif
+    #if defined(LOOP_PROFILER) || defined(INPUT_CAPTURE) || defined(POWER_MANAGEMENT) || defined(SERVO_POWER_GATING) || defined(RUNTIME_CONFIG) || defined(REMOTE_CONTROL)
+    #ifdef REMOTE_CONTROL
+    // Poll for setpoint frames often enough that they do not wait in the UART
+    int consoleIndex = registerTask("console", runConsoleTask, TASK_PERIOD_REMOTE);
+    #ifdef POWER_MANAGEMENT
+    consoleTaskIndex = consoleIndex;
+    #else
+    (void)consoleIndex;
+    #endif
+    #else
+    registerTask("console", runConsoleTask, TASK_PERIOD_CONSOLE);
+    #endif
+    #endif
+    scheduler.begin();
+
     #ifdef SERIAL_DEBUG
     Serial.println("Setup complete. Starting loop...");
     #endif
@@ -44,17 +380,20 @@ void setup() {
  * @brief Main loop for the Blinkenstein control code.
  */
 void loop() {
-    // Update input values (needs to be done outside the stateManager to enable power control)
-    inputHandler.update();
+    // Run whichever tasks are due
+    unsigned long idleMicros;
+    {
+        PROFILE_SCOPE(PROFILE_STAGE_LOOP);
+        idleMicros = scheduler.run();
+    }
 
-    // Update the state manager
-    stateManager.update();
-
-    // Update the Servo Controller
-    servoController.update(stateManager.getPanState(), stateManager.getTiltState(), stateManager.getTopLidState(), stateManager.getBottomLidState());
-
-    // Output debug information
-    #ifdef SERIAL_DEBUG
-    printDebugValues();
+    #if defined(POWER_MANAGEMENT) && !defined(PIPELINED_TASKS)
+    // Light sleep until the next task is due, if idle or soft-powered off and there is time to
+    if (powerManager.idle(idleMicros)) {
+        return;
+    }
     #endif
+
+    // With PIPELINED_TASKS the stages run in their own tasks, so this only waits for the debug output
+    waitForNextTask(idleMicros);
 }
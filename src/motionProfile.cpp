@@ -0,0 +1,349 @@
+/**
+ * @file motionProfile.cpp
+ * @brief Generates smooth per-axis trajectories between the state targets and the servo output.
+ *
+ * The StateManager jumps its targets instantly, which makes the servos slam, draw current spikes
+ * and buzz. Each MotionAxis instead moves towards its target within a velocity and acceleration
+ * limit, emitting one setpoint per servo frame. Two profiles are available:
+ *  - MOTION_TRAPEZOIDAL: constant acceleration up to the velocity limit, then constant deceleration.
+ *    Retargeting mid-move keeps the current velocity.
+ *  - MOTION_SCURVE: a smootherstep ease (zero acceleration at both ends) read from a precomputed
+ *    integer table, with the move duration stretched so neither limit is exceeded. Retargeting
+ *    mid-move blends from the current velocity and acceleration, so the motion stays smooth
+ *    (coming to rest first if the new target is behind it).
+ *
+ * Everything is integer arithmetic; positions are held in Q8 state units.
+ */
+
+#include "motionProfile.h"
+
+#define EASE_TABLE_SEGMENTS 64
+#define EASE_TABLE_MAX 65535
+
+// Smootherstep 6t^5 - 15t^4 + 10t^3 sampled at 65 points and scaled to 0 -> 65535
+static const uint16_t EASE_TABLE[EASE_TABLE_SEGMENTS + 1] = {
+        0,     2,    19,    63,   145,   277,   467,   723,
+     1052,  1460,  1951,  2529,  3196,  3955,  4806,  5749,
+     6784,  7909,  9121, 10418, 11797, 13253, 14781, 16377,
+    18036, 19750, 21515, 23323, 25167, 27041, 28938, 30849,
+    32768, 34686, 36597, 38494, 40368, 42212, 44020, 45785,
+    47499, 49158, 50754, 52282, 53738, 55117, 56414, 57626,
+    58751, 59786, 60729, 61580, 62339, 63006, 63584, 64075,
+    64483, 64812, 65068, 65258, 65390, 65472, 65516, 65533,
+    65535
+};
+
+// Smootherstep peak velocity is 1.875 * distance / duration and peak acceleration is 5.774 * distance / duration^2
+#define SCURVE_PEAK_VELOCITY_X1000 1875
+#define SCURVE_PEAK_ACCELERATION_X1000 5774
+
+// Blending from a starting velocity v over a move of T frames adds up to 3.94 * v / T acceleration,
+// and turns back unless the distance is at least 0.296 * v * T
+#define SCURVE_BLEND_ACCELERATION_X1000 3940
+#define SCURVE_BLEND_REVERSAL_X1000 296
+
+// Coming to rest from a velocity v over T frames travels v * T / 2 and peaks at 1.5 * v / T acceleration
+#define SCURVE_STOP_ACCELERATION_X1000 1500
+
+#define Q16_ONE 65536
+
+/**
+ * @brief Multiplies two Q16 values.
+ *
+ * @param a The first value.
+ * @param b The second value.
+ * @return the product (Q16).
+ */
+static inline int64_t mulQ16(int64_t a, int64_t b) {
+    return (a * b) / Q16_ONE;
+}
+
+/**
+ * @brief Integer square root (floor).
+ *
+ * @param value The value.
+ * @return the largest integer whose square does not exceed the value.
+ */
+static uint32_t isqrt(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+
+/**
+ * @brief Constructs a new MotionAxis object at position 0.
+ *
+ * @param profile The motion profile to follow.
+ * @param maxVelocity The velocity limit (state units per second).
+ * @param maxAcceleration The acceleration limit (state units per second per second).
+ * @param frameRateHz How often update() is called (Hz).
+ */
+MotionAxis::MotionAxis(MotionProfileType profile, uint32_t maxVelocity, uint32_t maxAcceleration, uint32_t frameRateHz):
+    profile(profile),
+    maxVelocityQ8(max((int32_t)1, (int32_t)((maxVelocity << 8) / frameRateHz))),
+    maxAccelerationQ8(max((int32_t)1, (int32_t)(((uint64_t)maxAcceleration << 8) / ((uint64_t)frameRateHz * frameRateHz)))),
+    positionQ8(0),
+    velocityQ8(0),
+    accelerationQ8(0),
+    targetQ8(0),
+    moveTargetQ8(0),
+    moveStartQ8(0),
+    moveDistanceQ8(0),
+    moveVelocityQ8(0),
+    moveAccelerationQ8(0),
+    moveFrames(0),
+    moveFrame(0)
+{}
+
+/**
+ * @brief Advances the axis by one frame towards the target.
+ *
+ * @param target The target position (state units).
+ * @return the setpoint for this frame (state units).
+ */
+int MotionAxis::update(int target) {
+    targetQ8 = (int32_t)target << 8;
+
+    if (profile == MOTION_SCURVE) {
+        stepSCurve();
+    } else {
+        stepTrapezoidal();
+    }
+
+    return getPosition();
+}
+
+/**
+ * @brief Jumps the axis to a position and stops it.
+ *
+ * @param position The new position (state units).
+ */
+void MotionAxis::reset(int position) {
+    positionQ8 = (int32_t)position << 8;
+    targetQ8 = positionQ8;
+    velocityQ8 = 0;
+    accelerationQ8 = 0;
+    moveTargetQ8 = positionQ8;
+    moveStartQ8 = positionQ8;
+    moveDistanceQ8 = 0;
+    moveVelocityQ8 = 0;
+    moveAccelerationQ8 = 0;
+    moveFrames = 0;
+    moveFrame = 0;
+}
+
+/**
+ * @brief Steps a trapezoidal profile: accelerate towards the fastest velocity that can still stop at the target.
+ */
+void MotionAxis::stepTrapezoidal() {
+    int32_t error = targetQ8 - positionQ8;
+    if (error == 0 && velocityQ8 == 0) {
+        return;
+    }
+
+    int32_t stoppingVelocity = isqrt(2ULL * maxAccelerationQ8 * abs(error));
+    int32_t desiredVelocity = min(maxVelocityQ8, stoppingVelocity);
+    if (error < 0) {
+        desiredVelocity = -desiredVelocity;
+    }
+
+    if (velocityQ8 < desiredVelocity) {
+        velocityQ8 = min(velocityQ8 + maxAccelerationQ8, desiredVelocity);
+    } else {
+        velocityQ8 = max(velocityQ8 - maxAccelerationQ8, desiredVelocity);
+    }
+    positionQ8 += velocityQ8;
+
+    // Arrive once the target is reached or crossed
+    if ((error >= 0 && positionQ8 >= targetQ8) || (error <= 0 && positionQ8 <= targetQ8)) {
+        positionQ8 = targetQ8;
+        velocityQ8 = 0;
+    }
+}
+
+/**
+ * @brief Steps an S-curve profile, replanning from the current motion whenever the target changes.
+ *
+ * The move is the quintic from the current position, velocity and acceleration to the target at
+ * rest: the smootherstep ease over the distance, plus two blend terms that start with the current
+ * velocity and acceleration and fade to zero (with zero velocity and acceleration) by the end.
+ */
+void MotionAxis::stepSCurve() {
+    if (targetQ8 != moveTargetQ8 || (moveFrame >= moveFrames && positionQ8 != targetQ8)) {
+        planSCurve();
+    }
+
+    int32_t previousQ8 = positionQ8;
+    int32_t previousVelocityQ8 = velocityQ8;
+    if (moveFrame >= moveFrames) {
+        positionQ8 = moveStartQ8 + moveDistanceQ8;
+    } else {
+        moveFrame++;
+
+        // Interpolate between the two nearest table entries
+        uint32_t phaseQ8 = (moveFrame * (EASE_TABLE_SEGMENTS << 8)) / moveFrames;
+        uint32_t index = phaseQ8 >> 8;
+        uint32_t ease = EASE_TABLE_MAX;
+        if (index < EASE_TABLE_SEGMENTS) {
+            uint32_t fraction = phaseQ8 & 0xFF;
+            ease = EASE_TABLE[index] + (((EASE_TABLE[index + 1] - EASE_TABLE[index]) * fraction) >> 8);
+        }
+        positionQ8 = moveStartQ8 + (int32_t)(((int64_t)moveDistanceQ8 * ease) / EASE_TABLE_MAX);
+
+        if (moveVelocityQ8 != 0 || moveAccelerationQ8 != 0) {
+            // s - 6s^3 + 8s^4 - 3s^5 and s^2/2 - 3s^3/2 + 3s^4/2 - s^5/2, for s = moveFrame / moveFrames
+            int64_t s = ((int64_t)moveFrame * Q16_ONE) / moveFrames;
+            int64_t s2 = mulQ16(s, s);
+            int64_t velocityBlend = mulQ16(s, Q16_ONE + mulQ16(s2, -6 * Q16_ONE + mulQ16(s, 8 * Q16_ONE - 3 * s)));
+            int64_t accelerationBlend = mulQ16(s2, Q16_ONE / 2 + mulQ16(s, -3 * Q16_ONE / 2 + mulQ16(s, 3 * Q16_ONE / 2 - s / 2)));
+            int64_t frames = moveFrames;
+            positionQ8 += (int32_t)(mulQ16((int64_t)moveVelocityQ8 * frames, velocityBlend)
+                                  + mulQ16((int64_t)moveAccelerationQ8 * frames * frames, accelerationBlend));
+        }
+    }
+    velocityQ8 = positionQ8 - previousQ8;
+    accelerationQ8 = velocityQ8 - previousVelocityQ8;
+}
+
+/**
+ * @brief Plans an S-curve move from the current motion to the target, long enough to respect both
+ * limits and to bleed off the current velocity. If the axis is heading away from the target, or is
+ * too fast to stop on it, the move only brings it to rest and the next one sets off from there.
+ */
+void MotionAxis::planSCurve() {
+    // A finished move ends at rest, whatever its last step was
+    bool atRest = moveFrame >= moveFrames;
+    moveTargetQ8 = targetQ8;
+    moveStartQ8 = positionQ8;
+    moveDistanceQ8 = targetQ8 - positionQ8;
+    moveVelocityQ8 = atRest ? 0 : velocityQ8;
+    moveAccelerationQ8 = atRest ? 0 : accelerationQ8;
+    moveFrame = 0;
+
+    uint64_t distance = abs(moveDistanceQ8);
+    uint64_t velocity = abs(moveVelocityQ8);
+    uint32_t velocityFrames = (distance * SCURVE_PEAK_VELOCITY_X1000 + 1000ULL * maxVelocityQ8 - 1) / (1000ULL * maxVelocityQ8);
+    uint32_t accelerationFrames = isqrt((distance * SCURVE_PEAK_ACCELERATION_X1000) / (1000ULL * maxAccelerationQ8)) + 1;
+    uint32_t blendFrames = (velocity * SCURVE_BLEND_ACCELERATION_X1000 + 1000ULL * maxAccelerationQ8 - 1) / (1000ULL * maxAccelerationQ8);
+    moveFrames = max(max(velocityFrames, accelerationFrames), blendFrames);
+
+    bool towards = (int64_t)moveVelocityQ8 * moveDistanceQ8 > 0;
+    if (velocity == 0 || (towards && distance * 1000 >= velocity * moveFrames * SCURVE_BLEND_REVERSAL_X1000)) {
+        return;
+    }
+
+    // Too fast to blend into the move without turning back, so brake. Braking may take up to twice
+    // the acceleration limit, so the axis does not run far past where it is needed
+    uint32_t stopFrames = max((uint32_t)1, (uint32_t)((velocity * SCURVE_STOP_ACCELERATION_X1000 + 2000ULL * maxAccelerationQ8 - 1) / (2000ULL * maxAccelerationQ8)));
+    uint32_t landFrames = max((uint64_t)1, (2 * distance + velocity - 1) / velocity);
+    if (towards && landFrames >= stopFrames) {
+        // Stop on the target
+        moveFrames = landFrames;
+        return;
+    }
+
+    // Heading away from the target, or unable to stop before it: come to rest first, and move on
+    // to the target from there
+    moveFrames = stopFrames;
+    moveDistanceQ8 = (int32_t)(((int64_t)moveVelocityQ8 * moveFrames) / 2);
+}
+
+/**
+ * @brief Gets the current setpoint.
+ *
+ * @return the current setpoint (state units, rounded).
+ */
+int MotionAxis::getPosition() const {
+    return (positionQ8 + 128) >> 8;
+}
+
+/**
+ * @brief Gets whether the axis has reached its target and stopped.
+ *
+ * @return true if the axis is at rest on its target, false otherwise.
+ */
+bool MotionAxis::isSettled() const {
+    return positionQ8 == targetQ8 && velocityQ8 == 0;
+}
+
+/**
+ * @brief Constructs a new MotionPlanner object with the limits from config.h.
+ */
+MotionPlanner::MotionPlanner():
+    pan(MOTION_PROFILE_LOOK, MOTION_PAN_MAX_VELOCITY, MOTION_PAN_MAX_ACCELERATION, 1000000 / TASK_PERIOD_SERVOS),
+    tilt(MOTION_PROFILE_LOOK, MOTION_TILT_MAX_VELOCITY, MOTION_TILT_MAX_ACCELERATION, 1000000 / TASK_PERIOD_SERVOS),
+    topLid(MOTION_PROFILE_LIDS, MOTION_LID_MAX_VELOCITY, MOTION_LID_MAX_ACCELERATION, 1000000 / TASK_PERIOD_SERVOS),
+    bottomLid(MOTION_PROFILE_LIDS, MOTION_LID_MAX_VELOCITY, MOTION_LID_MAX_ACCELERATION, 1000000 / TASK_PERIOD_SERVOS)
+{}
+
+/**
+ * @brief Advances every axis by one servo frame. Call once per servo frame.
+ *
+ * @param panTarget The pan target (-100 -> 100).
+ * @param tiltTarget The tilt target (-100 -> 100).
+ * @param topLidTarget The top lid target (0 -> 100).
+ * @param bottomLidTarget The bottom lid target (0 -> 100).
+ */
+void MotionPlanner::update(int panTarget, int tiltTarget, int topLidTarget, int bottomLidTarget) {
+    pan.update(panTarget);
+    tilt.update(tiltTarget);
+    topLid.update(topLidTarget);
+    bottomLid.update(bottomLidTarget);
+}
+
+/**
+ * @brief Gets the pan setpoint for this frame.
+ *
+ * @return the pan setpoint.
+ */
+int MotionPlanner::getPan() const {
+    return pan.getPosition();
+}
+
+/**
+ * @brief Gets the tilt setpoint for this frame.
+ *
+ * @return the tilt setpoint.
+ */
+int MotionPlanner::getTilt() const {
+    return tilt.getPosition();
+}
+
+/**
+ * @brief Gets the top lid setpoint for this frame.
+ *
+ * @return the top lid setpoint.
+ */
+int MotionPlanner::getTopLid() const {
+    return topLid.getPosition();
+}
+
+/**
+ * @brief Gets the bottom lid setpoint for this frame.
+ *
+ * @return the bottom lid setpoint.
+ */
+int MotionPlanner::getBottomLid() const {
+    return bottomLid.getPosition();
+}
+
+/**
+ * @brief Gets whether every axis has reached its target.
+ *
+ * @return true if every axis is at rest, false otherwise.
+ */
+bool MotionPlanner::isSettled() const {
+    return pan.isSettled() && tilt.isSettled() && topLid.isSettled() && bottomLid.isSettled();
+}
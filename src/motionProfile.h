@@ -0,0 +1,84 @@
+/**
+ * @file motionProfile.h
+ * @brief Generates smooth per-axis trajectories between the state targets and the servo output.
+ *
+ * The StateManager jumps its targets instantly, which makes the servos slam, draw current spikes
+ * and buzz. Each MotionAxis instead moves towards its target within a velocity and acceleration
+ * limit, emitting one setpoint per servo frame. Two profiles are available:
+ *  - MOTION_TRAPEZOIDAL: constant acceleration up to the velocity limit, then constant deceleration.
+ *    Retargeting mid-move keeps the current velocity.
+ *  - MOTION_SCURVE: a smootherstep ease (zero acceleration at both ends) read from a precomputed
+ *    integer table, with the move duration stretched so neither limit is exceeded. Retargeting
+ *    mid-move blends from the current velocity and acceleration, so the motion stays smooth
+ *    (coming to rest first if the new target is behind it).
+ *
+ * Everything is integer arithmetic; positions are held in Q8 state units.
+ */
+
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum MotionProfileType {
+    MOTION_TRAPEZOIDAL,
+    MOTION_SCURVE
+};
+
+class MotionAxis {
+public:
+    MotionAxis(MotionProfileType profile, uint32_t maxVelocity, uint32_t maxAcceleration, uint32_t frameRateHz);
+
+    int update(int target);
+    void reset(int position);
+
+    int getPosition() const;
+    bool isSettled() const;
+
+private:
+    MotionProfileType profile;
+    int32_t maxVelocityQ8;          // Q8 units per frame
+    int32_t maxAccelerationQ8;      // Q8 units per frame per frame
+
+    int32_t positionQ8;
+    int32_t velocityQ8;
+    int32_t accelerationQ8;         // S-curve only: the change in velocity over the last frame
+    int32_t targetQ8;
+
+    // S-curve move in progress
+    int32_t moveTargetQ8;           // The target it was planned for
+    int32_t moveStartQ8;
+    int32_t moveDistanceQ8;
+    int32_t moveVelocityQ8;         // Velocity and acceleration the move started with
+    int32_t moveAccelerationQ8;
+    uint32_t moveFrames;
+    uint32_t moveFrame;
+
+    void stepTrapezoidal();
+    void stepSCurve();
+    void planSCurve();
+};
+
+class MotionPlanner {
+public:
+    MotionPlanner();
+
+    void update(int panTarget, int tiltTarget, int topLidTarget, int bottomLidTarget);
+
+    int getPan() const;
+    int getTilt() const;
+    int getTopLid() const;
+    int getBottomLid() const;
+    bool isSettled() const;
+
+private:
+    MotionAxis pan;
+    MotionAxis tilt;
+    MotionAxis topLid;
+    MotionAxis bottomLid;
+};
+
+extern MotionPlanner motionPlanner;
+
+#endif // MOTION_PROFILE_H
@@ -0,0 +1,44 @@
+/**
+ * @file Adafruit_PWMServoDriver.h
+ * @brief Host-native stand-in for the Adafruit PCA9685 driver.
+ *
+ * Register writes go through the mock Wire bus so they show up in its transaction and byte counts.
+ */
+
+#ifndef NATIVE_ADAFRUIT_PWM_SERVO_DRIVER_H
+#define NATIVE_ADAFRUIT_PWM_SERVO_DRIVER_H
+
+#include <Wire.h>
+
+class Adafruit_PWMServoDriver {
+public:
+    Adafruit_PWMServoDriver(uint8_t address = 0x40, TwoWire& wire = Wire) : address(address), wire(wire) {}
+
+    bool begin(uint8_t prescale = 0) { (void)prescale; return write8(0x00, 0x00); }
+    void reset() { write8(0x00, 0x80); }
+    void sleep() { write8(0x00, 0x10); }
+    void wakeup() { write8(0x00, 0x00); }
+    void setPWMFreq(float frequency) { (void)frequency; write8(0xFE, 0x79); write8(0x00, 0xA0); }
+    uint8_t setPWM(uint8_t channel, uint16_t on, uint16_t off) {
+        wire.beginTransmission(address);
+        wire.write(0x06 + 4 * channel);
+        wire.write(on & 0xFF);
+        wire.write(on >> 8);
+        wire.write(off & 0xFF);
+        wire.write(off >> 8);
+        return wire.endTransmission();
+    }
+
+private:
+    uint8_t address;
+    TwoWire& wire;
+
+    bool write8(uint8_t reg, uint8_t value) {
+        wire.beginTransmission(address);
+        wire.write(reg);
+        wire.write(value);
+        return wire.endTransmission() == 0;
+    }
+};
+
+#endif // NATIVE_ADAFRUIT_PWM_SERVO_DRIVER_H
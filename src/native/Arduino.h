@@ -0,0 +1,120 @@
+/**
+ * @file Arduino.h
+ * @brief Host-native stand-in for the subset of the Arduino core used by Blinkenstein.
+ *
+ * Only built in the `native` PlatformIO environment. Time, GPIO and ADC are provided by the
+ * native HAL (see nativeHal.h) so they can be scripted and run faster than real time.
+ */
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+#include <string>
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+
+#define NATIVE_CPU_FREQ_MHZ 160     // The clock rate the host cycle counter pretends to run at (ESP32-C3 default)
+
+typedef uint8_t byte;
+typedef void (*voidFuncPtr)(void);
+
+using std::abs;
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define digitalPinToInterrupt(pin) (pin)
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+
+void attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode);
+void detachInterrupt(uint8_t pin);
+
+uint32_t esp_random();
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+class String : public std::string {
+public:
+    String(const char* value = "") : std::string(value) {}
+    String(const std::string& value) : std::string(value) {}
+    String(int value) : std::string(std::to_string(value)) {}
+    String(long value) : std::string(std::to_string(value)) {}
+    String(unsigned int value) : std::string(std::to_string(value)) {}
+    String(unsigned long value) : std::string(std::to_string(value)) {}
+};
+
+inline String operator+(const char* left, const String& right) {
+    return String(std::string(left) + right);
+}
+
+inline String operator+(const String& left, const char* right) {
+    return String(static_cast<const std::string&>(left) + right);
+}
+
+inline String operator+(const String& left, const String& right) {
+    return String(static_cast<const std::string&>(left) + static_cast<const std::string&>(right));
+}
+
+class HardwareSerial {
+public:
+    void begin(unsigned long baud);
+    operator bool() const;
+
+    size_t print(const char* value);
+    size_t print(const String& value);
+    size_t print(long value);
+    size_t println(const char* value = "");
+    size_t println(const String& value);
+    size_t println(long value);
+
+    size_t write(uint8_t value);
+    size_t write(const uint8_t* buffer, size_t length);
+    int availableForWrite();
+    int available();
+    int read();
+    void flush();
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
+
+bool setCpuFrequencyMhz(uint32_t cpuFrequencyMhz);
+uint32_t getCpuFrequencyMhz();
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,48 @@
+/**
+ * @file LittleFS.h
+ * @brief Host-native stand-in for the Arduino LittleFS filesystem.
+ *
+ * Paths are mapped into NATIVE_LITTLEFS_ROOT under the working directory, so files written by the
+ * firmware on the host (e.g. input captures) can be picked up directly.
+ */
+
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define NATIVE_LITTLEFS_ROOT "littlefs"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class File {
+public:
+    File();
+    File(FILE* handle);
+
+    size_t write(const uint8_t* buffer, size_t length);
+    size_t read(uint8_t* buffer, size_t length);
+    size_t size() const;
+    void flush();
+    void close();
+    operator bool() const;
+
+private:
+    std::shared_ptr<FILE> handle;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false);
+    File open(const char* path, const char* mode = FILE_READ);
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* fromPath, const char* toPath);
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // NATIVE_LITTLEFS_H
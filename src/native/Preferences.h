@@ -0,0 +1,39 @@
+/**
+ * @file Preferences.h
+ * @brief Host-native stand-in for the Arduino Preferences (NVS) library.
+ *
+ * Each key is stored as a file under NATIVE_NVS_ROOT/<namespace>/ in the working directory, so a
+ * config stored by the firmware on the host survives to the next run, like NVS does across boots.
+ * Only the byte array accessors are implemented.
+ */
+
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <Arduino.h>
+
+#define NATIVE_NVS_ROOT "nvs"
+
+class Preferences {
+public:
+    Preferences();
+    ~Preferences();
+
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+
+    bool isKey(const char* key);
+    bool remove(const char* key);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buffer, size_t maxLength);
+    size_t putBytes(const char* key, const void* value, size_t length);
+
+private:
+    std::string directory;
+    bool opened;
+    bool readOnly;
+
+    std::string keyPath(const char* key) const;
+};
+
+#endif // NATIVE_PREFERENCES_H
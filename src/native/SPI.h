@@ -0,0 +1,11 @@
+/**
+ * @file SPI.h
+ * @brief Host-native stand-in for the Arduino SPI header (SPI is not used on the host).
+ */
+
+#ifndef NATIVE_SPI_H
+#define NATIVE_SPI_H
+
+#include <Arduino.h>
+
+#endif // NATIVE_SPI_H
@@ -0,0 +1,42 @@
+/**
+ * @file Wire.h
+ * @brief Host-native stand-in for the Arduino I2C (Wire) library.
+ *
+ * Transactions are not sent anywhere. The mock counts transactions and bytes and can be told that
+ * no device is present so the link supervision path can be exercised on the host.
+ */
+
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    TwoWire();
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void setClock(uint32_t frequency);
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    size_t write(const uint8_t* buffer, size_t length);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    int available();
+    int read();
+
+    void setDevicePresent(bool present);
+    unsigned long getTransactionCount() const;
+    unsigned long getByteCount() const;
+
+private:
+    bool devicePresent;
+    size_t pendingBytes;
+    unsigned long transactionCount;
+    unsigned long byteCount;
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_WIRE_H
@@ -0,0 +1,28 @@
+/**
+ * @file esp_sleep.h
+ * @brief Host-native stand-in for the ESP-IDF sleep API (light sleep with timer and GPIO wakeup).
+ *
+ * A light sleep advances the clock by the timer wakeup (instantly in virtual time), or returns at
+ * once if an enabled GPIO wakeup pin is already at its wake level.
+ */
+
+#ifndef NATIVE_ESP_SLEEP_H
+#define NATIVE_ESP_SLEEP_H
+
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_TIMER,
+    ESP_SLEEP_WAKEUP_GPIO,
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+esp_err_t esp_sleep_enable_gpio_wakeup();
+esp_err_t esp_light_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+
+#endif // NATIVE_ESP_SLEEP_H
@@ -0,0 +1,78 @@
+/**
+ * @file loopbackUdpTransport.cpp
+ * @brief Host stand-in for WifiUdpTransport: a UDP socket on the loopback interface.
+ *
+ * Lets the native build take remote control frames from a host program (tools/remote_gaze.py
+ * --udp) or from the automated latency and packet loss test in nativeMain.cpp, with no radio.
+ */
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "loopbackUdpTransport.h"
+
+LoopbackUdpTransport::LoopbackUdpTransport(uint16_t port):
+    port(port),
+    socketFd(-1),
+    peer(),
+    hasPeer(false)
+{}
+
+LoopbackUdpTransport::~LoopbackUdpTransport() {
+    end();
+}
+
+bool LoopbackUdpTransport::begin() {
+    end();
+    socketFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socketFd < 0) {
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(socketFd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        end();
+        return false;
+    }
+    return true;
+}
+
+size_t LoopbackUdpTransport::receive(uint8_t* buffer, size_t capacity) {
+    if (socketFd < 0) {
+        return 0;
+    }
+
+    struct sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    ssize_t length = recvfrom(socketFd, buffer, capacity, MSG_DONTWAIT, (struct sockaddr*)&from, &fromLength);
+    if (length <= 0) {
+        return 0;
+    }
+    peer = from;
+    hasPeer = true;
+    return length;
+}
+
+bool LoopbackUdpTransport::send(const uint8_t* data, size_t length) {
+    if (socketFd < 0 || !hasPeer) {
+        return false;
+    }
+    return sendto(socketFd, data, length, MSG_DONTWAIT, (struct sockaddr*)&peer, sizeof(peer)) == (ssize_t)length;
+}
+
+/**
+ * @brief Closes the socket, so the port can be bound again (by another test run).
+ */
+void LoopbackUdpTransport::end() {
+    if (socketFd >= 0) {
+        close(socketFd);
+        socketFd = -1;
+    }
+    hasPeer = false;
+}
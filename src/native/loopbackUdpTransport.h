@@ -0,0 +1,38 @@
+/**
+ * @file loopbackUdpTransport.h
+ * @brief Host stand-in for WifiUdpTransport: a UDP socket on the loopback interface.
+ *
+ * Lets the native build take remote control frames from a host program (tools/remote_gaze.py
+ * --udp) or from the automated latency and packet loss test in nativeMain.cpp, with no radio.
+ */
+
+#ifndef LOOPBACK_UDP_TRANSPORT_H
+#define LOOPBACK_UDP_TRANSPORT_H
+
+#include <netinet/in.h>
+#include "../config.h"
+#include "../remoteTransport.h"
+
+class LoopbackUdpTransport : public RemoteTransport {
+public:
+    LoopbackUdpTransport(uint16_t port);
+    ~LoopbackUdpTransport();
+
+    bool begin() override;
+    size_t receive(uint8_t* buffer, size_t capacity) override;
+    bool send(const uint8_t* data, size_t length) override;
+
+    void end();
+
+private:
+    uint16_t port;
+    int socketFd;
+    struct sockaddr_in peer;    // Where the last datagram came from
+    bool hasPeer;
+};
+
+#if defined(REMOTE_CONTROL) && defined(REMOTE_UDP)
+extern LoopbackUdpTransport remoteTransport;
+#endif
+
+#endif // LOOPBACK_UDP_TRANSPORT_H
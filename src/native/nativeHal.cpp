@@ -0,0 +1,604 @@
+/**
+ * @file nativeHal.cpp
+ * @brief Thin hardware abstraction that backs the Arduino stand-in on the host.
+ *
+ * Provides a clock that can run in real time or be advanced manually (virtual time), scriptable
+ * analog and digital inputs (with edge interrupts), a CPU frequency setting, light sleep with
+ * timer and GPIO wakeup, a switch to mute Serial output, a file descriptor (such as a pty) to stand in for the
+ * serial port and a heap allocation counter for the benchmarks. All state is atomic so the pipelined tasks can use it.
+ */
+
+#include <chrono>
+#include <new>
+#include <thread>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "nativeHal.h"
+#include "Wire.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+
+NativeHal nativeHal;
+HardwareSerial Serial;
+TwoWire Wire;
+EspClass ESP;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static uint32_t randomState = 1;
+
+/**
+ * @brief Constructs a new NativeHal object. Analog inputs rest at mid-scale and digital inputs read HIGH (pulled up).
+ */
+NativeHal::NativeHal():
+    virtualTime(false),
+    virtualMicros(0),
+    cpuFrequencyMhz(NATIVE_CPU_FREQ_MHZ),
+    sleepTimerMicros(0),
+    gpioWakeupEnabled(false),
+    lightSleepCount(0),
+    serialEnabled(true),
+    serialPort(-1),
+    allocationCount(0)
+{
+    for (uint8_t pin = 0; pin < NATIVE_PIN_COUNT; pin++) {
+        analogInputs[pin] = 2048;
+        digitalInputs[pin] = HIGH;
+        interruptCallbacks[pin] = nullptr;
+        interruptModes[pin] = 0;
+        wakeupLevels[pin] = -1;
+    }
+}
+
+/**
+ * @brief Switches between the real clock and a virtual clock that only moves when advanced.
+ *
+ * @param enabled true to use virtual time.
+ */
+void NativeHal::useVirtualTime(bool enabled) {
+    virtualTime = enabled;
+}
+
+/**
+ * @brief Gets whether the virtual clock is in use.
+ *
+ * @return true if using virtual time.
+ */
+bool NativeHal::isVirtualTime() const {
+    return virtualTime;
+}
+
+/**
+ * @brief Advances the virtual clock.
+ *
+ * @param us The number of microseconds to advance.
+ */
+void NativeHal::advanceMicros(unsigned long us) {
+    virtualMicros += us;
+}
+
+/**
+ * @brief Sets the virtual clock (used to restart a scenario at time zero).
+ *
+ * @param us The new time since start (us).
+ */
+void NativeHal::setMicros(unsigned long us) {
+    virtualMicros = us;
+}
+
+/**
+ * @brief Gets the current time from the active clock.
+ *
+ * @return the time since start (us).
+ */
+unsigned long NativeHal::getMicros() const {
+    if (virtualTime) {
+        return (unsigned long)virtualMicros.load();
+    }
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/**
+ * @brief Sets the value returned by analogRead() for a pin.
+ *
+ * @param pin The pin.
+ * @param value The value (0 -> 4095).
+ */
+void NativeHal::setAnalogInput(uint8_t pin, int value) {
+    if (pin < NATIVE_PIN_COUNT) {
+        analogInputs[pin] = value;
+    }
+}
+
+/**
+ * @brief Gets the value returned by analogRead() for a pin.
+ *
+ * @param pin The pin.
+ * @return the value (0 -> 4095).
+ */
+int NativeHal::getAnalogInput(uint8_t pin) const {
+    return pin < NATIVE_PIN_COUNT ? analogInputs[pin].load() : 0;
+}
+
+/**
+ * @brief Sets the level returned by digitalRead() for a pin and fires any matching interrupt.
+ *
+ * @param pin The pin.
+ * @param value The level (LOW or HIGH).
+ */
+void NativeHal::setDigitalInput(uint8_t pin, int value) {
+    if (pin >= NATIVE_PIN_COUNT) {
+        return;
+    }
+
+    int previous = digitalInputs[pin].exchange(value);
+    voidFuncPtr callback = interruptCallbacks[pin];
+    if (callback == nullptr || previous == value) {
+        return;
+    }
+
+    int mode = interruptModes[pin];
+    if (mode == CHANGE || (mode == RISING && value == HIGH) || (mode == FALLING && value == LOW)) {
+        callback();
+    }
+}
+
+/**
+ * @brief Gets the level returned by digitalRead() for a pin.
+ *
+ * @param pin The pin.
+ * @return the level (LOW or HIGH).
+ */
+int NativeHal::getDigitalInput(uint8_t pin) const {
+    return pin < NATIVE_PIN_COUNT ? digitalInputs[pin].load() : LOW;
+}
+
+/**
+ * @brief Registers an edge interrupt on a pin.
+ *
+ * @param pin The pin.
+ * @param callback The interrupt handler, or nullptr to detach.
+ * @param mode RISING, FALLING or CHANGE.
+ */
+void NativeHal::attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode) {
+    if (pin < NATIVE_PIN_COUNT) {
+        interruptModes[pin] = mode;
+        interruptCallbacks[pin] = callback;
+    }
+}
+
+/**
+ * @brief Records the CPU frequency set by setCpuFrequencyMhz(). The clock does not change speed.
+ *
+ * @param mhz The CPU frequency (MHz).
+ */
+void NativeHal::setCpuFrequency(uint32_t mhz) {
+    cpuFrequencyMhz = mhz;
+}
+
+/**
+ * @brief Gets the CPU frequency last set.
+ *
+ * @return the CPU frequency (MHz).
+ */
+uint32_t NativeHal::getCpuFrequency() const {
+    return cpuFrequencyMhz;
+}
+
+/**
+ * @brief Configures the light sleep wakeup sources.
+ *
+ * @param timerMicros The timer wakeup (us), or 0 to leave it unchanged.
+ * @param gpioPin A pin to wake on (NATIVE_PIN_COUNT to leave the pins unchanged).
+ * @param gpioLevel The level to wake on (LOW or HIGH), or -1 to disable the pin.
+ */
+void NativeHal::setSleepWakeup(uint64_t timerMicros, uint8_t gpioPin, int gpioLevel) {
+    if (timerMicros > 0) {
+        sleepTimerMicros = timerMicros;
+    }
+    if (gpioPin < NATIVE_PIN_COUNT) {
+        wakeupLevels[gpioPin] = gpioLevel;
+    }
+}
+
+/**
+ * @brief Lets the pins configured with setSleepWakeup() wake a light sleep.
+ */
+void NativeHal::enableGpioWakeup() {
+    gpioWakeupEnabled = true;
+}
+
+/**
+ * @brief Light sleeps until the timer wakeup, or not at all if a wakeup pin is already at its level.
+ *
+ * @return true if woken by the timer, false if woken by a GPIO.
+ */
+bool NativeHal::lightSleep() {
+    lightSleepCount++;
+    if (gpioWakeupEnabled) {
+        for (uint8_t pin = 0; pin < NATIVE_PIN_COUNT; pin++) {
+            if (wakeupLevels[pin] >= 0 && digitalInputs[pin] == wakeupLevels[pin]) {
+                return false;
+            }
+        }
+    }
+    if (virtualTime) {
+        advanceMicros(sleepTimerMicros);
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(sleepTimerMicros.load()));
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the number of light sleeps started.
+ *
+ * @return the light sleep count.
+ */
+unsigned long NativeHal::getLightSleepCount() const {
+    return lightSleepCount;
+}
+
+/**
+ * @brief Enables or mutes Serial output (muted while benchmarking).
+ *
+ * @param enabled true to print Serial output to stdout.
+ */
+void NativeHal::setSerialEnabled(bool enabled) {
+    serialEnabled = enabled;
+}
+
+/**
+ * @brief Gets whether Serial output is printed.
+ *
+ * @return true if Serial output is printed.
+ */
+bool NativeHal::isSerialEnabled() const {
+    return serialEnabled;
+}
+
+/**
+ * @brief Connects Serial to a file descriptor, such as the master side of a pty. Writes that would
+ * block are dropped, as on a full UART.
+ *
+ * @param fd A non-blocking file descriptor, or -1 to go back to stdout (with no input).
+ */
+void NativeHal::setSerialPort(int fd) {
+    serialPort = fd;
+}
+
+/**
+ * @brief Gets the file descriptor Serial is connected to.
+ *
+ * @return the file descriptor, or -1 for stdout.
+ */
+int NativeHal::getSerialPort() const {
+    return serialPort;
+}
+
+/**
+ * @brief Gets the number of heap allocations made so far.
+ *
+ * @return the number of allocations.
+ */
+unsigned long NativeHal::getAllocationCount() const {
+    return allocationCount;
+}
+
+/**
+ * @brief Counts a heap allocation (called from operator new).
+ */
+void NativeHal::countAllocation() {
+    allocationCount++;
+}
+
+// Count every heap allocation so the benchmarks can report allocations per operation
+void* operator new(size_t size) {
+    nativeHal.countAllocation();
+    void* pointer = malloc(size ? size : 1);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+// Arduino core
+unsigned long millis() {
+    return nativeHal.getMicros() / 1000;
+}
+
+unsigned long micros() {
+    return nativeHal.getMicros();
+}
+
+void delay(unsigned long ms) {
+    delayMicroseconds(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    // Delays move the virtual clock on instead of sleeping
+    if (nativeHal.isVirtualTime()) {
+        nativeHal.advanceMicros(us);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+int digitalRead(uint8_t pin) {
+    return nativeHal.getDigitalInput(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    (void)pin;
+    (void)value;
+}
+
+int analogRead(uint8_t pin) {
+    return nativeHal.getAnalogInput(pin);
+}
+
+void attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode) {
+    nativeHal.attachInterrupt(pin, callback, mode);
+}
+
+void detachInterrupt(uint8_t pin) {
+    nativeHal.attachInterrupt(pin, nullptr, 0);
+}
+
+uint32_t esp_random() {
+    // xorshift32 keeps runs repeatable for a given seed (the device uses its hardware RNG)
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+long random(long howBig) {
+    if (howBig <= 0) {
+        return 0;
+    }
+    return esp_random() % howBig;
+}
+
+long random(long howSmall, long howBig) {
+    if (howSmall >= howBig) {
+        return howSmall;
+    }
+    return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+    randomState = seed ? (uint32_t)seed : 1;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// Serial (stdout, or the file descriptor set with setSerialPort)
+void HardwareSerial::begin(unsigned long baud) {
+    (void)baud;
+}
+
+HardwareSerial::operator bool() const {
+    return true;
+}
+
+size_t HardwareSerial::print(const char* value) {
+    return write((const uint8_t*)value, strlen(value));
+}
+
+size_t HardwareSerial::print(const String& value) {
+    return print(value.c_str());
+}
+
+size_t HardwareSerial::print(long value) {
+    return print(String(value));
+}
+
+size_t HardwareSerial::println(const char* value) {
+    return print(value) + print("\n");
+}
+
+size_t HardwareSerial::println(const String& value) {
+    return println(value.c_str());
+}
+
+size_t HardwareSerial::println(long value) {
+    return println(String(value));
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t length) {
+    if (!nativeHal.isSerialEnabled()) {
+        return length;
+    }
+    int fd = nativeHal.getSerialPort();
+    if (fd < 0) {
+        return fwrite(buffer, 1, length, stdout);
+    }
+    ssize_t written = ::write(fd, buffer, length);
+    return written > 0 ? written : 0;
+}
+
+int HardwareSerial::availableForWrite() {
+    return 256;
+}
+
+int HardwareSerial::available() {
+    int fd = nativeHal.getSerialPort();
+    int count = 0;
+    if (fd < 0 || ioctl(fd, FIONREAD, &count) != 0) {
+        return 0;
+    }
+    return count;
+}
+
+int HardwareSerial::read() {
+    int fd = nativeHal.getSerialPort();
+    uint8_t value;
+    if (fd < 0 || ::read(fd, &value, 1) != 1) {
+        return -1;
+    }
+    return value;
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+// ESP
+
+/**
+ * @brief Gets a cycle count derived from the real clock, so profiling measures host time even in virtual time.
+ *
+ * @return the cycles since start at NATIVE_CPU_FREQ_MHZ (wraps like the hardware counter).
+ */
+uint32_t EspClass::getCycleCount() {
+    uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+    return (uint32_t)(nanoseconds * NATIVE_CPU_FREQ_MHZ / 1000);
+}
+
+bool setCpuFrequencyMhz(uint32_t cpuFrequencyMhz) {
+    nativeHal.setCpuFrequency(cpuFrequencyMhz);
+    return true;
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return nativeHal.getCpuFrequency();
+}
+
+// Sleep
+static esp_sleep_wakeup_cause_t wakeupCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+    nativeHal.setSleepWakeup(time_in_us, NATIVE_PIN_COUNT, -1);
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+    nativeHal.enableGpioWakeup();
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    nativeHal.setSleepWakeup(0, gpio_num, intr_type == GPIO_INTR_LOW_LEVEL ? LOW : HIGH);
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num) {
+    nativeHal.setSleepWakeup(0, gpio_num, -1);
+    return ESP_OK;
+}
+
+// The native interrupts are only raised by setDigitalInput(), so there is nothing to mask
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    (void)gpio_num;
+    (void)intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+    (void)gpio_num;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+    (void)gpio_num;
+    return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+    wakeupCause = nativeHal.lightSleep() ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_GPIO;
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return wakeupCause;
+}
+
+// Wire
+TwoWire::TwoWire():
+    devicePresent(true),
+    pendingBytes(0),
+    transactionCount(0),
+    byteCount(0)
+{}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda;
+    (void)scl;
+    (void)frequency;
+    return true;
+}
+
+void TwoWire::setClock(uint32_t frequency) {
+    (void)frequency;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    (void)address;
+    pendingBytes = 1;
+}
+
+size_t TwoWire::write(uint8_t value) {
+    (void)value;
+    pendingBytes++;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* buffer, size_t length) {
+    (void)buffer;
+    pendingBytes += length;
+    return length;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    transactionCount++;
+    byteCount += pendingBytes;
+    pendingBytes = 0;
+    return devicePresent ? 0 : 2; // 2 = address NACK
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+    (void)address;
+    transactionCount++;
+    byteCount += 1 + quantity;
+    return devicePresent ? quantity : 0;
+}
+
+int TwoWire::available() {
+    return 0;
+}
+
+int TwoWire::read() {
+    return 0;
+}
+
+void TwoWire::setDevicePresent(bool present) {
+    devicePresent = present;
+}
+
+unsigned long TwoWire::getTransactionCount() const {
+    return transactionCount;
+}
+
+unsigned long TwoWire::getByteCount() const {
+    return byteCount;
+}
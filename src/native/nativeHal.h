@@ -0,0 +1,69 @@
+/**
+ * @file nativeHal.h
+ * @brief Thin hardware abstraction that backs the Arduino stand-in on the host.
+ *
+ * Provides a clock that can run in real time or be advanced manually (virtual time), scriptable
+ * analog and digital inputs (with edge interrupts), a CPU frequency setting, light sleep with
+ * timer and GPIO wakeup, a switch to mute Serial output, a file descriptor (such as a pty) to stand in for the
+ * serial port and a heap allocation counter for the benchmarks. All state is atomic so the pipelined tasks can use it.
+ */
+
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#define NATIVE_PIN_COUNT 48
+
+class NativeHal {
+public:
+    NativeHal();
+
+    void useVirtualTime(bool enabled);
+    bool isVirtualTime() const;
+    void advanceMicros(unsigned long us);
+    void setMicros(unsigned long us);
+    unsigned long getMicros() const;
+
+    void setAnalogInput(uint8_t pin, int value);
+    int getAnalogInput(uint8_t pin) const;
+    void setDigitalInput(uint8_t pin, int value);
+    int getDigitalInput(uint8_t pin) const;
+    void attachInterrupt(uint8_t pin, voidFuncPtr callback, int mode);
+
+    void setCpuFrequency(uint32_t mhz);
+    uint32_t getCpuFrequency() const;
+    void setSleepWakeup(uint64_t timerMicros, uint8_t gpioPin, int gpioLevel);
+    void enableGpioWakeup();
+    bool lightSleep();
+    unsigned long getLightSleepCount() const;
+
+    void setSerialEnabled(bool enabled);
+    bool isSerialEnabled() const;
+    void setSerialPort(int fd);
+    int getSerialPort() const;
+
+    unsigned long getAllocationCount() const;
+    void countAllocation();
+
+private:
+    std::atomic<bool> virtualTime;
+    std::atomic<uint64_t> virtualMicros;
+    std::atomic<int> analogInputs[NATIVE_PIN_COUNT];
+    std::atomic<int> digitalInputs[NATIVE_PIN_COUNT];
+    std::atomic<voidFuncPtr> interruptCallbacks[NATIVE_PIN_COUNT];
+    std::atomic<int> interruptModes[NATIVE_PIN_COUNT];
+    std::atomic<uint32_t> cpuFrequencyMhz;
+    std::atomic<uint64_t> sleepTimerMicros;
+    std::atomic<int> wakeupLevels[NATIVE_PIN_COUNT];
+    std::atomic<bool> gpioWakeupEnabled;
+    std::atomic<unsigned long> lightSleepCount;
+    std::atomic<bool> serialEnabled;
+    std::atomic<int> serialPort;
+    std::atomic<unsigned long> allocationCount;
+};
+
+extern NativeHal nativeHal;
+
+#endif // NATIVE_HAL_H
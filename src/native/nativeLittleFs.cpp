@@ -0,0 +1,93 @@
+/**
+ * @file nativeLittleFs.cpp
+ * @brief Host-native stand-in for the Arduino LittleFS filesystem.
+ *
+ * Paths are mapped into NATIVE_LITTLEFS_ROOT under the working directory, so files written by the
+ * firmware on the host (e.g. input captures) can be picked up directly.
+ */
+
+#include <sys/stat.h>
+#include "LittleFS.h"
+
+LittleFSFS LittleFS;
+
+/**
+ * @brief Maps a LittleFS path onto the host.
+ *
+ * @param path The LittleFS path (e.g. "/capture.bin").
+ * @return the host path.
+ */
+static std::string hostPath(const char* path) {
+    return std::string(NATIVE_LITTLEFS_ROOT) + (path[0] == '/' ? "" : "/") + path;
+}
+
+/**
+ * @brief Constructs a closed File.
+ */
+File::File() {}
+
+/**
+ * @brief Constructs a File around an open stdio handle (closed when the last copy goes away).
+ *
+ * @param handle The stdio handle, or nullptr.
+ */
+File::File(FILE* handle) {
+    if (handle) {
+        this->handle = std::shared_ptr<FILE>(handle, fclose);
+    }
+}
+
+size_t File::write(const uint8_t* buffer, size_t length) {
+    return handle ? fwrite(buffer, 1, length, handle.get()) : 0;
+}
+
+size_t File::read(uint8_t* buffer, size_t length) {
+    return handle ? fread(buffer, 1, length, handle.get()) : 0;
+}
+
+size_t File::size() const {
+    if (!handle) {
+        return 0;
+    }
+    struct stat status;
+    return fstat(fileno(handle.get()), &status) == 0 ? status.st_size : 0;
+}
+
+void File::flush() {
+    if (handle) {
+        fflush(handle.get());
+    }
+}
+
+void File::close() {
+    handle.reset();
+}
+
+File::operator bool() const {
+    return (bool)handle;
+}
+
+bool LittleFSFS::begin(bool formatOnFail) {
+    (void)formatOnFail;
+    mkdir(NATIVE_LITTLEFS_ROOT, 0755);
+    struct stat status;
+    return stat(NATIVE_LITTLEFS_ROOT, &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    std::string binaryMode = std::string(mode) + "b";
+    return File(fopen(hostPath(path).c_str(), binaryMode.c_str()));
+}
+
+bool LittleFSFS::exists(const char* path) {
+    struct stat status;
+    return stat(hostPath(path).c_str(), &status) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::rename(const char* fromPath, const char* toPath) {
+    return ::rename(hostPath(fromPath).c_str(), hostPath(toPath).c_str()) == 0;
+}
@@ -0,0 +1,1297 @@
+/**
+ * @file nativeMain.cpp
+ * @brief Host entry point for the `native` environment.
+ *
+ * Usage:
+ *   program [bench] [iterations]                       Benchmark each stage under scripted inputs (default)
+ *   program run [seconds]                              Run setup() and loop() against the native HAL with scripted inputs
+ *   program replay <capture> [pulses.csv] [reference]  Replay an input capture and diff the servo pulses against a reference
+ *   program takeover [capture]                         Measure the manual takeover latency over recorded gestures (or a capture)
+ *   program synthetic                                  Drive the input stage from SyntheticAdcSampler waveforms and check the filters and takeover
+ *   program channels                                   Check the servo channel table against the compile-time ServoChannel lookup tables
+ *   program config                                     Check the runtime config: rejected blobs, a hot swap picked up by the stages, NVS round trip
+ *   program remote [seconds]                           Run setup() and loop() in real time with the serial port on a pty, for tools/remote_gaze.py
+ *   program udp [lossPercent]                          Stream setpoints over loopback UDP with jitter, loss, stale and damaged datagrams and check the reports
+ *
+ * The benchmarks run in virtual time so results do not depend on wall-clock pacing. Each reports
+ * the mean time per call and the number of heap allocations per call.
+ */
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <fcntl.h>
+#include <functional>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "nativeHal.h"
+#include "../config.h"
+#include "../analogReadSampler.h"
+#include "../syntheticAdcSampler.h"
+#include "../behaviourModel.h"
+#include "../inputHandler.h"
+#include "../inputFilters.h"
+#include "../stateManager.h"
+#include "../servoController.h"
+#include "../motionProfile.h"
+#include "../poissonTimer.h"
+#include "../randomGenerator.h"
+#include "../loopProfiler.h"
+#include "../periodicTask.h"
+#include "../captureLog.h"
+#include "../inputCapture.h"
+#include "../powerManager.h"
+#include "../runtimeConfig.h"
+#include "../servoCalibration.h"
+#include "../remoteControl.h"
+#ifdef REMOTE_UDP
+#include "loopbackUdpTransport.h"
+#endif
+
+#define BENCHMARK_DEFAULT_ITERATIONS 200000
+#define BENCHMARK_BATCH_SIZE 1000   // Calls between untimed batch setups (keeps the autonomous bot from falling asleep)
+
+#define TAKEOVER_REST_MILLIS (MANUAL_CONTROL_TIMEOUT + 1000)    // Rest before each gesture, so the bot is autonomous when it starts
+#define TAKEOVER_GESTURE_MILLIS 5000    // How long each gesture is recorded for
+#define TAKEOVER_DRIFT_GESTURE_MILLIS 65000     // How long the slow drift gestures are recorded for (well past the displacement thresholds)
+#define TAKEOVER_ONSET_THRESHOLD 64     // How far a raw input must move from its rest reading to start a gesture (ADC units)
+#define TAKEOVER_MAX_LATENCY 1          // Input updates a deliberate gesture may take to switch to manual control
+
+#define SYNTHETIC_CASE_MILLIS 5000      // How long each synthetic waveform runs for, after TAKEOVER_REST_MILLIS at rest
+
+#define CHANNEL_CHECK_STATE_MARGIN 10    // How far past each axis' range the states are checked (the table must clamp them)
+
+#define UDP_TEST_DEFAULT_LOSS 10            // Percentage of setpoints the sender drops
+#define UDP_TEST_STREAM_MILLIS 10000        // How long setpoints are streamed for
+#define UDP_TEST_PERIOD_MICROS 10000        // Setpoint interval (100 Hz)
+#define UDP_TEST_JITTER_MICROS ((REMOTE_JITTER_DELAY - TASK_PERIOD_STATE) / 2)  // Longest delivery delay added to a setpoint (leaves room for a state period and thread wakeups, so none are late)
+#define UDP_TEST_STALE_INTERVAL 50          // Every this many setpoints, the one from UDP_TEST_STALE_AGE back is sent again
+#define UDP_TEST_STALE_AGE 10
+#define UDP_TEST_DAMAGED_SEQUENCE 321       // The setpoint that is also sent with a damaged byte
+#define UDP_TEST_CLOCK_OFFSET 123456789UL   // Host clock minus bot clock (us)
+
+void setup();
+void loop();
+
+static volatile int benchmarkSink;
+
+/**
+ * @brief One input update, as recorded in a capture.
+ */
+struct RecordedInput {
+    uint32_t timestampMicros;
+    RawInputs raw;
+};
+
+/**
+ * @brief Drives the analog and digital inputs from a repeatable script.
+ *
+ * The joystick sweeps in slow triangle waves, the pot ramps, and the blink button is pressed for
+ * 100ms every 2 seconds.
+ *
+ * @param currentMillis The current time (ms).
+ * @param moving false to hold the joystick and pot still (so the bot stays autonomous).
+ */
+static void applyScriptedInputs(unsigned long currentMillis, bool moving) {
+    if (moving) {
+        int sweep = currentMillis % 4000;
+        nativeHal.setAnalogInput(PIN_JOYSTICK_X, sweep < 2000 ? sweep * 2 : (4000 - sweep) * 2);
+        int tilt = (currentMillis + 1000) % 3000;
+        nativeHal.setAnalogInput(PIN_JOYSTICK_Y, tilt < 1500 ? tilt * 2 + 500 : (3000 - tilt) * 2 + 500);
+        nativeHal.setAnalogInput(PIN_EYELIDS_POT, (currentMillis / 2) % 4096);
+        nativeHal.setDigitalInput(PIN_BLINK_BUTTON, (currentMillis % 2000) < 100 ? LOW : HIGH);
+    } else {
+        nativeHal.setAnalogInput(PIN_JOYSTICK_X, 2048 - JOYSTICK_DRIFT_ADUSTMENT_X);
+        nativeHal.setAnalogInput(PIN_JOYSTICK_Y, 2048 - JOYSTICK_DRIFT_ADUSTMENT_Y);
+        nativeHal.setAnalogInput(PIN_EYELIDS_POT, 2048);
+        nativeHal.setDigitalInput(PIN_BLINK_BUTTON, HIGH);
+    }
+}
+
+/**
+ * @brief Times a benchmark body and prints the mean time and allocations per call.
+ *
+ * @param name The name of the benchmark.
+ * @param iterations The number of times to call the body.
+ * @param body The operation to time. Receives the iteration index.
+ * @param batchSetup Optional untimed setup run before every BENCHMARK_BATCH_SIZE calls.
+ */
+static void runBenchmark(const char* name, unsigned long iterations, const std::function<void(unsigned long)>& body,
+                         const std::function<void()>& batchSetup = nullptr) {
+    double nanoseconds = 0;
+    unsigned long allocations = 0;
+
+    for (unsigned long batchStart = 0; batchStart < iterations; batchStart += BENCHMARK_BATCH_SIZE) {
+        if (batchSetup) {
+            batchSetup();
+        }
+
+        unsigned long batchEnd = min(iterations, batchStart + BENCHMARK_BATCH_SIZE);
+        unsigned long allocationsBefore = nativeHal.getAllocationCount();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        for (unsigned long i = batchStart; i < batchEnd; i++) {
+            body(i);
+        }
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        nanoseconds += std::chrono::duration<double, std::nano>(end - start).count();
+        allocations += nativeHal.getAllocationCount() - allocationsBefore;
+    }
+
+    printf("%-48s %10.1f ns/op %10.3f allocs/op\n", name, nanoseconds / iterations, (double)allocations / iterations);
+}
+
+/**
+ * @brief Benchmarks each stage in isolation under scripted inputs.
+ *
+ * @param iterations The number of calls per benchmark.
+ */
+static void runBenchmarks(unsigned long iterations) {
+    nativeHal.useVirtualTime(true);
+    nativeHal.setSerialEnabled(false);
+
+    AnalogReadSampler sampler;
+    InputHandler input(sampler);
+
+    printf("Blinkenstein native benchmarks (%lu iterations)\n", iterations);
+
+    // Input sampling at the input task rate
+    nativeHal.setMicros(0);
+    runBenchmark("InputHandler::update()", iterations, [&](unsigned long) {
+        nativeHal.advanceMicros(TASK_PERIOD_INPUT);
+        applyScriptedInputs(millis(), true);
+        input.update();
+    });
+
+    // Behaviour under manual control at the state task rate
+    {
+        InputHandler manualInput(sampler);
+        StateManager state(manualInput);
+        nativeHal.setMicros(0);
+        runBenchmark("StateManager::update() manual", iterations, [&](unsigned long) {
+            nativeHal.advanceMicros(TASK_PERIOD_STATE);
+            applyScriptedInputs(millis(), true);
+            manualInput.update();
+            state.update();
+        });
+    }
+
+    // Behaviour under autonomous control at the state task rate (most ticks only check the event timers)
+    {
+        InputHandler* autoInput = nullptr;
+        StateManager* state = nullptr;
+        runBenchmark("StateManager::update() autonomous", iterations, [&](unsigned long) {
+            nativeHal.advanceMicros(TASK_PERIOD_STATE);
+            state->update();
+        }, [&]() {
+            // Start each batch with a fresh bot that has just handed over to autonomous control
+            delete state;
+            delete autoInput;
+            nativeHal.setMicros(0);
+            applyScriptedInputs(0, false);
+            autoInput = new InputHandler(sampler);
+            state = new StateManager(*autoInput);
+            state->begin(1);
+            autoInput->update();
+            nativeHal.advanceMicros((MANUAL_CONTROL_TIMEOUT + 1000) * 1000UL);
+            autoInput->update();
+        });
+        delete state;
+        delete autoInput;
+    }
+
+    // The cost of an event firing: sampling the next interval and drawing the behaviour outcome
+    {
+        Prng randomGenerator(1);
+        PoissonTimer timer(AUTO_LOOK_TWITCH_INTERVAL, randomGenerator);
+        unsigned long eventMillis = 0;
+        timer.start(eventMillis);
+        runBenchmark("PoissonTimer::poll() firing", iterations, [&](unsigned long) {
+            eventMillis = timer.getNextMillis();
+            timer.poll(eventMillis);
+        });
+
+        BehaviourModel model(AUTO_BEHAVIOUR_TABLE.outcomes, BEHAVIOUR_TABLE_ROWS);
+        runBenchmark("BehaviourModel::decide()", iterations, [&](unsigned long) {
+            model.decide(randomGenerator.uniform(model.getOutcomeWeight()));
+        });
+    }
+
+    // Bounded draws from each generator, against Arduino random() (a modulo of esp_random() on the device)
+    {
+        volatile uint32_t sink = 0;
+        Xoshiro128StarStar xoshiro(1);
+        Pcg32 pcg(1);
+        runBenchmark("Xoshiro128StarStar::uniform()", iterations, [&](unsigned long) {
+            sink = xoshiro.uniform(AUTO_LOOK_PAN_POSITION_COUNT);
+        });
+        runBenchmark("Pcg32::uniform()", iterations, [&](unsigned long) {
+            sink = pcg.uniform(AUTO_LOOK_PAN_POSITION_COUNT);
+        });
+        runBenchmark("random() (Arduino)", iterations, [&](unsigned long) {
+            sink = random(0, AUTO_LOOK_PAN_POSITION_COUNT);
+        });
+        (void)sink;
+    }
+
+    // Motion profiles at the servo frame rate
+    {
+        MotionPlanner planner;
+        runBenchmark("MotionPlanner::update()", iterations, [&](unsigned long i) {
+            int target = (i / 30) % 2 ? 100 : -100;
+            planner.update(target, -target, i % 60 < 10 ? 0 : 80, i % 60 < 10 ? 0 : 80);
+        });
+    }
+
+    // Servo output, with the pulses changing every frame and with an unchanged frame
+    {
+        ServoController servos;
+        servos.begin();
+        runBenchmark("ServoController::update() changing", iterations, [&](unsigned long i) {
+            int value = (int)(i % 200) - 100;
+            servos.update(value, -value, (i % 100), (i % 100));
+        });
+        runBenchmark("ServoController::update() unchanged", iterations, [&](unsigned long) {
+            servos.update(10, -10, 50, 50);
+        });
+    }
+
+    // Input filters, compared against the previous floating point EMA
+    {
+        EmaFilter ema(TO_Q15(SMOOTHING_FACTOR));
+        OneEuroFilter oneEuro(1000000 / TASK_PERIOD_INPUT, INPUT_FILTER_MIN_CUTOFF, INPUT_FILTER_BETA, INPUT_FILTER_DERIVATIVE_CUTOFF);
+        MedianFilter<INPUT_MEDIAN_WINDOW> median;
+        int smoothed = 0;
+        runBenchmark("float EMA (previous smoothing path)", iterations, [&](unsigned long i) {
+            smoothed = (SMOOTHING_FACTOR * (int)(i & 4095)) + ((1 - SMOOTHING_FACTOR) * smoothed);
+            benchmarkSink = smoothed;
+        });
+        runBenchmark("EmaFilter::update() (Q15)", iterations, [&](unsigned long i) {
+            benchmarkSink = ema.update(i & 4095);
+        });
+        runBenchmark("MedianFilter::update()", iterations, [&](unsigned long i) {
+            benchmarkSink = median.update(i & 4095);
+        });
+        runBenchmark("OneEuroFilter::update()", iterations, [&](unsigned long i) {
+            benchmarkSink = oneEuro.update(i & 4095);
+        });
+    }
+
+    printf("Note: host timings show relative cost only; the ESP32-C3 has no FPU, so float paths cost far more on target.\n");
+    printf("Build with LOOP_PROFILER and send '%c' over serial for the filter cycles per sample on target.\n", PROFILER_FILTER_BENCH_KEY);
+}
+
+/**
+ * @brief Stops the tasks started by setup().
+ */
+static void stopFirmware() {
+    #ifdef PIPELINED_TASKS
+    servoTask.stop();
+    stateTask.stop();
+    inputTask.stop();
+    #endif
+    #ifdef ASYNC_SERVO_OUTPUT
+    servoController.stopOutputTask();
+    #endif
+
+    #ifdef INPUT_CAPTURE
+    inputCapture.stop();
+    #endif
+}
+
+/**
+ * @brief Runs the firmware against the native HAL with scripted inputs.
+ *
+ * @param seconds How long to run for (virtual time unless the stages run in their own threads).
+ */
+static void runFirmware(unsigned long seconds) {
+    #ifndef PIPELINED_TASKS
+    nativeHal.useVirtualTime(true);
+    #endif
+
+    setup();
+
+    unsigned long endMillis = millis() + seconds * 1000UL;
+    while (millis() < endMillis) {
+        applyScriptedInputs(millis(), true);
+        loop();
+        if (nativeHal.isVirtualTime()) {
+            nativeHal.advanceMicros(100);
+        }
+    }
+
+    stopFirmware();
+
+    #ifdef LOOP_PROFILER
+    loopProfiler.printReport();
+    #endif
+
+    #ifdef POWER_MANAGEMENT
+    powerManager.printReport();
+    #endif
+    servoController.printPowerReport();
+}
+
+/**
+ * @brief Reads a whole file.
+ *
+ * @param path The file path.
+ * @param contents Receives the file contents.
+ * @return true if the file was read.
+ */
+static bool readFile(const char* path, std::vector<uint8_t>& contents) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        contents.insert(contents.end(), chunk, chunk + length);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Sets the native inputs to a set of raw readings.
+ *
+ * @param raw The readings (as recorded by the InputHandler).
+ */
+static void applyRawInputs(const RawInputs& raw) {
+    for (uint8_t adcInput = 0; adcInput < ADC_INPUT_COUNT; adcInput++) {
+        nativeHal.setAnalogInput(ADC_INPUT_PINS[adcInput], raw.adc[adcInput]);
+    }
+    nativeHal.setDigitalInput(PIN_BLINK_BUTTON, raw.buttons & RAW_BUTTON_BLINK ? LOW : HIGH);
+    nativeHal.setDigitalInput(PIN_BLINK_BUTTON_2, raw.buttons & RAW_BUTTON_BLINK_2 ? LOW : HIGH);
+    nativeHal.setDigitalInput(PIN_POWER_BUTTON, raw.buttons & RAW_BUTTON_POWER ? LOW : HIGH);
+}
+
+/**
+ * @brief Decodes every input update in a capture.
+ *
+ * @param capturePath The capture log.
+ * @param header Receives the capture header.
+ * @param inputs Receives the recorded input updates.
+ * @return true if the capture was read (a truncated capture keeps the updates before the damage).
+ */
+static bool readCapture(const char* capturePath, CaptureHeader& header, std::vector<RecordedInput>& inputs) {
+    std::vector<uint8_t> capture;
+    if (!readFile(capturePath, capture) || capture.size() < sizeof(CaptureHeader)) {
+        fprintf(stderr, "Cannot read %s\n", capturePath);
+        return false;
+    }
+
+    memcpy(&header, capture.data(), sizeof(header));
+    if (header.magic != CAPTURE_MAGIC || header.version != CAPTURE_VERSION || header.adcInputCount != RAW_INPUT_ADC_COUNT) {
+        fprintf(stderr, "%s is not a version %d capture\n", capturePath, CAPTURE_VERSION);
+        return false;
+    }
+
+    CaptureDecoder decoder;
+    size_t offset = sizeof(CaptureHeader);
+    while (offset < capture.size()) {
+        RecordedInput input;
+        size_t used = decoder.decode(capture.data() + offset, capture.size() - offset, input.timestampMicros, input.raw);
+        if (used == 0) {
+            fprintf(stderr, "Capture truncated at byte %lu\n", (unsigned long)offset);
+            break;
+        }
+        offset += used;
+        inputs.push_back(input);
+    }
+    return true;
+}
+
+/**
+ * @brief Replays an input capture through the input, state, motion and servo stages in virtual time.
+ *
+ * The stages are driven on the same grid as the scheduler: every recorded input update runs at its
+ * recorded time, and the state and servo stages run on their own periods from the start of the capture.
+ * The random number generator is seeded with the recorded seed, so replays are repeatable.
+ *
+ * @param capturePath The capture log.
+ * @param pulsesPath Where to write the servo pulses as CSV ("-" for stdout), or nullptr.
+ * @param referencePath A pulse CSV from an earlier replay to diff against, or nullptr.
+ * @return the exit code (0 if the replay matched the reference).
+ */
+static int runReplay(const char* capturePath, const char* pulsesPath, const char* referencePath) {
+    CaptureHeader header;
+    std::vector<RecordedInput> inputs;
+    if (!readCapture(capturePath, header, inputs)) {
+        return 2;
+    }
+
+    nativeHal.useVirtualTime(true);
+    nativeHal.setSerialEnabled(false);
+    nativeHal.setMicros(0);
+
+    AnalogReadSampler sampler;
+    InputHandler input(sampler);
+    StateManager state(input);
+    MotionPlanner planner;
+    ServoController servos;
+    servos.begin();
+    state.begin(header.randomSeed);
+    input.begin();
+
+    std::vector<std::string> pulses;
+    unsigned long nextStateMicros = 0;
+    unsigned long nextServoMicros = 0;
+    unsigned long inputCount = 0;
+
+    // Runs the state and servo stages that fall due up to a point in time
+    auto runStagesUntil = [&](unsigned long untilMicros) {
+        while (nextStateMicros <= untilMicros || nextServoMicros <= untilMicros) {
+            if (nextStateMicros <= nextServoMicros) {
+                nativeHal.setMicros(nextStateMicros);
+                state.update();
+                nextStateMicros += TASK_PERIOD_STATE;
+            } else {
+                nativeHal.setMicros(nextServoMicros);
+                StateSnapshot snapshot = state.getSnapshot();
+                planner.update(snapshot.pan, snapshot.tilt, snapshot.topLid, snapshot.bottomLid);
+                servos.update(planner.getPan(), planner.getTilt(), planner.getTopLid(), planner.getBottomLid());
+
+                ServoSnapshot frame = servos.getSnapshot();
+                char line[96];
+                snprintf(line, sizeof(line), "%lu,%u,%u,%u,%u,%u,%u", nextServoMicros,
+                         frame.pan, frame.tilt, frame.leftLidTop, frame.leftLidBottom, frame.rightLidTop, frame.rightLidBottom);
+                pulses.push_back(line);
+                nextServoMicros += TASK_PERIOD_SERVOS;
+            }
+        }
+    };
+
+    for (const RecordedInput& recorded : inputs) {
+        runStagesUntil(recorded.timestampMicros);
+
+        nativeHal.setMicros(recorded.timestampMicros);
+        applyRawInputs(recorded.raw);
+        input.update();
+        inputCount++;
+    }
+
+    fprintf(stderr, "Replay: %lu input updates (%.1f s, seed %lu), %lu servo frames\n", inputCount,
+            nativeHal.getMicros() / 1e6, (unsigned long)header.randomSeed, (unsigned long)pulses.size());
+
+    if (pulsesPath) {
+        FILE* output = strcmp(pulsesPath, "-") == 0 ? stdout : fopen(pulsesPath, "w");
+        if (!output) {
+            fprintf(stderr, "Replay: Cannot write %s\n", pulsesPath);
+            return 2;
+        }
+        fprintf(output, "time_us,pan,tilt,left_lid_top,left_lid_bottom,right_lid_top,right_lid_bottom\n");
+        for (const std::string& line : pulses) {
+            fprintf(output, "%s\n", line.c_str());
+        }
+        if (output != stdout) {
+            fclose(output);
+        }
+    }
+
+    if (!referencePath) {
+        return 0;
+    }
+
+    // Diff the pulse stream against the reference, frame by frame
+    std::vector<uint8_t> referenceFile;
+    if (!readFile(referencePath, referenceFile)) {
+        fprintf(stderr, "Replay: Cannot read %s\n", referencePath);
+        return 2;
+    }
+    std::vector<std::string> reference;
+    std::string line;
+    for (uint8_t character : referenceFile) {
+        if (character == '\n') {
+            reference.push_back(line);
+            line.clear();
+        } else if (character != '\r') {
+            line += (char)character;
+        }
+    }
+    if (!reference.empty()) {
+        reference.erase(reference.begin());     // Header
+    }
+
+    size_t frames = max(pulses.size(), reference.size());
+    size_t differences = 0;
+    for (size_t frame = 0; frame < frames; frame++) {
+        const std::string& replayed = frame < pulses.size() ? pulses[frame] : "(missing)";
+        const std::string& expected = frame < reference.size() ? reference[frame] : "(missing)";
+        if (replayed != expected) {
+            if (differences < 10) {
+                fprintf(stderr, "Replay: Frame %lu differs: %s != %s\n", (unsigned long)frame, replayed.c_str(), expected.c_str());
+            }
+            differences++;
+        }
+    }
+    fprintf(stderr, "Replay: %lu of %lu servo frames differ from %s\n", (unsigned long)differences, (unsigned long)frames, referencePath);
+    return differences == 0 ? 0 : 1;
+}
+
+/**
+ * @brief A scripted gesture for measuring the manual takeover latency.
+ */
+struct TakeoverGesture {
+    const char* name;
+    bool deliberate;    // A person meant to take control, so it must be detected (otherwise it must not be)
+    unsigned long durationMillis;   // How long the gesture is recorded for
+    std::function<void(unsigned long, RawInputs&)> apply;   // Moves the inputs away from rest (receives the us since it started)
+};
+
+/**
+ * @brief Moves linearly from 0 to an amount over a time, then holds it.
+ *
+ * @param elapsedMicros The time since the movement started (us).
+ * @param durationMillis How long the movement takes (ms).
+ * @param amount How far it moves.
+ * @return the distance moved so far.
+ */
+static int rampTo(unsigned long elapsedMicros, unsigned long durationMillis, int amount) {
+    unsigned long durationMicros = durationMillis * 1000UL;
+    return elapsedMicros >= durationMicros ? amount : (int)((long)amount * (long)elapsedMicros / (long)durationMicros);
+}
+
+/**
+ * @brief Records a gesture at the input task rate: TAKEOVER_REST_MILLIS at rest, then the gesture for its duration.
+ *
+ * @param gesture The gesture.
+ * @return the input updates.
+ */
+static std::vector<RecordedInput> recordGesture(const TakeoverGesture& gesture) {
+    RawInputs rest;
+    rest.adc[ADC_INPUT_JOYSTICK_X] = 2048 - JOYSTICK_DRIFT_ADUSTMENT_X;
+    rest.adc[ADC_INPUT_JOYSTICK_Y] = 2048 - JOYSTICK_DRIFT_ADUSTMENT_Y;
+    rest.adc[ADC_INPUT_EYELIDS_POT] = 2048;
+    rest.buttons = 0;
+
+    std::vector<RecordedInput> inputs;
+    unsigned long onsetMicros = TAKEOVER_REST_MILLIS * 1000UL;
+    unsigned long endMicros = onsetMicros + gesture.durationMillis * 1000UL;
+    for (unsigned long timestampMicros = 0; timestampMicros < endMicros; timestampMicros += TASK_PERIOD_INPUT) {
+        RecordedInput input = {(uint32_t)timestampMicros, rest};
+        if (timestampMicros >= onsetMicros) {
+            gesture.apply(timestampMicros - onsetMicros, input.raw);
+        }
+        inputs.push_back(input);
+    }
+    return inputs;
+}
+
+/**
+ * @brief Runs recorded inputs through an InputHandler and reports each switch from autonomous to manual control,
+ * with its latency from the start of the movement that caused it.
+ *
+ * A movement starts on the first update at which a raw input is TAKEOVER_ONSET_THRESHOLD from its reading
+ * when the bot last became autonomous, or a button is pressed. The manual control at boot is not counted.
+ *
+ * @param name The name to report the takeovers under.
+ * @param inputs The input updates.
+ * @param maxLatency Set to the longest latency (input updates) of a takeover that followed a movement, or -1 if none did.
+ * @return the number of takeovers.
+ */
+static unsigned long measureTakeovers(const char* name, const std::vector<RecordedInput>& inputs, long& maxLatency) {
+    nativeHal.useVirtualTime(true);
+    nativeHal.setSerialEnabled(false);
+    nativeHal.setMicros(0);
+
+    AnalogReadSampler sampler;
+    InputHandler input(sampler);
+    input.begin();
+
+    RawInputs rest = {};
+    bool armed = false;     // The bot has been autonomous, so the next takeover is measured
+    bool manual = false;
+    long onsetIndex = -1;
+    unsigned long takeovers = 0;
+    maxLatency = -1;
+
+    for (size_t index = 0; index < inputs.size(); index++) {
+        const RecordedInput& recorded = inputs[index];
+        nativeHal.setMicros(recorded.timestampMicros);
+        applyRawInputs(recorded.raw);
+        input.update();
+        bool nowManual = input.getSnapshot().manualControlEnabled;
+
+        if (armed && onsetIndex < 0) {
+            bool moved = recorded.raw.buttons != rest.buttons;
+            for (uint8_t adcInput = 0; adcInput < ADC_INPUT_COUNT; adcInput++) {
+                moved |= abs((int)recorded.raw.adc[adcInput] - (int)rest.adc[adcInput]) >= TAKEOVER_ONSET_THRESHOLD;
+            }
+            if (moved) {
+                onsetIndex = index;
+            }
+        }
+
+        if (nowManual && !manual && armed) {
+            takeovers++;
+            armed = false;
+            if (onsetIndex < 0) {
+                printf("%-20s takeover at %9.1f ms with no movement\n", name, recorded.timestampMicros / 1e3);
+            } else {
+                maxLatency = max(maxLatency, (long)index - onsetIndex);
+                printf("%-20s takeover at %9.1f ms, %5ld updates (%7.1f ms) after the movement started\n", name,
+                       recorded.timestampMicros / 1e3, (long)index - onsetIndex,
+                       (recorded.timestampMicros - inputs[onsetIndex].timestampMicros) / 1e3);
+            }
+        } else if (!nowManual && manual) {
+            armed = true;
+            rest = recorded.raw;
+            onsetIndex = -1;
+        }
+        manual = nowManual;
+    }
+
+    if (armed && onsetIndex >= 0) {
+        printf("%-20s movement at %9.1f ms was not taken over\n", name, inputs[onsetIndex].timestampMicros / 1e3);
+    } else if (takeovers == 0) {
+        printf("%-20s no takeover\n", name);
+    }
+    return takeovers;
+}
+
+/**
+ * @brief Measures the manual takeover latency over a set of scripted gestures, or over a capture.
+ *
+ * Each deliberate gesture must take over within TAKEOVER_MAX_LATENCY input updates of the movement
+ * starting, and each accidental one (noise, drift, jitter) must not take over.
+ *
+ * @param capturePath A capture to measure instead of the gestures, or nullptr.
+ * @return the exit code (0 if every gesture was detected correctly).
+ */
+static int runTakeover(const char* capturePath) {
+    if (capturePath) {
+        CaptureHeader header;
+        std::vector<RecordedInput> inputs;
+        if (!readCapture(capturePath, header, inputs)) {
+            return 2;
+        }
+        long maxLatency;
+        measureTakeovers(capturePath, inputs, maxLatency);
+        return 0;
+    }
+
+    const TakeoverGesture gestures[] = {
+        {"joystick flick", true, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_JOYSTICK_X] += rampTo(elapsed, 30, 1700); }},
+        {"joystick nudge", true, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_JOYSTICK_X] += rampTo(elapsed, 100, 300); }},
+        {"opposite axes", true, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) {
+            // Cancelled out in the sum of the inputs
+            raw.adc[ADC_INPUT_JOYSTICK_X] += rampTo(elapsed, 200, 600);
+            raw.adc[ADC_INPUT_EYELIDS_POT] -= rampTo(elapsed, 200, 600);
+        }},
+        {"pot twist", true, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_EYELIDS_POT] += rampTo(elapsed, 150, 800); }},
+        {"slow pot turn", true, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_EYELIDS_POT] += rampTo(elapsed, 5000, 500); }},
+        {"blink press", true, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.buttons |= elapsed < 100000 ? RAW_BUTTON_BLINK : 0; }},
+        {"pot noise", false, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_EYELIDS_POT] += (int)(elapsed / 1000 * 7919 % 81) - 40; }},
+        {"pot drift", false, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_EYELIDS_POT] += rampTo(elapsed, 5000, 60); }},
+        {"pot drift far", false, TAKEOVER_DRIFT_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) {
+            // Several times the displacement threshold, under the same noise as above
+            raw.adc[ADC_INPUT_EYELIDS_POT] += rampTo(elapsed, 60000, 300) + (int)(elapsed / 1000 * 7919 % 81) - 40;
+        }},
+        {"joystick drift", false, TAKEOVER_DRIFT_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_JOYSTICK_Y] -= rampTo(elapsed, 60000, 200); }},
+        {"joystick jitter", false, TAKEOVER_GESTURE_MILLIS, [](unsigned long elapsed, RawInputs& raw) { raw.adc[ADC_INPUT_JOYSTICK_X] += (elapsed / 1000) % 2 ? 80 : -80; }},
+    };
+
+    int failures = 0;
+    for (const TakeoverGesture& gesture : gestures) {
+        long maxLatency;
+        unsigned long takeovers = measureTakeovers(gesture.name, recordGesture(gesture), maxLatency);
+        if ((takeovers > 0) != gesture.deliberate) {
+            printf("%-20s FAILED: %s\n", gesture.name, gesture.deliberate ? "a deliberate gesture was missed" : "an accidental gesture took over");
+            failures++;
+        } else if (maxLatency > TAKEOVER_MAX_LATENCY) {
+            printf("%-20s FAILED: took %ld updates to take over (at most %d)\n", gesture.name, maxLatency, TAKEOVER_MAX_LATENCY);
+            failures++;
+        }
+    }
+    printf("Takeover: %d of %lu gestures detected incorrectly\n", failures, (unsigned long)(sizeof(gestures) / sizeof(gestures[0])));
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief A synthetic waveform on one analog input, and what the input stage must make of it.
+ */
+struct SyntheticCase {
+    const char* name;
+    uint8_t input;              // ADC_INPUT_*
+    SyntheticChannel channel;   // Replaces the resting input once the bot is autonomous
+    bool deliberate;            // It must take over (otherwise it must not)
+    int swing;                  // The processed value must reach this far from rest (0 for none)
+};
+
+/**
+ * @brief Runs the input stage from a SyntheticAdcSampler: TAKEOVER_REST_MILLIS with every input at
+ * rest, then the case's waveform for SYNTHETIC_CASE_MILLIS.
+ *
+ * @param syntheticCase The waveform and its expected outcome.
+ * @return 1 if the input stage got it wrong, otherwise 0.
+ */
+static int runSyntheticCase(const SyntheticCase& syntheticCase) {
+    nativeHal.setMicros(0);
+
+    const int rest[ADC_INPUT_COUNT] = {2048 - JOYSTICK_DRIFT_ADUSTMENT_X, 2048 - JOYSTICK_DRIFT_ADUSTMENT_Y, 2048};
+    SyntheticAdcSampler sampler;
+    for (uint8_t adcInput = 0; adcInput < ADC_INPUT_COUNT; adcInput++) {
+        sampler.setChannel(adcInput, {WAVEFORM_CONSTANT, rest[adcInput], 0, 1000, 0});
+    }
+    InputHandler input(sampler);
+    input.begin();
+
+    bool tookOver = false;
+    int swing = 0;
+    unsigned long onsetMicros = TAKEOVER_REST_MILLIS * 1000UL;
+    unsigned long endMicros = onsetMicros + SYNTHETIC_CASE_MILLIS * 1000UL;
+    for (unsigned long timestampMicros = 0; timestampMicros < endMicros; timestampMicros += TASK_PERIOD_INPUT) {
+        if (timestampMicros == onsetMicros) {
+            sampler.setChannel(syntheticCase.input, syntheticCase.channel);
+        }
+        nativeHal.setMicros(timestampMicros);
+        input.update();
+        if (timestampMicros < onsetMicros) {
+            continue;
+        }
+
+        InputSnapshot snapshot = input.getSnapshot();
+        tookOver |= snapshot.manualControlEnabled;
+        // The joysticks are centred on 2048 after the drift adjustment
+        int value = syntheticCase.input == ADC_INPUT_JOYSTICK_X ? snapshot.joystickXValue - 2048
+                  : syntheticCase.input == ADC_INPUT_JOYSTICK_Y ? snapshot.joystickYValue - 2048
+                  : snapshot.potValue - rest[ADC_INPUT_EYELIDS_POT];
+        swing = std::max(swing, abs(value));
+    }
+
+    bool failed = tookOver != syntheticCase.deliberate || swing < syntheticCase.swing;
+    printf("%-20s %-11s swing %4d (expected at least %4d)%s\n", syntheticCase.name, tookOver ? "took over" : "autonomous",
+           swing, syntheticCase.swing, failed ? "  FAILED" : "");
+    return failed ? 1 : 0;
+}
+
+/**
+ * @brief Drives the input stage from SyntheticAdcSampler waveforms. Noise on a resting input must
+ * not take over, and a deliberate waveform must take over and come through the filters with most of
+ * its swing.
+ *
+ * @return the exit code (0 if every case passed).
+ */
+static int runSynthetic() {
+    nativeHal.useVirtualTime(true);
+    nativeHal.setSerialEnabled(false);
+
+    const SyntheticCase cases[] = {
+        {"joystick noise", ADC_INPUT_JOYSTICK_X, {WAVEFORM_CONSTANT, 2048 - JOYSTICK_DRIFT_ADUSTMENT_X, 0, 1000, 40}, false, 0},
+        {"pot noise", ADC_INPUT_EYELIDS_POT, {WAVEFORM_CONSTANT, 2048, 0, 1000, 40}, false, 0},
+        {"joystick sine", ADC_INPUT_JOYSTICK_X, {WAVEFORM_SINE, 2048 - JOYSTICK_DRIFT_ADUSTMENT_X, 1500, 2000, 20}, true, 1300},
+        {"joystick ramp", ADC_INPUT_JOYSTICK_Y, {WAVEFORM_RAMP, 2048 - JOYSTICK_DRIFT_ADUSTMENT_Y, 1200, 4000, 20}, true, 1000},
+        {"pot square", ADC_INPUT_EYELIDS_POT, {WAVEFORM_SQUARE, 2048, 1000, 2000, 20}, true, 900},
+    };
+
+    int failures = 0;
+    for (const SyntheticCase& syntheticCase : cases) {
+        failures += runSyntheticCase(syntheticCase);
+    }
+    printf("Synthetic: %d of %lu cases failed\n", failures, (unsigned long)(sizeof(cases) / sizeof(cases[0])));
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Checks the servo channel table against the compile-time ServoChannel lookup tables, which
+ * round each pulse to the nearest tick: every state of every slot of the SERVO_* calibration (and
+ * states past each end, which must be clamped), every travel the pulse limits allow on both axis
+ * ranges, and the ends of each board's default runtime config calibration.
+ *
+ * @return the exit code (0 if every pulse matched).
+ */
+static int runChannels() {
+    typedef uint16_t (*PulseLookup)(int state);
+    const PulseLookup lookups[SERVO_SLOT_COUNT] = {
+        PanServo::pulse, TiltServo::pulse,
+        LeftLidTopServo::pulse, LeftLidBottomServo::pulse,
+        RightLidTopServo::pulse, RightLidBottomServo::pulse,
+    };
+    int failures = 0;
+    uint16_t pulses[SERVO_MAX_CHANNELS];
+
+    // The SERVO_* calibration, state by state
+    ServoChannelTable table;
+    addEyeRig(table, 0);
+    unsigned long checked = 0;
+    unsigned long differences = 0;
+    for (int state = -100 - CHANNEL_CHECK_STATE_MARGIN; state <= 100 + CHANNEL_CHECK_STATE_MARGIN; state++) {
+        const int16_t states[SERVO_AXIS_COUNT] = {(int16_t)state, (int16_t)state, (int16_t)state, (int16_t)state};
+        table.map(states, pulses);
+        for (uint8_t row = 0; row < table.getCount(); row++) {
+            uint16_t expected = lookups[table.getSlot(row)](state);
+            if (pulses[row] != expected && differences++ < 10) {
+                printf("%-28s slot %u at state %d: %u (expected %u)\n", "SERVO_* calibration", table.getSlot(row), state, pulses[row], expected);
+            }
+            checked++;
+        }
+    }
+    printf("%-28s %lu of %lu pulses differ%s\n", "SERVO_* calibration", differences, checked, differences == 0 ? "" : "  FAILED");
+    failures += differences == 0 ? 0 : 1;
+
+    // Every travel within the pulse limits, rising and falling, on a pan (-100 -> 100) and a lid (0 -> 100) axis
+    checked = 0;
+    differences = 0;
+    const uint8_t slots[] = {SERVO_SLOT_PAN, SERVO_SLOT_LEFT_LID_TOP};
+    for (uint8_t slot : slots) {
+        long stateMin = slot == SERVO_SLOT_PAN ? -100 : 0;
+        long range = 100 - stateMin;
+        for (long travel = -(SERVO_PULSE_TICKS_MAX - SERVO_PULSE_TICKS_MIN); travel <= SERVO_PULSE_TICKS_MAX - SERVO_PULSE_TICKS_MIN; travel++) {
+            if (travel == 0) {
+                continue;
+            }
+            long pulseMin = travel > 0 ? SERVO_PULSE_TICKS_MIN : SERVO_PULSE_TICKS_MAX;
+            ServoChannelTable travelTable;
+            travelTable.add(0, 0, slot, (uint16_t)pulseMin, (uint16_t)(pulseMin + travel));
+            for (long offset = 0; offset <= range; offset++) {
+                const int16_t states[SERVO_AXIS_COUNT] = {(int16_t)(stateMin + offset), 0, (int16_t)(stateMin + offset), 0};
+                travelTable.map(states, pulses);
+                // As ServoChannel::buildTable(): the nearest tick, halves rounded away from the origin
+                long expected = pulseMin + (2 * offset * travel + (travel > 0 ? range : -range)) / (2 * range);
+                if (pulses[0] != expected && differences++ < 10) {
+                    printf("%-28s travel %ld over %ld at %ld: %u (expected %ld)\n", "travels", travel, range, offset, pulses[0], expected);
+                }
+                checked++;
+            }
+        }
+    }
+    printf("%-28s %lu of %lu pulses differ%s\n", "every travel", differences, checked, differences == 0 ? "" : "  FAILED");
+    failures += differences == 0 ? 0 : 1;
+
+    // Each board's rig ends at its own calibrated pulses
+    const RuntimeConfigValues& defaults = RuntimeConfig::getDefaults();
+    ServoChannelTable rigs;
+    for (uint8_t board = 0; board < SERVO_BOARD_COUNT; board++) {
+        addEyeRig(rigs, board, defaults.servoPulseAtStateMin[board], defaults.servoPulseAtStateMax[board]);
+    }
+    differences = 0;
+    const int16_t lowest[SERVO_AXIS_COUNT] = {-100, -100, 0, 0};
+    const int16_t highest[SERVO_AXIS_COUNT] = {100, 100, 100, 100};
+    uint16_t highestPulses[SERVO_MAX_CHANNELS];
+    rigs.map(lowest, pulses);
+    rigs.map(highest, highestPulses);
+    for (uint8_t row = 0; row < rigs.getCount(); row++) {
+        uint8_t board = rigs.getBoard(row);
+        uint8_t slot = rigs.getSlot(row);
+        if (pulses[row] != defaults.servoPulseAtStateMin[board][slot] || highestPulses[row] != defaults.servoPulseAtStateMax[board][slot]) {
+            printf("%-28s board %u slot %u: %u -> %u (expected %u -> %u)\n", "board calibration", board, slot, pulses[row], highestPulses[row],
+                   defaults.servoPulseAtStateMin[board][slot], defaults.servoPulseAtStateMax[board][slot]);
+            differences++;
+        }
+    }
+    printf("%-28s %lu of %u rows differ%s\n", "board calibration", differences, rigs.getCount(), differences == 0 ? "" : "  FAILED");
+    failures += differences == 0 ? 0 : 1;
+
+    printf("Channels: %d checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Checks one runtime config result and prints it.
+ *
+ * @param name What was tried.
+ * @param result The result.
+ * @param expected The result it should have given.
+ * @return 1 if it was wrong, otherwise 0.
+ */
+static int expectConfigResult(const char* name, RuntimeConfigResult result, RuntimeConfigResult expected) {
+    printf("%-28s %d%s\n", name, (int)result, result == expected ? "" : "  FAILED");
+    return result == expected ? 0 : 1;
+}
+
+/**
+ * @brief Checks the runtime config: damaged and out-of-range blobs are rejected, a valid one is
+ * swapped in and picked up by the servo stage, a second change within the grace period is refused,
+ * and (with RUNTIME_CONFIG) the stored config is loaded again on the next boot.
+ *
+ * @return the exit code (0 if every check passed).
+ */
+static int runConfig() {
+    nativeHal.useVirtualTime(true);
+    servoController.begin();
+
+    RuntimeConfigBlob blob;
+    blob.values = RuntimeConfig::getDefaults();
+    RuntimeConfig::seal(blob);
+    const uint8_t* bytes = (const uint8_t*)&blob;
+    int failures = 0;
+
+    failures += expectConfigResult("short blob", runtimeConfig.apply(bytes, sizeof(blob) - 1, false), RUNTIME_CONFIG_BAD_LENGTH);
+    RuntimeConfigBlob damaged = blob;
+    damaged.version++;
+    failures += expectConfigResult("other version", runtimeConfig.apply((const uint8_t*)&damaged, sizeof(damaged), false), RUNTIME_CONFIG_BAD_HEADER);
+    damaged = blob;
+    damaged.values.autoBlinkDuration++;
+    failures += expectConfigResult("damaged values", runtimeConfig.apply((const uint8_t*)&damaged, sizeof(damaged), false), RUNTIME_CONFIG_BAD_CRC);
+    damaged = blob;
+    damaged.values.servoPulseAtStateMin[0][SERVO_SLOT_PAN] = SERVO_PULSE_TICKS_MAX + 1;
+    RuntimeConfig::seal(damaged);
+    failures += expectConfigResult("pulse out of range", runtimeConfig.apply((const uint8_t*)&damaged, sizeof(damaged), false), RUNTIME_CONFIG_BAD_VALUE);
+    damaged = blob;
+    std::swap(damaged.values.servoPulseAtStateMin[0][SERVO_SLOT_LEFT_LID_TOP], damaged.values.servoPulseAtStateMax[0][SERVO_SLOT_LEFT_LID_TOP]);
+    RuntimeConfig::seal(damaged);
+    failures += expectConfigResult("lids not mirrored", runtimeConfig.apply((const uint8_t*)&damaged, sizeof(damaged), false), RUNTIME_CONFIG_BAD_VALUE);
+    damaged = blob;
+    damaged.values.chanceOfBlink = AUTO_MAX_CHANCE;
+    damaged.values.chanceOfEyelidChange = AUTO_MAX_CHANCE;
+    RuntimeConfig::seal(damaged);
+    failures += expectConfigResult("chances over one", runtimeConfig.apply((const uint8_t*)&damaged, sizeof(damaged), false), RUNTIME_CONFIG_BAD_VALUE);
+    if (runtimeConfig.getGeneration() != 0) {
+        printf("A rejected config was swapped in  FAILED\n");
+        failures++;
+    }
+
+    // Move the pan calibration and check the servo stage picks it up on its next update
+    RuntimeConfigBlob tuned = blob;
+    tuned.values.servoPulseAtStateMin[0][SERVO_SLOT_PAN] -= 10;
+    tuned.values.servoPulseAtStateMax[0][SERVO_SLOT_PAN] += 10;
+    RuntimeConfig::seal(tuned);
+    failures += expectConfigResult("tuned pan", runtimeConfig.apply((const uint8_t*)&tuned, sizeof(tuned), true), RUNTIME_CONFIG_OK);
+    servoController.update(-100, 0, 100, 100);
+    uint16_t panPulse = servoController.getSnapshot().pan;
+    printf("%-28s %u (expected %u)%s\n", "pan pulse at -100", panPulse, tuned.values.servoPulseAtStateMin[0][SERVO_SLOT_PAN],
+           panPulse == tuned.values.servoPulseAtStateMin[0][SERVO_SLOT_PAN] ? "" : "  FAILED");
+    failures += panPulse == tuned.values.servoPulseAtStateMin[0][SERVO_SLOT_PAN] ? 0 : 1;
+
+    // The other buffer may still be read until the grace period has passed
+    failures += expectConfigResult("change within grace", runtimeConfig.apply(bytes, sizeof(blob), false), RUNTIME_CONFIG_BUSY);
+    nativeHal.advanceMicros(RUNTIME_CONFIG_SWAP_GRACE * 1000UL);
+
+    #ifdef RUNTIME_CONFIG
+    // A fresh boot loads the stored config
+    RuntimeConfig rebooted;
+    rebooted.begin();
+    bool reloaded = memcmp(&rebooted.get(), &tuned.values, sizeof(tuned.values)) == 0;
+    printf("%-28s %s\n", "reloaded from NVS", reloaded ? "yes" : "no  FAILED");
+    failures += reloaded ? 0 : 1;
+    #endif
+
+    failures += expectConfigResult("reset", runtimeConfig.reset(), RUNTIME_CONFIG_OK);
+    bool defaults = memcmp(&runtimeConfig.get(), &RuntimeConfig::getDefaults(), sizeof(RuntimeConfigValues)) == 0;
+    printf("%-28s %s\n", "back on the defaults", defaults ? "yes" : "no  FAILED");
+    failures += defaults ? 0 : 1;
+
+    printf("Config: %d checks failed (generation %lu)\n", failures, (unsigned long)runtimeConfig.getGeneration());
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Runs the firmware in real time with its serial port on a pty, so a host program can
+ * stream setpoints to it (see tools/remote_gaze.py). The joystick and pot are held still.
+ *
+ * @param seconds How long to run for.
+ * @return the exit code.
+ */
+static int runRemote(unsigned long seconds) {
+    #ifdef REMOTE_CONTROL
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("Could not open a pty");
+        return 1;
+    }
+    const char* portName = ptsname(master);
+
+    // Keep the slave open in raw mode, so the port survives the host program closing it
+    int slave = open(portName, O_RDWR | O_NOCTTY);
+    struct termios settings;
+    if (slave < 0 || tcgetattr(slave, &settings) != 0) {
+        perror("Could not open the pty slave");
+        return 1;
+    }
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    printf("Serial port: %s\n", portName);
+    fflush(stdout);
+    nativeHal.setSerialPort(master);
+
+    // Rest the inputs before the first sample, so the bot does not start under manual control
+    applyScriptedInputs(0, false);
+    setup();
+
+    unsigned long endMillis = millis() + seconds * 1000UL;
+    while (millis() < endMillis) {
+        applyScriptedInputs(millis(), false);
+        loop();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    stopFirmware();
+    nativeHal.setSerialPort(-1);
+    remoteControl.printReport();
+
+    close(slave);
+    close(master);
+    return 0;
+    #else
+    (void)seconds;
+    fprintf(stderr, "Build with REMOTE_CONTROL to run the remote mode\n");
+    return 1;
+    #endif
+}
+
+#if defined(REMOTE_CONTROL) && defined(REMOTE_UDP)
+/**
+ * @brief A datagram held back to simulate delivery jitter.
+ */
+struct PendingDatagram {
+    unsigned long deliverMicros;
+    std::vector<uint8_t> bytes;
+};
+
+/**
+ * @brief Encodes a remote control frame, as a host would send it.
+ *
+ * @param type The frame type.
+ * @param sequence The sequence number.
+ * @param body The payload after the header (nullptr for none).
+ * @param length The payload length.
+ * @return the encoded frame, with its delimiters.
+ */
+static std::vector<uint8_t> encodeRemoteFrame(uint8_t type, uint16_t sequence, const void* body, size_t length) {
+    uint8_t raw[REMOTE_HEADER_SIZE + sizeof(RemoteSetpointPayload)];
+    raw[0] = type;
+    raw[1] = sequence & 0xFF;
+    raw[2] = sequence >> 8;
+    memcpy(raw + REMOTE_HEADER_SIZE, body, length);
+
+    uint8_t frame[FRAME_ENCODED_SIZE(sizeof(raw))];
+    size_t frameLength = frameEncode(raw, REMOTE_HEADER_SIZE + length, frame);
+    return std::vector<uint8_t>(frame, frame + frameLength);
+}
+
+/**
+ * @brief Reads the report datagrams waiting on the host socket.
+ *
+ * @param fd The host socket.
+ * @param last Receives the latest report.
+ * @param reportCount Incremented for each report.
+ * @param latencyCount Adds the setpoints each report counted.
+ * @param latencySum Adds their total latency (us).
+ * @param latencyMax Raised to the longest latency reported (us).
+ */
+static void readRemoteReports(int fd, RemoteReportPayload& last, unsigned long& reportCount,
+                              unsigned long& latencyCount, double& latencySum, uint32_t& latencyMax) {
+    uint8_t datagram[64];
+    ssize_t length;
+    while ((length = recv(fd, datagram, sizeof(datagram), MSG_DONTWAIT)) > 0) {
+        uint8_t payload[sizeof(datagram)];
+        size_t start = datagram[0] == FRAME_DELIMITER ? 1 : 0;
+        size_t end = datagram[length - 1] == FRAME_DELIMITER ? length - 1 : length;
+        if (end <= start || frameDecode(datagram + start, end - start, payload) != REMOTE_HEADER_SIZE + sizeof(RemoteReportPayload)
+            || payload[0] != REMOTE_FRAME_REPORT) {
+            continue;
+        }
+        memcpy(&last, payload + REMOTE_HEADER_SIZE, sizeof(last));
+        reportCount++;
+        latencyCount += last.latencyCount;
+        latencySum += (double)last.latencyMeanMicros * last.latencyCount;
+        latencyMax = std::max(latencyMax, last.latencyMaxMicros);
+    }
+}
+
+/**
+ * @brief Checks one remote control count and prints it.
+ *
+ * @param name What was counted.
+ * @param actual The count the bot reported.
+ * @param expected The count it should have reported.
+ * @return 1 if it was wrong, otherwise 0.
+ */
+static int expectRemoteCount(const char* name, unsigned long actual, unsigned long expected) {
+    printf("%-28s %lu (expected %lu)%s\n", name, actual, expected, actual == expected ? "" : "  FAILED");
+    return actual == expected ? 0 : 1;
+}
+#endif
+
+/**
+ * @brief Streams setpoints to the firmware over the loopback UDP transport, as the host side of a
+ * Wi-Fi link would: delivery is delayed by up to UDP_TEST_JITTER_MICROS, some setpoints are lost,
+ * old ones are sent again and one is damaged. Checks that the reports count every frame, that the
+ * stale and damaged ones were dropped, that none was late and that the latency to PWM stays within
+ * the jitter delay plus one state and one servo period.
+ *
+ * @param lossPercent The percentage of setpoints the sender drops.
+ * @return the exit code (0 if every check passed).
+ */
+static int runUdp(unsigned long lossPercent) {
+    #if defined(REMOTE_CONTROL) && defined(REMOTE_UDP)
+    #ifndef PIPELINED_TASKS
+    nativeHal.useVirtualTime(true);
+    #endif
+
+    // Keep the debug text and telemetry frames off the terminal
+    int devNull = open("/dev/null", O_RDWR);
+    nativeHal.setSerialPort(devNull);
+
+    int host = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in bot = {};
+    bot.sin_family = AF_INET;
+    bot.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bot.sin_port = htons(REMOTE_UDP_PORT);
+    if (host < 0 || connect(host, (struct sockaddr*)&bot, sizeof(bot)) != 0) {
+        perror("Could not open the host socket");
+        return 1;
+    }
+
+    RemoteReportPayload report = {};
+    unsigned long reportCount = 0;
+    unsigned long latencyCount = 0;
+    double latencySum = 0;
+    uint32_t latencyMax = 0;
+    unsigned long steps = 0;
+    unsigned long remoteSteps = 0;
+    auto step = [&](bool streaming) {
+        applyScriptedInputs(millis(), false);
+        loop();
+        if (nativeHal.isVirtualTime()) {
+            nativeHal.advanceMicros(100);
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        readRemoteReports(host, report, reportCount, latencyCount, latencySum, latencyMax);
+        if (streaming) {
+            steps++;
+            remoteSteps += (stateManager.getSnapshot().flags & STATE_FLAG_REMOTE) ? 1 : 0;
+        }
+    };
+
+    // Rest the inputs before the first sample, and wait until the bot leaves manual control
+    applyScriptedInputs(0, false);
+    setup();
+    while (millis() < MANUAL_CONTROL_TIMEOUT + 500UL) {
+        step(false);
+    }
+
+    Prng randomGenerator(1);
+    std::vector<PendingDatagram> pending;
+    std::vector<std::vector<uint8_t>> sent;
+    unsigned long delivered = 0;
+    unsigned long lost = 0;
+    unsigned long resent = 0;
+    unsigned long startMicros = micros();
+    unsigned long nextSendMicros = startMicros;
+    while (micros() - startMicros < UDP_TEST_STREAM_MILLIS * 1000UL || !pending.empty()) {
+        unsigned long currentMicros = micros();
+        if (micros() - startMicros < UDP_TEST_STREAM_MILLIS * 1000UL && (long)(currentMicros - nextSendMicros) >= 0) {
+            uint16_t sequence = sent.size();
+            RemoteSetpointPayload body = {(uint32_t)(currentMicros + UDP_TEST_CLOCK_OFFSET), (int8_t)(sequence % 200 - 100), 0, 60, 60, 0};
+            sent.push_back(encodeRemoteFrame(REMOTE_FRAME_SETPOINT, sequence, &body, sizeof(body)));
+            if (randomGenerator.uniform(100) < lossPercent) {
+                lost++;
+            } else {
+                pending.push_back({currentMicros + randomGenerator.uniform(UDP_TEST_JITTER_MICROS + 1), sent.back()});
+                delivered++;
+            }
+            if (sequence % UDP_TEST_STALE_INTERVAL == UDP_TEST_STALE_INTERVAL - 1) {
+                pending.push_back({currentMicros, sent[sequence - UDP_TEST_STALE_AGE]});
+                resent++;
+            }
+            if (sequence == UDP_TEST_DAMAGED_SEQUENCE) {
+                std::vector<uint8_t> damaged = sent.back();
+                damaged[damaged.size() / 2] ^= 0x40;
+                pending.push_back({currentMicros, damaged});
+            }
+            nextSendMicros += UDP_TEST_PERIOD_MICROS;
+        }
+
+        for (size_t i = 0; i < pending.size();) {
+            if ((long)(currentMicros - pending[i].deliverMicros) >= 0) {
+                send(host, pending[i].bytes.data(), pending[i].bytes.size(), 0);
+                pending.erase(pending.begin() + i);
+            } else {
+                i++;
+            }
+        }
+        step(true);
+    }
+
+    // Hand back and wait for the last report
+    std::vector<uint8_t> release = encodeRemoteFrame(REMOTE_FRAME_RELEASE, sent.size(), nullptr, 0);
+    send(host, release.data(), release.size(), 0);
+    unsigned long releaseMillis = millis();
+    while (millis() - releaseMillis < REMOTE_REPORT_INTERVAL + 500UL) {
+        step(false);
+    }
+    bool released = !(stateManager.getSnapshot().flags & STATE_FLAG_REMOTE);
+
+    stopFirmware();
+    remoteTransport.end();
+    nativeHal.setSerialPort(-1);
+    close(devNull);
+    close(host);
+
+    printf("Sent %lu setpoints: %lu lost, %lu delivered, %lu sent again, 1 damaged\n",
+           (unsigned long)sent.size(), lost, delivered, resent);
+    int failures = 0;
+    printf("%-28s %lu%s\n", "reports", reportCount, reportCount > 0 ? "" : "  FAILED (is the port free?)");
+    failures += reportCount > 0 ? 0 : 1;
+    failures += expectRemoteCount("frames", report.frameCount, delivered + resent + 1);
+    failures += expectRemoteCount("bad frames", report.badFrameCount, 1);
+    failures += expectRemoteCount("stale", report.staleCount, resent);
+    failures += expectRemoteCount("late", report.lateCount, 0);
+    failures += expectRemoteCount("dropped", report.droppedCount, 0);
+
+    unsigned long remotePercent = steps > 0 ? remoteSteps * 100 / steps : 0;
+    printf("%-28s %lu%%%s\n", "under remote control", remotePercent, remotePercent >= 95 ? "" : "  FAILED");
+    failures += remotePercent >= 95 ? 0 : 1;
+    printf("%-28s %s\n", "released", released ? "yes" : "no  FAILED");
+    failures += released ? 0 : 1;
+
+    // A setpoint waits at most the jitter delay plus the transit estimate, then up to one state and one servo period
+    uint32_t latencyLimit = REMOTE_JITTER_DELAY + UDP_TEST_JITTER_MICROS + TASK_PERIOD_STATE + TASK_PERIOD_SERVOS + TASK_PERIOD_REMOTE;
+    printf("%-28s %lu setpoints, mean %.1f ms, max %.1f ms (limit %.1f ms)%s\n", "latency to PWM", latencyCount,
+           latencyCount > 0 ? latencySum / latencyCount / 1000.0 : 0.0, latencyMax / 1000.0, latencyLimit / 1000.0,
+           latencyCount > 0 && latencyMax <= latencyLimit ? "" : "  FAILED");
+    failures += latencyCount > 0 && latencyMax <= latencyLimit ? 0 : 1;
+
+    printf("Udp: %d checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+    #else
+    (void)lossPercent;
+    fprintf(stderr, "Build with REMOTE_CONTROL and REMOTE_UDP to run the udp mode\n");
+    return 1;
+    #endif
+}
+
+/**
+ * @brief Host entry point.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return the exit code.
+ */
+int main(int argc, char** argv) {
+    const char* mode = argc > 1 ? argv[1] : "bench";
+
+    if (strcmp(mode, "run") == 0) {
+        runFirmware(argc > 2 ? strtoul(argv[2], nullptr, 10) : 10);
+    } else if (strcmp(mode, "replay") == 0 && argc > 2) {
+        return runReplay(argv[2], argc > 3 ? argv[3] : nullptr, argc > 4 ? argv[4] : nullptr);
+    } else if (strcmp(mode, "takeover") == 0) {
+        return runTakeover(argc > 2 ? argv[2] : nullptr);
+    } else if (strcmp(mode, "synthetic") == 0) {
+        return runSynthetic();
+    } else if (strcmp(mode, "channels") == 0) {
+        return runChannels();
+    } else if (strcmp(mode, "config") == 0) {
+        return runConfig();
+    } else if (strcmp(mode, "remote") == 0) {
+        return runRemote(argc > 2 ? strtoul(argv[2], nullptr, 10) : 60);
+    } else if (strcmp(mode, "udp") == 0) {
+        return runUdp(argc > 2 ? strtoul(argv[2], nullptr, 10) : UDP_TEST_DEFAULT_LOSS);
+    } else if (strcmp(mode, "bench") == 0) {
+        runBenchmarks(argc > 2 ? strtoul(argv[2], nullptr, 10) : BENCHMARK_DEFAULT_ITERATIONS);
+    } else {
+        fprintf(stderr, "Usage: %s [bench [iterations] | run [seconds] | replay <capture> [pulses.csv] [reference.csv] | takeover [capture] | synthetic | channels | config | remote [seconds] | udp [lossPercent]]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
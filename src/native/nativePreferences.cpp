@@ -0,0 +1,87 @@
+/**
+ * @file nativePreferences.cpp
+ * @brief Host-native stand-in for the Arduino Preferences (NVS) library.
+ *
+ * Each key is stored as a file under NATIVE_NVS_ROOT/<namespace>/ in the working directory, so a
+ * config stored by the firmware on the host survives to the next run, like NVS does across boots.
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include "Preferences.h"
+
+Preferences::Preferences():
+    opened(false),
+    readOnly(true)
+{}
+
+Preferences::~Preferences() {
+    end();
+}
+
+/**
+ * @brief Opens a namespace. Like NVS, a read-only open fails if nothing has been stored in it yet.
+ */
+bool Preferences::begin(const char* name, bool readOnly) {
+    directory = std::string(NATIVE_NVS_ROOT) + "/" + name;
+    struct stat status;
+    if (!readOnly) {
+        mkdir(NATIVE_NVS_ROOT, 0755);
+        mkdir(directory.c_str(), 0755);
+    }
+    opened = stat(directory.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+    this->readOnly = readOnly;
+    return opened;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::isKey(const char* key) {
+    struct stat status;
+    return opened && stat(keyPath(key).c_str(), &status) == 0;
+}
+
+bool Preferences::remove(const char* key) {
+    return opened && !readOnly && ::remove(keyPath(key).c_str()) == 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    struct stat status;
+    return opened && stat(keyPath(key).c_str(), &status) == 0 ? status.st_size : 0;
+}
+
+/**
+ * @brief Reads a byte array. Like NVS, nothing is read if the stored value is longer than the buffer.
+ */
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    size_t length = getBytesLength(key);
+    if (length == 0 || length > maxLength) {
+        return 0;
+    }
+    FILE* file = fopen(keyPath(key).c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    length = fread(buffer, 1, length, file);
+    fclose(file);
+    return length;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!opened || readOnly) {
+        return 0;
+    }
+    FILE* file = fopen(keyPath(key).c_str(), "wb");
+    if (!file) {
+        return 0;
+    }
+    length = fwrite(value, 1, length, file);
+    fclose(file);
+    return length;
+}
+
+std::string Preferences::keyPath(const char* key) const {
+    return directory + "/" + key;
+}
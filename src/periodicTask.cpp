@@ -0,0 +1,171 @@
+/**
+ * @file periodicTask.cpp
+ * @brief Runs a callback at a fixed rate in its own task.
+ *
+ * On the ESP32 each PeriodicTask is a FreeRTOS task paced with xTaskDelayUntil(). On the host the
+ * same class is backed by a std::thread (pthreads) so the pipelined mode can be exercised under
+ * ThreadSanitizer. Timing statistics are kept in the same format as the cooperative Scheduler and
+ * published through a SeqLock so they can be read from any task.
+ */
+
+#include "periodicTask.h"
+
+#ifndef ESP_PLATFORM
+#include <chrono>
+#endif
+
+/**
+ * @brief Constructs a new PeriodicTask object. The task does not run until start() is called.
+ *
+ * @param name A short name for the task (used as the FreeRTOS task name and in debug output).
+ * @param callback The function to run.
+ * @param periodMicros How often the task should run (us).
+ * @param priority The FreeRTOS priority of the task (ignored on the host).
+ */
+PeriodicTask::PeriodicTask(const char* name, TaskCallback callback, unsigned long periodMicros, unsigned int priority):
+    priority(priority)
+    #ifdef ESP_PLATFORM
+    , handle(NULL)
+    #else
+    , running(false)
+    #endif
+{
+    stats.name = name;
+    stats.callback = callback;
+    stats.periodMicros = periodMicros;
+    stats.nextRunMicros = 0;
+    stats.runCount = 0;
+    stats.overrunCount = 0;
+    stats.maxJitterMicros = 0;
+    stats.maxDurationMicros = 0;
+    publishedStats.write(stats);
+}
+
+/**
+ * @brief Starts the task.
+ *
+ * @return true if the task was created, false otherwise.
+ */
+bool PeriodicTask::start() {
+    #ifdef ESP_PLATFORM
+    return xTaskCreate(taskEntry, stats.name, PIPELINE_TASK_STACK_SIZE, this, priority, &handle) == pdPASS;
+    #else
+    running.store(true, std::memory_order_release);
+    thread = std::thread(&PeriodicTask::run, this);
+    return true;
+    #endif
+}
+
+/**
+ * @brief Stops the task. On the host this waits for the current run to finish.
+ */
+void PeriodicTask::stop() {
+    #ifdef ESP_PLATFORM
+    if (handle != NULL) {
+        vTaskDelete(handle);
+        handle = NULL;
+    }
+    #else
+    running.store(false, std::memory_order_release);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    #endif
+}
+
+/**
+ * @brief Gets the timing statistics of the task. Safe to call from another task.
+ *
+ * @return the timing statistics.
+ */
+ScheduledTask PeriodicTask::getStats() const {
+    return publishedStats.read();
+}
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief FreeRTOS entry point.
+ *
+ * @param parameter The PeriodicTask to run.
+ */
+void PeriodicTask::taskEntry(void* parameter) {
+    static_cast<PeriodicTask*>(parameter)->run();
+}
+
+/**
+ * @brief Runs the callback on a fixed grid of ticks. A missed release is counted as an overrun and
+ * the task is re-phased rather than run back to back to catch up.
+ */
+void PeriodicTask::run() {
+    const TickType_t periodTicks = max((TickType_t)1, (TickType_t)((uint64_t)stats.periodMicros * configTICK_RATE_HZ / 1000000));
+    const unsigned long periodMicros = (unsigned long)periodTicks * (1000000 / configTICK_RATE_HZ);
+
+    TickType_t lastWakeTicks = xTaskGetTickCount();
+    unsigned long releaseMicros = micros();
+    for (;;) {
+        unsigned long startMicros = micros();
+        stats.callback();
+        unsigned long endMicros = micros();
+
+        long jitterMicros = (long)(startMicros - releaseMicros);
+        bool overrun = xTaskDelayUntil(&lastWakeTicks, periodTicks) == pdFALSE;
+        recordRun(jitterMicros > 0 ? jitterMicros : 0, endMicros - startMicros, overrun);
+
+        if (overrun) {
+            lastWakeTicks = xTaskGetTickCount();
+            releaseMicros = micros();
+        } else {
+            releaseMicros += periodMicros;
+        }
+    }
+}
+#else
+/**
+ * @brief Runs the callback on a fixed grid of the period. A missed release is counted as an overrun
+ * and the task is re-phased rather than run back to back to catch up.
+ */
+void PeriodicTask::run() {
+    const std::chrono::microseconds period(stats.periodMicros);
+
+    std::chrono::steady_clock::time_point release = std::chrono::steady_clock::now();
+    while (running.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_until(release);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        stats.callback();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        unsigned long jitterMicros = std::chrono::duration_cast<std::chrono::microseconds>(start - release).count();
+        unsigned long durationMicros = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        release += period;
+        bool overrun = end >= release;
+        if (overrun) {
+            release = end + period;
+        }
+
+        recordRun(jitterMicros, durationMicros, overrun);
+    }
+}
+#endif
+
+/**
+ * @brief Updates and publishes the timing statistics after a run.
+ *
+ * @param jitterMicros How late the run started relative to its release time (us).
+ * @param durationMicros How long the callback took (us).
+ * @param overrun Whether the next release was missed.
+ */
+void PeriodicTask::recordRun(unsigned long jitterMicros, unsigned long durationMicros, bool overrun) {
+    stats.runCount++;
+    if (overrun) {
+        stats.overrunCount++;
+    }
+    if (jitterMicros > stats.maxJitterMicros) {
+        stats.maxJitterMicros = jitterMicros;
+    }
+    if (durationMicros > stats.maxDurationMicros) {
+        stats.maxDurationMicros = durationMicros;
+    }
+    publishedStats.write(stats);
+}
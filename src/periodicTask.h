@@ -0,0 +1,59 @@
+/**
+ * @file periodicTask.h
+ * @brief Runs a callback at a fixed rate in its own task.
+ *
+ * On the ESP32 each PeriodicTask is a FreeRTOS task paced with xTaskDelayUntil(). On the host the
+ * same class is backed by a std::thread (pthreads) so the pipelined mode can be exercised under
+ * ThreadSanitizer. Timing statistics are kept in the same format as the cooperative Scheduler and
+ * published through a SeqLock so they can be read from any task.
+ */
+
+#ifndef PERIODIC_TASK_H
+#define PERIODIC_TASK_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "scheduler.h"
+#include "seqLock.h"
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <atomic>
+#include <thread>
+#endif
+
+class PeriodicTask {
+public:
+    PeriodicTask(const char* name, TaskCallback callback, unsigned long periodMicros, unsigned int priority);
+
+    bool start();
+    void stop();
+
+    ScheduledTask getStats() const;
+
+private:
+    ScheduledTask stats;
+    SeqLock<ScheduledTask> publishedStats;
+    unsigned int priority;
+
+    #ifdef ESP_PLATFORM
+    TaskHandle_t handle;
+    static void taskEntry(void* parameter);
+    #else
+    std::thread thread;
+    std::atomic<bool> running;
+    #endif
+
+    void run();
+    void recordRun(unsigned long jitterMicros, unsigned long durationMicros, bool overrun);
+};
+
+#ifdef PIPELINED_TASKS
+extern PeriodicTask inputTask;
+extern PeriodicTask stateTask;
+extern PeriodicTask servoTask;
+#endif
+
+#endif // PERIODIC_TASK_H
@@ -0,0 +1,154 @@
+/**
+ * @file poissonTimer.cpp
+ * @brief Timer for random events that happen at an average rate (a Poisson process).
+ *
+ * Rather than rolling a chance every tick, the timer samples the time until the next event once,
+ * from an exponential distribution with the configured mean, and then only compares times until
+ * it fires. The event rate therefore does not depend on how often poll() is called, and the ticks
+ * in between cost no random numbers.
+ */
+
+#include "poissonTimer.h"
+
+#define LN2_Q16 45426
+#define LN_TABLE_BITS 6
+
+// ln(1 + (k + 0.5) / 64) in Q16, the midpoint of each mantissa bucket
+static const uint16_t LN_ONE_PLUS_TABLE[1 << LN_TABLE_BITS] = {
+    510, 1518, 2511, 3489, 4453, 5403, 6339, 7262, 8173, 9070, 9956, 10830, 11692, 12543, 13383, 14213,
+    15032, 15841, 16641, 17430, 18210, 18981, 19743, 20497, 21241, 21978, 22706, 23426, 24139, 24843, 25540, 26230,
+    26913, 27589, 28257, 28919, 29575, 30224, 30866, 31502, 32133, 32757, 33375, 33987, 34594, 35196, 35791, 36382,
+    36967, 37547, 38122, 38692, 39257, 39817, 40372, 40923, 41469, 42011, 42548, 43081, 43609, 44133, 44654, 45170,
+};
+
+/**
+ * @brief Constructs a new PoissonTimer object. The timer does not fire until started.
+ *
+ * @param meanIntervalMillis The average time between events (ms). 0 disables the event.
+ * @param randomGenerator The generator to draw the intervals from.
+ */
+PoissonTimer::PoissonTimer(uint32_t meanIntervalMillis, RandomGenerator& randomGenerator):
+    randomGenerator(randomGenerator),
+    meanIntervalMillis(meanIntervalMillis),
+    nextMillis(0),
+    running(false)
+{}
+
+/**
+ * @brief Computes -ln(u) for a uniform u in (0, 1).
+ *
+ * u = draw / POISSON_DRAW_RANGE = 2^-n * (1 + f), so -ln(u) = n * ln(2) - ln(1 + f), with n from
+ * the leading zeros and ln(1 + f) from the top bits of f.
+ *
+ * @param draw A uniform random number below POISSON_DRAW_RANGE (0 is treated as 1).
+ * @return -ln(draw / POISSON_DRAW_RANGE) in Q16.
+ */
+uint32_t PoissonTimer::negativeLogQ16(uint32_t draw) {
+    draw &= POISSON_DRAW_RANGE - 1;
+    if (draw == 0) {
+        draw = 1;
+    }
+    uint8_t msb = 31 - __builtin_clz(draw);
+    uint8_t fraction = ((draw << (31 - msb)) >> (31 - LN_TABLE_BITS)) & ((1 << LN_TABLE_BITS) - 1);
+    return (POISSON_DRAW_BITS - msb) * LN2_Q16 - LN_ONE_PLUS_TABLE[fraction];
+}
+
+/**
+ * @brief Samples the time to the next event from an exponential distribution.
+ *
+ * @param meanIntervalMillis The average time between events (ms).
+ * @param draw A uniform random number below POISSON_DRAW_RANGE (0 is treated as 1).
+ * @return the time to the next event (ms).
+ */
+uint32_t PoissonTimer::sampleInterval(uint32_t meanIntervalMillis, uint32_t draw) {
+    return ((uint64_t)meanIntervalMillis * negativeLogQ16(draw)) >> 16;
+}
+
+/**
+ * @brief Draws the time to the next event.
+ *
+ * @return the time to the next event (ms).
+ */
+uint32_t PoissonTimer::drawInterval() {
+    return sampleInterval(meanIntervalMillis, randomGenerator.next() >> (32 - POISSON_DRAW_BITS));
+}
+
+/**
+ * @brief Starts the timer, scheduling the first event from now.
+ *
+ * @param currentMillis The current time (ms).
+ */
+void PoissonTimer::start(unsigned long currentMillis) {
+    running = meanIntervalMillis > 0;
+    if (running) {
+        nextMillis = currentMillis + drawInterval();
+    }
+}
+
+/**
+ * @brief Stops the timer. Restarting it samples a fresh interval.
+ */
+void PoissonTimer::stop() {
+    running = false;
+}
+
+/**
+ * @brief Checks whether the timer is running.
+ *
+ * @return true if the timer is running.
+ */
+bool PoissonTimer::isRunning() const {
+    return running;
+}
+
+/**
+ * @brief Checks whether the next event is due, and if so schedules the one after it.
+ *
+ * The next event is scheduled from the time this one was due, so the rate holds however late
+ * poll() is called. After a stall it is scheduled from now instead, so missed events are dropped
+ * rather than fired in a burst.
+ *
+ * @param currentMillis The current time (ms).
+ * @return true if an event is due.
+ */
+bool PoissonTimer::poll(unsigned long currentMillis) {
+    if (!running || (long)(currentMillis - nextMillis) < 0) {
+        return false;
+    }
+
+    nextMillis += drawInterval();
+    if ((long)(currentMillis - nextMillis) > 0) {
+        nextMillis = currentMillis + drawInterval();
+    }
+    return true;
+}
+
+/**
+ * @brief Changes the average time between events. Takes effect from the next event.
+ *
+ * @param meanIntervalMillis The average time between events (ms). 0 disables the event.
+ */
+void PoissonTimer::setMeanInterval(uint32_t meanIntervalMillis) {
+    this->meanIntervalMillis = meanIntervalMillis;
+    if (meanIntervalMillis == 0) {
+        running = false;
+    }
+}
+
+/**
+ * @brief Gets the average time between events.
+ *
+ * @return the mean interval (ms).
+ */
+uint32_t PoissonTimer::getMeanInterval() const {
+    return meanIntervalMillis;
+}
+
+/**
+ * @brief Gets when the next event is due.
+ *
+ * @return the time of the next event (ms), if running.
+ */
+unsigned long PoissonTimer::getNextMillis() const {
+    return nextMillis;
+}
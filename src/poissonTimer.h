@@ -0,0 +1,48 @@
+/**
+ * @file poissonTimer.h
+ * @brief Timer for random events that happen at an average rate (a Poisson process).
+ *
+ * Rather than rolling a chance every tick, the timer samples the time until the next event once,
+ * from an exponential distribution with the configured mean, and then only compares times until
+ * it fires. The event rate therefore does not depend on how often poll() is called, and the ticks
+ * in between cost no random numbers.
+ *
+ * The ESP32-C3 has no FPU, so -ln(u) is computed in Q16 from a count-leading-zeros and a 64 entry
+ * ln(1 + f) table (within 1% of the true value).
+ */
+
+#ifndef POISSON_TIMER_H
+#define POISSON_TIMER_H
+
+#include <Arduino.h>
+#include "randomGenerator.h"
+
+#define POISSON_DRAW_BITS 31                          // Bits of uniform random input to each sample
+#define POISSON_DRAW_RANGE (1UL << POISSON_DRAW_BITS) // Draws are below POISSON_DRAW_RANGE
+
+class PoissonTimer {
+public:
+    PoissonTimer(uint32_t meanIntervalMillis, RandomGenerator& randomGenerator);
+
+    void start(unsigned long currentMillis);
+    void stop();
+    bool isRunning() const;
+    bool poll(unsigned long currentMillis);
+
+    void setMeanInterval(uint32_t meanIntervalMillis);
+    uint32_t getMeanInterval() const;
+    unsigned long getNextMillis() const;
+
+    static uint32_t negativeLogQ16(uint32_t draw);
+    static uint32_t sampleInterval(uint32_t meanIntervalMillis, uint32_t draw);
+
+private:
+    RandomGenerator& randomGenerator;
+    uint32_t meanIntervalMillis;
+    unsigned long nextMillis;
+    bool running;
+
+    uint32_t drawInterval();
+};
+
+#endif // POISSON_TIMER_H
@@ -0,0 +1,261 @@
+/**
+ * @file powerManager.cpp
+ * @brief Scales the CPU clock with activity, light sleeps while soft-powered off and estimates the energy used.
+ *
+ * The power task picks a mode from the latest state and servo snapshots, and the loop light sleeps
+ * between tasks when they are far enough apart (in practice only while soft-powered off). The time spent in each mode and in light sleep is weighted
+ * by an estimated current to give the charge drawn from the battery.
+ */
+
+#include "powerManager.h"
+
+#ifdef POWER_MANAGEMENT
+
+#include <string.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include "buttonEvents.h"
+
+#define MICROS_PER_HOUR 3600000000ULL
+
+static const char* POWER_MODE_NAMES[POWER_MODE_COUNT] = {"active", "idle", "off"};
+
+/**
+ * @brief Constructs a new PowerManager object.
+ */
+PowerManager::PowerManager():
+    mode(POWER_MODE_ACTIVE),
+    previousServos(),
+    lastActiveMillis(0),
+    lastAccountMicros(0),
+    modeMicros(),
+    lightSleepMicros(0),
+    lightSleepCount(0),
+    chargeMicroampMicros(0)
+{}
+
+/**
+ * @brief Starts at the active clock and lets the blink and power buttons wake a light sleep.
+ */
+void PowerManager::begin() {
+    setCpuFrequencyMhz(getModeCpuFrequency(mode));
+
+    #ifndef BUTTON_INTERRUPTS
+    // The buttons are pulled up, so they wake the chip when pressed (low)
+    // With BUTTON_INTERRUPTS the button interrupts are swapped for the wakeup around each light sleep instead
+    gpio_wakeup_enable((gpio_num_t)PIN_POWER_BUTTON, GPIO_INTR_LOW_LEVEL);
+    gpio_wakeup_enable((gpio_num_t)PIN_BLINK_BUTTON, GPIO_INTR_LOW_LEVEL);
+    gpio_wakeup_enable((gpio_num_t)PIN_BLINK_BUTTON_2, GPIO_INTR_LOW_LEVEL);
+    #endif
+    esp_sleep_enable_gpio_wakeup();
+
+    lastActiveMillis = millis();
+    lastAccountMicros = micros();
+}
+
+/**
+ * @brief Picks the power mode and sets the CPU clock for it.
+ *
+ * @param state The latest state snapshot.
+ * @param servos The latest servo snapshot (the eyes are moving while the pulses change).
+ * @return true if the mode changed.
+ */
+bool PowerManager::update(const StateSnapshot& state, const ServoSnapshot& servos) {
+    unsigned long currentMillis = millis();
+    if ((state.flags & (STATE_FLAG_MANUAL | STATE_FLAG_REMOTE)) || memcmp(&servos, &previousServos, sizeof(servos)) != 0) {
+        lastActiveMillis = currentMillis;
+    }
+    previousServos = servos;
+
+    PowerMode newMode;
+    if (!(state.flags & STATE_FLAG_POWER)) {
+        newMode = POWER_MODE_OFF;
+    } else if (currentMillis - lastActiveMillis < POWER_IDLE_DELAY) {
+        newMode = POWER_MODE_ACTIVE;
+    } else {
+        newMode = POWER_MODE_IDLE;
+    }
+    if (newMode == mode) {
+        return false;
+    }
+
+    // Charge the time so far to the old mode and clock
+    account(micros());
+    mode = newMode;
+    setCpuFrequencyMhz(getModeCpuFrequency(mode));
+
+    #ifdef SERIAL_DEBUG
+    Serial.println("Power: " + String(POWER_MODE_NAMES[mode]) + " at " + String((int)getCpuFrequencyMhz()) + " MHz");
+    #endif
+
+    return true;
+}
+
+/**
+ * @brief Light sleeps until the next task is due, if idle or soft-powered off and there is time to.
+ *
+ * While idle the input task still runs every TASK_PERIOD_INPUT, so at the default 1 kHz the gap never
+ * reaches POWER_LIGHT_SLEEP_MIN_MICROS and the caller blocks at the idle clock instead. Slowing the
+ * input task while idle would let it sleep, but the input filters are tuned for a fixed sample rate.
+ *
+ * @param idleMicros The time until the next task is due (us).
+ * @return true if it slept, false if the caller should wait for the task itself.
+ */
+bool PowerManager::idle(unsigned long idleMicros) {
+    if (mode == POWER_MODE_ACTIVE || idleMicros < POWER_LIGHT_SLEEP_MIN_MICROS) {
+        return false;
+    }
+
+    // The UART stops in light sleep, so let it finish sending first
+    Serial.flush();
+
+    unsigned long sleepStartMicros = micros();
+    account(sleepStartMicros);
+
+    esp_sleep_enable_timer_wakeup(idleMicros);
+    #ifdef BUTTON_INTERRUPTS
+    buttonEvents.suspend();
+    esp_light_sleep_start();
+    buttonEvents.resume();
+    #else
+    esp_light_sleep_start();
+    #endif
+
+    // The microsecond clock keeps running in light sleep
+    unsigned long wakeMicros = micros();
+    unsigned long sleptMicros = wakeMicros - sleepStartMicros;
+    lightSleepMicros += sleptMicros;
+    lightSleepCount++;
+    chargeMicroampMicros += (uint64_t)sleptMicros * POWER_CURRENT_LIGHT_SLEEP_UA;
+    lastAccountMicros = wakeMicros;
+    return true;
+}
+
+/**
+ * @brief Charges the awake time since the last call to the current mode at the current clock.
+ *
+ * @param currentMicros The current time (us).
+ */
+void PowerManager::account(unsigned long currentMicros) {
+    unsigned long elapsedMicros = currentMicros - lastAccountMicros;
+    modeMicros[mode] += elapsedMicros;
+    chargeMicroampMicros += (uint64_t)elapsedMicros * getAwakeCurrentMicroamps(getCpuFrequencyMhz());
+    lastAccountMicros = currentMicros;
+}
+
+/**
+ * @brief Gets the CPU clock for a mode.
+ *
+ * @param mode The power mode.
+ * @return the CPU frequency (MHz).
+ */
+uint32_t PowerManager::getModeCpuFrequency(PowerMode mode) {
+    switch (mode) {
+        case POWER_MODE_IDLE:
+            return POWER_CPU_FREQ_IDLE;
+        case POWER_MODE_OFF:
+            return POWER_CPU_FREQ_OFF;
+        default:
+            return POWER_CPU_FREQ_ACTIVE;
+    }
+}
+
+/**
+ * @brief Estimates the current drawn by the ESP32-C3 while awake.
+ *
+ * @param cpuFrequencyMhz The CPU clock (MHz).
+ * @return the estimated current (uA).
+ */
+uint32_t PowerManager::getAwakeCurrentMicroamps(uint32_t cpuFrequencyMhz) {
+    return POWER_CURRENT_AWAKE_BASE_UA + POWER_CURRENT_AWAKE_PER_MHZ_UA * cpuFrequencyMhz;
+}
+
+/**
+ * @brief Gets the current power mode.
+ *
+ * @return the power mode.
+ */
+PowerMode PowerManager::getMode() const {
+    return mode;
+}
+
+/**
+ * @brief Gets the time spent awake in a mode (up to the last mode change or light sleep).
+ *
+ * @param mode The power mode.
+ * @return the time in the mode (us).
+ */
+uint64_t PowerManager::getModeMicros(PowerMode mode) const {
+    return modeMicros[mode];
+}
+
+/**
+ * @brief Gets the time spent in light sleep.
+ *
+ * @return the time asleep (us).
+ */
+uint64_t PowerManager::getLightSleepMicros() const {
+    return lightSleepMicros;
+}
+
+/**
+ * @brief Gets the number of light sleeps.
+ *
+ * @return the light sleep count.
+ */
+uint32_t PowerManager::getLightSleepCount() const {
+    return lightSleepCount;
+}
+
+/**
+ * @brief Gets the estimated charge drawn since boot.
+ *
+ * @return the charge (uAh).
+ */
+uint32_t PowerManager::getChargeMicroampHours() {
+    account(micros());
+    return chargeMicroampMicros / MICROS_PER_HOUR;
+}
+
+/**
+ * @brief Gets the estimated average current since boot.
+ *
+ * @return the average current (uA).
+ */
+uint32_t PowerManager::getAverageCurrentMicroamps() {
+    account(micros());
+    uint64_t totalMicros = lightSleepMicros;
+    for (int i = 0; i < POWER_MODE_COUNT; i++) {
+        totalMicros += modeMicros[i];
+    }
+    return totalMicros == 0 ? 0 : chargeMicroampMicros / totalMicros;
+}
+
+/**
+ * @brief Prints the time in each mode, the estimated charge and the battery life it implies.
+ */
+void PowerManager::printReport() {
+    char buffer[128];
+    uint32_t averageMicroamps = getAverageCurrentMicroamps();
+
+    for (int i = 0; i < POWER_MODE_COUNT; i++) {
+        snprintf(buffer, sizeof(buffer), "POWER: %-11s %10lu ms  (%lu uA at %lu MHz)",
+                 POWER_MODE_NAMES[i],
+                 (unsigned long)(modeMicros[i] / 1000),
+                 (unsigned long)getAwakeCurrentMicroamps(getModeCpuFrequency((PowerMode)i)),
+                 (unsigned long)getModeCpuFrequency((PowerMode)i));
+        Serial.println(buffer);
+    }
+    snprintf(buffer, sizeof(buffer), "POWER: %-11s %10lu ms  (%lu uA, %lu sleeps)",
+             "light sleep", (unsigned long)(lightSleepMicros / 1000),
+             (unsigned long)POWER_CURRENT_LIGHT_SLEEP_UA, (unsigned long)lightSleepCount);
+    Serial.println(buffer);
+
+    snprintf(buffer, sizeof(buffer), "POWER: %lu uAh used, %lu uA average, ~%lu h on a %d mAh battery",
+             (unsigned long)getChargeMicroampHours(), (unsigned long)averageMicroamps,
+             (unsigned long)(averageMicroamps == 0 ? 0 : (uint64_t)BATTERY_CAPACITY_MAH * 1000 / averageMicroamps),
+             BATTERY_CAPACITY_MAH);
+    Serial.println(buffer);
+}
+
+#endif // POWER_MANAGEMENT
@@ -0,0 +1,69 @@
+/**
+ * @file powerManager.h
+ * @brief Scales the CPU clock with activity, light sleeps while soft-powered off and estimates the energy used.
+ *
+ * The power task picks a mode from the latest state and servo snapshots:
+ * - Active (manual or remote control, or the eyes moved within POWER_IDLE_DELAY): full CPU clock.
+ * - Idle (autonomous with the eyes still, including asleep with the lids closed): reduced CPU clock, and
+ *   the loop blocks between tasks (they are too close together at the default input rate to light sleep).
+ * - Off (soft-powered off): reduced CPU clock, the input and state tasks slow to POWER_OFF_TASK_PERIOD
+ *   and the loop light sleeps until the next task is due. The blink and power buttons wake it early.
+ *
+ * The time spent in each mode and in light sleep is weighted by an estimated current to give the
+ * charge drawn from the battery, so battery life can be compared between modes (POWER_REPORT_KEY).
+ * With PIPELINED_TASKS the stages run in their own tasks, so only the clock is scaled.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "snapshots.h"
+
+enum PowerMode {
+    POWER_MODE_ACTIVE,
+    POWER_MODE_IDLE,
+    POWER_MODE_OFF,
+    POWER_MODE_COUNT
+};
+
+#ifdef POWER_MANAGEMENT
+
+class PowerManager {
+public:
+    PowerManager();
+
+    void begin();
+    bool update(const StateSnapshot& state, const ServoSnapshot& servos);
+    bool idle(unsigned long idleMicros);
+
+    PowerMode getMode() const;
+    uint64_t getModeMicros(PowerMode mode) const;
+    uint64_t getLightSleepMicros() const;
+    uint32_t getLightSleepCount() const;
+    uint32_t getChargeMicroampHours();
+    uint32_t getAverageCurrentMicroamps();
+    void printReport();
+
+    static uint32_t getModeCpuFrequency(PowerMode mode);
+    static uint32_t getAwakeCurrentMicroamps(uint32_t cpuFrequencyMhz);
+
+private:
+    PowerMode mode;
+    ServoSnapshot previousServos;
+    unsigned long lastActiveMillis;
+    unsigned long lastAccountMicros;
+    uint64_t modeMicros[POWER_MODE_COUNT];
+    uint64_t lightSleepMicros;
+    uint32_t lightSleepCount;
+    uint64_t chargeMicroampMicros;
+
+    void account(unsigned long currentMicros);
+};
+
+extern PowerManager powerManager;
+
+#endif // POWER_MANAGEMENT
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,146 @@
+/**
+ * @file pwmFrameWriter.cpp
+ * @brief Writes servo frames to a PCA9685 using a single auto-increment I2C transaction.
+ *
+ * This class keeps a shadow copy of the last pulse written to each PCA9685 channel and only
+ * sends the span of LEDn registers that actually changed since the previous frame.
+ */
+
+#include "pwmFrameWriter.h"
+
+/**
+ * @brief Constructs a new PwmFrameWriter object.
+ *
+ * @param address The I2C address of the PCA9685.
+ * @param wire The I2C bus the PCA9685 is attached to.
+ */
+PwmFrameWriter::PwmFrameWriter(uint8_t address, TwoWire& wire):
+    wire(wire),
+    address(address),
+    activeChannels(0),
+    forcedChannels(0),
+    frameCount(0),
+    skippedFrameCount(0),
+    transactionCount(0),
+    byteCount(0)
+{
+    for (uint8_t channel = 0; channel < PCA9685_CHANNEL_COUNT; channel++) {
+        pendingPulses[channel] = PCA9685_FULL_OFF;
+        shadowPulses[channel] = PCA9685_FULL_OFF;
+    }
+}
+
+/**
+ * @brief Stages the pulse for a channel. Nothing is sent until flush() is called.
+ *
+ * @param channel The PCA9685 channel (0 -> 15).
+ * @param pulse The OFF tick of the pulse (0 -> 4095), or PCA9685_FULL_OFF to switch the channel off.
+ */
+void PwmFrameWriter::setPulse(uint8_t channel, uint16_t pulse) {
+    if (channel >= PCA9685_CHANNEL_COUNT) {
+        return;
+    }
+    pendingPulses[channel] = pulse;
+    activeChannels |= (1 << channel);
+}
+
+/**
+ * @brief Sends the staged frame to the PCA9685.
+ *
+ * Only the contiguous span of LEDn registers between the first and last changed channel is written,
+ * relying on the MODE1 auto-increment bit (set by Adafruit_PWMServoDriver::setPWMFreq()).
+ * Unchanged channels inside the span are re-sent with their shadow value. No transaction is made
+ * when nothing changed.
+ *
+ * @return The Wire::endTransmission() status, or 0 if nothing needed to be sent.
+ */
+uint8_t PwmFrameWriter::flush() {
+    frameCount++;
+
+    int firstChannel = -1;
+    int lastChannel = -1;
+    for (uint8_t channel = 0; channel < PCA9685_CHANNEL_COUNT; channel++) {
+        if (pendingPulses[channel] != shadowPulses[channel] || (forcedChannels & (1 << channel))) {
+            if (firstChannel < 0) {
+                firstChannel = channel;
+            }
+            lastChannel = channel;
+        }
+    }
+
+    if (firstChannel < 0) {
+        skippedFrameCount++;
+        return 0;
+    }
+
+    wire.beginTransmission(address);
+    wire.write(PCA9685_LED0_ON_L + 4 * firstChannel);
+    for (int channel = firstChannel; channel <= lastChannel; channel++) {
+        uint16_t pulse = pendingPulses[channel];
+        wire.write(0);              // ON_L
+        wire.write(0);              // ON_H
+        wire.write(pulse & 0xFF);   // OFF_L
+        wire.write(pulse >> 8);     // OFF_H (bit 4 = full off)
+    }
+    uint8_t status = wire.endTransmission();
+
+    transactionCount++;
+    byteCount += 2 + 4 * (lastChannel - firstChannel + 1); // Address + register + 4 bytes per channel
+
+    if (status == 0) {
+        for (int channel = firstChannel; channel <= lastChannel; channel++) {
+            shadowPulses[channel] = pendingPulses[channel];
+        }
+        forcedChannels = 0;
+    } else {
+        // The chip may have latched part of the frame, so resend everything next time
+        invalidate();
+    }
+
+    return status;
+}
+
+/**
+ * @brief Marks the PCA9685 register contents as unknown so the next flush() rewrites every active channel.
+ *
+ * Call this after the chip has been reset or reinitialized.
+ */
+void PwmFrameWriter::invalidate() {
+    forcedChannels = activeChannels;
+}
+
+/**
+ * @brief Gets the number of frames passed to flush().
+ *
+ * @return the number of frames.
+ */
+unsigned long PwmFrameWriter::getFrameCount() const {
+    return frameCount;
+}
+
+/**
+ * @brief Gets the number of frames that were skipped because nothing changed.
+ *
+ * @return the number of skipped frames.
+ */
+unsigned long PwmFrameWriter::getSkippedFrameCount() const {
+    return skippedFrameCount;
+}
+
+/**
+ * @brief Gets the number of I2C transactions sent.
+ *
+ * @return the number of I2C transactions.
+ */
+unsigned long PwmFrameWriter::getTransactionCount() const {
+    return transactionCount;
+}
+
+/**
+ * @brief Gets the number of bytes sent on the I2C bus (including the address byte).
+ *
+ * @return the number of bytes sent.
+ */
+unsigned long PwmFrameWriter::getByteCount() const {
+    return byteCount;
+}
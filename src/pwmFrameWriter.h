@@ -0,0 +1,47 @@
+/**
+ * @file pwmFrameWriter.h
+ * @brief Writes servo frames to a PCA9685 using a single auto-increment I2C transaction.
+ *
+ * This class keeps a shadow copy of the last pulse written to each PCA9685 channel and only
+ * sends the span of LEDn registers that actually changed since the previous frame.
+ */
+
+#ifndef PWM_FRAME_WRITER_H
+#define PWM_FRAME_WRITER_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define PCA9685_CHANNEL_COUNT 16
+#define PCA9685_LED0_ON_L 0x06          // First LEDn register, each channel uses 4 registers (ON_L, ON_H, OFF_L, OFF_H)
+#define PCA9685_FULL_OFF 4096           // OFF value with the full-off bit (OFF_H bit 4) set, matches the chip's reset state
+
+class PwmFrameWriter {
+public:
+    PwmFrameWriter(uint8_t address, TwoWire& wire = Wire);
+
+    void setPulse(uint8_t channel, uint16_t pulse);
+    uint8_t flush();
+    void invalidate();
+
+    unsigned long getFrameCount() const;
+    unsigned long getSkippedFrameCount() const;
+    unsigned long getTransactionCount() const;
+    unsigned long getByteCount() const;
+
+private:
+    TwoWire& wire;
+    uint8_t address;
+
+    uint16_t pendingPulses[PCA9685_CHANNEL_COUNT];
+    uint16_t shadowPulses[PCA9685_CHANNEL_COUNT];
+    uint16_t activeChannels;
+    uint16_t forcedChannels;
+
+    unsigned long frameCount;
+    unsigned long skippedFrameCount;
+    unsigned long transactionCount;
+    unsigned long byteCount;
+};
+
+#endif // PWM_FRAME_WRITER_H
@@ -0,0 +1,149 @@
+/**
+ * @file randomGenerator.cpp
+ * @brief Small, fast, seedable pseudo-random number generators for the behaviour engine.
+ *
+ * These generators are a few shifts and multiplies per draw, give the same sequence for the same
+ * seed on the device and on the host, and draw bounded integers without bias (Lemire's
+ * multiply-shift method, which only divides in the rare case that a draw must be rejected).
+ */
+
+#include "randomGenerator.h"
+
+#define PCG32_MULTIPLIER 6364136223846793005ULL
+#define PCG32_STREAM 0xda3e39cb94b95bdbULL
+
+/**
+ * @brief Steps a SplitMix32 sequence, used to spread a 32 bit seed over a generator's state.
+ *
+ * @param state The SplitMix32 state (updated).
+ * @return the next well-mixed 32 bit value.
+ */
+static uint32_t splitMix32(uint32_t& state) {
+    uint32_t value = (state += 0x9e3779b9);
+    value = (value ^ (value >> 16)) * 0x85ebca6b;
+    value = (value ^ (value >> 13)) * 0xc2b2ae35;
+    return value ^ (value >> 16);
+}
+
+/**
+ * @brief Rotates a 32 bit value left.
+ *
+ * @param value The value.
+ * @param bits The number of bits to rotate by (1 -> 31).
+ * @return the rotated value.
+ */
+static inline uint32_t rotateLeft(uint32_t value, uint8_t bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/**
+ * @brief Draws a uniform random number below a bound, without bias.
+ *
+ * Multiplies a 32 bit draw by the bound and keeps the top 32 bits. Draws that would make some
+ * results more likely than others are rejected, which needs the one division and happens with a
+ * chance of at most bound / 2^32.
+ *
+ * @param bound The number of possible results (0 returns 0).
+ * @return a uniform random number from 0 to bound - 1.
+ */
+uint32_t RandomGenerator::uniform(uint32_t bound) {
+    uint64_t product = (uint64_t)next() * bound;
+    uint32_t low = (uint32_t)product;
+    if (low < bound) {
+        uint32_t threshold = (0U - bound) % bound;
+        while (low < threshold) {
+            product = (uint64_t)next() * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return product >> 32;
+}
+
+/**
+ * @brief Draws a uniform random number in a range, like Arduino random(min, max).
+ *
+ * @param min The lowest possible result.
+ * @param max One more than the highest possible result.
+ * @return a uniform random number from min to max - 1 (min if the range is empty).
+ */
+int32_t RandomGenerator::uniform(int32_t min, int32_t max) {
+    if (max <= min) {
+        return min;
+    }
+    return min + (int32_t)uniform((uint32_t)(max - min));
+}
+
+/**
+ * @brief Constructs a new Xoshiro128StarStar object.
+ *
+ * @param seed The seed.
+ */
+Xoshiro128StarStar::Xoshiro128StarStar(uint32_t seed) {
+    this->seed(seed);
+}
+
+/**
+ * @brief Restarts the sequence from a seed, filling the state with SplitMix32 so it is never all zero.
+ *
+ * @param seed The seed.
+ */
+void Xoshiro128StarStar::seed(uint32_t seed) {
+    uint32_t mixState = seed;
+    for (int i = 0; i < 4; i++) {
+        state[i] = splitMix32(mixState);
+    }
+}
+
+/**
+ * @brief Draws the next 32 random bits.
+ *
+ * @return a uniform random number from 0 to UINT32_MAX.
+ */
+uint32_t Xoshiro128StarStar::next() {
+    uint32_t result = rotateLeft(state[1] * 5, 7) * 9;
+    uint32_t shifted = state[1] << 9;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= shifted;
+    state[3] = rotateLeft(state[3], 11);
+
+    return result;
+}
+
+/**
+ * @brief Constructs a new Pcg32 object.
+ *
+ * @param seed The seed.
+ */
+Pcg32::Pcg32(uint32_t seed) {
+    this->seed(seed);
+}
+
+/**
+ * @brief Restarts the sequence from a seed (on a fixed stream), as the reference pcg32_srandom().
+ *
+ * @param seed The seed.
+ */
+void Pcg32::seed(uint32_t seed) {
+    state = 0;
+    increment = (PCG32_STREAM << 1) | 1;
+    next();
+    state += seed;
+    next();
+}
+
+/**
+ * @brief Draws the next 32 random bits.
+ *
+ * @return a uniform random number from 0 to UINT32_MAX.
+ */
+uint32_t Pcg32::next() {
+    uint64_t previous = state;
+    state = previous * PCG32_MULTIPLIER + increment;
+    uint32_t xorShifted = ((previous >> 18) ^ previous) >> 27;
+    uint8_t rotation = previous >> 59;
+    return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+}
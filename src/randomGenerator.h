@@ -0,0 +1,77 @@
+/**
+ * @file randomGenerator.h
+ * @brief Small, fast, seedable pseudo-random number generators for the behaviour engine.
+ *
+ * Arduino random() on the ESP32 reads the hardware RNG and ignores randomSeed(), so behaviour can
+ * never be reproduced, and every bounded draw costs a division. These generators are a few
+ * shifts and multiplies per draw, give the same sequence for the same seed on the device and on
+ * the host, and draw bounded integers without bias (Lemire's multiply-shift method, which only
+ * divides in the rare case that a draw must be rejected).
+ *
+ * Prng is the generator the firmware uses: xoshiro128** by default, or PCG32 if PRNG_PCG32 is defined.
+ */
+
+#ifndef RANDOM_GENERATOR_H
+#define RANDOM_GENERATOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+class RandomGenerator {
+public:
+    virtual ~RandomGenerator() {}
+
+    /**
+     * @brief Restarts the sequence from a seed. Equal seeds give equal sequences.
+     *
+     * @param seed The seed (any value, including 0).
+     */
+    virtual void seed(uint32_t seed) = 0;
+
+    /**
+     * @brief Draws the next 32 random bits.
+     *
+     * @return a uniform random number from 0 to UINT32_MAX.
+     */
+    virtual uint32_t next() = 0;
+
+    uint32_t uniform(uint32_t bound);
+    int32_t uniform(int32_t min, int32_t max);
+};
+
+/**
+ * @brief xoshiro128** (Blackman and Vigna): 128 bits of state, period 2^128 - 1.
+ */
+class Xoshiro128StarStar : public RandomGenerator {
+public:
+    Xoshiro128StarStar(uint32_t seed = 0);
+
+    void seed(uint32_t seed) override;
+    uint32_t next() override;
+
+private:
+    uint32_t state[4];
+};
+
+/**
+ * @brief PCG32 (O'Neill): 64 bit LCG state with a permuted 32 bit output, period 2^64.
+ */
+class Pcg32 : public RandomGenerator {
+public:
+    Pcg32(uint32_t seed = 0);
+
+    void seed(uint32_t seed) override;
+    uint32_t next() override;
+
+private:
+    uint64_t state;
+    uint64_t increment;
+};
+
+#ifdef PRNG_PCG32
+typedef Pcg32 Prng;
+#else
+typedef Xoshiro128StarStar Prng;
+#endif
+
+#endif // RANDOM_GENERATOR_H
@@ -0,0 +1,386 @@
+/**
+ * @file remoteControl.cpp
+ * @brief Remote control: gaze setpoints streamed from a host over the serial port or a RemoteTransport.
+ *
+ * The host sends framed setpoints (see frameCodec.h) at 100 Hz or more, each stamped with its own
+ * clock and a sequence number, over serial or (with REMOTE_UDP) as one datagram per frame through a
+ * RemoteTransport. The console task decodes them and queues them for the state task,
+ * which holds them in a SetpointJitterBuffer until they are due and then drives the eyes with them.
+ * Remote control sits between the two existing modes: manual control (the joystick) always wins,
+ * and autonomous control takes over again once the host releases control or stops streaming for
+ * REMOTE_CONTROL_TIMEOUT.
+ *
+ * The servo task records when the first PWM frame for each setpoint is written, so the latency from
+ * a setpoint arriving to it reaching the servos (including the jitter delay) is measured on the bot.
+ * While setpoints are streaming, a report frame with that latency is sent back every
+ * REMOTE_REPORT_INTERVAL. Drive it from a host with tools/remote_gaze.py.
+ */
+
+#include "remoteControl.h"
+
+#ifdef REMOTE_CONTROL
+
+#ifdef TELEMETRY_STREAM
+#include "telemetry.h"
+
+static_assert(sizeof(RemoteReportPayload) <= sizeof(TelemetrySample), "RemoteReportPayload must fit a telemetry frame");
+#endif
+
+/**
+ * @brief Constructs a new RemoteControl object, under no host's control.
+ */
+RemoteControl::RemoteControl():
+    receiveLength(0),
+    inFrame(false),
+    framesSeen(false),
+    lastFrameMillis(0),
+    transport(nullptr),
+    packetsSeen(false),
+    lastPacketMillis(0),
+    lastReportMillis(0),
+    reportSequence(0),
+    frameCount(0),
+    badFrameCount(0),
+    queueFullCount(0),
+    reportedLatencyCount(0),
+    reportedLatencySum(0),
+    maxResetRequest(0),
+    current(),
+    active(false),
+    lastPlayMicros(0),
+    lateCount(0),
+    staleCount(0),
+    overflowCount(0),
+    outputSeen(false),
+    maxResetSeen(0),
+    lastOutputSequence(0),
+    latencyCount(0),
+    latencySum(0),
+    latencyMax(0),
+    latencyMaxEver(0)
+{}
+
+/**
+ * @brief Feeds a byte from the serial port through the frame decoder (runs in the console task).
+ *
+ * A delimiter opens a frame and the next one closes it, so a byte outside a frame is a console key.
+ *
+ * @param byte The byte.
+ * @param currentMillis The current time (ms).
+ * @param currentMicros The current time (us), taken as the receive time of a completed setpoint.
+ * @return true if the byte was part of a frame, false if it is a console key.
+ */
+bool RemoteControl::receive(uint8_t byte, unsigned long currentMillis, unsigned long currentMicros) {
+    if (byte == FRAME_DELIMITER) {
+        if (inFrame && receiveLength > 0) {
+            handleFrame(receiveBuffer, receiveLength, currentMicros);
+            inFrame = false;
+        } else {
+            // An opening delimiter (or an empty frame, which is the same thing)
+            inFrame = true;
+        }
+        receiveLength = 0;
+        framesSeen = true;
+        lastFrameMillis = currentMillis;
+        return true;
+    }
+
+    if (!inFrame) {
+        return false;
+    }
+
+    if (receiveLength < sizeof(receiveBuffer)) {
+        receiveBuffer[receiveLength++] = byte;
+    } else {
+        // Too long for any frame the bot accepts, so skip to the next delimiter
+        badFrameCount++;
+        inFrame = false;
+    }
+    lastFrameMillis = currentMillis;
+    return true;
+}
+
+/**
+ * @brief Checks whether console keys should be ignored because setpoints are streaming. After a lost
+ * delimiter the rest of a frame looks like keys until the next one.
+ *
+ * @param currentMillis The current time (ms).
+ * @return true if a frame byte was received within REMOTE_CONSOLE_LOCKOUT.
+ */
+bool RemoteControl::isConsoleLocked(unsigned long currentMillis) const {
+    return framesSeen && currentMillis - lastFrameMillis < REMOTE_CONSOLE_LOCKOUT;
+}
+
+/**
+ * @brief Sets the datagram link to take frames from, as well as the serial port.
+ *
+ * @param transport The started transport.
+ */
+void RemoteControl::setTransport(RemoteTransport* transport) {
+    this->transport = transport;
+}
+
+/**
+ * @brief Takes up to REMOTE_UDP_MAX_PACKETS waiting datagrams from the transport (runs in the console task).
+ *
+ * @param currentMillis The current time (ms).
+ * @param currentMicros The current time (us), taken as the receive time of the setpoints.
+ */
+void RemoteControl::poll(unsigned long currentMillis, unsigned long currentMicros) {
+    if (!transport) {
+        return;
+    }
+
+    // One byte more than a frame can be, so an oversized datagram is not mistaken for a valid one
+    uint8_t datagram[FRAME_ENCODED_SIZE(REMOTE_HEADER_SIZE + sizeof(RemoteSetpointPayload)) + 1];
+    for (uint8_t packet = 0; packet < REMOTE_UDP_MAX_PACKETS; packet++) {
+        size_t length = transport->receive(datagram, sizeof(datagram));
+        if (length == 0) {
+            break;
+        }
+        packetsSeen = true;
+        lastPacketMillis = currentMillis;
+
+        // The delimiters are optional in a datagram
+        const uint8_t* encoded = datagram;
+        if (length > 0 && encoded[0] == FRAME_DELIMITER) {
+            encoded++;
+            length--;
+        }
+        if (length > 0 && encoded[length - 1] == FRAME_DELIMITER) {
+            length--;
+        }
+        if (length == 0 || length > sizeof(receiveBuffer)) {
+            badFrameCount++;
+            continue;
+        }
+        handleFrame(encoded, length, currentMicros);
+    }
+}
+
+/**
+ * @brief Decodes a received frame and queues it for the state task.
+ *
+ * @param encoded The encoded bytes (without delimiters).
+ * @param length The number of encoded bytes (at most the size of receiveBuffer).
+ * @param currentMicros The receive time (us).
+ */
+void RemoteControl::handleFrame(const uint8_t* encoded, size_t length, unsigned long currentMicros) {
+    uint8_t payload[sizeof(receiveBuffer)];
+    length = frameDecode(encoded, length, payload);
+    if (length < REMOTE_HEADER_SIZE) {
+        badFrameCount++;
+        return;
+    }
+
+    RemoteCommand command = {};
+    command.type = payload[0];
+    command.setpoint.sequence = payload[1] | (payload[2] << 8);
+    command.setpoint.receiveMicros = currentMicros;
+
+    if (command.type == REMOTE_FRAME_SETPOINT && length == REMOTE_HEADER_SIZE + sizeof(RemoteSetpointPayload)) {
+        RemoteSetpointPayload body;
+        memcpy(&body, payload + REMOTE_HEADER_SIZE, sizeof(body));
+        command.setpoint.hostMicros = body.hostMicros;
+        command.setpoint.pan = constrain(body.pan, -100, 100);
+        command.setpoint.tilt = constrain(body.tilt, -100, 100);
+        command.setpoint.topLid = min(body.topLid, (uint8_t)100);
+        command.setpoint.bottomLid = min(body.bottomLid, (uint8_t)100);
+        command.setpoint.flags = body.flags;
+    } else if (command.type != REMOTE_FRAME_RELEASE || length != REMOTE_HEADER_SIZE) {
+        badFrameCount++;
+        return;
+    }
+
+    frameCount++;
+    if (!queue.push(command)) {
+        queueFullCount++;
+    }
+}
+
+/**
+ * @brief Plays the streamed setpoints (runs in the state task).
+ *
+ * @param currentMicros The current time (us).
+ * @param setpoint Receives the setpoint to drive the eyes with.
+ * @return true if the eyes are under remote control.
+ */
+bool RemoteControl::update(unsigned long currentMicros, RemoteSetpoint& setpoint) {
+    RemoteCommand command;
+    while (queue.pop(command)) {
+        if (command.type == REMOTE_FRAME_RELEASE) {
+            release();
+            continue;
+        }
+
+        switch (jitterBuffer.push(command.setpoint, currentMicros)) {
+            case JITTER_LATE:
+                lateCount.store(lateCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                break;
+            case JITTER_STALE:
+                staleCount.store(staleCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                break;
+            case JITTER_OVERFLOW:
+                overflowCount.store(overflowCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                break;
+            case JITTER_ACCEPTED:
+                break;
+        }
+    }
+
+    if (jitterBuffer.pop(currentMicros, current)) {
+        #ifdef SERIAL_DEBUG
+        if (!active) {
+            Serial.println("Remote Control Enabled");
+        }
+        #endif
+        active = true;
+        lastPlayMicros = currentMicros;
+    } else if (active && currentMicros - lastPlayMicros >= REMOTE_CONTROL_TIMEOUT * 1000UL) {
+        release();
+    }
+
+    if (active) {
+        setpoint = current;
+    }
+    return active;
+}
+
+/**
+ * @brief Hands back to autonomous control and gets ready for a new stream (whose sequence numbers
+ * and clock may start anywhere).
+ */
+void RemoteControl::release() {
+    #ifdef SERIAL_DEBUG
+    if (active) {
+        Serial.println("Remote Control Disabled");
+    }
+    #endif
+    active = false;
+    jitterBuffer.reset();
+}
+
+/**
+ * @brief Records the latency of a remote setpoint the first time it is written to the servos
+ * (runs in the servo task, just after the write).
+ *
+ * @param state The state snapshot the servos were moved towards.
+ * @param currentMicros The current time (us).
+ */
+void RemoteControl::recordOutput(const StateSnapshot& state, unsigned long currentMicros) {
+    uint32_t resetRequest = maxResetRequest.load(std::memory_order_acquire);
+    if (resetRequest != maxResetSeen) {
+        maxResetSeen = resetRequest;
+        latencyMax.store(0, std::memory_order_relaxed);
+    }
+
+    if (!(state.flags & STATE_FLAG_REMOTE)) {
+        // A new stream may start from any sequence number
+        outputSeen = false;
+        return;
+    }
+    if (outputSeen && state.remoteSequence == lastOutputSequence.load(std::memory_order_relaxed)) {
+        return;
+    }
+    outputSeen = true;
+
+    uint32_t latency = currentMicros - state.remoteReceiveMicros;
+    lastOutputSequence.store(state.remoteSequence, std::memory_order_relaxed);
+    latencySum.store(latencySum.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+    if (latency > latencyMax.load(std::memory_order_relaxed)) {
+        latencyMax.store(latency, std::memory_order_relaxed);
+    }
+    if (latency > latencyMaxEver.load(std::memory_order_relaxed)) {
+        latencyMaxEver.store(latency, std::memory_order_relaxed);
+    }
+    // The count is published last, so a reader that sees it also sees its latency in the sum
+    latencyCount.store(latencyCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Fills in a report with the latencies recorded since the last report, and the running counts.
+ *
+ * @param report Receives the report.
+ */
+void RemoteControl::takeLatency(RemoteReportPayload& report) {
+    uint32_t count = latencyCount.load(std::memory_order_acquire);
+    uint32_t sum = latencySum.load(std::memory_order_relaxed);
+    uint32_t newCount = count - reportedLatencyCount;
+    uint32_t newSum = sum - reportedLatencySum;
+    reportedLatencyCount = count;
+    reportedLatencySum = sum;
+
+    report.outputSequence = lastOutputSequence.load(std::memory_order_relaxed);
+    report.latencyCount = min(newCount, (uint32_t)UINT16_MAX);
+    report.latencyMeanMicros = newCount > 0 ? newSum / newCount : 0;
+    report.latencyMaxMicros = latencyMax.load(std::memory_order_relaxed);
+    maxResetRequest.store(maxResetRequest.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    report.frameCount = frameCount;
+    report.badFrameCount = badFrameCount;
+    report.lateCount = lateCount.load(std::memory_order_relaxed);
+    report.staleCount = staleCount.load(std::memory_order_relaxed);
+    report.droppedCount = queueFullCount + overflowCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sends a report frame every REMOTE_REPORT_INTERVAL over each link that setpoints are
+ * streaming on (runs in the console task). The frame is dropped rather than waiting for a link.
+ *
+ * @param currentMillis The current time (ms).
+ */
+void RemoteControl::sendReport(unsigned long currentMillis) {
+    bool serialStreaming = framesSeen && currentMillis - lastFrameMillis < REMOTE_STREAM_IDLE;
+    bool packetsStreaming = packetsSeen && currentMillis - lastPacketMillis < REMOTE_STREAM_IDLE;
+    if (!(serialStreaming || packetsStreaming) || currentMillis - lastReportMillis < REMOTE_REPORT_INTERVAL) {
+        return;
+    }
+    lastReportMillis = currentMillis;
+
+    RemoteReportPayload report;
+    takeLatency(report);
+
+    uint8_t raw[REMOTE_HEADER_SIZE + sizeof(report)];
+    raw[0] = REMOTE_FRAME_REPORT;
+    raw[1] = reportSequence & 0xFF;
+    raw[2] = reportSequence >> 8;
+    memcpy(raw + REMOTE_HEADER_SIZE, &report, sizeof(report));
+    reportSequence++;
+
+    uint8_t frame[FRAME_ENCODED_SIZE(sizeof(raw))];
+    size_t frameLength = frameEncode(raw, sizeof(raw), frame);
+
+    if (packetsStreaming) {
+        transport->send(frame, frameLength);
+    }
+
+    if (serialStreaming) {
+        #ifdef TELEMETRY_STREAM
+        // Share the telemetry ring so the two streams never interleave inside a frame
+        telemetryStream.queueFrame(REMOTE_FRAME_REPORT, &report, sizeof(report));
+        #else
+        if (Serial.availableForWrite() >= (int)frameLength) {
+            Serial.write(frame, frameLength);
+        }
+        #endif
+    }
+}
+
+/**
+ * @brief Prints the latencies since the last report and the running counts.
+ */
+void RemoteControl::printReport() {
+    RemoteReportPayload report;
+    takeLatency(report);
+
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer), "REMOTE: latency count %u mean %lu us max %lu us (max since boot %lu us), last sequence %u",
+             report.latencyCount, (unsigned long)report.latencyMeanMicros, (unsigned long)report.latencyMaxMicros,
+             (unsigned long)latencyMaxEver.load(std::memory_order_relaxed), report.outputSequence);
+    Serial.println(buffer);
+    snprintf(buffer, sizeof(buffer), "REMOTE: frames %u bad %u late %u stale %u dropped %u",
+             report.frameCount, report.badFrameCount, report.lateCount, report.staleCount, report.droppedCount);
+    Serial.println(buffer);
+}
+
+#endif // REMOTE_CONTROL
@@ -0,0 +1,139 @@
+/**
+ * @file remoteControl.h
+ * @brief Remote control: gaze setpoints streamed from a host over the serial port or a RemoteTransport.
+ *
+ * The host sends framed setpoints (see frameCodec.h) at 100 Hz or more, each stamped with its own
+ * clock and a sequence number, over serial or (with REMOTE_UDP) as one datagram per frame through a
+ * RemoteTransport. The console task decodes them and queues them for the state task,
+ * which holds them in a SetpointJitterBuffer until they are due and then drives the eyes with them.
+ * Remote control sits between the two existing modes: manual control (the joystick) always wins,
+ * and autonomous control takes over again once the host releases control or stops streaming for
+ * REMOTE_CONTROL_TIMEOUT.
+ *
+ * The servo task records when the first PWM frame for each setpoint is written, so the latency from
+ * a setpoint arriving to it reaching the servos (including the jitter delay) is measured on the bot.
+ * While setpoints are streaming, a report frame with that latency is sent back every
+ * REMOTE_REPORT_INTERVAL. Drive it from a host with tools/remote_gaze.py.
+ */
+
+#ifndef REMOTE_CONTROL_H
+#define REMOTE_CONTROL_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "frameCodec.h"
+#include "remoteTransport.h"
+#include "setpointJitterBuffer.h"
+#include "snapshots.h"
+#include "spscQueue.h"
+
+#define REMOTE_FRAME_SETPOINT 0x10  // Host to bot. Payload: RemoteSetpointPayload
+#define REMOTE_FRAME_RELEASE 0x11   // Host to bot. No payload: hand back to autonomous control at once
+#define REMOTE_FRAME_REPORT 0x12    // Bot to host. Payload: RemoteReportPayload
+
+#define REMOTE_FLAG_BLINK 0x01      // RemoteSetpointPayload::flags: close both lids, whatever the lid setpoints
+
+// Frame header, as for telemetry: type (1 byte) and sequence number (2 bytes, little endian)
+#define REMOTE_HEADER_SIZE 3
+
+/**
+ * @brief A setpoint frame's payload. The layout is the wire format (little endian) and must match
+ * tools/remote_gaze.py.
+ */
+struct __attribute__((packed)) RemoteSetpointPayload {
+    uint32_t hostMicros;    // When the host sent it (host clock, us)
+    int8_t pan;             // -100 -> 100
+    int8_t tilt;            // -100 -> 100
+    uint8_t topLid;         // 0 -> 100
+    uint8_t bottomLid;      // 0 -> 100
+    uint8_t flags;          // REMOTE_FLAG_*
+};
+
+/**
+ * @brief A report frame's payload. The layout is the wire format (little endian) and must only ever
+ * be extended at the end.
+ */
+struct __attribute__((packed)) RemoteReportPayload {
+    uint16_t outputSequence;        // The last setpoint written to the servos
+    uint16_t latencyCount;          // Setpoints written to the servos since the last report
+    uint32_t latencyMeanMicros;     // Their mean latency from being received to being written (us)
+    uint32_t latencyMaxMicros;      // Their longest latency (us)
+    uint16_t frameCount;            // Frames received (running count)
+    uint16_t badFrameCount;         // Frames rejected for a bad CRC, length or type (running count)
+    uint16_t lateCount;             // Setpoints that arrived after they were due, played at once (running count)
+    uint16_t staleCount;            // Setpoints dropped as not newer than one already played (running count)
+    uint16_t droppedCount;          // Setpoints dropped because a queue was full (running count)
+};
+
+/**
+ * @brief A decoded frame, passed from the console task to the state task.
+ */
+struct RemoteCommand {
+    uint8_t type;               // REMOTE_FRAME_SETPOINT or REMOTE_FRAME_RELEASE
+    RemoteSetpoint setpoint;
+};
+
+class RemoteControl {
+public:
+    RemoteControl();
+
+    bool receive(uint8_t byte, unsigned long currentMillis, unsigned long currentMicros);
+    bool isConsoleLocked(unsigned long currentMillis) const;
+    void setTransport(RemoteTransport* transport);
+    void poll(unsigned long currentMillis, unsigned long currentMicros);
+    void sendReport(unsigned long currentMillis);
+    void printReport();
+
+    bool update(unsigned long currentMicros, RemoteSetpoint& setpoint);
+
+    void recordOutput(const StateSnapshot& state, unsigned long currentMicros);
+
+private:
+    // Console task
+    uint8_t receiveBuffer[FRAME_ENCODED_SIZE(REMOTE_HEADER_SIZE + sizeof(RemoteSetpointPayload))];
+    size_t receiveLength;
+    bool inFrame;
+    bool framesSeen;                        // lastFrameMillis is valid
+    unsigned long lastFrameMillis;          // When the last frame byte was received
+    RemoteTransport* transport;
+    bool packetsSeen;                       // lastPacketMillis is valid
+    unsigned long lastPacketMillis;         // When the last datagram was received
+    unsigned long lastReportMillis;
+    uint16_t reportSequence;
+    uint16_t frameCount;
+    uint16_t badFrameCount;
+    uint16_t queueFullCount;
+    uint32_t reportedLatencyCount;          // The latency totals at the last report
+    uint32_t reportedLatencySum;
+    SpscQueue<RemoteCommand, REMOTE_QUEUE_SIZE> queue;
+    std::atomic<uint32_t> maxResetRequest;  // Bumped to ask the servo task to restart latencyMax
+
+    // State task
+    SetpointJitterBuffer jitterBuffer;
+    RemoteSetpoint current;
+    bool active;
+    unsigned long lastPlayMicros;
+    std::atomic<uint16_t> lateCount;
+    std::atomic<uint16_t> staleCount;
+    std::atomic<uint16_t> overflowCount;
+
+    // Servo task
+    bool outputSeen;                        // lastOutputSequence is valid
+    uint32_t maxResetSeen;
+    std::atomic<uint16_t> lastOutputSequence;
+    std::atomic<uint32_t> latencyCount;     // Setpoints written to the servos (running count)
+    std::atomic<uint32_t> latencySum;       // Their total latency (us, wraps)
+    std::atomic<uint32_t> latencyMax;       // Their longest latency since the last report (us)
+    std::atomic<uint32_t> latencyMaxEver;   // Their longest latency since boot (us)
+
+    void handleFrame(const uint8_t* encoded, size_t length, unsigned long currentMicros);
+    void release();
+    void takeLatency(RemoteReportPayload& report);
+};
+
+#ifdef REMOTE_CONTROL
+extern RemoteControl remoteControl;
+#endif
+
+#endif // REMOTE_CONTROL_H
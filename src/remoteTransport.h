@@ -0,0 +1,46 @@
+/**
+ * @file remoteTransport.h
+ * @brief Abstract interface for a datagram link that carries remote control frames.
+ *
+ * RemoteControl only ever calls begin(), receive() and send(), so the link can be swapped between
+ * Wi-Fi UDP on the bot and a loopback UDP socket on the host (for latency and packet loss tests).
+ * Each datagram carries one frame, encoded exactly as on the serial port (see frameCodec.h).
+ */
+
+#ifndef REMOTE_TRANSPORT_H
+#define REMOTE_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class RemoteTransport {
+public:
+    virtual ~RemoteTransport() {}
+
+    /**
+     * @brief Starts listening. Never waits for the link to come up.
+     *
+     * @return true if the transport started, false otherwise.
+     */
+    virtual bool begin() = 0;
+
+    /**
+     * @brief Takes the next waiting datagram. Never blocks.
+     *
+     * @param buffer Receives the datagram (truncated to capacity).
+     * @param capacity The buffer size.
+     * @return the datagram length, or 0 if none is waiting.
+     */
+    virtual size_t receive(uint8_t* buffer, size_t capacity) = 0;
+
+    /**
+     * @brief Sends a datagram to wherever the last one was received from. Never blocks.
+     *
+     * @param data The datagram.
+     * @param length The datagram length.
+     * @return true if it was sent, false if there is no peer yet or the link is busy.
+     */
+    virtual bool send(const uint8_t* data, size_t length) = 0;
+};
+
+#endif // REMOTE_TRANSPORT_H
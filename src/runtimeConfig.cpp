@@ -0,0 +1,518 @@
+/**
+ * @file runtimeConfig.cpp
+ * @brief The tuning settings that can be changed at runtime, stored as one packed, CRC-checked blob in NVS.
+ *
+ * A new config is written into the inactive buffer, checked, and then made active with a single
+ * atomic store. The stages notice the change through getGeneration() at the start of their next
+ * update. The inactive buffer is only reused once RUNTIME_CONFIG_SWAP_GRACE has passed.
+ */
+
+#include <stddef.h>
+#include "runtimeConfig.h"
+#include "behaviourModel.h"
+#include "servoCalibration.h"
+
+#ifdef RUNTIME_CONFIG
+#include <Preferences.h>
+#endif
+
+/**
+ * @brief Builds the default config from the config.h settings (evaluated by the compiler).
+ *
+ * @return the defaults.
+ */
+constexpr RuntimeConfigValues buildDefaults() {
+    RuntimeConfigValues values = {};
+    for (uint8_t board = 0; board < SERVO_BOARD_COUNT; board++) {
+        for (uint8_t slot = 0; slot < SERVO_SLOT_COUNT; slot++) {
+            values.servoPulseAtStateMin[board][slot] = SERVO_DEFAULT_PULSE_AT_STATE_MIN[slot] + SERVO_RIG_PULSE_TRIM_MIN[board][slot];
+            values.servoPulseAtStateMax[board][slot] = SERVO_DEFAULT_PULSE_AT_STATE_MAX[slot] + SERVO_RIG_PULSE_TRIM_MAX[board][slot];
+        }
+    }
+    values.joystickDriftX = JOYSTICK_DRIFT_ADUSTMENT_X;
+    values.joystickDriftY = JOYSTICK_DRIFT_ADUSTMENT_Y;
+    values.joystickDeadzone = JOYSTICK_DEADZONE;
+    values.joystickDeadzoneHysteresis = JOYSTICK_DEADZONE_HYSTERESIS;
+    values.manualControlTimeout = MANUAL_CONTROL_TIMEOUT;
+    values.autoPowerOffTimeout = AUTO_POWER_OFF_TIMEOUT;
+    values.autoBlinkDuration = AUTO_BLINK_DURATION;
+    values.chanceOfBlink = AUTO_CHANCE_OF_BLINK;
+    values.chanceOfEyelidChange = AUTO_CHANCE_OF_EYELID_CHANGE;
+    values.chanceOfMajorLookChange = AUTO_CHANCE_OF_MAJOR_LOOK_CHANGE;
+    values.chanceOfLookReturnCentre = AUTO_CHANCE_OF_LOOK_RETURN_CENTRE;
+    values.chanceOfBlinkWhileLook = AUTO_CHANCE_OF_BLINK_WHILE_LOOK;
+    for (uint8_t i = 0; i < AUTO_SQUINT_POSITION_COUNT; i++) {
+        values.squintPositions[i] = AUTO_SQUINT_POSITIONS[i];
+    }
+    for (uint8_t i = 0; i < AUTO_LOOK_PAN_POSITION_COUNT; i++) {
+        values.lookPanPositions[i] = AUTO_LOOK_PAN_POSITIONS[i];
+    }
+    for (uint8_t i = 0; i < AUTO_LOOK_TILT_POSITION_COUNT; i++) {
+        values.lookTiltPositions[i] = AUTO_LOOK_TILT_POSITIONS[i];
+    }
+    return values;
+}
+
+/**
+ * @brief Checks that every position is within its range.
+ *
+ * @param positions The positions.
+ * @param count The number of positions.
+ * @param minimum The lowest allowed position.
+ * @param maximum The highest allowed position.
+ * @return true if they are all in range.
+ */
+constexpr bool positionsInRange(const int8_t* positions, uint8_t count, int minimum, int maximum) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (positions[i] < minimum || positions[i] > maximum) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks a config against the same limits the config.h settings are held to at compile time.
+ *
+ * @param values The config.
+ * @return true if the config can be used.
+ */
+constexpr bool validateValues(const RuntimeConfigValues& values) {
+    for (uint8_t board = 0; board < SERVO_BOARD_COUNT; board++) {
+        bool inverted[SERVO_SLOT_COUNT] = {};
+        for (uint8_t slot = 0; slot < SERVO_SLOT_COUNT; slot++) {
+            uint16_t pulseMin = values.servoPulseAtStateMin[board][slot];
+            uint16_t pulseMax = values.servoPulseAtStateMax[board][slot];
+            if (pulseMin == pulseMax ||
+                pulseMin < SERVO_PULSE_TICKS_MIN || pulseMin > SERVO_PULSE_TICKS_MAX ||
+                pulseMax < SERVO_PULSE_TICKS_MIN || pulseMax > SERVO_PULSE_TICKS_MAX) {
+                return false;
+            }
+            inverted[slot] = pulseMin > pulseMax;
+        }
+
+        // The lids are mounted as mirror images (see servoCalibration.h)
+        if (inverted[SERVO_SLOT_LEFT_LID_TOP] == inverted[SERVO_SLOT_RIGHT_LID_TOP] ||
+            inverted[SERVO_SLOT_LEFT_LID_BOTTOM] == inverted[SERVO_SLOT_RIGHT_LID_BOTTOM] ||
+            inverted[SERVO_SLOT_LEFT_LID_TOP] == inverted[SERVO_SLOT_LEFT_LID_BOTTOM] ||
+            inverted[SERVO_SLOT_RIGHT_LID_TOP] == inverted[SERVO_SLOT_RIGHT_LID_BOTTOM]) {
+            return false;
+        }
+    }
+
+    if (values.joystickDriftX < -2048 || values.joystickDriftX > 2048 ||
+        values.joystickDriftY < -2048 || values.joystickDriftY > 2048 ||
+        values.joystickDeadzone + values.joystickDeadzoneHysteresis > 2048) {
+        return false;
+    }
+
+    // The bot sleeps for the last second before powering off
+    if (values.manualControlTimeout == 0 || values.autoPowerOffTimeout <= 1000 || values.autoBlinkDuration == 0) {
+        return false;
+    }
+
+    const uint16_t chances[] = {
+        values.chanceOfBlink, values.chanceOfEyelidChange, values.chanceOfMajorLookChange,
+        values.chanceOfLookReturnCentre, values.chanceOfBlinkWhileLook,
+    };
+    for (uint16_t chance : chances) {
+        if (chance > AUTO_MAX_CHANCE) {
+            return false;
+        }
+    }
+    BehaviourChances behaviourChances = {
+        values.chanceOfBlink, values.chanceOfEyelidChange, values.chanceOfMajorLookChange,
+        values.chanceOfLookReturnCentre, values.chanceOfBlinkWhileLook,
+    };
+    if (totalBehaviourWeight(buildBehaviourTable(behaviourChances)) > BEHAVIOUR_WEIGHT_SCALE) {
+        return false;
+    }
+
+    if (!positionsInRange(values.squintPositions, AUTO_SQUINT_POSITION_COUNT, 0, 100) ||
+        !positionsInRange(values.lookPanPositions, AUTO_LOOK_PAN_POSITION_COUNT, -100, 100) ||
+        !positionsInRange(values.lookTiltPositions, AUTO_LOOK_TILT_POSITION_COUNT, -100, 100)) {
+        return false;
+    }
+
+    for (uint8_t reserved : values.reserved) {
+        if (reserved != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static constexpr RuntimeConfigValues RUNTIME_CONFIG_DEFAULTS = buildDefaults();
+
+static_assert(validateValues(RUNTIME_CONFIG_DEFAULTS), "The config.h defaults fail the runtime config checks");
+
+enum RuntimeConfigFieldType : uint8_t {
+    FIELD_INT8,
+    FIELD_INT16,
+    FIELD_UINT16,
+    FIELD_UINT32,
+};
+
+/**
+ * @brief Where a field is in RuntimeConfigValues, so print() can list them by name.
+ */
+struct RuntimeConfigField {
+    const char* name;
+    uint8_t offset;
+    uint8_t type;
+    uint8_t count;
+};
+
+#define CONFIG_FIELD(field, type, count) {#field, offsetof(RuntimeConfigValues, field), type, count}
+
+static const RuntimeConfigField RUNTIME_CONFIG_FIELDS[] = {
+    CONFIG_FIELD(servoPulseAtStateMin, FIELD_UINT16, SERVO_BOARD_COUNT * SERVO_SLOT_COUNT),
+    CONFIG_FIELD(servoPulseAtStateMax, FIELD_UINT16, SERVO_BOARD_COUNT * SERVO_SLOT_COUNT),
+    CONFIG_FIELD(joystickDriftX, FIELD_INT16, 1),
+    CONFIG_FIELD(joystickDriftY, FIELD_INT16, 1),
+    CONFIG_FIELD(joystickDeadzone, FIELD_UINT16, 1),
+    CONFIG_FIELD(joystickDeadzoneHysteresis, FIELD_UINT16, 1),
+    CONFIG_FIELD(manualControlTimeout, FIELD_UINT32, 1),
+    CONFIG_FIELD(autoPowerOffTimeout, FIELD_UINT32, 1),
+    CONFIG_FIELD(autoBlinkDuration, FIELD_UINT16, 1),
+    CONFIG_FIELD(chanceOfBlink, FIELD_UINT16, 1),
+    CONFIG_FIELD(chanceOfEyelidChange, FIELD_UINT16, 1),
+    CONFIG_FIELD(chanceOfMajorLookChange, FIELD_UINT16, 1),
+    CONFIG_FIELD(chanceOfLookReturnCentre, FIELD_UINT16, 1),
+    CONFIG_FIELD(chanceOfBlinkWhileLook, FIELD_UINT16, 1),
+    CONFIG_FIELD(squintPositions, FIELD_INT8, AUTO_SQUINT_POSITION_COUNT),
+    CONFIG_FIELD(lookPanPositions, FIELD_INT8, AUTO_LOOK_PAN_POSITION_COUNT),
+    CONFIG_FIELD(lookTiltPositions, FIELD_INT8, AUTO_LOOK_TILT_POSITION_COUNT),
+};
+
+static const char* const RUNTIME_CONFIG_RESULT_NAMES[] = {
+    "ok", "bad length", "bad header", "bad crc", "bad value", "busy", "store failed",
+};
+
+/**
+ * @brief Constructs a new RuntimeConfig object, running on the defaults.
+ */
+RuntimeConfig::RuntimeConfig():
+    activeIndex(0),
+    generation(0),
+    lastSwapMillis(0),
+    swapped(false),
+    receiveLength(0),
+    receiving(false),
+    receiveStartMillis(0)
+{
+    buffers[0].values = RUNTIME_CONFIG_DEFAULTS;
+    seal(buffers[0]);
+    buffers[1] = buffers[0];
+}
+
+/**
+ * @brief Loads the stored config, reading it straight into the inactive buffer. Keeps the defaults
+ * if there is none or it fails its checks. Call this before any stage starts.
+ */
+void RuntimeConfig::begin() {
+    #ifdef RUNTIME_CONFIG
+    Preferences preferences;
+    if (!preferences.begin(RUNTIME_CONFIG_NAMESPACE, true)) {
+        // Nothing has been stored yet
+        return;
+    }
+    RuntimeConfigBlob& blob = getInactive();
+    size_t length = preferences.getBytesLength(RUNTIME_CONFIG_KEY);
+    if (length == sizeof(RuntimeConfigBlob)) {
+        length = preferences.getBytes(RUNTIME_CONFIG_KEY, &blob, sizeof(RuntimeConfigBlob));
+    }
+    preferences.end();
+    if (length == 0) {
+        return;
+    }
+
+    RuntimeConfigResult result = check(blob, length);
+    if (result == RUNTIME_CONFIG_OK) {
+        swap(false);
+    }
+    #ifdef SERIAL_DEBUG
+    Serial.print("Runtime Config: Stored config ");
+    Serial.println(result == RUNTIME_CONFIG_OK ? "loaded" : RUNTIME_CONFIG_RESULT_NAMES[result]);
+    #endif
+    #endif
+}
+
+/**
+ * @brief Gets the active config. The reference stays valid for RUNTIME_CONFIG_SWAP_GRACE after
+ * the next change, so read it afresh on each update rather than keeping it.
+ *
+ * @return the active config.
+ */
+const RuntimeConfigValues& RuntimeConfig::get() const {
+    return buffers[activeIndex.load(std::memory_order_acquire)].values;
+}
+
+/**
+ * @brief Gets the number of times the config has changed since boot.
+ *
+ * @return the generation (0 while running on the defaults from boot).
+ */
+uint32_t RuntimeConfig::getGeneration() const {
+    return generation.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Checks a config blob and, if it passes, makes it the active config.
+ *
+ * @param data The blob (a RuntimeConfigBlob).
+ * @param length The number of bytes.
+ * @param persist Also store it in NVS, so it is loaded on the next boot.
+ * @return RUNTIME_CONFIG_OK, or why the config was not (or not fully) applied.
+ */
+RuntimeConfigResult RuntimeConfig::apply(const uint8_t* data, size_t length, bool persist) {
+    if (length != sizeof(RuntimeConfigBlob)) {
+        return RUNTIME_CONFIG_BAD_LENGTH;
+    }
+    if (isBusy()) {
+        return RUNTIME_CONFIG_BUSY;
+    }
+
+    RuntimeConfigBlob& blob = getInactive();
+    memcpy(&blob, data, length);
+    RuntimeConfigResult result = check(blob, length);
+    return result == RUNTIME_CONFIG_OK ? swap(persist) : result;
+}
+
+/**
+ * @brief Erases the stored config and goes back to the defaults.
+ *
+ * @return RUNTIME_CONFIG_OK, or why the defaults were not (or not fully) restored.
+ */
+RuntimeConfigResult RuntimeConfig::reset() {
+    if (isBusy()) {
+        return RUNTIME_CONFIG_BUSY;
+    }
+
+    RuntimeConfigBlob& blob = getInactive();
+    blob.values = RUNTIME_CONFIG_DEFAULTS;
+    seal(blob);
+    RuntimeConfigResult result = swap(false);
+    #ifdef RUNTIME_CONFIG
+    if (!erase()) {
+        result = RUNTIME_CONFIG_STORE_FAILED;
+    }
+    #endif
+    return result;
+}
+
+/**
+ * @brief Prints the active config, one field per line, in the form read by tools/runtime_config.py.
+ */
+void RuntimeConfig::print() const {
+    const uint8_t* values = (const uint8_t*)&get();
+    char buffer[64 + 6 * SERVO_BOARD_COUNT * SERVO_SLOT_COUNT];    // Room for every servo pulse on one line
+
+    snprintf(buffer, sizeof(buffer), "CONFIG: version %u generation %lu",
+             (unsigned)RUNTIME_CONFIG_VERSION, (unsigned long)getGeneration());
+    Serial.println(buffer);
+    for (const RuntimeConfigField& field : RUNTIME_CONFIG_FIELDS) {
+        int length = snprintf(buffer, sizeof(buffer), "CONFIG: %s", field.name);
+        const uint8_t* value = values + field.offset;
+        for (uint8_t i = 0; i < field.count; i++) {
+            long number = 0;
+            if (field.type == FIELD_INT8) {
+                number = (int8_t)value[i];
+            } else if (field.type == FIELD_INT16) {
+                int16_t element;
+                memcpy(&element, value + i * sizeof(element), sizeof(element));
+                number = element;
+            } else if (field.type == FIELD_UINT16) {
+                uint16_t element;
+                memcpy(&element, value + i * sizeof(element), sizeof(element));
+                number = element;
+            } else {
+                uint32_t element;
+                memcpy(&element, value + i * sizeof(element), sizeof(element));
+                number = element;
+            }
+            length += snprintf(buffer + length, sizeof(buffer) - length, " %ld", number);
+        }
+        Serial.println(buffer);
+    }
+}
+
+/**
+ * @brief Starts taking the bytes passed to receive() as a config frame (see frameCodec.h).
+ *
+ * @param currentMillis The current time (ms).
+ */
+void RuntimeConfig::startReceiving(unsigned long currentMillis) {
+    receiving = true;
+    receiveLength = 0;
+    receiveStartMillis = currentMillis;
+}
+
+/**
+ * @brief Checks whether a config frame is still being received, giving up after RUNTIME_CONFIG_RECEIVE_TIMEOUT.
+ *
+ * @param currentMillis The current time (ms).
+ * @return true if the next serial bytes belong to the frame.
+ */
+bool RuntimeConfig::isReceiving(unsigned long currentMillis) {
+    if (receiving && currentMillis - receiveStartMillis >= RUNTIME_CONFIG_RECEIVE_TIMEOUT) {
+        receiving = false;
+        Serial.println("CONFIG: upload timed out");
+    }
+    return receiving;
+}
+
+/**
+ * @brief Takes the next byte of a config frame. Once the closing delimiter arrives, the frame is
+ * decoded and the config is applied and stored.
+ *
+ * @param byte The byte.
+ */
+void RuntimeConfig::receive(uint8_t byte) {
+    if (byte != FRAME_DELIMITER) {
+        if (receiveLength < sizeof(receiveBuffer)) {
+            receiveBuffer[receiveLength++] = byte;
+        } else {
+            receiving = false;
+            Serial.println("CONFIG: upload too long");
+        }
+        return;
+    }
+    if (receiveLength == 0) {
+        // The opening delimiter
+        return;
+    }
+    receiving = false;
+
+    uint8_t payload[sizeof(receiveBuffer)];
+    size_t length = frameDecode(receiveBuffer, receiveLength, payload);
+    RuntimeConfigResult result = length == 0 ? RUNTIME_CONFIG_BAD_CRC : apply(payload, length, true);
+    Serial.print("CONFIG: upload ");
+    Serial.println(RUNTIME_CONFIG_RESULT_NAMES[result]);
+}
+
+/**
+ * @brief Gets the compiled-in defaults (the config.h settings).
+ *
+ * @return the defaults.
+ */
+const RuntimeConfigValues& RuntimeConfig::getDefaults() {
+    return RUNTIME_CONFIG_DEFAULTS;
+}
+
+/**
+ * @brief Fills in the header and CRC of a blob from its values.
+ *
+ * @param blob The blob.
+ */
+void RuntimeConfig::seal(RuntimeConfigBlob& blob) {
+    blob.magic = RUNTIME_CONFIG_MAGIC;
+    blob.version = RUNTIME_CONFIG_VERSION;
+    blob.crc = crc16((const uint8_t*)&blob.values, sizeof(blob.values));
+}
+
+/**
+ * @brief Checks a blob's length, header, CRC and values.
+ *
+ * @param blob The blob.
+ * @param length The number of bytes it was read from.
+ * @return RUNTIME_CONFIG_OK, or the first check it failed.
+ */
+RuntimeConfigResult RuntimeConfig::check(const RuntimeConfigBlob& blob, size_t length) {
+    if (length != sizeof(RuntimeConfigBlob)) {
+        return RUNTIME_CONFIG_BAD_LENGTH;
+    }
+    if (blob.magic != RUNTIME_CONFIG_MAGIC || blob.version != RUNTIME_CONFIG_VERSION) {
+        return RUNTIME_CONFIG_BAD_HEADER;
+    }
+    if (crc16((const uint8_t*)&blob.values, sizeof(blob.values)) != blob.crc) {
+        return RUNTIME_CONFIG_BAD_CRC;
+    }
+    return isValid(blob.values) ? RUNTIME_CONFIG_OK : RUNTIME_CONFIG_BAD_VALUE;
+}
+
+/**
+ * @brief Checks a config against the same limits the config.h settings are held to at compile time.
+ *
+ * @param values The config.
+ * @return true if the config can be used.
+ */
+bool RuntimeConfig::isValid(const RuntimeConfigValues& values) {
+    return validateValues(values);
+}
+
+/**
+ * @brief Checks whether the inactive buffer may still be being read by a stage.
+ *
+ * @return true within RUNTIME_CONFIG_SWAP_GRACE of the last change.
+ */
+bool RuntimeConfig::isBusy() const {
+    return swapped && millis() - lastSwapMillis < RUNTIME_CONFIG_SWAP_GRACE;
+}
+
+/**
+ * @brief Gets the buffer that is not being read, to write the next config into.
+ *
+ * @return the inactive buffer.
+ */
+RuntimeConfigBlob& RuntimeConfig::getInactive() {
+    return buffers[activeIndex.load(std::memory_order_relaxed) ^ 1];
+}
+
+/**
+ * @brief Makes the inactive buffer the active config, then bumps the generation so the stages pick it up.
+ *
+ * @param persist Also store it in NVS.
+ * @return RUNTIME_CONFIG_OK, or RUNTIME_CONFIG_STORE_FAILED if it was applied but not stored.
+ */
+RuntimeConfigResult RuntimeConfig::swap(bool persist) {
+    uint8_t next = activeIndex.load(std::memory_order_relaxed) ^ 1;
+    RuntimeConfigResult result = RUNTIME_CONFIG_OK;
+    #ifdef RUNTIME_CONFIG
+    if (persist && !store(buffers[next])) {
+        result = RUNTIME_CONFIG_STORE_FAILED;
+    }
+    #else
+    (void)persist;
+    #endif
+
+    // A stage that sees the new generation also sees the new buffer
+    activeIndex.store(next, std::memory_order_release);
+    generation.store(generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    lastSwapMillis = millis();
+    swapped = true;
+    return result;
+}
+
+#ifdef RUNTIME_CONFIG
+/**
+ * @brief Writes a blob to NVS.
+ *
+ * @param blob The blob.
+ * @return true if it was written.
+ */
+bool RuntimeConfig::store(const RuntimeConfigBlob& blob) {
+    Preferences preferences;
+    if (!preferences.begin(RUNTIME_CONFIG_NAMESPACE, false)) {
+        return false;
+    }
+    bool stored = preferences.putBytes(RUNTIME_CONFIG_KEY, &blob, sizeof(blob)) == sizeof(blob);
+    preferences.end();
+    return stored;
+}
+
+/**
+ * @brief Removes the stored blob from NVS.
+ *
+ * @return true if there is no stored blob any more.
+ */
+bool RuntimeConfig::erase() {
+    Preferences preferences;
+    if (!preferences.begin(RUNTIME_CONFIG_NAMESPACE, false)) {
+        return false;
+    }
+    bool erased = !preferences.isKey(RUNTIME_CONFIG_KEY) || preferences.remove(RUNTIME_CONFIG_KEY);
+    preferences.end();
+    return erased;
+}
+#endif // RUNTIME_CONFIG
@@ -0,0 +1,120 @@
+/**
+ * @file runtimeConfig.h
+ * @brief The tuning settings that can be changed at runtime, stored as one packed, CRC-checked blob in NVS.
+ *
+ * The servo calibration of every board, joystick trim, timeouts, behaviour chances and positions are read from a
+ * RuntimeConfigValues struct instead of straight from config.h. The config.h values are the defaults,
+ * used until a valid blob is loaded and whenever the stored one is missing, damaged or from another
+ * version. The struct has no padding, so the blob in NVS and on the wire is the struct itself:
+ * begin() reads it straight into a buffer and the stages read it in place.
+ *
+ * There are two buffers. A new config is written into the inactive one, checked, and then made
+ * active with a single atomic store, so a stage never sees half of an update. The stages notice the
+ * change through getGeneration() and rebuild anything derived from it (the servo channel table, the
+ * behaviour table) at the start of their next update. The inactive buffer is only reused once
+ * RUNTIME_CONFIG_SWAP_GRACE has passed, by which time every stage has finished reading the old one.
+ */
+
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "frameCodec.h"
+#include "servoChannelTable.h"
+
+#define RUNTIME_CONFIG_MAGIC 0x46434B42UL   // "BKCF"
+#define RUNTIME_CONFIG_VERSION 2            // Bump whenever RuntimeConfigValues changes
+
+/**
+ * @brief The runtime settings. Multi-byte values are little endian (as on the ESP32-C3) and the
+ * fields are ordered so there is no padding. Must match tools/runtime_config.py.
+ */
+struct RuntimeConfigValues {
+    uint16_t servoPulseAtStateMin[SERVO_BOARD_COUNT][SERVO_SLOT_COUNT];   // SERVO_* pulse at the lowest state of each slot, per board (ticks)
+    uint16_t servoPulseAtStateMax[SERVO_BOARD_COUNT][SERVO_SLOT_COUNT];   // SERVO_* pulse at the highest state of each slot, per board (ticks)
+    int16_t joystickDriftX;                 // JOYSTICK_DRIFT_ADUSTMENT_X
+    int16_t joystickDriftY;                 // JOYSTICK_DRIFT_ADUSTMENT_Y
+    uint16_t joystickDeadzone;              // JOYSTICK_DEADZONE
+    uint16_t joystickDeadzoneHysteresis;    // JOYSTICK_DEADZONE_HYSTERESIS
+    uint32_t manualControlTimeout;          // MANUAL_CONTROL_TIMEOUT (ms)
+    uint32_t autoPowerOffTimeout;           // AUTO_POWER_OFF_TIMEOUT (ms)
+    uint16_t autoBlinkDuration;             // AUTO_BLINK_DURATION (ms)
+    uint16_t chanceOfBlink;                 // AUTO_CHANCE_OF_BLINK
+    uint16_t chanceOfEyelidChange;          // AUTO_CHANCE_OF_EYELID_CHANGE
+    uint16_t chanceOfMajorLookChange;       // AUTO_CHANCE_OF_MAJOR_LOOK_CHANGE
+    uint16_t chanceOfLookReturnCentre;      // AUTO_CHANCE_OF_LOOK_RETURN_CENTRE
+    uint16_t chanceOfBlinkWhileLook;        // AUTO_CHANCE_OF_BLINK_WHILE_LOOK
+    int8_t squintPositions[AUTO_SQUINT_POSITION_COUNT];       // AUTO_SQUINT_POSITIONS
+    int8_t lookPanPositions[AUTO_LOOK_PAN_POSITION_COUNT];    // AUTO_LOOK_PAN_POSITIONS
+    int8_t lookTiltPositions[AUTO_LOOK_TILT_POSITION_COUNT];  // AUTO_LOOK_TILT_POSITIONS
+    uint8_t reserved[3];                    // Zero, pads the struct to a multiple of 4 bytes
+};
+
+static_assert(sizeof(RuntimeConfigValues) == 48 + 4 * SERVO_BOARD_COUNT * SERVO_SLOT_COUNT,
+              "RuntimeConfigValues must have no padding (update reserved and tools/runtime_config.py)");
+
+/**
+ * @brief A RuntimeConfigValues as stored in NVS and sent over serial.
+ */
+struct RuntimeConfigBlob {
+    uint32_t magic;     // RUNTIME_CONFIG_MAGIC
+    uint16_t version;   // RUNTIME_CONFIG_VERSION
+    uint16_t crc;       // CRC-16/CCITT-FALSE of values
+    RuntimeConfigValues values;
+};
+
+enum RuntimeConfigResult {
+    RUNTIME_CONFIG_OK,
+    RUNTIME_CONFIG_BAD_LENGTH,      // Not the size of a RuntimeConfigBlob
+    RUNTIME_CONFIG_BAD_HEADER,      // Wrong magic or version
+    RUNTIME_CONFIG_BAD_CRC,         // The values are damaged
+    RUNTIME_CONFIG_BAD_VALUE,       // A value is out of range
+    RUNTIME_CONFIG_BUSY,            // The last swap was within RUNTIME_CONFIG_SWAP_GRACE
+    RUNTIME_CONFIG_STORE_FAILED,    // Applied, but could not be written to NVS
+};
+
+class RuntimeConfig {
+public:
+    RuntimeConfig();
+
+    void begin();
+    const RuntimeConfigValues& get() const;
+    uint32_t getGeneration() const;
+
+    RuntimeConfigResult apply(const uint8_t* data, size_t length, bool persist);
+    RuntimeConfigResult reset();
+    void print() const;
+
+    void startReceiving(unsigned long currentMillis);
+    bool isReceiving(unsigned long currentMillis);
+    void receive(uint8_t byte);
+
+    static const RuntimeConfigValues& getDefaults();
+    static void seal(RuntimeConfigBlob& blob);
+    static RuntimeConfigResult check(const RuntimeConfigBlob& blob, size_t length);
+    static bool isValid(const RuntimeConfigValues& values);
+
+private:
+    RuntimeConfigBlob buffers[2];
+    std::atomic<uint8_t> activeIndex;       // The buffer the stages read
+    std::atomic<uint32_t> generation;       // Bumped on every swap
+    unsigned long lastSwapMillis;
+    bool swapped;                           // There has been a swap, so lastSwapMillis is valid
+
+    uint8_t receiveBuffer[FRAME_ENCODED_SIZE(sizeof(RuntimeConfigBlob))];
+    size_t receiveLength;
+    bool receiving;
+    unsigned long receiveStartMillis;
+
+    bool isBusy() const;
+    RuntimeConfigBlob& getInactive();
+    RuntimeConfigResult swap(bool persist);
+    static bool store(const RuntimeConfigBlob& blob);
+    static bool erase();
+};
+
+extern RuntimeConfig runtimeConfig;
+
+#endif // RUNTIME_CONFIG_H
@@ -0,0 +1,165 @@
+/**
+ * @file scheduler.cpp
+ * @brief A small cooperative fixed-rate scheduler for the main loop.
+ *
+ * Tasks are registered with their own period and run in registration order whenever they are due.
+ * The scheduler keeps per-task jitter, duration and overrun statistics so the timing of each stage
+ * no longer depends on how fast the loop happens to spin.
+ */
+
+#include <limits.h>
+#include "scheduler.h"
+
+/**
+ * @brief Constructs a new Scheduler object.
+ */
+Scheduler::Scheduler():
+    taskCount(0)
+{}
+
+/**
+ * @brief Registers a task. Tasks that are due at the same time run in the order they were added.
+ *
+ * @param name A short name for the task (used in debug output).
+ * @param callback The function to run.
+ * @param periodMicros How often the task should run (us).
+ * @return the index of the task, or -1 if the task table is full.
+ */
+int Scheduler::addTask(const char* name, TaskCallback callback, unsigned long periodMicros) {
+    if (taskCount >= SCHEDULER_MAX_TASKS) {
+        return -1;
+    }
+
+    ScheduledTask& task = tasks[taskCount];
+    task.name = name;
+    task.callback = callback;
+    task.periodMicros = periodMicros;
+    task.nextRunMicros = 0;
+    task.runCount = 0;
+    task.overrunCount = 0;
+    task.maxJitterMicros = 0;
+    task.maxDurationMicros = 0;
+
+    return taskCount++;
+}
+
+/**
+ * @brief Aligns every task to start on the next call to run().
+ */
+void Scheduler::begin() {
+    unsigned long currentMicros = micros();
+    for (int i = 0; i < taskCount; i++) {
+        tasks[i].nextRunMicros = currentMicros;
+    }
+}
+
+/**
+ * @brief Runs every task that is due.
+ *
+ * Each task is released on a fixed grid of its period. If a task is still behind its grid after
+ * running (because it, or the tasks before it, took longer than its period) the missed releases
+ * are counted as an overrun and the task is re-phased rather than run back to back to catch up.
+ *
+ * @return the time until the next task is due (us).
+ */
+unsigned long Scheduler::run() {
+    for (int i = 0; i < taskCount; i++) {
+        ScheduledTask& task = tasks[i];
+
+        unsigned long startMicros = micros();
+        if ((long)(startMicros - task.nextRunMicros) < 0) {
+            continue;
+        }
+
+        unsigned long jitterMicros = startMicros - task.nextRunMicros;
+        if (jitterMicros > task.maxJitterMicros) {
+            task.maxJitterMicros = jitterMicros;
+        }
+
+        task.callback();
+
+        unsigned long endMicros = micros();
+        unsigned long durationMicros = endMicros - startMicros;
+        if (durationMicros > task.maxDurationMicros) {
+            task.maxDurationMicros = durationMicros;
+        }
+        task.runCount++;
+
+        task.nextRunMicros += task.periodMicros;
+        if ((long)(endMicros - task.nextRunMicros) >= 0) {
+            task.overrunCount++;
+            task.nextRunMicros = endMicros + task.periodMicros;
+        }
+    }
+
+    unsigned long currentMicros = micros();
+    unsigned long idleMicros = ULONG_MAX;
+    for (int i = 0; i < taskCount; i++) {
+        long untilDue = (long)(tasks[i].nextRunMicros - currentMicros);
+        if (untilDue <= 0) {
+            return 0;
+        }
+        if ((unsigned long)untilDue < idleMicros) {
+            idleMicros = untilDue;
+        }
+    }
+    return idleMicros;
+}
+
+/**
+ * @brief Changes how often a task runs. The task next runs one new period after it last ran.
+ *
+ * @param index The index returned by addTask().
+ * @param periodMicros How often the task should run (us).
+ */
+void Scheduler::setTaskPeriod(int index, unsigned long periodMicros) {
+    if (index < 0 || index >= taskCount) {
+        return;
+    }
+    ScheduledTask& task = tasks[index];
+    task.nextRunMicros = task.nextRunMicros - task.periodMicros + periodMicros;
+    task.periodMicros = periodMicros;
+}
+
+/**
+ * @brief Gets the number of registered tasks.
+ *
+ * @return the number of registered tasks.
+ */
+int Scheduler::getTaskCount() const {
+    return taskCount;
+}
+
+/**
+ * @brief Gets a registered task and its statistics.
+ *
+ * @param index The index returned by addTask().
+ * @return the task.
+ */
+const ScheduledTask& Scheduler::getTask(int index) const {
+    return tasks[index];
+}
+
+#ifdef SERIAL_DEBUG
+/**
+ * @brief Prints the timing statistics of every task for debugging purposes.
+ */
+void Scheduler::printDebugValues() {
+    for (int i = 0; i < taskCount; i++) {
+        printTaskDebugValues(tasks[i]);
+    }
+}
+
+/**
+ * @brief Prints the timing statistics of a single task for debugging purposes.
+ *
+ * @param task The task statistics to print.
+ */
+void printTaskDebugValues(const ScheduledTask& task) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+            "TASK %-6s: [PERIOD: %6lu | RUNS: %8lu | OVR: %5lu | JIT: %6lu | DUR: %6lu] ",
+            task.name, task.periodMicros, task.runCount, task.overrunCount, task.maxJitterMicros, task.maxDurationMicros);
+    Serial.print(buffer);
+}
+#endif
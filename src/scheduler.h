@@ -0,0 +1,59 @@
+/**
+ * @file scheduler.h
+ * @brief A small cooperative fixed-rate scheduler for the main loop.
+ *
+ * Tasks are registered with their own period and run in registration order whenever they are due.
+ * The scheduler keeps per-task jitter, duration and overrun statistics so the timing of each stage
+ * no longer depends on how fast the loop happens to spin.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#define SCHEDULER_MAX_TASKS 12    // Every option enabled registers 8 tasks, so this leaves room for more
+
+typedef void (*TaskCallback)();
+
+struct ScheduledTask {
+    const char* name;
+    TaskCallback callback;
+    unsigned long periodMicros;
+    unsigned long nextRunMicros;
+
+    unsigned long runCount;
+    unsigned long overrunCount;
+    unsigned long maxJitterMicros;
+    unsigned long maxDurationMicros;
+};
+
+class Scheduler {
+public:
+    Scheduler();
+
+    int addTask(const char* name, TaskCallback callback, unsigned long periodMicros);
+    void begin();
+    unsigned long run();
+    void setTaskPeriod(int index, unsigned long periodMicros);
+
+    int getTaskCount() const;
+    const ScheduledTask& getTask(int index) const;
+
+    #ifdef SERIAL_DEBUG
+    void printDebugValues();
+    #endif
+
+private:
+    ScheduledTask tasks[SCHEDULER_MAX_TASKS];
+    int taskCount;
+};
+
+extern Scheduler scheduler;
+
+#ifdef SERIAL_DEBUG
+void printTaskDebugValues(const ScheduledTask& task);
+#endif
+
+#endif // SCHEDULER_H
@@ -0,0 +1,85 @@
+/**
+ * @file seqLock.h
+ * @brief A lock-free single-producer sequence lock for passing small POD snapshots between tasks.
+ *
+ * The writer never blocks and the reader retries until it has copied a consistent snapshot.
+ * The payload is stored as relaxed atomic words so the structure is free of data races under the
+ * C++ memory model (and therefore clean under ThreadSanitizer on the host).
+ *
+ * On a single core the reader must not run at a higher priority than the writer, otherwise a reader
+ * that preempts a half-finished write would spin until the writer is scheduled again.
+ */
+
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+template <typename T>
+class SeqLock {
+public:
+    SeqLock(): sequence(0) {
+        write(T());
+        sequence.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Publishes a new value. Must only be called from a single producer.
+     *
+     * @param value The value to publish.
+     */
+    void write(const T& value) {
+        uint32_t buffer[WORD_COUNT] = {};
+        memcpy(buffer, &value, sizeof(T));
+
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies the most recently published value.
+     *
+     * @return the latest value.
+     */
+    T read() const {
+        uint32_t buffer[WORD_COUNT];
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        T value;
+        memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Gets the number of values published so far, useful to detect a new value without copying it.
+     *
+     * @return the number of values published.
+     */
+    uint32_t getVersion() const {
+        return sequence.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    static const size_t WORD_COUNT = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[WORD_COUNT];
+};
+
+#endif // SEQ_LOCK_H
@@ -0,0 +1,90 @@
+/**
+ * @file servoCalibration.h
+ * @brief The compile-time calibration of each servo, built from the SERVO_* settings in config.h.
+ *
+ * Pan and tilt take a -100 -> 100 state, the lids take a 0 (closed) -> 100 (open) state.
+ * The build fails if two servos share a channel or if the lid directions do not match the
+ * mirrored mounting of the mechanism.
+ *
+ * addEyeRig() adds these servos to a ServoChannelTable for one rig on one board. Each board's rig
+ * starts from these pulses plus its row of SERVO_RIG_TRIM_AT_STATE_MIN/MAX, and the runtime config
+ * (runtimeConfig.h) can replace the pulses of every board.
+ */
+
+#ifndef SERVO_CALIBRATION_H
+#define SERVO_CALIBRATION_H
+
+#include "servoChannel.h"
+#include "servoChannelTable.h"
+
+// Positive pan = left and positive tilt = down, so both run from the maximum pulse to the minimum
+typedef ServoChannel<SERVO_CHANNEL_PAN, -100, 100, SERVO_PAN_MAX, SERVO_PAN_MIN> PanServo;
+typedef ServoChannel<SERVO_CHANNEL_TILT, -100, 100, SERVO_TILT_MAX, SERVO_TILT_MIN> TiltServo;
+
+typedef ServoChannel<SERVO_CHANNEL_LEFT_LID_TOP, 0, 100, SERVO_LEFT_LID_TOP_CLOSED, SERVO_LEFT_LID_TOP_OPEN> LeftLidTopServo;
+typedef ServoChannel<SERVO_CHANNEL_LEFT_LID_BOTTOM, 0, 100, SERVO_LEFT_LID_BOTTOM_CLOSED, SERVO_LEFT_LID_BOTTOM_OPEN> LeftLidBottomServo;
+typedef ServoChannel<SERVO_CHANNEL_RIGHT_LID_TOP, 0, 100, SERVO_RIGHT_LID_TOP_CLOSED, SERVO_RIGHT_LID_TOP_OPEN> RightLidTopServo;
+typedef ServoChannel<SERVO_CHANNEL_RIGHT_LID_BOTTOM, 0, 100, SERVO_RIGHT_LID_BOTTOM_CLOSED, SERVO_RIGHT_LID_BOTTOM_OPEN> RightLidBottomServo;
+
+static_assert(servoChannelsUnique(PanServo::channel, TiltServo::channel,
+                                  LeftLidTopServo::channel, LeftLidBottomServo::channel,
+                                  RightLidTopServo::channel, RightLidBottomServo::channel),
+              "Each servo must be on its own PCA9685 channel");
+
+// The left and right lid servos are mounted as mirror images, and the top and bottom lids of each eye close towards each other
+static_assert(LeftLidTopServo::inverted != RightLidTopServo::inverted, "Left and right top lids must move in opposite directions");
+static_assert(LeftLidBottomServo::inverted != RightLidBottomServo::inverted, "Left and right bottom lids must move in opposite directions");
+static_assert(LeftLidTopServo::inverted != LeftLidBottomServo::inverted, "Left top and bottom lids must move in opposite directions");
+static_assert(RightLidTopServo::inverted != RightLidBottomServo::inverted, "Right top and bottom lids must move in opposite directions");
+
+// The ServoChannelTable maps pan and tilt from -100 -> 100 and the lids from 0 -> 100
+static_assert(PanServo::stateMin == -100 && PanServo::stateMax == 100 && TiltServo::stateMin == -100 && TiltServo::stateMax == 100,
+              "Pan and tilt must be calibrated over -100 -> 100");
+static_assert(LeftLidTopServo::stateMin == 0 && LeftLidTopServo::stateMax == 100 && LeftLidBottomServo::stateMin == 0 && LeftLidBottomServo::stateMax == 100 &&
+              RightLidTopServo::stateMin == 0 && RightLidTopServo::stateMax == 100 && RightLidBottomServo::stateMin == 0 && RightLidBottomServo::stateMax == 100,
+              "The lids must be calibrated over 0 -> 100");
+
+// The compile-time calibration of each slot, in ServoSlot order
+constexpr uint16_t SERVO_DEFAULT_PULSE_AT_STATE_MIN[SERVO_SLOT_COUNT] = {
+    PanServo::pulseAtStateMin, TiltServo::pulseAtStateMin,
+    LeftLidTopServo::pulseAtStateMin, LeftLidBottomServo::pulseAtStateMin,
+    RightLidTopServo::pulseAtStateMin, RightLidBottomServo::pulseAtStateMin,
+};
+constexpr uint16_t SERVO_DEFAULT_PULSE_AT_STATE_MAX[SERVO_SLOT_COUNT] = {
+    PanServo::pulseAtStateMax, TiltServo::pulseAtStateMax,
+    LeftLidTopServo::pulseAtStateMax, LeftLidBottomServo::pulseAtStateMax,
+    RightLidTopServo::pulseAtStateMax, RightLidBottomServo::pulseAtStateMax,
+};
+
+// The trim of each board's rig, in ServoSlot order (boards without a row in config.h are not trimmed)
+constexpr int16_t SERVO_RIG_PULSE_TRIM_MIN[SERVO_BOARD_COUNT][SERVO_SLOT_COUNT] = SERVO_RIG_TRIM_AT_STATE_MIN;
+constexpr int16_t SERVO_RIG_PULSE_TRIM_MAX[SERVO_BOARD_COUNT][SERVO_SLOT_COUNT] = SERVO_RIG_TRIM_AT_STATE_MAX;
+
+// The channel of each slot, in ServoSlot order
+constexpr uint8_t SERVO_SLOT_CHANNELS[SERVO_SLOT_COUNT] = {
+    PanServo::channel, TiltServo::channel,
+    LeftLidTopServo::channel, LeftLidBottomServo::channel,
+    RightLidTopServo::channel, RightLidBottomServo::channel,
+};
+
+/**
+ * @brief Adds the six servos of an eye rig to a channel table, on the SERVO_CHANNEL_* channels of a board.
+ *
+ * @param table The channel table.
+ * @param board The board index (into SERVO_BOARD_ADDRESSES).
+ * @param pulseAtStateMin The pulse of each slot at the lowest state of its axis (ticks, in ServoSlot order).
+ * @param pulseAtStateMax The pulse of each slot at the highest state of its axis (ticks, in ServoSlot order).
+ * @return true if every servo was added.
+ */
+inline bool addEyeRig(ServoChannelTable& table, uint8_t board,
+                      const uint16_t pulseAtStateMin[SERVO_SLOT_COUNT] = SERVO_DEFAULT_PULSE_AT_STATE_MIN,
+                      const uint16_t pulseAtStateMax[SERVO_SLOT_COUNT] = SERVO_DEFAULT_PULSE_AT_STATE_MAX) {
+    for (uint8_t slot = 0; slot < SERVO_SLOT_COUNT; slot++) {
+        if (!table.add(board, SERVO_SLOT_CHANNELS[slot], slot, pulseAtStateMin[slot], pulseAtStateMax[slot])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // SERVO_CALIBRATION_H
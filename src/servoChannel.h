@@ -0,0 +1,96 @@
+/**
+ * @file servoChannel.h
+ * @brief Compile-time servo channel calibration.
+ *
+ * A ServoChannel bakes the mapping from a state value to a PCA9685 pulse into a lookup table at
+ * compile time. Invalid calibrations (channel out of range, pulses outside what a servo accepts, an
+ * empty state range) fail the build. The servo output maps through a ServoChannelTable instead, and
+ * these tables are the reference the native `channels` mode checks it against.
+ */
+
+#ifndef SERVO_CHANNEL_H
+#define SERVO_CHANNEL_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "pwmFrameWriter.h"
+
+// Pulse limits in PCA9685 ticks at SERVO_PWM_FREQ (4096 ticks per PWM period)
+#define SERVO_PULSE_TICKS(us) ((long)(us) * 4096L * SERVO_PWM_FREQ / 1000000L)
+#define SERVO_PULSE_TICKS_MIN SERVO_PULSE_TICKS(SERVO_PULSE_LIMIT_MIN_US)
+#define SERVO_PULSE_TICKS_MAX SERVO_PULSE_TICKS(SERVO_PULSE_LIMIT_MAX_US)
+
+/**
+ * @brief A servo on a PCA9685 channel with a linear calibration from state to pulse.
+ *
+ * @tparam Channel The PCA9685 channel.
+ * @tparam StateMin The lowest state value (e.g. -100 or 0).
+ * @tparam StateMax The highest state value (e.g. 100).
+ * @tparam PulseAtStateMin The pulse (ticks) at StateMin.
+ * @tparam PulseAtStateMax The pulse (ticks) at StateMax.
+ */
+template <uint8_t Channel, int StateMin, int StateMax, int PulseAtStateMin, int PulseAtStateMax>
+struct ServoChannel {
+    static_assert(Channel < PCA9685_CHANNEL_COUNT, "Servo channel must be between 0 and 15");
+    static_assert(StateMin < StateMax, "Servo state range must not be empty");
+    static_assert(PulseAtStateMin != PulseAtStateMax, "Servo calibration must have a non-zero travel");
+    static_assert(PulseAtStateMin >= SERVO_PULSE_TICKS_MIN && PulseAtStateMin <= SERVO_PULSE_TICKS_MAX, "Servo pulse is outside SERVO_PULSE_LIMIT_MIN_US/MAX_US");
+    static_assert(PulseAtStateMax >= SERVO_PULSE_TICKS_MIN && PulseAtStateMax <= SERVO_PULSE_TICKS_MAX, "Servo pulse is outside SERVO_PULSE_LIMIT_MIN_US/MAX_US");
+
+    static constexpr uint8_t channel = Channel;
+    static constexpr bool inverted = PulseAtStateMin > PulseAtStateMax;
+    static constexpr int stateMin = StateMin;
+    static constexpr int stateMax = StateMax;
+    static constexpr uint16_t pulseAtStateMin = PulseAtStateMin;
+    static constexpr uint16_t pulseAtStateMax = PulseAtStateMax;
+    static constexpr size_t tableSize = StateMax - StateMin + 1;
+
+    struct Table {
+        uint16_t pulses[tableSize];
+    };
+
+    /**
+     * @brief Builds the lookup table (evaluated by the compiler).
+     *
+     * @return the pulse for every state value, rounded to the nearest tick.
+     */
+    static constexpr Table buildTable() {
+        Table table = {};
+        constexpr long range = StateMax - StateMin;
+        constexpr long travel = PulseAtStateMax - PulseAtStateMin;
+        for (size_t i = 0; i < tableSize; i++) {
+            long scaled = 2 * (long)i * travel + (travel >= 0 ? range : -range);
+            table.pulses[i] = (uint16_t)(PulseAtStateMin + scaled / (2 * range));
+        }
+        return table;
+    }
+
+    static constexpr Table table = buildTable();
+
+    /**
+     * @brief Looks up the pulse for a state value. States outside the range are clamped so the servo
+     * is never driven past its calibrated travel.
+     *
+     * @param state The state value.
+     * @return the pulse (ticks).
+     */
+    static uint16_t pulse(int state) {
+        return table.pulses[constrain(state, StateMin, StateMax) - StateMin];
+    }
+};
+
+/**
+ * @brief Checks that no two channels in a list are the same (evaluated by the compiler).
+ *
+ * @return true if every channel is unique.
+ */
+constexpr bool servoChannelsUnique(uint8_t) {
+    return true;
+}
+
+template <typename... Rest>
+constexpr bool servoChannelsUnique(uint8_t first, Rest... rest) {
+    return ((first != rest) && ...) && servoChannelsUnique(rest...);
+}
+
+#endif // SERVO_CHANNEL_H
@@ -0,0 +1,162 @@
+/**
+ * @file servoChannelTable.cpp
+ * @brief The servo channels of every eye rig as a table, mapped from the state in one batch pass.
+ *
+ * Each row is one servo: the PCA9685 board it is on, its channel, the part of the mechanism it drives
+ * (its ServoSlot, which decides the state axis it follows) and its calibration. The columns are kept
+ * as separate arrays so the mapping pass walks each of them in order.
+ */
+
+#include "servoChannelTable.h"
+#include "servoChannel.h"
+
+static const int8_t SERVO_AXIS_STATE_MIN[SERVO_AXIS_COUNT] = {-100, -100, 0, 0};
+static const int8_t SERVO_AXIS_STATE_MAX[SERVO_AXIS_COUNT] = {100, 100, 100, 100};
+
+static const uint8_t SERVO_SLOT_AXES[SERVO_SLOT_COUNT] = {
+    SERVO_AXIS_PAN, SERVO_AXIS_TILT,
+    SERVO_AXIS_TOP_LID, SERVO_AXIS_BOTTOM_LID,
+    SERVO_AXIS_TOP_LID, SERVO_AXIS_BOTTOM_LID,
+};
+
+/**
+ * @brief Constructs a new, empty ServoChannelTable object.
+ */
+ServoChannelTable::ServoChannelTable():
+    count(0)
+{}
+
+/**
+ * @brief Adds a servo to the table.
+ *
+ * @param board The index of its PCA9685 board (into SERVO_BOARD_ADDRESSES).
+ * @param channel The PCA9685 channel (0 -> 15).
+ * @param slot The part of the mechanism it drives (ServoSlot).
+ * @param pulseAtStateMin The pulse (ticks) at the lowest state of the slot's axis.
+ * @param pulseAtStateMax The pulse (ticks) at the highest state of the slot's axis.
+ * @return true if it was added, false if the table is full, the board channel is already used
+ * or the calibration is outside SERVO_PULSE_LIMIT_MIN_US/MAX_US.
+ */
+bool ServoChannelTable::add(uint8_t board, uint8_t channel, uint8_t slot, uint16_t pulseAtStateMin, uint16_t pulseAtStateMax) {
+    if (count >= SERVO_MAX_CHANNELS || board >= SERVO_BOARD_COUNT || channel >= PCA9685_CHANNEL_COUNT || slot >= SERVO_SLOT_COUNT) {
+        return false;
+    }
+    if (pulseAtStateMin == pulseAtStateMax ||
+        pulseAtStateMin < SERVO_PULSE_TICKS_MIN || pulseAtStateMin > SERVO_PULSE_TICKS_MAX ||
+        pulseAtStateMax < SERVO_PULSE_TICKS_MIN || pulseAtStateMax > SERVO_PULSE_TICKS_MAX) {
+        return false;
+    }
+    for (uint8_t row = 0; row < count; row++) {
+        if (boards[row] == board && channels[row] == channel) {
+            return false;
+        }
+    }
+
+    uint8_t axis = SERVO_SLOT_AXES[slot];
+    uint32_t range = SERVO_AXIS_STATE_MAX[axis] - SERVO_AXIS_STATE_MIN[axis];
+    bool falling = pulseAtStateMin > pulseAtStateMax;
+    uint32_t travel = falling ? pulseAtStateMin - pulseAtStateMax : pulseAtStateMax - pulseAtStateMin;
+
+    boards[count] = board;
+    channels[count] = channel;
+    slots[count] = slot;
+    axes[count] = axis;
+    pulseOrigins[count] = pulseAtStateMin;
+    slopes[count] = ((travel << 16) + range - 1) / range;
+    inverted[count] = falling;
+    count++;
+    return true;
+}
+
+/**
+ * @brief Removes every servo from the table.
+ */
+void ServoChannelTable::clear() {
+    count = 0;
+}
+
+/**
+ * @brief Maps the state of each axis to the pulse of every servo in the table.
+ *
+ * States outside an axis' range are clamped so no servo is driven past its calibrated travel.
+ *
+ * @param states The state of each axis (ServoAxis order).
+ * @param pulses Receives the pulse (ticks) of each row.
+ */
+void ServoChannelTable::map(const int16_t states[SERVO_AXIS_COUNT], uint16_t pulses[SERVO_MAX_CHANNELS]) const {
+    // Clamp each axis once rather than once per servo
+    uint32_t offsets[SERVO_AXIS_COUNT];
+    for (uint8_t axis = 0; axis < SERVO_AXIS_COUNT; axis++) {
+        offsets[axis] = constrain(states[axis], SERVO_AXIS_STATE_MIN[axis], SERVO_AXIS_STATE_MAX[axis]) - SERVO_AXIS_STATE_MIN[axis];
+    }
+
+    for (uint8_t row = 0; row < count; row++) {
+        uint16_t magnitude = (offsets[axes[row]] * slopes[row] + 0x8000) >> 16;
+        pulses[row] = inverted[row] ? pulseOrigins[row] - magnitude : pulseOrigins[row] + magnitude;
+    }
+}
+
+/**
+ * @brief Gets the number of servos in the table.
+ *
+ * @return the row count.
+ */
+uint8_t ServoChannelTable::getCount() const {
+    return count;
+}
+
+/**
+ * @brief Gets the board a servo is on.
+ *
+ * @param row The row.
+ * @return the board index.
+ */
+uint8_t ServoChannelTable::getBoard(uint8_t row) const {
+    return boards[row];
+}
+
+/**
+ * @brief Gets the PCA9685 channel a servo is on.
+ *
+ * @param row The row.
+ * @return the channel (0 -> 15).
+ */
+uint8_t ServoChannelTable::getChannel(uint8_t row) const {
+    return channels[row];
+}
+
+/**
+ * @brief Gets the part of the mechanism a servo drives.
+ *
+ * @param row The row.
+ * @return the ServoSlot.
+ */
+uint8_t ServoChannelTable::getSlot(uint8_t row) const {
+    return slots[row];
+}
+
+/**
+ * @brief Checks whether a servo's pulse falls as its state rises.
+ *
+ * @param row The row.
+ * @return true if the servo is mounted inverted.
+ */
+bool ServoChannelTable::isInverted(uint8_t row) const {
+    return inverted[row];
+}
+
+/**
+ * @brief Finds the servo driving a slot on a board.
+ *
+ * @param slot The ServoSlot.
+ * @param board The board index.
+ * @return the first matching row, or -1 if there is none.
+ */
+int ServoChannelTable::findSlot(uint8_t slot, uint8_t board) const {
+    for (uint8_t row = 0; row < count; row++) {
+        if (slots[row] == slot && boards[row] == board) {
+            return row;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file servoChannelTable.h
+ * @brief The servo channels of every eye rig as a table, mapped from the state in one batch pass.
+ *
+ * Each row is one servo: the PCA9685 board it is on, its channel, the part of the mechanism it drives
+ * (its ServoSlot, which decides the state axis it follows) and its calibration. The columns are kept
+ * as separate arrays so the mapping pass walks each of them in order. Several eye rigs are driven
+ * by adding the same slots again on other boards or channels; they all follow the same state.
+ *
+ * The pulse is pulseOrigin +/- offset * slope, where offset is the state above the axis minimum and
+ * slope is the travel per state unit in Q16, rounded up. For the state ranges and every travel within
+ * the pulse limits this gives exactly the rounded pulses of the ServoChannel lookup tables, which the
+ * native `channels` mode checks.
+ */
+
+#ifndef SERVO_CHANNEL_TABLE_H
+#define SERVO_CHANNEL_TABLE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "pwmFrameWriter.h"
+
+#define SERVO_MAX_CHANNELS (SERVO_BOARD_COUNT * PCA9685_CHANNEL_COUNT)
+
+enum ServoSlot {
+    SERVO_SLOT_PAN,
+    SERVO_SLOT_TILT,
+    SERVO_SLOT_LEFT_LID_TOP,
+    SERVO_SLOT_LEFT_LID_BOTTOM,
+    SERVO_SLOT_RIGHT_LID_TOP,
+    SERVO_SLOT_RIGHT_LID_BOTTOM,
+    SERVO_SLOT_COUNT
+};
+
+enum ServoAxis {
+    SERVO_AXIS_PAN,         // -100 -> 100
+    SERVO_AXIS_TILT,        // -100 -> 100
+    SERVO_AXIS_TOP_LID,     // 0 (closed) -> 100 (open)
+    SERVO_AXIS_BOTTOM_LID,  // 0 (closed) -> 100 (open)
+    SERVO_AXIS_COUNT
+};
+
+class ServoChannelTable {
+public:
+    ServoChannelTable();
+
+    bool add(uint8_t board, uint8_t channel, uint8_t slot, uint16_t pulseAtStateMin, uint16_t pulseAtStateMax);
+    void clear();
+    void map(const int16_t states[SERVO_AXIS_COUNT], uint16_t pulses[SERVO_MAX_CHANNELS]) const;
+
+    uint8_t getCount() const;
+    uint8_t getBoard(uint8_t row) const;
+    uint8_t getChannel(uint8_t row) const;
+    uint8_t getSlot(uint8_t row) const;
+    bool isInverted(uint8_t row) const;
+    int findSlot(uint8_t slot, uint8_t board) const;
+
+private:
+    uint8_t count;
+    uint8_t boards[SERVO_MAX_CHANNELS];
+    uint8_t channels[SERVO_MAX_CHANNELS];
+    uint8_t slots[SERVO_MAX_CHANNELS];
+    uint8_t axes[SERVO_MAX_CHANNELS];
+    uint16_t pulseOrigins[SERVO_MAX_CHANNELS];  // Pulse at the axis minimum (ticks)
+    uint32_t slopes[SERVO_MAX_CHANNELS];        // Travel per state unit (ticks, Q16)
+    bool inverted[SERVO_MAX_CHANNELS];          // The pulse falls as the state rises
+};
+
+#endif // SERVO_CHANNEL_TABLE_H
@@ -9,26 +9,75 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include "servoController.h"
+#include "servoCalibration.h"
+#include "runtimeConfig.h"
 #include "config.h"
 
+static const uint8_t SERVO_BOARD_ADDRESS_LIST[] = {SERVO_BOARD_ADDRESSES};
+static_assert(sizeof(SERVO_BOARD_ADDRESS_LIST) == SERVO_BOARD_COUNT, "SERVO_BOARD_ADDRESSES must list SERVO_BOARD_COUNT addresses");
+// The channel table counts and indexes its rows with a uint8_t
+static_assert(SERVO_MAX_CHANNELS <= 255, "SERVO_BOARD_COUNT is too high for the channel table (at most 15 boards)");
+
+/**
+ * @brief Constructs a new ServoBoard object.
+ *
+ * @param address The I2C address of the PCA9685.
+ */
+ServoBoard::ServoBoard(uint8_t address)
+    : pwm(Adafruit_PWMServoDriver(address)),
+      frameWriter(address),
+      linkSupervisor(address),
+      asleep(false)
+{}
+
 /**
  * @brief Constructs a new ServoController object.
  */
 ServoController::ServoController()
-    : pwm(Adafruit_PWMServoDriver()),
-      servoPanPulse(0), servoTiltPulse(0), servoLeftLidTopPulse(0),
-      servoLeftLidBottomPulse(0), servoRightLidTopPulse(0), servoRightLidBottomPulse(0)
-{}
+    : boards{SERVO_BOARD_ADDRESSES},
+      configGeneration(0)
+{
+    for (uint8_t row = 0; row < SERVO_MAX_CHANNELS; row++) {
+        pulses[row] = 0;
+    }
+    for (uint8_t slot = 0; slot < SERVO_SLOT_COUNT; slot++) {
+        snapshotRows[slot] = -1;
+    }
+}
 
 /**
  * @brief Initializes the servo controller.
  */
 void ServoController::begin() {
+    configGeneration = runtimeConfig.getGeneration();
+    buildChannelTable();
+
     // Initialize I2C with specific SDA and SCL pins
     Wire.begin(PIN_SDA, PIN_SCL);
 
-    pwm.begin();
-    pwm.setPWMFreq(SERVO_PWM_FREQ);
+    for (ServoBoard& board : boards) {
+        board.pwm.begin();
+        board.pwm.setPWMFreq(SERVO_PWM_FREQ);
+        board.frameWriter.invalidate();
+    }
+}
+
+/**
+ * @brief Builds the channel table, driving an eye rig from every board with that board's runtime config calibration.
+ */
+void ServoController::buildChannelTable() {
+    const RuntimeConfigValues& config = runtimeConfig.get();
+    channelTable.clear();
+    for (uint8_t board = 0; board < SERVO_BOARD_COUNT; board++) {
+        if (!addEyeRig(channelTable, board, config.servoPulseAtStateMin[board], config.servoPulseAtStateMax[board])) {
+            #ifdef SERIAL_DEBUG
+            Serial.println("Servo: Invalid channel table");
+            #endif
+        }
+    }
+    for (uint8_t slot = 0; slot < SERVO_SLOT_COUNT; slot++) {
+        snapshotRows[slot] = channelTable.findSlot(slot, 0);
+    }
 }
 
 /**
@@ -40,49 +89,249 @@ void ServoController::begin() {
  * @param bottomLidState The bottom lid state.
  */
 void ServoController::update(int panState, int tiltState, int topLidState, int bottomLidState) {
-    checkI2CConnection();
+    // Recalibrate when the runtime config changes (the rows stay in the same order)
+    uint32_t generation = runtimeConfig.getGeneration();
+    if (generation != configGeneration) {
+        configGeneration = generation;
+        buildChannelTable();
+    }
+
+    // Map every servo of every rig in one pass over the channel table
+    const int16_t states[SERVO_AXIS_COUNT] = {(int16_t)panState, (int16_t)tiltState, (int16_t)topLidState, (int16_t)bottomLidState};
+    channelTable.map(states, pulses);
 
-    servoPanPulse = map(panState * -1, -100, 100, SERVO_PAN_MIN, SERVO_PAN_MAX);
-    servoTiltPulse = map(tiltState * -1, -100, 100, SERVO_TILT_MIN, SERVO_TILT_MAX);
+    // Switch off the servos that are at rest (the published snapshot keeps the calibrated pulses)
+    uint8_t count = channelTable.getCount();
+    uint16_t gatedPulses[SERVO_MAX_CHANNELS];
+    memcpy(gatedPulses, pulses, count * sizeof(gatedPulses[0]));
+    powerGate.apply(channelTable, gatedPulses, millis());
 
-    servoLeftLidTopPulse = map(topLidState, 0, 100, SERVO_LEFT_LID_TOP_CLOSED, SERVO_LEFT_LID_TOP_OPEN);
-    servoLeftLidBottomPulse = map(bottomLidState, 0, 100, SERVO_LEFT_LID_BOTTOM_CLOSED, SERVO_LEFT_LID_BOTTOM_OPEN);
-    servoRightLidTopPulse = map(topLidState, 0, 100, SERVO_RIGHT_LID_TOP_CLOSED, SERVO_RIGHT_LID_TOP_OPEN);
-    servoRightLidBottomPulse = map(bottomLidState, 0, 100, SERVO_RIGHT_LID_BOTTOM_CLOSED, SERVO_RIGHT_LID_BOTTOM_OPEN);
+    // Sort the frame by board and hand it over for sending
+    ServoFrame& frame = frameQueue.getPostFrame();
+    for (ServoBoardFrame& boardFrame : frame.boards) {
+        boardFrame.channels = 0;
+        boardFrame.sleep = powerGate.isChipAsleep();
+    }
+    for (uint8_t row = 0; row < count; row++) {
+        ServoBoardFrame& boardFrame = frame.boards[channelTable.getBoard(row)];
+        uint8_t channel = channelTable.getChannel(row);
+        boardFrame.pulses[channel] = gatedPulses[row];
+        boardFrame.channels |= 1 << channel;
+    }
+    frameQueue.post();
+    publish();
 
-    pwm.setPWM(SERVO_CHANNEL_PAN, 0, servoPanPulse);
-    pwm.setPWM(SERVO_CHANNEL_TILT, 0, servoTiltPulse);
-    pwm.setPWM(SERVO_CHANNEL_LEFT_LID_TOP, 0, servoLeftLidTopPulse);
-    pwm.setPWM(SERVO_CHANNEL_LEFT_LID_BOTTOM, 0, servoLeftLidBottomPulse);
-    pwm.setPWM(SERVO_CHANNEL_RIGHT_LID_TOP, 0, servoRightLidTopPulse);
-    pwm.setPWM(SERVO_CHANNEL_RIGHT_LID_BOTTOM, 0, servoRightLidBottomPulse);
+    if (!frameQueue.isRunning()) {
+        transmit();
+    }
 }
 
 /**
- * @brief Checks the I2C connection and reinitializes if necessary.
+ * @brief Sends the newest frame to every board, in one transaction per board, and supervises the links.
+ *
+ * Called by update() unless the bus task has been started, in which case only the bus task may call it.
  */
-void ServoController::checkI2CConnection()
-{
-    // Check I2C connection by reading a register from the PWM driver
-    Wire.beginTransmission(SERVO_I2C_ADDRESS);
-    Wire.write(0x00); // Read mode register 1
-    if (Wire.endTransmission() != 0 || Wire.requestFrom(SERVO_I2C_ADDRESS, 1) != 1) {
-        // Attempt to reinitialize I2C if the connection is lost
-        Wire.begin(PIN_SDA, PIN_SCL);
-        pwm.begin();
-        pwm.setPWMFreq(SERVO_PWM_FREQ);
+void ServoController::transmit() {
+    const ServoFrame* frame = frameQueue.take();
+    unsigned long currentMillis = millis();
+    bool completed = frame != NULL;
+
+    for (uint8_t index = 0; index < SERVO_BOARD_COUNT; index++) {
+        ServoBoard& board = boards[index];
+        if (frame == NULL || !board.linkSupervisor.isLinkUp()) {
+            // A board with its link down misses the frame
+            completed = false;
+            continue;
+        }
+
+        // Send only the registers that changed since the board last received a frame
+        const ServoBoardFrame& boardFrame = frame->boards[index];
+        for (uint8_t channel = 0; channel < PCA9685_CHANNEL_COUNT; channel++) {
+            if (boardFrame.channels & (1 << channel)) {
+                board.frameWriter.setPulse(channel, boardFrame.pulses[channel]);
+            }
+        }
+
+        if (!boardFrame.sleep && board.asleep) {
+            // Restart the oscillator, the channels are re-armed over the following frames
+            board.pwm.wakeup();
+            board.frameWriter.invalidate();
+            board.asleep = false;
+        }
+        if (!board.asleep) {
+            uint8_t status = board.frameWriter.flush();
+            board.linkSupervisor.reportWriteResult(status, currentMillis);
+            frameQueue.reportWriteResult(status);
+            completed = completed && status == 0;
+        }
+        if (boardFrame.sleep && !board.asleep) {
+            // The frame that was just sent switched every channel off
+            board.pwm.sleep();
+            board.asleep = true;
+        }
+    }
+
+    if (completed) {
+        frameQueue.reportFrameCompleted();
+    }
+
+    // Supervise the links after the frame has gone out so servo output never waits behind a probe
+    for (ServoBoard& board : boards) {
+        if (board.linkSupervisor.service(currentMillis)) {
+            board.linkSupervisor.reportReinitResult(reinitialize(board), currentMillis);
+        }
     }
 }
 
+/**
+ * @brief Starts the bus task, so update() only posts its frames and the task sends them.
+ *
+ * @param transmitCallback A function that calls transmit() (runs in the bus task).
+ * @return true if the task was created, false otherwise.
+ */
+bool ServoController::startOutputTask(TaskCallback transmitCallback) {
+    return frameQueue.start(transmitCallback);
+}
+
+/**
+ * @brief Stops the bus task, so update() sends its frames itself again.
+ */
+void ServoController::stopOutputTask() {
+    frameQueue.stop();
+}
+
+/**
+ * @brief Sets whether the bot is (soft) powered on, so the servos can be switched off while it is not.
+ *
+ * @param powered The soft power state.
+ */
+void ServoController::setPowerState(bool powered) {
+    powerGate.setPowered(powered);
+}
+
+/**
+ * @brief Publishes the pulses of the first board's rig for other tasks (e.g. telemetry) to read. The
+ * other rigs follow the same state and differ only by their calibration, so they are not published.
+ */
+void ServoController::publish() {
+    uint16_t slotPulses[SERVO_SLOT_COUNT];
+    for (uint8_t slot = 0; slot < SERVO_SLOT_COUNT; slot++) {
+        slotPulses[slot] = snapshotRows[slot] < 0 ? 0 : pulses[snapshotRows[slot]];
+    }
+
+    ServoSnapshot snapshot;
+    snapshot.pan = slotPulses[SERVO_SLOT_PAN];
+    snapshot.tilt = slotPulses[SERVO_SLOT_TILT];
+    snapshot.leftLidTop = slotPulses[SERVO_SLOT_LEFT_LID_TOP];
+    snapshot.leftLidBottom = slotPulses[SERVO_SLOT_LEFT_LID_BOTTOM];
+    snapshot.rightLidTop = slotPulses[SERVO_SLOT_RIGHT_LID_TOP];
+    snapshot.rightLidBottom = slotPulses[SERVO_SLOT_RIGHT_LID_BOTTOM];
+    publishedSnapshot.write(snapshot);
+}
+
+/**
+ * @brief Attempts to reinitialize the I2C bus and a PCA9685.
+ *
+ * The PCA9685 is only reconfigured once it acknowledges its address, so a missing board
+ * costs a single probe rather than a full begin()/setPWMFreq() sequence.
+ *
+ * @param board The board to reinitialize.
+ * @return true if the PCA9685 responded and was reconfigured, false otherwise.
+ */
+bool ServoController::reinitialize(ServoBoard& board) {
+    Wire.begin(PIN_SDA, PIN_SCL);
+    if (!board.linkSupervisor.probe()) {
+        return false;
+    }
+
+    board.pwm.begin();
+    board.pwm.setPWMFreq(SERVO_PWM_FREQ);
+    board.frameWriter.invalidate();
+    if (board.asleep) {
+        // The board was reset while the bot is off, so resend the full-off frame and let it sleep again
+        board.frameWriter.flush();
+        board.pwm.sleep();
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the table of servo channels driven by the controller.
+ *
+ * @return the channel table.
+ */
+const ServoChannelTable& ServoController::getChannelTable() const {
+    return channelTable;
+}
+
+/**
+ * @brief Gets the I2C link supervisor for a PCA9685.
+ *
+ * @param board The board index.
+ * @return the I2C link supervisor.
+ */
+const I2CLinkSupervisor& ServoController::getLinkSupervisor(uint8_t board) const {
+    return boards[board < SERVO_BOARD_COUNT ? board : 0].linkSupervisor;
+}
+
+/**
+ * @brief Gets the servo power gate (switched-off servos and the current estimate).
+ *
+ * @return the servo power gate.
+ */
+const ServoPowerGate& ServoController::getPowerGate() const {
+    return powerGate;
+}
+
+/**
+ * @brief Gets the queue the frames are passed to the bus through (posted, coalesced and failed counts).
+ *
+ * @return the frame queue.
+ */
+const ServoFrameQueue& ServoController::getFrameQueue() const {
+    return frameQueue;
+}
+
+/**
+ * @brief Prints the servo current estimate and which servos are switched off.
+ */
+void ServoController::printPowerReport() const {
+    powerGate.printReport(channelTable);
+}
+
+/**
+ * @brief Gets the most recently published pulses. Safe to call from another task.
+ *
+ * @return ServoSnapshot The latest servo snapshot.
+ */
+ServoSnapshot ServoController::getSnapshot() const {
+    return publishedSnapshot.read();
+}
+
 #ifdef SERIAL_DEBUG
 /**
  * @brief Prints the current servo values for debugging purposes.
+ *
+ * The pulses are those of the first board's rig, the bus counts are totals over every board.
  */
 void ServoController::printDebugValues() {
+    unsigned long transactions = 0, skipped = 0, bytes = 0, errors = 0, retries = 0, reinits = 0;
+    for (const ServoBoard& board : boards) {
+        transactions += board.frameWriter.getTransactionCount();
+        skipped += board.frameWriter.getSkippedFrameCount();
+        bytes += board.frameWriter.getByteCount();
+        errors += board.linkSupervisor.getErrorCount();
+        retries += board.linkSupervisor.getRetryCount();
+        reinits += board.linkSupervisor.getReinitCount();
+    }
+
+    ServoSnapshot snapshot = getSnapshot();
     char servoBuffer[256];
     snprintf(servoBuffer, sizeof(servoBuffer),
-            "SERVOS: [PAN: %3d | TILT: %3d | LLT: %3d | LLB: %3d | RLT: %3d | RLB: %3d] ",
-            servoPanPulse, servoTiltPulse, servoLeftLidTopPulse, servoLeftLidBottomPulse, servoRightLidTopPulse, servoRightLidBottomPulse);
+            "SERVOS: [PAN: %3u | TILT: %3u | LLT: %3u | LLB: %3u | RLT: %3u | RLB: %3u | TX: %lu | SKIP: %lu | BYTES: %lu | ERR: %lu | RETRY: %lu | REINIT: %lu | COALESCED: %lu | OFF: %u | %lu uA] ",
+            snapshot.pan, snapshot.tilt, snapshot.leftLidTop, snapshot.leftLidBottom, snapshot.rightLidTop, snapshot.rightLidBottom,
+            transactions, skipped, bytes, errors, retries, reinits, frameQueue.getCoalescedCount(),
+            powerGate.getGatedCount(), (unsigned long)powerGate.getCurrentMicroamps());
     Serial.print(servoBuffer);
 }
-#endif
\ No newline at end of file
+#endif
@@ -4,6 +4,13 @@
  *
  * This class manages the initialization and updating of servo motors,
  * including setting their positions based on the current state.
+ *
+ * The servos are listed in a ServoChannelTable, so one state can drive an eye rig on each of the
+ * SERVO_BOARD_COUNT PCA9685 boards. Every frame is mapped in one pass over the table and sent to
+ * each board in a single I2C transaction.
+ *
+ * update() prepares the frame and posts it to a ServoFrameQueue. transmit() takes it and does the I2C
+ * writes: straight after update(), or in the bus task when one has been started with startOutputTask().
  */
 
 #ifndef SERVO_CONTROLLER_H
@@ -11,6 +18,25 @@
 
 #include <Adafruit_PWMServoDriver.h>
 #include "config.h"
+#include "pwmFrameWriter.h"
+#include "i2cLinkSupervisor.h"
+#include "servoChannelTable.h"
+#include "servoPowerGate.h"
+#include "servoFrameQueue.h"
+#include "seqLock.h"
+#include "snapshots.h"
+
+/**
+ * @brief A PCA9685 board with its frame writer and link supervisor.
+ */
+struct ServoBoard {
+    ServoBoard(uint8_t address);
+
+    Adafruit_PWMServoDriver pwm;
+    PwmFrameWriter frameWriter;
+    I2CLinkSupervisor linkSupervisor;
+    bool asleep;    // The PCA9685 was last put in SLEEP mode (owned by whichever task transmits)
+};
 
 class ServoController {
 public:
@@ -18,23 +44,39 @@ public:
 
     void begin();
     void update(int panState, int tiltState, int topLidState, int bottomLidState);
-    void checkI2CConnection();
+    void setPowerState(bool powered);
+    void transmit();
+    bool startOutputTask(TaskCallback transmitCallback);
+    void stopOutputTask();
+
+    const ServoChannelTable& getChannelTable() const;
+    const I2CLinkSupervisor& getLinkSupervisor(uint8_t board = 0) const;
+    const ServoPowerGate& getPowerGate() const;
+    const ServoFrameQueue& getFrameQueue() const;
+    ServoSnapshot getSnapshot() const;
+    void printPowerReport() const;
 
     #ifdef SERIAL_DEBUG
     void printDebugValues();
     #endif
 
 private:
-    Adafruit_PWMServoDriver pwm;
+    ServoBoard boards[SERVO_BOARD_COUNT];
+    ServoChannelTable channelTable;
+    ServoPowerGate powerGate;
+    ServoFrameQueue frameQueue;
+
+    uint16_t pulses[SERVO_MAX_CHANNELS];        // The calibrated pulse of each table row
+    int8_t snapshotRows[SERVO_SLOT_COUNT];      // The rows of the first board's rig, published in the snapshot
+    uint32_t configGeneration;                  // The runtime config generation the channel table was built from
+
+    SeqLock<ServoSnapshot> publishedSnapshot;
 
-    int servoPanPulse;
-    int servoTiltPulse;
-    int servoLeftLidTopPulse;
-    int servoLeftLidBottomPulse;
-    int servoRightLidTopPulse;
-    int servoRightLidBottomPulse;
+    void buildChannelTable();
+    bool reinitialize(ServoBoard& board);
+    void publish();
 };
 
 extern ServoController servoController;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,238 @@
+/**
+ * @file servoFrameQueue.cpp
+ * @brief Passes servo frames to the I2C bus task, keeping only the newest frame that has not been sent.
+ *
+ * The frames go through a triple buffer: the servo stage always has a free buffer to fill and the
+ * bus task always takes the newest complete frame, so neither ever waits for the other. The buffers
+ * change hands with an atomic exchange of readyState. The ESP32-C3 has no atomic read-modify-write
+ * instructions, so the exchange is a short critical section in the runtime, but it never blocks.
+ */
+
+#include "servoFrameQueue.h"
+
+#define FRAME_QUEUE_INDEX_MASK 0x03
+#define FRAME_QUEUE_FRESH 0x04  // The ready buffer holds a frame the bus task has not taken
+
+/**
+ * @brief Increments a counter that only one task writes.
+ *
+ * @param counter The counter.
+ */
+static void incrementCounter(std::atomic<unsigned long>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Constructs a new ServoFrameQueue object. The bus task does not run until start() is called.
+ */
+ServoFrameQueue::ServoFrameQueue():
+    frames(),
+    postIndex(0),
+    takeIndex(2),
+    readyState(1),
+    postedCount(0),
+    coalescedCount(0),
+    completedCount(0),
+    errorCount(0),
+    drain(NULL)
+    #ifdef ESP_PLATFORM
+    , handle(NULL)
+    #else
+    , running(false)
+    , wakePending(false)
+    #endif
+{}
+
+/**
+ * @brief Starts the bus task, which calls the drain callback whenever a frame is posted.
+ *
+ * @param drain The function that takes and sends the frame (runs in the bus task).
+ * @return true if the task was created, false otherwise.
+ */
+bool ServoFrameQueue::start(TaskCallback drain) {
+    this->drain = drain;
+    #ifdef ESP_PLATFORM
+    return xTaskCreate(taskEntry, "i2c", PIPELINE_TASK_STACK_SIZE, this, I2C_BUS_TASK_PRIORITY, &handle) == pdPASS;
+    #else
+    running.store(true, std::memory_order_release);
+    thread = std::thread(&ServoFrameQueue::run, this);
+    return true;
+    #endif
+}
+
+/**
+ * @brief Stops the bus task. On the host this waits for the current drain to finish.
+ */
+void ServoFrameQueue::stop() {
+    #ifdef ESP_PLATFORM
+    if (handle != NULL) {
+        vTaskDelete(handle);
+        handle = NULL;
+    }
+    #else
+    running.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakePending = true;
+    }
+    wakeCondition.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    #endif
+}
+
+/**
+ * @brief Checks whether the bus task is sending the frames.
+ *
+ * @return true if the bus task is running, false if the poster must send the frames itself.
+ */
+bool ServoFrameQueue::isRunning() const {
+    #ifdef ESP_PLATFORM
+    return handle != NULL;
+    #else
+    return running.load(std::memory_order_acquire);
+    #endif
+}
+
+/**
+ * @brief Gets the buffer to fill with the next frame. Servo stage only.
+ *
+ * @return the frame to fill before calling post().
+ */
+ServoFrame& ServoFrameQueue::getPostFrame() {
+    return frames[postIndex];
+}
+
+/**
+ * @brief Publishes the frame filled through getPostFrame() and wakes the bus task. Servo stage only.
+ *
+ * If the bus task has not taken the previous frame yet, it is replaced (coalesced).
+ */
+void ServoFrameQueue::post() {
+    uint8_t previous = readyState.exchange(postIndex | FRAME_QUEUE_FRESH, std::memory_order_acq_rel);
+    postIndex = previous & FRAME_QUEUE_INDEX_MASK;
+    incrementCounter(postedCount);
+    if (previous & FRAME_QUEUE_FRESH) {
+        incrementCounter(coalescedCount);
+    }
+
+    #ifdef ESP_PLATFORM
+    if (handle != NULL) {
+        xTaskNotifyGive(handle);
+    }
+    #else
+    if (running.load(std::memory_order_acquire)) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakePending = true;
+        }
+        wakeCondition.notify_one();
+    }
+    #endif
+}
+
+/**
+ * @brief Takes the newest posted frame. Bus task only (or the poster when the task is not running).
+ *
+ * @return the frame, valid until the next take(), or NULL if nothing new has been posted.
+ */
+const ServoFrame* ServoFrameQueue::take() {
+    if (!(readyState.load(std::memory_order_relaxed) & FRAME_QUEUE_FRESH)) {
+        return NULL;
+    }
+    uint8_t previous = readyState.exchange(takeIndex, std::memory_order_acq_rel);
+    takeIndex = previous & FRAME_QUEUE_INDEX_MASK;
+    return &frames[takeIndex];
+}
+
+/**
+ * @brief Counts a frame that reached every board. Bus task only.
+ */
+void ServoFrameQueue::reportFrameCompleted() {
+    incrementCounter(completedCount);
+}
+
+/**
+ * @brief Counts a failed board write. Bus task only.
+ *
+ * @param status The Wire::endTransmission() status of the write (0 = success).
+ */
+void ServoFrameQueue::reportWriteResult(uint8_t status) {
+    if (status != 0) {
+        incrementCounter(errorCount);
+    }
+}
+
+/**
+ * @brief Gets the number of frames posted. Safe to call from another task.
+ *
+ * @return the number of frames posted.
+ */
+unsigned long ServoFrameQueue::getPostedCount() const {
+    return postedCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of frames replaced by a newer one before they were sent. Safe to call from another task.
+ *
+ * @return the number of coalesced frames.
+ */
+unsigned long ServoFrameQueue::getCoalescedCount() const {
+    return coalescedCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of frames written to every board without an error. Safe to call from another task.
+ *
+ * @return the number of completed frames.
+ */
+unsigned long ServoFrameQueue::getCompletedCount() const {
+    return completedCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of board writes that failed. Safe to call from another task.
+ *
+ * @return the number of failed writes.
+ */
+unsigned long ServoFrameQueue::getErrorCount() const {
+    return errorCount.load(std::memory_order_relaxed);
+}
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief FreeRTOS entry point.
+ *
+ * @param parameter The ServoFrameQueue to run.
+ */
+void ServoFrameQueue::taskEntry(void* parameter) {
+    static_cast<ServoFrameQueue*>(parameter)->run();
+}
+
+/**
+ * @brief Sleeps until a frame is posted, then drains it. Posts made while draining wake it once more.
+ */
+void ServoFrameQueue::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        drain();
+    }
+}
+#else
+/**
+ * @brief Sleeps until a frame is posted, then drains it. Posts made while draining wake it once more.
+ */
+void ServoFrameQueue::run() {
+    while (running.load(std::memory_order_acquire)) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait(lock, [this] { return wakePending; });
+            wakePending = false;
+        }
+        if (running.load(std::memory_order_acquire)) {
+            drain();
+        }
+    }
+}
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file servoFrameQueue.h
+ * @brief Passes servo frames to the I2C bus task, keeping only the newest frame that has not been sent.
+ *
+ * Wire on the ESP32 is blocking, so a task that writes a frame waits for the whole transaction.
+ * With ASYNC_SERVO_OUTPUT defined the servo stage only posts its frame here, and a bus task takes
+ * it and does the I2C writes (and the link supervision). The stages keep running while the bus is
+ * busy, because the bus task spends its transactions blocked in the I2C driver.
+ *
+ * The frames go through a triple buffer: the servo stage always has a free buffer to fill and the
+ * bus task always takes the newest complete frame, so neither ever waits for the other. A frame
+ * that is replaced before the bus task gets to it is counted as coalesced. Each PwmFrameWriter
+ * still sends only the channels that differ from what the board last received, so a coalesced
+ * frame loses nothing.
+ *
+ * Without ASYNC_SERVO_OUTPUT no task is started and the servo stage sends each frame itself.
+ * On the host the bus task is a std::thread woken through a condition variable.
+ */
+
+#ifndef SERVO_FRAME_QUEUE_H
+#define SERVO_FRAME_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "pwmFrameWriter.h"
+#include "scheduler.h"
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+/**
+ * @brief The frame for one PCA9685 board.
+ */
+struct ServoBoardFrame {
+    uint16_t pulses[PCA9685_CHANNEL_COUNT]; // Ticks, or PCA9685_FULL_OFF
+    uint16_t channels;                      // The channels in use (one bit per channel)
+    bool sleep;                             // The PCA9685 should be put in (or kept in) SLEEP mode
+};
+
+/**
+ * @brief The frame for every board.
+ */
+struct ServoFrame {
+    ServoBoardFrame boards[SERVO_BOARD_COUNT];
+};
+
+class ServoFrameQueue {
+public:
+    ServoFrameQueue();
+
+    bool start(TaskCallback drain);
+    void stop();
+    bool isRunning() const;
+
+    ServoFrame& getPostFrame();
+    void post();
+    const ServoFrame* take();
+    void reportWriteResult(uint8_t status);
+    void reportFrameCompleted();
+
+    unsigned long getPostedCount() const;
+    unsigned long getCoalescedCount() const;
+    unsigned long getCompletedCount() const;
+    unsigned long getErrorCount() const;
+
+private:
+    ServoFrame frames[3];
+    uint8_t postIndex;                  // Owned by the servo stage
+    uint8_t takeIndex;                  // Owned by the bus task
+    std::atomic<uint8_t> readyState;    // The buffer between them, with FRAME_QUEUE_FRESH if it has not been taken
+
+    std::atomic<unsigned long> postedCount;
+    std::atomic<unsigned long> coalescedCount;
+    std::atomic<unsigned long> completedCount;
+    std::atomic<unsigned long> errorCount;
+
+    TaskCallback drain;
+
+    #ifdef ESP_PLATFORM
+    TaskHandle_t handle;
+    static void taskEntry(void* parameter);
+    #else
+    std::thread thread;
+    std::atomic<bool> running;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool wakePending;
+    #endif
+
+    void run();
+};
+
+#endif // SERVO_FRAME_QUEUE_H
@@ -0,0 +1,231 @@
+/**
+ * @file servoPowerGate.cpp
+ * @brief Switches servos off when they are at rest and puts the PCA9685 to sleep when the bot is soft-off.
+ *
+ * Lid channels are switched to full-off once they settle. While soft-powered off every channel is
+ * switched off and the PCA9685 boards sleep. On power up the channels are re-armed one slot per frame. The
+ * estimated current of the servos and the PCA9685 is tracked with or without gating.
+ */
+
+#include "servoPowerGate.h"
+
+#define MILLIS_PER_HOUR 3600000UL
+
+// The order the slots are switched back on after the PCA9685 boards wake (eyes first, then lids)
+static const uint8_t SERVO_REARM_ORDER[SERVO_SLOT_COUNT] = {
+    SERVO_SLOT_PAN, SERVO_SLOT_TILT,
+    SERVO_SLOT_LEFT_LID_TOP, SERVO_SLOT_RIGHT_LID_TOP,
+    SERVO_SLOT_LEFT_LID_BOTTOM, SERVO_SLOT_RIGHT_LID_BOTTOM,
+};
+
+static const char* SERVO_SLOT_NAMES[SERVO_SLOT_COUNT] = {"pan", "tilt", "llt", "llb", "rlt", "rlb"};
+
+/**
+ * @brief Constructs a new ServoPowerGate object, with every servo armed and the PCA9685 awake.
+ */
+ServoPowerGate::ServoPowerGate():
+    powered(true),
+    chipAsleep(false),
+    rearmedCount(SERVO_SLOT_COUNT),
+    accounting(false),
+    startMillis(0),
+    lastAccountMillis(0),
+    chargeMicroampMillis(0),
+    currentMicroamps(0),
+    chargeMicroampHours(0),
+    averageCurrentMicroamps(0),
+    gatedCount(0)
+{
+    for (uint8_t row = 0; row < SERVO_MAX_CHANNELS; row++) {
+        lastPulses[row] = PCA9685_FULL_OFF;
+        lastChangeMillis[row] = 0;
+        gated[row] = false;
+    }
+}
+
+/**
+ * @brief Sets whether the bot is (soft) powered on.
+ *
+ * @param powered false to switch every servo off once settled and put the PCA9685 to sleep.
+ */
+void ServoPowerGate::setPowered(bool powered) {
+    this->powered = powered;
+}
+
+/**
+ * @brief Checks whether a slot drives an eyelid.
+ *
+ * @param slot The servo slot.
+ * @return true for the four lid servos.
+ */
+bool ServoPowerGate::isLid(uint8_t slot) {
+    return slot >= SERVO_SLOT_LEFT_LID_TOP && slot <= SERVO_SLOT_RIGHT_LID_BOTTOM;
+}
+
+#ifdef SERVO_POWER_GATING
+/**
+ * @brief Gets the position of a slot in SERVO_REARM_ORDER.
+ *
+ * @param slot The ServoSlot.
+ * @return the number of slots re-armed before it.
+ */
+static uint8_t getRearmRank(uint8_t slot) {
+    uint8_t rank = 0;
+    while (rank < SERVO_SLOT_COUNT - 1 && SERVO_REARM_ORDER[rank] != slot) {
+        rank++;
+    }
+    return rank;
+}
+#endif
+
+/**
+ * @brief Gates a frame: replaces the pulse of every servo that should be off with PCA9685_FULL_OFF.
+ *
+ * @param table The channel table the frame was mapped with.
+ * @param pulses The frame's pulses, one per table row (updated).
+ * @param currentMillis The current time (ms).
+ */
+void ServoPowerGate::apply(const ServoChannelTable& table, uint16_t pulses[SERVO_MAX_CHANNELS], unsigned long currentMillis) {
+    // Charge the time since the last frame at the draw estimated for it
+    account(currentMillis);
+
+    // Track when each servo was last given a new pulse
+    uint8_t count = table.getCount();
+    for (uint8_t row = 0; row < count; row++) {
+        if (pulses[row] != lastPulses[row]) {
+            lastPulses[row] = pulses[row];
+            lastChangeMillis[row] = currentMillis;
+        }
+    }
+
+    #ifdef SERVO_POWER_GATING
+    if (chipAsleep && powered) {
+        // Wake the PCA9685 boards this frame and re-arm one slot per frame from the next
+        chipAsleep = false;
+        rearmedCount = 0;
+    } else if (rearmedCount < SERVO_SLOT_COUNT && !chipAsleep) {
+        rearmedCount++;
+    }
+
+    uint8_t offCount = 0;
+    for (uint8_t row = 0; row < count; row++) {
+        uint8_t slot = table.getSlot(row);
+        unsigned long stillMillis = currentMillis - lastChangeMillis[row];
+
+        bool off;
+        if (chipAsleep || getRearmRank(slot) >= rearmedCount) {
+            off = true;
+        } else if (!powered) {
+            off = stillMillis >= SERVO_SETTLE_TIME;
+        } else {
+            off = isLid(slot) && stillMillis >= SERVO_LID_OFF_DELAY;
+        }
+
+        gated[row] = off;
+        if (off) {
+            pulses[row] = PCA9685_FULL_OFF;
+            offCount++;
+        }
+    }
+
+    // Once everything is off, send the frame and put the PCA9685 boards to sleep
+    if (!powered && !chipAsleep && offCount == count) {
+        chipAsleep = true;
+    }
+    #endif
+
+    // Estimate the draw until the next frame
+    uint32_t current = (uint32_t)SERVO_BOARD_COUNT * (chipAsleep ? SERVO_CURRENT_PCA9685_SLEEP_UA : SERVO_CURRENT_PCA9685_UA);
+    uint8_t offTotal = 0;
+    for (uint8_t row = 0; row < count; row++) {
+        if (gated[row]) {
+            offTotal++;
+        } else {
+            current += currentMillis - lastChangeMillis[row] < SERVO_SETTLE_TIME ? SERVO_CURRENT_MOVING_UA : SERVO_CURRENT_HOLDING_UA;
+        }
+    }
+    currentMicroamps.store(current, std::memory_order_relaxed);
+    gatedCount.store(offTotal, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Charges the time since the last frame at the current estimate and publishes the totals.
+ *
+ * @param currentMillis The current time (ms).
+ */
+void ServoPowerGate::account(unsigned long currentMillis) {
+    if (!accounting) {
+        accounting = true;
+        startMillis = currentMillis;
+    } else {
+        chargeMicroampMillis += (uint64_t)(currentMillis - lastAccountMillis) * currentMicroamps.load(std::memory_order_relaxed);
+    }
+    lastAccountMillis = currentMillis;
+
+    unsigned long elapsedMillis = currentMillis - startMillis;
+    chargeMicroampHours.store(chargeMicroampMillis / MILLIS_PER_HOUR, std::memory_order_relaxed);
+    averageCurrentMicroamps.store(elapsedMillis == 0 ? 0 : chargeMicroampMillis / elapsedMillis, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Checks whether the PCA9685 boards should be asleep.
+ *
+ * @return true if the frame is all off and the PCA9685 boards should be put (or kept) asleep.
+ */
+bool ServoPowerGate::isChipAsleep() const {
+    return chipAsleep;
+}
+
+/**
+ * @brief Gets the number of servos currently switched off. Safe to call from another task.
+ *
+ * @return the number of gated servos.
+ */
+uint8_t ServoPowerGate::getGatedCount() const {
+    return gatedCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the estimated current of the servos and the PCA9685. Safe to call from another task.
+ *
+ * @return the estimated current (uA).
+ */
+uint32_t ServoPowerGate::getCurrentMicroamps() const {
+    return currentMicroamps.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the estimated charge drawn by the servos and the PCA9685 since the first frame.
+ *
+ * @return the charge (uAh).
+ */
+uint32_t ServoPowerGate::getChargeMicroampHours() const {
+    return chargeMicroampHours.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the estimated average current of the servos and the PCA9685 since the first frame.
+ *
+ * @return the average current (uA).
+ */
+uint32_t ServoPowerGate::getAverageCurrentMicroamps() const {
+    return averageCurrentMicroamps.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Prints the servo current estimate and which servos are switched off.
+ *
+ * @param table The channel table the frames are mapped with (names the servos).
+ */
+void ServoPowerGate::printReport(const ServoChannelTable& table) const {
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer), "SERVO POWER: %lu uA now, %lu uA average, %lu uAh used, off:",
+                          (unsigned long)getCurrentMicroamps(), (unsigned long)getAverageCurrentMicroamps(),
+                          (unsigned long)getChargeMicroampHours());
+    for (uint8_t row = 0; row < table.getCount() && length < (int)sizeof(buffer); row++) {
+        if (gated[row]) {
+            length += snprintf(buffer + length, sizeof(buffer) - length, " %s@%u", SERVO_SLOT_NAMES[table.getSlot(row)], table.getBoard(row));
+        }
+    }
+    Serial.println(buffer);
+}
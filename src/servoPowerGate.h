@@ -0,0 +1,63 @@
+/**
+ * @file servoPowerGate.h
+ * @brief Switches servos off when they are at rest and puts the PCA9685 to sleep when the bot is soft-off.
+ *
+ * A servo that is driven keeps drawing current to hold its position. With SERVO_POWER_GATING defined:
+ * - A lid channel is switched to full-off once its pulse has not changed for SERVO_LID_OFF_DELAY.
+ *   It is switched back on as soon as it is given a new pulse.
+ * - While soft-powered off, every channel is switched off once it has settled, and then the PCA9685
+ *   is put into its SLEEP mode (oscillator stopped).
+ * - On power up the PCA9685 boards are woken and the channels are re-armed one slot per frame in
+ *   SERVO_REARM_ORDER (the pan servo of every rig first, and so on), so the servos do not all draw
+ *   their start-up current at once.
+ *
+ * The estimated current of the servos and the PCA9685 is tracked with or without gating, so the two
+ * can be compared.
+ */
+
+#ifndef SERVO_POWER_GATE_H
+#define SERVO_POWER_GATE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "servoChannelTable.h"
+
+class ServoPowerGate {
+public:
+    ServoPowerGate();
+
+    void setPowered(bool powered);
+    void apply(const ServoChannelTable& table, uint16_t pulses[SERVO_MAX_CHANNELS], unsigned long currentMillis);
+
+    bool isChipAsleep() const;
+    uint8_t getGatedCount() const;
+    uint32_t getCurrentMicroamps() const;
+    uint32_t getChargeMicroampHours() const;
+    uint32_t getAverageCurrentMicroamps() const;
+    void printReport(const ServoChannelTable& table) const;
+
+    static bool isLid(uint8_t slot);
+
+private:
+    bool powered;
+    bool chipAsleep;
+    uint8_t rearmedCount;
+    uint16_t lastPulses[SERVO_MAX_CHANNELS];
+    unsigned long lastChangeMillis[SERVO_MAX_CHANNELS];
+    bool gated[SERVO_MAX_CHANNELS];
+
+    bool accounting;
+    unsigned long startMillis;
+    unsigned long lastAccountMillis;
+    uint64_t chargeMicroampMillis;
+
+    std::atomic<uint32_t> currentMicroamps;
+    std::atomic<uint32_t> chargeMicroampHours;
+    std::atomic<uint32_t> averageCurrentMicroamps;
+    std::atomic<uint8_t> gatedCount;
+
+    void account(unsigned long currentMillis);
+};
+
+#endif // SERVO_POWER_GATE_H
@@ -0,0 +1,177 @@
+/**
+ * @file setpointJitterBuffer.cpp
+ * @brief Holds streamed gaze setpoints back until they are due, to smooth out uneven delivery.
+ *
+ * USB and the host's scheduler deliver setpoints in bursts, so each one is played a fixed delay
+ * after the earliest time it could have arrived rather than as soon as it arrives. The host stamps
+ * every setpoint with its own clock. The smallest gap seen between the host stamp and the receive
+ * time is the fastest delivery, so a setpoint is due at its host stamp plus that gap plus
+ * REMOTE_JITTER_DELAY. The smallest gap is tracked over a window of REMOTE_JITTER_WINDOW
+ * setpoints (keeping the previous window too), so it follows the drift between the two clocks.
+ *
+ * Setpoints are kept in sequence order. One that is not newer than the last one played, or that is
+ * already held, is stale and dropped. One that arrives after it was due is late and plays at once.
+ */
+
+#include "setpointJitterBuffer.h"
+
+static_assert(REMOTE_JITTER_BUFFER_SIZE >= 2 && REMOTE_JITTER_BUFFER_SIZE <= 255, "REMOTE_JITTER_BUFFER_SIZE must be 2 -> 255");
+
+/**
+ * @brief Constructs a new SetpointJitterBuffer object, empty.
+ */
+SetpointJitterBuffer::SetpointJitterBuffer() {
+    reset();
+}
+
+/**
+ * @brief Drops every held setpoint and forgets the sequence and the clock gap, ready for a new stream.
+ */
+void SetpointJitterBuffer::reset() {
+    count = 0;
+    lastPlayedSequence = 0;
+    played = false;
+    windowMinTransit = 0;
+    previousMinTransit = 0;
+    windowCount = 0;
+    previousWindow = false;
+}
+
+/**
+ * @brief Adds a received setpoint.
+ *
+ * @param setpoint The setpoint (with its receive time).
+ * @param currentMicros The current time (us).
+ * @return the JitterResult.
+ */
+JitterResult SetpointJitterBuffer::push(const RemoteSetpoint& setpoint, unsigned long currentMicros) {
+    trackTransit(setpoint);
+
+    if (played && !isNewer(setpoint.sequence, lastPlayedSequence)) {
+        return JITTER_STALE;
+    }
+
+    // Find where it goes, keeping the entries in sequence order
+    uint8_t index = count;
+    while (index > 0 && isNewer(entries[index - 1].sequence, setpoint.sequence)) {
+        index--;
+    }
+    if (index > 0 && entries[index - 1].sequence == setpoint.sequence) {
+        return JITTER_STALE;
+    }
+
+    JitterResult result = isDue(setpoint, currentMicros) ? JITTER_LATE : JITTER_ACCEPTED;
+
+    // When full, the oldest setpoint would be overtaken by the newer ones anyway
+    if (count == REMOTE_JITTER_BUFFER_SIZE) {
+        if (index == 0) {
+            return JITTER_OVERFLOW;
+        }
+        for (uint8_t i = 1; i < count; i++) {
+            entries[i - 1] = entries[i];
+        }
+        count--;
+        index--;
+        result = JITTER_OVERFLOW;
+    }
+
+    for (uint8_t i = count; i > index; i--) {
+        entries[i] = entries[i - 1];
+    }
+    entries[index] = setpoint;
+    count++;
+    return result;
+}
+
+/**
+ * @brief Takes the newest setpoint that is due, dropping any older ones it overtakes.
+ *
+ * @param currentMicros The current time (us).
+ * @param setpoint Receives the setpoint.
+ * @return true if a setpoint was due.
+ */
+bool SetpointJitterBuffer::pop(unsigned long currentMicros, RemoteSetpoint& setpoint) {
+    int due = -1;
+    for (uint8_t i = 0; i < count; i++) {
+        if (isDue(entries[i], currentMicros)) {
+            due = i;
+        }
+    }
+    if (due < 0) {
+        return false;
+    }
+
+    setpoint = entries[due];
+    lastPlayedSequence = setpoint.sequence;
+    played = true;
+
+    for (uint8_t i = due + 1; i < count; i++) {
+        entries[i - due - 1] = entries[i];
+    }
+    count -= due + 1;
+    return true;
+}
+
+/**
+ * @brief Gets the number of setpoints waiting to be played.
+ *
+ * @return the held setpoint count.
+ */
+uint8_t SetpointJitterBuffer::getCount() const {
+    return count;
+}
+
+/**
+ * @brief Gets the smallest gap between the host stamp and the receive time over the last one to two windows.
+ *
+ * @return the gap (us, wrapping like the clocks).
+ */
+uint32_t SetpointJitterBuffer::getTransitMicros() const {
+    if (windowCount == 0) {
+        return previousMinTransit;
+    }
+    if (previousWindow && (int32_t)(previousMinTransit - windowMinTransit) < 0) {
+        return previousMinTransit;
+    }
+    return windowMinTransit;
+}
+
+/**
+ * @brief Adds a setpoint's receive - host gap to the current window.
+ *
+ * @param setpoint The received setpoint.
+ */
+void SetpointJitterBuffer::trackTransit(const RemoteSetpoint& setpoint) {
+    uint32_t transit = setpoint.receiveMicros - setpoint.hostMicros;
+    if (windowCount == 0 || (int32_t)(transit - windowMinTransit) < 0) {
+        windowMinTransit = transit;
+    }
+    if (++windowCount >= REMOTE_JITTER_WINDOW) {
+        previousMinTransit = windowMinTransit;
+        previousWindow = true;
+        windowCount = 0;
+    }
+}
+
+/**
+ * @brief Checks whether a setpoint should be playing by now.
+ *
+ * @param setpoint The setpoint.
+ * @param currentMicros The current time (us).
+ * @return true if it is due.
+ */
+bool SetpointJitterBuffer::isDue(const RemoteSetpoint& setpoint, unsigned long currentMicros) const {
+    uint32_t playoutMicros = setpoint.hostMicros + getTransitMicros() + REMOTE_JITTER_DELAY;
+    return (int32_t)((uint32_t)currentMicros - playoutMicros) >= 0;
+}
+
+/**
+ * @brief Compares two sequence numbers, allowing for them wrapping.
+ *
+ * @param sequence The sequence number to check.
+ * @param than The sequence number to compare it with.
+ * @return true if sequence comes after than.
+ */
+bool SetpointJitterBuffer::isNewer(uint16_t sequence, uint16_t than) {
+    return (int16_t)(sequence - than) > 0;
+}
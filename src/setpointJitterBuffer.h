@@ -0,0 +1,71 @@
+/**
+ * @file setpointJitterBuffer.h
+ * @brief Holds streamed gaze setpoints back until they are due, to smooth out uneven delivery.
+ *
+ * USB and the host's scheduler deliver setpoints in bursts, so each one is played a fixed delay
+ * after the earliest time it could have arrived rather than as soon as it arrives. The host stamps
+ * every setpoint with its own clock. The smallest gap seen between the host stamp and the receive
+ * time is the fastest delivery, so a setpoint is due at its host stamp plus that gap plus
+ * REMOTE_JITTER_DELAY. The smallest gap is tracked over a window of REMOTE_JITTER_WINDOW
+ * setpoints (keeping the previous window too), so it follows the drift between the two clocks.
+ *
+ * Setpoints are kept in sequence order. One that is not newer than the last one played, or that is
+ * already held, is stale and dropped. One that arrives after it was due is late and plays at once.
+ */
+
+#ifndef SETPOINT_JITTER_BUFFER_H
+#define SETPOINT_JITTER_BUFFER_H
+
+#include <stdint.h>
+#include "config.h"
+
+/**
+ * @brief One gaze setpoint streamed from a host.
+ */
+struct RemoteSetpoint {
+    uint16_t sequence;          // Increases by one per setpoint (wraps)
+    uint32_t hostMicros;        // When the host sent it (host clock, us)
+    uint32_t receiveMicros;     // When it was received (us)
+    int8_t pan;                 // -100 -> 100
+    int8_t tilt;                // -100 -> 100
+    uint8_t topLid;             // 0 -> 100
+    uint8_t bottomLid;          // 0 -> 100
+    uint8_t flags;              // REMOTE_FLAG_*
+};
+
+enum JitterResult {
+    JITTER_ACCEPTED,    // Held until it is due
+    JITTER_LATE,        // Held, but already due
+    JITTER_STALE,       // Dropped: not newer than the last one played, or already held
+    JITTER_OVERFLOW,    // Held, but the oldest held setpoint was dropped to make room
+};
+
+class SetpointJitterBuffer {
+public:
+    SetpointJitterBuffer();
+
+    void reset();
+    JitterResult push(const RemoteSetpoint& setpoint, unsigned long currentMicros);
+    bool pop(unsigned long currentMicros, RemoteSetpoint& setpoint);
+
+    uint8_t getCount() const;
+    uint32_t getTransitMicros() const;
+
+private:
+    RemoteSetpoint entries[REMOTE_JITTER_BUFFER_SIZE];   // Oldest sequence first
+    uint8_t count;
+
+    uint16_t lastPlayedSequence;
+    bool played;                    // lastPlayedSequence is valid
+
+    uint32_t windowMinTransit;      // The smallest receive - host gap in the current window (us)
+    uint32_t previousMinTransit;    // The smallest gap in the previous window (us)
+    uint16_t windowCount;           // Setpoints seen in the current window
+    bool previousWindow;            // previousMinTransit is valid
+
+    void trackTransit(const RemoteSetpoint& setpoint);
+    bool isDue(const RemoteSetpoint& setpoint, unsigned long currentMicros) const;
+    static bool isNewer(uint16_t sequence, uint16_t than);
+};
+
+#endif // SETPOINT_JITTER_BUFFER_H
@@ -0,0 +1,77 @@
+/**
+ * @file snapshots.h
+ * @brief Compact POD snapshots passed between the input, behaviour and servo stages.
+ *
+ * Each stage publishes its output through a SeqLock so the next stage can read a consistent copy
+ * without sharing any mutable state or taking a mutex.
+ */
+
+#ifndef SNAPSHOTS_H
+#define SNAPSHOTS_H
+
+#include <stdint.h>
+
+#define RAW_INPUT_ADC_COUNT 3            // Joystick X, joystick Y, eyelid pot (ADC_INPUT_* order)
+
+#define RAW_BUTTON_BLINK    0x01    // The blink button is pressed
+#define RAW_BUTTON_BLINK_2  0x02    // The second blink button is pressed
+#define RAW_BUTTON_POWER    0x04    // The power button is pressed
+
+/**
+ * @brief The unprocessed hardware readings taken by the InputHandler on each update.
+ */
+struct RawInputs {
+    uint16_t adc[RAW_INPUT_ADC_COUNT];  // 0 -> 4095, before drift adjustment and filtering
+    uint8_t buttons;                    // RAW_BUTTON_*
+};
+
+/**
+ * @brief The processed inputs published by the InputHandler.
+ *
+ * Button presses are published as running counts so that a consumer can detect every press,
+ * however long it takes to read the snapshot.
+ */
+struct InputSnapshot {
+    int16_t joystickXValue;
+    int16_t joystickYValue;
+    int16_t potValue;
+    int16_t smoothedPotValue;
+    uint8_t buttonPressed;
+    uint8_t manualControlEnabled;
+    uint16_t powerButtonPressCount;
+    uint16_t powerButtonDoublePressCount;
+    uint16_t powerButtonLongPressCount;
+    uint32_t manualControlDisabledSinceMillis;
+};
+
+#define STATE_FLAG_POWER    0x01    // The bot is (soft) powered on
+#define STATE_FLAG_SLEEPING 0x02    // The bot is asleep with its eyes closed
+#define STATE_FLAG_MANUAL   0x04    // The bot is under manual control
+#define STATE_FLAG_REMOTE   0x08    // The bot is under remote control (streamed setpoints, see remoteControl.h)
+
+/**
+ * @brief The servo targets published by the StateManager (twitch offsets already applied).
+ */
+struct StateSnapshot {
+    int8_t pan;             // -100 -> 100
+    int8_t tilt;            // -100 -> 100
+    uint8_t topLid;         // 0 -> 100
+    uint8_t bottomLid;      // 0 -> 100
+    uint8_t flags;          // STATE_FLAG_*
+    uint16_t remoteSequence;        // The remote setpoint being played (when STATE_FLAG_REMOTE)
+    uint32_t remoteReceiveMicros;   // When that setpoint was received (us)
+};
+
+/**
+ * @brief The pulses last sent by the ServoController (PCA9685 ticks).
+ */
+struct ServoSnapshot {
+    uint16_t pan;
+    uint16_t tilt;
+    uint16_t leftLidTop;
+    uint16_t leftLidBottom;
+    uint16_t rightLidTop;
+    uint16_t rightLidBottom;
+};
+
+#endif // SNAPSHOTS_H
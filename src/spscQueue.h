@@ -0,0 +1,70 @@
+/**
+ * @file spscQueue.h
+ * @brief A lock-free single-producer, single-consumer ring buffer, safe to push from an interrupt.
+ *
+ * The producer only writes the head index and the consumer only writes the tail index, so neither
+ * needs an atomic read-modify-write (which the ESP32-C3 does not have) and neither ever blocks.
+ * A push into a full queue fails rather than overwriting the oldest element.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T, uint32_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue(): head(0), tail(0) {}
+
+    /**
+     * @brief Adds an element. Must only be called from the producer.
+     *
+     * @param value The element.
+     * @return true if it was added, false if the queue is full.
+     */
+    bool push(const T& value) {
+        uint32_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead - tail.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        elements[currentHead & (Capacity - 1)] = value;
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element. Must only be called from the consumer.
+     *
+     * @param value Receives the element.
+     * @return true if an element was removed, false if the queue is empty.
+     */
+    bool pop(T& value) {
+        uint32_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = elements[currentTail & (Capacity - 1)];
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Checks whether the queue is empty. Either side may call it.
+     *
+     * @return true if there is nothing to pop.
+     */
+    bool isEmpty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+private:
+    T elements[Capacity];
+    std::atomic<uint32_t> head;    // Written by the producer
+    std::atomic<uint32_t> tail;    // Written by the consumer
+};
+
+#endif // SPSC_QUEUE_H
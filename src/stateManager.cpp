@@ -10,6 +10,8 @@
 #include <Arduino.h>
 #include "stateManager.h"
 #include "config.h"
+#include "gazeLidModel.h"
+#include "runtimeConfig.h"
 
 /**
  * @brief Constructs a new StateManager object.
@@ -28,21 +30,88 @@ StateManager::StateManager(InputHandler& inputHandler):
     autoBlinkState(false),
     autoEyelidsState(50),
     sleeping(false),
-    previousAutoUpdateMillis(0),
-    perviousAutoBlinkMillis(0)
+    remoteControlled(false),
+    remoteSetpoint(),
+    remoteControlMillis(0),
+    perviousAutoBlinkMillis(0),
+    randomSeedValue(0),
+    randomGenerator(0),
+    behaviourTable(AUTO_BEHAVIOUR_TABLE),
+    behaviourModel(behaviourTable.outcomes, BEHAVIOUR_TABLE_ROWS),
+    behaviourTimer(behaviourModel.getMeanIntervalMillis(), randomGenerator),
+    configGeneration(0),
+    twitchTimer(AUTO_LOOK_TWITCH_INTERVAL, randomGenerator)
 {}
 
 /**
- * @brief Initialize the state manager.
+ * @brief Initialize the state manager, seeded from the hardware RNG (or RNG_SEED for repeatable behaviour).
  */
 void StateManager::begin() {
-    randomSeed(analogRead(0)); // Initialize random seed
+    #ifdef RNG_SEED
+    begin(RNG_SEED);
+    #else
+    begin(esp_random());
+    #endif
+}
+
+/**
+ * @brief Initialize the state manager with a known random seed (e.g. to replay a capture).
+ *
+ * @param seed The random seed.
+ */
+void StateManager::begin(uint32_t seed) {
+    randomSeedValue = seed;
+    randomGenerator.seed(seed);
+    twitchTimer.start(millis());
+}
+
+/**
+ * @brief Gets the seed the random number generator was started with.
+ *
+ * @return the random seed.
+ */
+uint32_t StateManager::getRandomSeed() const {
+    return randomSeedValue;
+}
+
+/**
+ * @brief Rebuilds the behaviour table from the runtime config chances.
+ */
+void StateManager::applyConfig() {
+    const RuntimeConfigValues& config = runtimeConfig.get();
+    BehaviourChances chances = {
+        config.chanceOfBlink,
+        config.chanceOfEyelidChange,
+        config.chanceOfMajorLookChange,
+        config.chanceOfLookReturnCentre,
+        config.chanceOfBlinkWhileLook,
+    };
+    behaviourTable = buildBehaviourTable(chances);
+    behaviourModel.setOutcomes(behaviourTable.outcomes, BEHAVIOUR_TABLE_ROWS);
+    behaviourTimer.setMeanInterval(behaviourModel.getMeanIntervalMillis());
 }
 
 /**
  * @brief Updates the state based on the current input values or autonomous control.
  */
 void StateManager::update() {
+    // Pick up a new runtime config before using any of it
+    uint32_t generation = runtimeConfig.getGeneration();
+    if (generation != configGeneration) {
+        configGeneration = generation;
+        applyConfig();
+    }
+    const RuntimeConfigValues& config = runtimeConfig.get();
+
+    // Take a consistent copy of the latest inputs for this update
+    inputHandler.latch();
+
+    #ifdef REMOTE_CONTROL
+    // Play the streamed setpoints even while powered off or under manual control, so they never back up
+    bool remoteActive = remoteControl.update(micros(), remoteSetpoint);
+    remoteControlled = remoteActive && !inputHandler.isManualControlEnabled();
+    #endif
+
     // Ensure the lids are closed
     if (sleeping) {
         autoEyelidsState = 0;
@@ -52,6 +121,8 @@ void StateManager::update() {
 
     // Don't continue if the bot is powered off (or soft powered off when charging)
     if (!checkPowerState()) {
+        remoteControlled = false;
+        publish();
         return;
     }
 
@@ -67,6 +138,9 @@ void StateManager::update() {
         // Bot can't be asleep if the manual control is enabled
         sleeping = false;
 
+        // The behaviour is rescheduled when autonomous control takes over again
+        behaviourTimer.stop();
+
         int joystickXPercent = inputHandler.getJoystickXPercent();
         int joystickYPercent = inputHandler.getJoystickYPercent();
         int potPercent = inputHandler.getPotPercent();
@@ -83,29 +157,49 @@ void StateManager::update() {
         autoEyelidsState = potPercent;
     }
 
+    // Update the state from the streamed setpoints when under remote control
+    else if (remoteControlled) {
+        // Bot can't be asleep while a host is driving it
+        sleeping = false;
+        behaviourTimer.stop();
+        remoteControlMillis = millis();
+
+        bool blink = remoteSetpoint.flags & REMOTE_FLAG_BLINK;
+        newPanState = remoteSetpoint.pan;
+        newTiltState = remoteSetpoint.tilt;
+        newTopLidState = blink ? 0 : remoteSetpoint.topLid;
+        newBottomLidState = blink ? 0 : remoteSetpoint.bottomLid;
+
+        // Carry the lids over to autonomous control
+        newAutoEyelidsState = remoteSetpoint.topLid;
+    }
+
     // Update the state using autonomous control
     else {
         // Don't update if the bot is asleep
         if (!sleeping && powerState) {
             bool prevAutoBlinkState = autoBlinkState;
 
+            // Schedule the behaviour from when autonomous control takes over
             unsigned long currentMillis = millis();
-            if (currentMillis - previousAutoUpdateMillis >= AUTO_UPDATE_INTERVAL) {
-                previousAutoUpdateMillis = currentMillis;
-                randomizeStates(newPanState, newTiltState, newTopLidState, newBottomLidState, newAutoEyelidsState, newAutoBlinkState);
+            if (!behaviourTimer.isRunning()) {
+                behaviourTimer.start(currentMillis);
+            }
+            if (behaviourTimer.poll(currentMillis)) {
+                randomizeStates(newPanState, newTiltState, newAutoEyelidsState, newAutoBlinkState);
             }
 
             // Keep track of when the blink state changes
-            if (prevAutoBlinkState != autoBlinkState) {
+            if (prevAutoBlinkState != newAutoBlinkState) {
                 perviousAutoBlinkMillis = currentMillis;
             }
 
             // Stop blinking if the blink state is true and the blink duration has passed
-            if (newAutoBlinkState && currentMillis - perviousAutoBlinkMillis >= AUTO_BLINK_DURATION) {
+            if (newAutoBlinkState && currentMillis - perviousAutoBlinkMillis >= config.autoBlinkDuration) {
                 newAutoBlinkState = false;
             }
 
-            if (millis() - inputHandler.getManualControlDisabledSinceMillis() >= (AUTO_POWER_OFF_TIMEOUT - 1000)) {
+            if (millis() - getIdleSinceMillis() >= (config.autoPowerOffTimeout - 1000)) {
                 #ifdef SERIAL_DEBUG
                 Serial.println("Sleeping. Bot will power down in 1 second...");
                 #endif
@@ -114,27 +208,30 @@ void StateManager::update() {
                 sleeping = true;
                 newAutoBlinkState = true;
             }
-        } else if (sleeping && powerState && (millis() - inputHandler.getManualControlDisabledSinceMillis() >= AUTO_POWER_OFF_TIMEOUT)) {
+
+            // Close the lids while blinking, otherwise hold them at the auto eyelids position
+            newTopLidState = newAutoBlinkState ? 0 : newAutoEyelidsState;
+            newBottomLidState = newAutoBlinkState ? 0 : newAutoEyelidsState;
+        } else if (sleeping && powerState && (millis() - getIdleSinceMillis() >= config.autoPowerOffTimeout)) {
             // power down if the bot has been inactive for a while
             powerDown();
         }
     }
 
-    // Randomise a twitch on the eyeballs to emulate realism
+    // Twitch the eyeballs at random times to emulate realism
     // The twitch is only applied to the servo positions, not the state
-    if (random(0, AUTO_MAX_CHANCE) < AUTO_CHANCE_OF_LOOK_TWITCH) {
-        panTwitchOffset = constrain(random(-AUTO_LOOK_TWITCH_AMOUNT, AUTO_LOOK_TWITCH_AMOUNT + 1), -100, 100);
-        tiltTwitchOffset = constrain(random(-AUTO_LOOK_TWITCH_AMOUNT, AUTO_LOOK_TWITCH_AMOUNT + 1), -100, 100);
+    if (twitchTimer.poll(millis())) {
+        panTwitchOffset = constrain(randomGenerator.uniform(-AUTO_LOOK_TWITCH_AMOUNT, AUTO_LOOK_TWITCH_AMOUNT + 1), -100, 100);
+        tiltTwitchOffset = constrain(randomGenerator.uniform(-AUTO_LOOK_TWITCH_AMOUNT, AUTO_LOOK_TWITCH_AMOUNT + 1), -100, 100);
     }
 
-    // Adjust the top and bottom lid states based on the tilt state so that the pupil is always visible
-    if (newTiltState < 0 and newTopLidState > 0 and newTopLidState < PUPIL_REVEAL_LID_MAX_AMOUNT) {
-        int offsetTopLidState = map(-newTiltState, 0, 100, PUPIL_REVEAL_LID_MIN_AMOUNT, PUPIL_REVEAL_LID_MAX_AMOUNT) - PUPIL_REVEAL_LID_MIN_AMOUNT;
-        newTopLidState = constrain(newTopLidState + offsetTopLidState, 0, 100);
+    // Open the top and bottom lids away from the gaze so that the pupil is always visible
+    GazeLidOffsets reveal = getGazeLidOffsets(newPanState, newTiltState);
+    if (newTopLidState > 0 and newTopLidState < PUPIL_REVEAL_LID_MAX_AMOUNT) {
+        newTopLidState = constrain(newTopLidState + reveal.top, 0, 100);
     }
-    if (newTiltState > 0 and newBottomLidState > 0 and newBottomLidState < PUPIL_REVEAL_LID_MAX_AMOUNT) {
-        int offsetBottomLidState = map(-newTiltState, 0, 100, PUPIL_REVEAL_LID_MIN_AMOUNT, PUPIL_REVEAL_LID_MAX_AMOUNT) - PUPIL_REVEAL_LID_MIN_AMOUNT;
-        newBottomLidState = constrain(newBottomLidState - offsetBottomLidState, 0, 100);
+    if (newBottomLidState > 0 and newBottomLidState < PUPIL_REVEAL_LID_MAX_AMOUNT) {
+        newBottomLidState = constrain(newBottomLidState + reveal.bottom, 0, 100);
     }
 
     // Update the state
@@ -144,50 +241,73 @@ void StateManager::update() {
     bottomLidState = newBottomLidState;
     autoEyelidsState = newAutoEyelidsState;
     autoBlinkState = newAutoBlinkState;
+
+    publish();
+}
+
+/**
+ * @brief Publishes the servo targets so they can be read by the servo stage (possibly in another task).
+ */
+void StateManager::publish() {
+    StateSnapshot snapshot;
+    snapshot.pan = getPanState();
+    snapshot.tilt = getTiltState();
+    snapshot.topLid = topLidState;
+    snapshot.bottomLid = bottomLidState;
+    snapshot.flags = (powerState ? STATE_FLAG_POWER : 0)
+        | (sleeping ? STATE_FLAG_SLEEPING : 0)
+        | (inputHandler.isManualControlEnabled() ? STATE_FLAG_MANUAL : 0)
+        | (remoteControlled ? STATE_FLAG_REMOTE : 0);
+    snapshot.remoteSequence = remoteSetpoint.sequence;
+    snapshot.remoteReceiveMicros = remoteSetpoint.receiveMicros;
+    publishedSnapshot.write(snapshot);
 }
 
 /**
- * @brief Randomly changes the state of the bot when under autonomous control.
+ * @brief Randomly changes the state of the bot when under autonomous control, by drawing one
+ * outcome from the behaviour table (see behaviourModel.h). Called when the behaviour timer fires.
  */
-void StateManager::randomizeStates(int& newPanState, int& newTiltState, int& newTopLidState, int& newBottomLidState, int& newAutoEyelidsState, bool& newAutoBlinkState) {
-    // Randomly change pan and tilt values to a major new look direction
-    if (random(0, AUTO_MAX_CHANCE) < AUTO_CHANCE_OF_MAJOR_LOOK_CHANGE) {
-        // Return to centre?
-        if (newPanState != 0 || newTiltState != 0 && random(0, AUTO_MAX_CHANCE) < AUTO_CHANCE_OF_LOOK_RETURN_CENTRE) {
+void StateManager::randomizeStates(int& newPanState, int& newTiltState, int& newAutoEyelidsState, bool& newAutoBlinkState) {
+    const RuntimeConfigValues& config = runtimeConfig.get();
+
+    // One draw decides what happens, and where
+    BehaviourDecision decision = behaviourModel.decide(randomGenerator.uniform(behaviourModel.getOutcomeWeight()));
+
+    // Change pan and tilt values to a major new look direction
+    if (decision.actions & (BEHAVIOUR_LOOK_CENTRE | BEHAVIOUR_LOOK_AROUND)) {
+        // Return to centre (unless already there)
+        if ((decision.actions & BEHAVIOUR_LOOK_CENTRE) && (newPanState != 0 || newTiltState != 0)) {
             newPanState = 0;
             newTiltState = 0;
         } else {
-            // choose a random new look direction based on the available positions
-            newPanState = AUTO_LOOK_PAN_POSITIONS[random(0, AUTO_LOOK_PAN_POSITION_COUNT)];
-            newTiltState = AUTO_LOOK_TILT_POSITIONS[random(0, AUTO_LOOK_TILT_POSITION_COUNT)];
+            // choose a new look direction based on the available positions
+            newPanState = config.lookPanPositions[decision.panIndex];
+            newTiltState = config.lookTiltPositions[decision.tiltIndex];
         }
 
         // Also blink?
-        newAutoBlinkState = newAutoBlinkState || (random(0, AUTO_MAX_CHANCE) < AUTO_CHANCE_OF_BLINK_WHILE_LOOK);
+        newAutoBlinkState = newAutoBlinkState || (decision.actions & BEHAVIOUR_BLINK);
 
         #ifdef SERIAL_DEBUG
         Serial.println("RAND: Look: P" + String(newPanState) + ", T" + String(newTiltState) + String(newAutoBlinkState ? " (and blink)" : ""));
         #endif
     }
 
-    if (random(0, AUTO_MAX_CHANCE) < AUTO_CHANCE_OF_EYELID_CHANGE) {
-        newAutoEyelidsState = AUTO_SQUINT_POSITIONS[random(0, AUTO_SQUINT_POSITION_COUNT)];
+    if (decision.actions & BEHAVIOUR_SQUINT) {
+        newAutoEyelidsState = config.squintPositions[decision.squintIndex];
 
         #ifdef SERIAL_DEBUG
         Serial.println("RAND: Squint: " + String(newAutoEyelidsState));
         #endif
     }
 
-    if (random(0, AUTO_MAX_CHANCE) < AUTO_CHANCE_OF_BLINK) {
+    if (decision.actions & BEHAVIOUR_BLINK) {
         newAutoBlinkState = 1;
 
         #ifdef SERIAL_DEBUG
         Serial.println("RAND: Blink");
         #endif
     }
-
-    newTopLidState = newAutoBlinkState ? 0 : newAutoEyelidsState;
-    newBottomLidState = newAutoBlinkState ? 0 : newAutoEyelidsState;
 }
 
 /**
@@ -203,6 +323,19 @@ bool StateManager::checkPowerState() {
     return powerState;
 }
 
+/**
+ * @brief Gets when the bot was last driven by manual or remote control, for the sleep and power off timeouts.
+ *
+ * @return the time control was handed back to autonomous control (ms).
+ */
+unsigned long StateManager::getIdleSinceMillis() const {
+    unsigned long idleSinceMillis = inputHandler.getManualControlDisabledSinceMillis();
+    if (remoteControlMillis != 0 && (long)(remoteControlMillis - idleSinceMillis) > 0) {
+        idleSinceMillis = remoteControlMillis;
+    }
+    return idleSinceMillis;
+}
+
 /**
  * @brief Toggle the power button pin from an input to an output and send a double pulse to the power button
  */
@@ -291,6 +424,15 @@ int StateManager::getBottomLidState() const {
     return bottomLidState;
 }
 
+/**
+ * @brief Gets the most recently published servo targets. Safe to call from another task.
+ *
+ * @return StateSnapshot The latest state snapshot.
+ */
+StateSnapshot StateManager::getSnapshot() const {
+    return publishedSnapshot.read();
+}
+
 #ifdef SERIAL_DEBUG
 /**
  * @brief Prints the current input values for debugging purposes.
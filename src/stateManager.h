@@ -11,13 +11,20 @@
 #define STATE_MANAGER_H
 
 #include <Arduino.h>
+#include "behaviourModel.h"
 #include "inputHandler.h"
+#include "poissonTimer.h"
+#include "randomGenerator.h"
+#include "remoteControl.h"
+#include "seqLock.h"
+#include "snapshots.h"
 
 class StateManager {
 public:
     StateManager(InputHandler& inputHandler);
 
     void begin();
+    void begin(uint32_t seed);
     void update();
 
     bool getPowerState() const;
@@ -28,6 +35,9 @@ public:
     int getTopLidState() const;
     int getBottomLidState() const;
 
+    StateSnapshot getSnapshot() const;
+    uint32_t getRandomSeed() const;
+
     #ifdef SERIAL_DEBUG
     void printDebugValues();
     #endif
@@ -46,15 +56,32 @@ private:
 
     bool sleeping;
 
+    bool remoteControlled;              // Driven by remote setpoints (manual control still wins)
+    RemoteSetpoint remoteSetpoint;      // The remote setpoint being played
+    unsigned long remoteControlMillis;  // When remote control last drove the eyes
+
     int autoEyelidsState;
     bool autoBlinkState;
 
-    unsigned long previousAutoUpdateMillis;
     unsigned long perviousAutoBlinkMillis;
 
+    uint32_t randomSeedValue;
+    Prng randomGenerator;
+
+    BehaviourTable behaviourTable;  // Built from the runtime config
+    BehaviourModel behaviourModel;
+    PoissonTimer behaviourTimer;
+    uint32_t configGeneration;      // The runtime config generation the behaviour was built from
+    PoissonTimer twitchTimer;
+
+    SeqLock<StateSnapshot> publishedSnapshot;
+
+    void applyConfig();
     bool checkPowerState();
-    void randomizeStates(int& newPanState, int& newTiltState, int& newTopLidState, int& newBottomLidState, int& newAutoEyelidsState, bool& newAutoBlinkState);
+    unsigned long getIdleSinceMillis() const;
+    void randomizeStates(int& newPanState, int& newTiltState, int& newAutoEyelidsState, bool& newAutoBlinkState);
     void powerDown();
+    void publish();
 };;
 
 extern StateManager stateManager;
@@ -0,0 +1,101 @@
+/**
+ * @file syntheticAdcSampler.cpp
+ * @brief Host stand-in for the ADC that generates a synthetic waveform on each analog input.
+ *
+ * Each input can be given a constant, sine, square or ramp waveform with optional pseudo-random
+ * noise, evaluated against millis(). This allows the input pipeline to be driven with known signals
+ * when no hardware is attached.
+ */
+
+#include "syntheticAdcSampler.h"
+
+/**
+ * @brief Constructs a new SyntheticAdcSampler object. Every input starts as a constant mid-scale value.
+ */
+SyntheticAdcSampler::SyntheticAdcSampler():
+    noiseState(0x12345678)
+{
+    SyntheticChannel centred = {WAVEFORM_CONSTANT, 2048, 0, 1000, 0};
+    for (uint8_t input = 0; input < ADC_INPUT_COUNT; input++) {
+        channels[input] = centred;
+        values[input] = centred.centre;
+    }
+}
+
+/**
+ * @brief Sets the waveform generated on an analog input.
+ *
+ * @param input The analog input index (ADC_INPUT_*).
+ * @param channel The waveform settings.
+ */
+void SyntheticAdcSampler::setChannel(uint8_t input, const SyntheticChannel& channel) {
+    if (input < ADC_INPUT_COUNT) {
+        channels[input] = channel;
+    }
+}
+
+/**
+ * @brief Nothing to configure.
+ *
+ * @return true.
+ */
+bool SyntheticAdcSampler::begin() {
+    return true;
+}
+
+/**
+ * @brief Evaluates every waveform at the current time.
+ */
+void SyntheticAdcSampler::poll() {
+    unsigned long currentMillis = millis();
+
+    for (uint8_t input = 0; input < ADC_INPUT_COUNT; input++) {
+        const SyntheticChannel& channel = channels[input];
+        unsigned long period = channel.periodMillis > 0 ? channel.periodMillis : 1;
+        unsigned long phase = currentMillis % period;
+
+        int value = channel.centre;
+        switch (channel.waveform) {
+            case WAVEFORM_SINE:
+                value += (int)(channel.amplitude * sin(2.0 * M_PI * phase / period));
+                break;
+            case WAVEFORM_SQUARE:
+                value += (phase < period / 2) ? channel.amplitude : -channel.amplitude;
+                break;
+            case WAVEFORM_RAMP:
+                value += (int)(2 * channel.amplitude * (long)phase / (long)period) - channel.amplitude;
+                break;
+            case WAVEFORM_CONSTANT:
+            default:
+                break;
+        }
+
+        values[input] = constrain(value + nextNoise(channel.noise), 0, 4095);
+    }
+}
+
+/**
+ * @brief Gets the value generated on the last poll.
+ *
+ * @param input The analog input index (ADC_INPUT_*).
+ * @return the latest value (0 -> 4095).
+ */
+int SyntheticAdcSampler::read(uint8_t input) const {
+    return values[input];
+}
+
+/**
+ * @brief Generates uniform noise with a small xorshift generator so runs are repeatable.
+ *
+ * @param amplitude The peak noise amplitude.
+ * @return a value between -amplitude and amplitude.
+ */
+int SyntheticAdcSampler::nextNoise(int amplitude) {
+    if (amplitude <= 0) {
+        return 0;
+    }
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    return (int)(noiseState % (uint32_t)(2 * amplitude + 1)) - amplitude;
+}
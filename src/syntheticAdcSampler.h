@@ -0,0 +1,48 @@
+/**
+ * @file syntheticAdcSampler.h
+ * @brief Host stand-in for the ADC that generates a synthetic waveform on each analog input.
+ *
+ * Each input can be given a constant, sine, square or ramp waveform with optional pseudo-random
+ * noise, evaluated against millis(). This allows the input pipeline to be driven with known signals
+ * when no hardware is attached.
+ */
+
+#ifndef SYNTHETIC_ADC_SAMPLER_H
+#define SYNTHETIC_ADC_SAMPLER_H
+
+#include "adcSampler.h"
+
+enum SyntheticWaveform {
+    WAVEFORM_CONSTANT,
+    WAVEFORM_SINE,
+    WAVEFORM_SQUARE,
+    WAVEFORM_RAMP
+};
+
+struct SyntheticChannel {
+    SyntheticWaveform waveform;
+    int centre;                     // Value at rest (0 -> 4095)
+    int amplitude;                  // Peak deviation from the centre
+    unsigned long periodMillis;     // Period of the waveform (ms)
+    int noise;                      // Peak uniform noise added to every sample
+};
+
+class SyntheticAdcSampler : public AdcSampler {
+public:
+    SyntheticAdcSampler();
+
+    void setChannel(uint8_t input, const SyntheticChannel& channel);
+
+    bool begin() override;
+    void poll() override;
+    int read(uint8_t input) const override;
+
+private:
+    SyntheticChannel channels[ADC_INPUT_COUNT];
+    int values[ADC_INPUT_COUNT];
+    uint32_t noiseState;
+
+    int nextNoise(int amplitude);
+};
+
+#endif // SYNTHETIC_ADC_SAMPLER_H
@@ -0,0 +1,165 @@
+/**
+ * @file telemetry.cpp
+ * @brief A compact binary telemetry stream of the input, state and servo snapshots.
+ *
+ * Each update samples the published snapshots into a fixed-layout TelemetrySample, frames it
+ * (see frameCodec.h) and queues it in a ring buffer. The ring is drained only as far as the
+ * UART can accept without blocking, so a slow or disconnected host drops whole frames (counted)
+ * rather than stalling the loop. Decode the stream with tools/telemetry_decode.py.
+ */
+
+#include "telemetry.h"
+#include "inputHandler.h"
+#include "stateManager.h"
+#include "servoController.h"
+
+static_assert((TELEMETRY_BUFFER_SIZE & (TELEMETRY_BUFFER_SIZE - 1)) == 0, "TELEMETRY_BUFFER_SIZE must be a power of two");
+static_assert(TELEMETRY_BUFFER_SIZE >= TELEMETRY_MAX_FRAME_SIZE, "TELEMETRY_BUFFER_SIZE must hold at least one frame");
+
+/**
+ * @brief Constructs a new TelemetryStream object with an empty buffer.
+ */
+TelemetryStream::TelemetryStream():
+    head(0),
+    tail(0),
+    sequence(0),
+    frameCount(0),
+    droppedFrameCount(0),
+    byteCount(0)
+{}
+
+/**
+ * @brief Samples the latest snapshots, queues them as a frame and sends as much as the UART will take.
+ *
+ * Runs as a scheduler task every TASK_PERIOD_TELEMETRY.
+ */
+void TelemetryStream::update() {
+    InputSnapshot input = inputHandler.getSnapshot();
+    StateSnapshot state = stateManager.getSnapshot();
+    ServoSnapshot servos = servoController.getSnapshot();
+
+    TelemetrySample sample;
+    sample.timestampMicros = micros();
+
+    sample.joystickXValue = input.joystickXValue;
+    sample.joystickYValue = input.joystickYValue;
+    sample.potValue = input.potValue;
+    sample.smoothedPotValue = input.smoothedPotValue;
+    sample.inputFlags = (input.buttonPressed ? TELEMETRY_INPUT_BUTTON : 0)
+                      | (input.manualControlEnabled ? TELEMETRY_INPUT_MANUAL : 0);
+
+    sample.pan = state.pan;
+    sample.tilt = state.tilt;
+    sample.topLid = state.topLid;
+    sample.bottomLid = state.bottomLid;
+    sample.stateFlags = state.flags;
+
+    sample.panPulse = servos.pan;
+    sample.tiltPulse = servos.tilt;
+    sample.leftLidTopPulse = servos.leftLidTop;
+    sample.leftLidBottomPulse = servos.leftLidBottom;
+    sample.rightLidTopPulse = servos.rightLidTop;
+    sample.rightLidBottomPulse = servos.rightLidBottom;
+
+    queueFrame(TELEMETRY_FRAME_SAMPLE, &sample, sizeof(sample));
+    drain();
+}
+
+/**
+ * @brief Frames a payload and queues it for sending. The frame is dropped whole if it does not fit.
+ *
+ * @param type The frame type (TELEMETRY_FRAME_*).
+ * @param payload The payload.
+ * @param length The payload length.
+ * @return true if the frame was queued, false if it was dropped.
+ */
+bool TelemetryStream::queueFrame(uint8_t type, const void* payload, size_t length) {
+    uint8_t raw[TELEMETRY_HEADER_SIZE + sizeof(TelemetrySample)];
+    if (length > sizeof(raw) - TELEMETRY_HEADER_SIZE) {
+        droppedFrameCount++;
+        return false;
+    }
+
+    raw[0] = type;
+    raw[1] = sequence & 0xFF;
+    raw[2] = sequence >> 8;
+    memcpy(raw + TELEMETRY_HEADER_SIZE, payload, length);
+
+    // The sequence number advances even for dropped frames so the decoder can count the gaps
+    sequence++;
+
+    uint8_t frame[TELEMETRY_MAX_FRAME_SIZE];
+    size_t frameLength = frameEncode(raw, TELEMETRY_HEADER_SIZE + length, frame);
+    if (frameLength == 0 || frameLength > TELEMETRY_BUFFER_SIZE - getUsed()) {
+        droppedFrameCount++;
+        return false;
+    }
+
+    for (size_t i = 0; i < frameLength; i++) {
+        buffer[(head + i) & (TELEMETRY_BUFFER_SIZE - 1)] = frame[i];
+    }
+    head += frameLength;
+    frameCount++;
+    return true;
+}
+
+/**
+ * @brief Sends as many queued bytes as the UART can accept without blocking.
+ *
+ * @return the number of bytes sent.
+ */
+size_t TelemetryStream::drain() {
+    size_t sent = 0;
+    size_t available = max(Serial.availableForWrite(), 0);
+
+    while (available > 0 && getUsed() > 0) {
+        size_t offset = tail & (TELEMETRY_BUFFER_SIZE - 1);
+        size_t chunk = min(min(available, getUsed()), TELEMETRY_BUFFER_SIZE - offset);
+        size_t written = Serial.write(buffer + offset, chunk);
+        if (written == 0) {
+            break;
+        }
+        tail += written;
+        sent += written;
+        available -= min(written, available);
+    }
+
+    byteCount += sent;
+    return sent;
+}
+
+/**
+ * @brief Gets the number of bytes waiting to be sent.
+ *
+ * @return the queued byte count.
+ */
+size_t TelemetryStream::getUsed() const {
+    return head - tail;
+}
+
+/**
+ * @brief Gets the number of frames queued since startup.
+ *
+ * @return the frame count.
+ */
+unsigned long TelemetryStream::getFrameCount() const {
+    return frameCount;
+}
+
+/**
+ * @brief Gets the number of frames dropped because the buffer was full.
+ *
+ * @return the dropped frame count.
+ */
+unsigned long TelemetryStream::getDroppedFrameCount() const {
+    return droppedFrameCount;
+}
+
+/**
+ * @brief Gets the number of bytes sent since startup.
+ *
+ * @return the byte count.
+ */
+unsigned long TelemetryStream::getByteCount() const {
+    return byteCount;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file telemetry.h
+ * @brief A compact binary telemetry stream of the input, state and servo snapshots.
+ *
+ * Each update samples the published snapshots into a fixed-layout TelemetrySample, frames it
+ * (see frameCodec.h) and queues it in a ring buffer. The ring is drained only as far as the
+ * UART can accept without blocking, so a slow or disconnected host drops whole frames (counted)
+ * rather than stalling the loop. Decode the stream with tools/telemetry_decode.py.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "frameCodec.h"
+
+#define TELEMETRY_FRAME_SAMPLE 0x01     // Payload: TelemetrySample
+
+#define TELEMETRY_INPUT_BUTTON 0x01     // TelemetrySample::inputFlags: the blink button is pressed
+#define TELEMETRY_INPUT_MANUAL 0x02     // TelemetrySample::inputFlags: manual control is enabled
+
+/**
+ * @brief One sample of the whole control path. The layout is the wire format (little endian) and
+ * must only ever be extended at the end.
+ */
+struct __attribute__((packed)) TelemetrySample {
+    uint32_t timestampMicros;
+
+    // Inputs (InputSnapshot)
+    int16_t joystickXValue;
+    int16_t joystickYValue;
+    int16_t potValue;
+    int16_t smoothedPotValue;
+    uint8_t inputFlags;             // TELEMETRY_INPUT_*
+
+    // Servo targets (StateSnapshot)
+    int8_t pan;
+    int8_t tilt;
+    uint8_t topLid;
+    uint8_t bottomLid;
+    uint8_t stateFlags;             // STATE_FLAG_*
+
+    // Pulses sent to the PCA9685 (ServoSnapshot)
+    uint16_t panPulse;
+    uint16_t tiltPulse;
+    uint16_t leftLidTopPulse;
+    uint16_t leftLidBottomPulse;
+    uint16_t rightLidTopPulse;
+    uint16_t rightLidBottomPulse;
+};
+
+// Frame header: type (1 byte) and sequence number (2 bytes, little endian)
+#define TELEMETRY_HEADER_SIZE 3
+#define TELEMETRY_MAX_FRAME_SIZE FRAME_ENCODED_SIZE(TELEMETRY_HEADER_SIZE + sizeof(TelemetrySample))
+
+class TelemetryStream {
+public:
+    TelemetryStream();
+
+    void update();
+    bool queueFrame(uint8_t type, const void* payload, size_t length);
+    size_t drain();
+
+    unsigned long getFrameCount() const;
+    unsigned long getDroppedFrameCount() const;
+    unsigned long getByteCount() const;
+
+private:
+    uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+    size_t head;        // Next byte to write
+    size_t tail;        // Next byte to send
+    uint16_t sequence;
+
+    unsigned long frameCount;
+    unsigned long droppedFrameCount;
+    unsigned long byteCount;
+
+    size_t getUsed() const;
+};
+
+extern TelemetryStream telemetryStream;
+
+#endif // TELEMETRY_H
@@ -0,0 +1,99 @@
+/**
+ * @file wifiUdpTransport.cpp
+ * @brief Carries remote control frames over Wi-Fi as UDP datagrams.
+ *
+ * begin() starts joining the network in the background and binds a UDP socket straight away, so
+ * setup() never waits for the radio. receive() and send() use the lwIP socket with MSG_DONTWAIT and
+ * copy straight into the caller's buffer, so, unlike WiFiUDP::parsePacket(), nothing is allocated
+ * per datagram. Wi-Fi modem sleep is turned off, as it would hold each datagram for up to a beacon
+ * interval. Reports go back to whichever address the last datagram came from.
+ */
+
+#include "wifiUdpTransport.h"
+
+#ifdef ESP_PLATFORM
+
+#include <WiFi.h>
+
+/**
+ * @brief Constructs a new WifiUdpTransport object.
+ *
+ * @param ssid The Wi-Fi network to join.
+ * @param password Its password.
+ * @param port The UDP port to listen on.
+ */
+WifiUdpTransport::WifiUdpTransport(const char* ssid, const char* password, uint16_t port):
+    ssid(ssid),
+    password(password),
+    port(port),
+    socketFd(-1),
+    peer(),
+    hasPeer(false)
+{}
+
+/**
+ * @brief Starts joining the network (the driver keeps retrying in the background) and binds the socket.
+ *
+ * @return true if the socket is listening, false otherwise.
+ */
+bool WifiUdpTransport::begin() {
+    WiFi.mode(WIFI_STA);
+    WiFi.setSleep(false);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(ssid, password);
+
+    socketFd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socketFd < 0) {
+        return false;
+    }
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(socketFd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(socketFd);
+        socketFd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Takes the next waiting datagram. Never blocks.
+ *
+ * @param buffer Receives the datagram (truncated to capacity).
+ * @param capacity The buffer size.
+ * @return the datagram length, or 0 if none is waiting.
+ */
+size_t WifiUdpTransport::receive(uint8_t* buffer, size_t capacity) {
+    if (socketFd < 0) {
+        return 0;
+    }
+
+    struct sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    int length = recvfrom(socketFd, buffer, capacity, MSG_DONTWAIT, (struct sockaddr*)&from, &fromLength);
+    if (length <= 0) {
+        return 0;
+    }
+    peer = from;
+    hasPeer = true;
+    return length;
+}
+
+/**
+ * @brief Sends a datagram to wherever the last one was received from. Never blocks.
+ *
+ * @param data The datagram.
+ * @param length The datagram length.
+ * @return true if it was sent, false if there is no peer yet or the link is busy.
+ */
+bool WifiUdpTransport::send(const uint8_t* data, size_t length) {
+    if (socketFd < 0 || !hasPeer) {
+        return false;
+    }
+    return sendto(socketFd, data, length, MSG_DONTWAIT, (struct sockaddr*)&peer, sizeof(peer)) == (int)length;
+}
+
+#endif // ESP_PLATFORM
@@ -0,0 +1,45 @@
+/**
+ * @file wifiUdpTransport.h
+ * @brief Carries remote control frames over Wi-Fi as UDP datagrams.
+ *
+ * begin() starts joining the network in the background and binds a UDP socket straight away, so
+ * setup() never waits for the radio. receive() and send() use the lwIP socket with MSG_DONTWAIT and
+ * copy straight into the caller's buffer, so, unlike WiFiUDP::parsePacket(), nothing is allocated
+ * per datagram. Wi-Fi modem sleep is turned off, as it would hold each datagram for up to a beacon
+ * interval. Reports go back to whichever address the last datagram came from.
+ */
+
+#ifndef WIFI_UDP_TRANSPORT_H
+#define WIFI_UDP_TRANSPORT_H
+
+#ifdef ESP_PLATFORM
+
+#include <Arduino.h>
+#include <lwip/sockets.h>
+#include "config.h"
+#include "remoteTransport.h"
+
+class WifiUdpTransport : public RemoteTransport {
+public:
+    WifiUdpTransport(const char* ssid, const char* password, uint16_t port);
+
+    bool begin() override;
+    size_t receive(uint8_t* buffer, size_t capacity) override;
+    bool send(const uint8_t* data, size_t length) override;
+
+private:
+    const char* ssid;
+    const char* password;
+    uint16_t port;
+    int socketFd;
+    struct sockaddr_in peer;    // Where the last datagram came from
+    bool hasPeer;
+};
+
+#if defined(REMOTE_CONTROL) && defined(REMOTE_UDP)
+extern WifiUdpTransport remoteTransport;
+#endif
+
+#endif // ESP_PLATFORM
+
+#endif // WIFI_UDP_TRANSPORT_H
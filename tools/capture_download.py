@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Download an input capture (see src/inputCapture.h) from the bot over serial.
+
+Sends the dump key, waits for the "CAPTURE <size>" line and saves the bytes that follow.
+Replay the result with the native build: program replay capture.bin pulses.csv
+
+Usage:
+    capture_download.py --port /dev/ttyACM0 capture.bin              (this boot's capture, stops recording)
+    capture_download.py --port /dev/ttyACM0 --previous capture.bin   (the previous boot's capture)
+
+Requires pyserial.
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+CAPTURE_DUMP_KEY = b"d"
+CAPTURE_DUMP_PREVIOUS_KEY = b"D"
+TIMEOUT_SECONDS = 10
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("output", help="where to save the capture")
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--previous", action="store_true", help="download the previous boot's capture")
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        port.reset_input_buffer()
+        port.write(CAPTURE_DUMP_PREVIOUS_KEY if args.previous else CAPTURE_DUMP_KEY)
+
+        # Skip any debug output or telemetry until the capture header line
+        deadline = time.monotonic() + TIMEOUT_SECONDS
+        size = None
+        while size is None:
+            if time.monotonic() > deadline:
+                sys.exit("No capture header received")
+            line = port.readline()
+            start = line.find(b"CAPTURE ")
+            if start >= 0:
+                size = int(line[start + len(b"CAPTURE "):].strip())
+
+        data = bytearray()
+        while len(data) < size:
+            chunk = port.read(size - len(data))
+            if not chunk:
+                sys.exit(f"Timed out after {len(data)} of {size} bytes")
+            data += chunk
+
+    with open(args.output, "wb") as output:
+        output.write(data)
+    print(f"Saved {size} bytes to {args.output}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""Stream gaze setpoints to the bot over serial or UDP (remote control, see src/remoteControl.h).
+
+The bot must be built with REMOTE_CONTROL. Each setpoint is a frame (COBS with a CRC-16/CCITT-FALSE,
+see src/frameCodec.h) stamped with a sequence number and this host's clock. The bot plays them
+after a short jitter delay and, while they are streaming, sends back a report every second with the
+latency from each setpoint arriving to it being written to the servos. Control goes back to the
+bot when the stream ends (a release frame is sent) or stops for longer than REMOTE_CONTROL_TIMEOUT.
+With --udp (bot built with REMOTE_UDP) each frame is sent as one datagram and the reports come back
+the same way.
+
+Usage:
+    remote_gaze.py --port /dev/ttyACM0 [--rate 100] [--seconds 10] [--pattern circle|sweep|blink]
+    remote_gaze.py --udp 192.168.1.50[:4210] [...]
+    program remote 30 &   (native build, prints "Serial port: /dev/pts/N")
+    remote_gaze.py --port /dev/pts/N   (or --udp 127.0.0.1 if built with REMOTE_UDP)
+
+Linux only (uses termios, no pyserial needed).
+"""
+
+import argparse
+import math
+import os
+import select
+import socket
+import struct
+import sys
+import termios
+import time
+import tty
+
+FRAME_DELIMITER = 0
+FRAME_SETPOINT = 0x10
+FRAME_RELEASE = 0x11
+FRAME_REPORT = 0x12
+FLAG_BLINK = 0x01
+REPORT_WAIT_SECONDS = 1.5
+UDP_PORT = 4210     # REMOTE_UDP_PORT in src/config.h
+
+HEADER = struct.Struct("<BH")
+# Must match RemoteSetpointPayload and RemoteReportPayload in src/remoteControl.h
+SETPOINT = struct.Struct("<IbbBBB")
+REPORT = struct.Struct("<HHIIHHHHH")
+
+BAUD_RATES = {9600: termios.B9600, 57600: termios.B57600, 115200: termios.B115200,
+              230400: termios.B230400, 460800: termios.B460800, 921600: termios.B921600}
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matching crc16() in src/frameCodec.cpp."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    """COBS-encode one block (at most 254 bytes, as the bot only decodes single-block frames)."""
+    output = bytearray([0])
+    code_index = 0
+    for byte in data:
+        if byte == FRAME_DELIMITER:
+            output[code_index] = len(output) - code_index
+            code_index = len(output)
+            output.append(0)
+        else:
+            output.append(byte)
+    output[code_index] = len(output) - code_index
+    return bytes(output)
+
+
+def cobs_decode(data):
+    """Decode one COBS block (without delimiters). Returns None if it is malformed."""
+    output = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        index += 1
+        if code == 0 or index + code - 1 > len(data):
+            return None
+        output += data[index:index + code - 1]
+        index += code - 1
+        if code != 0xFF and index < len(data):
+            output.append(0)
+    return bytes(output)
+
+
+def frame_encode(payload):
+    """Build a complete frame: delimiter, COBS(payload + CRC), delimiter."""
+    return bytes([FRAME_DELIMITER]) + cobs_encode(payload + struct.pack("<H", crc16(payload))) + bytes([FRAME_DELIMITER])
+
+
+def frame_decode(encoded):
+    """Decode and check one frame. Returns the payload, or None if it is damaged."""
+    decoded = cobs_decode(encoded)
+    if decoded is None or len(decoded) < 3:
+        return None
+    payload, crc = decoded[:-2], decoded[-2] | (decoded[-1] << 8)
+    return payload if crc16(payload) == crc else None
+
+
+def open_port(path, baud):
+    """Open a serial port (or pty) in raw, non-blocking mode."""
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    tty.setraw(fd)
+    attributes = termios.tcgetattr(fd)
+    attributes[4] = attributes[5] = BAUD_RATES[baud]
+    termios.tcsetattr(fd, termios.TCSANOW, attributes)
+    return fd
+
+
+def open_udp(target):
+    """Open a non-blocking UDP socket connected to HOST[:PORT]. Returns the socket and its descriptor."""
+    host, _, port = target.partition(":")
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.connect((host, int(port) if port else UDP_PORT))
+    sock.setblocking(False)
+    return sock, sock.fileno()
+
+
+def host_micros():
+    """This host's clock for the setpoint stamps (wraps like the bot's micros())."""
+    return (time.monotonic_ns() // 1000) & 0xFFFFFFFF
+
+
+def pattern_setpoint(pattern, elapsed):
+    """The (pan, tilt, top lid, bottom lid, flags) to send at a time into the stream."""
+    if pattern == "sweep":
+        phase = (elapsed / 4.0) % 1.0
+        pan = round(-100 + 400 * phase) if phase < 0.5 else round(300 - 400 * phase)
+        return pan, 0, 60, 60, 0
+    if pattern == "blink":
+        return 0, 0, 60, 60, FLAG_BLINK if (elapsed % 2.0) < 0.15 else 0
+    angle = 2 * math.pi * elapsed / 3.0
+    return round(80 * math.cos(angle)), round(80 * math.sin(angle)), 60, 60, 0
+
+
+def print_report(sequence, report):
+    (output_sequence, latency_count, latency_mean, latency_max,
+     frames, bad_frames, late, stale, dropped) = report
+    print(f"report {sequence}: {latency_count} setpoints to PWM, latency mean {latency_mean / 1000:.1f} ms "
+          f"max {latency_max / 1000:.1f} ms (last setpoint {output_sequence}); frames {frames} bad {bad_frames} "
+          f"late {late} stale {stale} dropped {dropped}")
+
+
+class ReportReader:
+    """Collects the report frames from whatever the bot sends (skipping text and other frames)."""
+
+    def __init__(self, fd):
+        self.fd = fd
+        self.pending = bytearray()
+        self.reports = []
+
+    def poll(self, timeout):
+        readable, _, _ = select.select([self.fd], [], [], max(timeout, 0))
+        if not readable:
+            return
+        try:
+            self.pending += os.read(self.fd, 4096)
+        except (BlockingIOError, ConnectionRefusedError):
+            # Over UDP, a refused datagram (nothing listening yet) is reported on the next read
+            return
+        *frames, rest = self.pending.split(bytes([FRAME_DELIMITER]))
+        self.pending = bytearray(rest)
+        for encoded in frames:
+            payload = frame_decode(bytes(encoded)) if encoded else None
+            if payload is None or len(payload) != HEADER.size + REPORT.size:
+                continue
+            frame_type, sequence = HEADER.unpack_from(payload)
+            if frame_type == FRAME_REPORT:
+                report = REPORT.unpack_from(payload, HEADER.size)
+                self.reports.append(report)
+                print_report(sequence, report)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    link = parser.add_mutually_exclusive_group(required=True)
+    link.add_argument("--port", help="serial port")
+    link.add_argument("--udp", metavar="HOST[:PORT]", help=f"send datagrams instead (default port {UDP_PORT})")
+    parser.add_argument("--baud", type=int, default=115200, choices=sorted(BAUD_RATES))
+    parser.add_argument("--rate", type=float, default=100, help="setpoints per second")
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--pattern", choices=["circle", "sweep", "blink"], default="circle")
+    args = parser.parse_args()
+
+    if args.udp:
+        sock, fd = open_udp(args.udp)
+    else:
+        sock, fd = None, open_port(args.port, args.baud)
+    reader = ReportReader(fd)
+    period = 1.0 / args.rate
+    start = time.monotonic()
+    next_send = start
+    sequence = 0
+    unsent = 0
+
+    while time.monotonic() - start < args.seconds:
+        pan, tilt, top_lid, bottom_lid, flags = pattern_setpoint(args.pattern, next_send - start)
+        payload = HEADER.pack(FRAME_SETPOINT, sequence) + SETPOINT.pack(host_micros(), pan, tilt, top_lid, bottom_lid, flags)
+        try:
+            os.write(fd, frame_encode(payload))
+        except (BlockingIOError, ConnectionRefusedError):
+            unsent += 1
+        sequence = (sequence + 1) & 0xFFFF
+        next_send += period
+        reader.poll(next_send - time.monotonic())
+
+    try:
+        os.write(fd, frame_encode(HEADER.pack(FRAME_RELEASE, sequence)))
+    except (BlockingIOError, ConnectionRefusedError):
+        pass
+    deadline = time.monotonic() + REPORT_WAIT_SECONDS
+    while time.monotonic() < deadline:
+        reader.poll(deadline - time.monotonic())
+    if sock:
+        sock.close()
+    else:
+        os.close(fd)
+
+    print(f"sent {sequence} setpoints in {args.seconds:g} s ({unsent} not sent, the link was full)")
+    if not reader.reports:
+        sys.exit("No report from the bot (is it built with REMOTE_CONTROL?)")
+    counted = sum(report[1] for report in reader.reports)
+    if counted:
+        mean = sum(report[1] * report[2] for report in reader.reports) / counted
+        print(f"{counted} setpoints reached PWM, latency mean {mean / 1000:.1f} ms "
+              f"max {max(report[3] for report in reader.reports) / 1000:.1f} ms")
+
+
+if __name__ == "__main__":
+    main()
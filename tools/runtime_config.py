@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Show, change or reset the bot's runtime config (see src/runtimeConfig.h) over serial.
+
+The bot must be built with RUNTIME_CONFIG. A change reads the active config, replaces the given
+fields, and uploads the whole config as one frame (COBS with a CRC-16/CCITT-FALSE, see
+src/frameCodec.h). The bot checks it, swaps it in at once and stores it in NVS for the next boot.
+
+Usage:
+    runtime_config.py --port /dev/ttyACM0 show
+    runtime_config.py --port /dev/ttyACM0 set joystickDeadzone=120 lookPanPositions=-90,-60,-30,0,30,60,90
+    runtime_config.py --port /dev/ttyACM0 reset      (erase the stored config, back to the config.h defaults)
+
+Requires pyserial.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+RUNTIME_CONFIG_PRINT_KEY = b"c"
+RUNTIME_CONFIG_UPLOAD_KEY = b"C"
+RUNTIME_CONFIG_RESET_KEY = b"x"
+RUNTIME_CONFIG_MAGIC = 0x46434B42
+RUNTIME_CONFIG_VERSION = 2
+SERVO_BOARD_COUNT = 1  # Must match SERVO_BOARD_COUNT in src/config.h
+FRAME_DELIMITER = 0
+TIMEOUT_SECONDS = 3
+
+# Must match RuntimeConfigValues in src/runtimeConfig.h: (name, struct format, count)
+# The servo pulses are six per board (pan, tilt, left lid top/bottom, right lid top/bottom), board by board
+FIELDS = [
+    ("servoPulseAtStateMin", "H", 6 * SERVO_BOARD_COUNT),
+    ("servoPulseAtStateMax", "H", 6 * SERVO_BOARD_COUNT),
+    ("joystickDriftX", "h", 1),
+    ("joystickDriftY", "h", 1),
+    ("joystickDeadzone", "H", 1),
+    ("joystickDeadzoneHysteresis", "H", 1),
+    ("manualControlTimeout", "I", 1),
+    ("autoPowerOffTimeout", "I", 1),
+    ("autoBlinkDuration", "H", 1),
+    ("chanceOfBlink", "H", 1),
+    ("chanceOfEyelidChange", "H", 1),
+    ("chanceOfMajorLookChange", "H", 1),
+    ("chanceOfLookReturnCentre", "H", 1),
+    ("chanceOfBlinkWhileLook", "H", 1),
+    ("squintPositions", "b", 5),
+    ("lookPanPositions", "b", 7),
+    ("lookTiltPositions", "b", 5),
+]
+VALUES = struct.Struct("<" + "".join(f"{count}{fmt}" for _, fmt, count in FIELDS) + "3x")
+HEADER = struct.Struct("<IHH")
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matching crc16() in src/frameCodec.cpp."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    """COBS-encode one block (at most 254 bytes, as the bot only decodes single-block frames)."""
+    output = bytearray([0])
+    code_index = 0
+    for byte in data:
+        if byte == FRAME_DELIMITER:
+            output[code_index] = len(output) - code_index
+            code_index = len(output)
+            output.append(0)
+        else:
+            output.append(byte)
+    output[code_index] = len(output) - code_index
+    return bytes(output)
+
+
+def frame_encode(payload):
+    """Build a complete frame: delimiter, COBS(payload + CRC), delimiter."""
+    return bytes([FRAME_DELIMITER]) + cobs_encode(payload + struct.pack("<H", crc16(payload))) + bytes([FRAME_DELIMITER])
+
+
+def pack_blob(config):
+    """Pack a config (field name -> list of values) into a RuntimeConfigBlob."""
+    flat = [value for name, _, _ in FIELDS for value in config[name]]
+    values = VALUES.pack(*flat)
+    return HEADER.pack(RUNTIME_CONFIG_MAGIC, RUNTIME_CONFIG_VERSION, crc16(values)) + values
+
+
+def read_lines(port, until):
+    """Read "CONFIG: " lines (skipping any other output) until one starts with until."""
+    lines = []
+    deadline = time.monotonic() + TIMEOUT_SECONDS
+    while time.monotonic() < deadline:
+        line = port.readline()
+        start = line.find(b"CONFIG: ")
+        if start < 0:
+            continue
+        text = line[start + len(b"CONFIG: "):].decode("ascii", "replace").strip()
+        lines.append(text)
+        if text.startswith(until):
+            return lines
+    sys.exit("No reply from the bot (is it built with RUNTIME_CONFIG?)")
+
+
+def read_config(port):
+    """Ask the bot for its active config. Returns field name -> list of values."""
+    port.write(RUNTIME_CONFIG_PRINT_KEY)
+    header = read_lines(port, "version")[-1].split()
+    if int(header[1]) != RUNTIME_CONFIG_VERSION:
+        sys.exit(f"The bot has config version {header[1]}, this tool writes version {RUNTIME_CONFIG_VERSION}")
+    config = {}
+    for text in read_lines(port, FIELDS[-1][0]):
+        name, *values = text.split()
+        config[name] = [int(value) for value in values]
+    missing = [name for name, _, _ in FIELDS if name not in config]
+    if missing:
+        sys.exit("The bot did not report " + ", ".join(missing))
+    return config
+
+
+def apply_assignments(config, assignments):
+    """Apply name=value[,value...] assignments to a config."""
+    counts = {name: count for name, _, count in FIELDS}
+    for assignment in assignments:
+        name, _, text = assignment.partition("=")
+        if name not in counts:
+            sys.exit(f"Unknown field {name} (one of: {', '.join(counts)})")
+        values = [int(value, 0) for value in text.split(",")]
+        if len(values) != counts[name]:
+            sys.exit(f"{name} takes {counts[name]} values, got {len(values)}")
+        config[name] = values
+
+
+def print_config(config):
+    for name, _, _ in FIELDS:
+        print(f"{name} = {','.join(str(value) for value in config[name])}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("command", choices=["show", "set", "reset"])
+    parser.add_argument("assignments", nargs="*", help="name=value[,value...] for set")
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        port.reset_input_buffer()
+        if args.command == "reset":
+            port.write(RUNTIME_CONFIG_RESET_KEY)
+            print(read_lines(port, "reset")[-1])
+            return
+
+        config = read_config(port)
+        if args.command == "show":
+            print_config(config)
+            return
+
+        apply_assignments(config, args.assignments)
+        port.write(RUNTIME_CONFIG_UPLOAD_KEY + frame_encode(pack_blob(config)))
+        result = read_lines(port, "upload")[-1]
+        print(result)
+        if not result.endswith(" ok"):
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
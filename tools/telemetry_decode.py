@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Decode a Blinkenstein telemetry stream (see src/telemetry.h) into CSV.
+
+Frames are COBS-encoded, delimited by 0x00 and end with a CRC-16/CCITT-FALSE.
+Anything that does not decode (partial frames, interleaved debug text) is skipped
+and counted, as are gaps in the frame sequence numbers.
+
+Usage:
+    telemetry_decode.py capture.bin > samples.csv
+    telemetry_decode.py --port /dev/ttyACM0 [--baud 115200] > samples.csv   (needs pyserial)
+    program run 10 | telemetry_decode.py - > samples.csv                     (native build)
+"""
+
+import argparse
+import struct
+import sys
+
+FRAME_DELIMITER = 0
+FRAME_SAMPLE = 0x01
+
+HEADER = struct.Struct("<BH")
+
+# Must match TelemetrySample in src/telemetry.h
+SAMPLE = struct.Struct("<IhhhhBbbBBBHHHHHH")
+SAMPLE_FIELDS = [
+    "timestamp_us",
+    "joystick_x", "joystick_y", "pot", "smoothed_pot", "input_flags",
+    "pan", "tilt", "top_lid", "bottom_lid", "state_flags",
+    "pan_pulse", "tilt_pulse", "left_lid_top_pulse", "left_lid_bottom_pulse",
+    "right_lid_top_pulse", "right_lid_bottom_pulse",
+]
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matching crc16() in src/frameCodec.cpp."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Decode one COBS block (without delimiters). Returns None if it is malformed."""
+    output = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        index += 1
+        if code == 0 or index + code - 1 > len(data):
+            return None
+        block = data[index:index + code - 1]
+        if FRAME_DELIMITER in block:
+            return None
+        output += block
+        index += code - 1
+        if code != 0xFF and index < len(data):
+            output.append(0)
+    return bytes(output)
+
+
+def frame_decode(encoded):
+    """Decode and check one frame. Returns the payload, or None if it is damaged."""
+    decoded = cobs_decode(encoded)
+    if decoded is None or len(decoded) < 3:
+        return None
+    payload, crc = decoded[:-2], decoded[-2] | (decoded[-1] << 8)
+    return payload if crc16(payload) == crc else None
+
+
+def read_chunks(args):
+    """Yield raw bytes from the chosen input."""
+    if args.port:
+        import serial  # pyserial
+        with serial.Serial(args.port, args.baud, timeout=1) as port:
+            while True:
+                yield port.read(4096)
+    source = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    with source:
+        while True:
+            chunk = source.read(65536)
+            if not chunk:
+                return
+            yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="?", default="-", help="capture file, or - for stdin")
+    parser.add_argument("--port", help="read from a serial port instead (requires pyserial)")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    out = sys.stdout
+    out.write("sequence," + ",".join(SAMPLE_FIELDS) + "\n")
+
+    pending = bytearray()
+    samples = bad_frames = lost_frames = 0
+    last_sequence = None
+
+    try:
+        for chunk in read_chunks(args):
+            pending += chunk
+            *frames, pending = pending.split(bytes([FRAME_DELIMITER]))
+            pending = bytearray(pending)
+            for encoded in frames:
+                if not encoded:
+                    continue
+                payload = frame_decode(bytes(encoded))
+                if payload is None or len(payload) < HEADER.size:
+                    bad_frames += 1
+                    continue
+
+                frame_type, sequence = HEADER.unpack_from(payload)
+                if last_sequence is not None:
+                    lost_frames += (sequence - last_sequence - 1) & 0xFFFF
+                last_sequence = sequence
+
+                if frame_type == FRAME_SAMPLE and len(payload) >= HEADER.size + SAMPLE.size:
+                    values = SAMPLE.unpack_from(payload, HEADER.size)
+                    out.write(f"{sequence}," + ",".join(str(v) for v in values) + "\n")
+                    samples += 1
+    except KeyboardInterrupt:
+        pass
+
+    print(f"{samples} samples, {lost_frames} frames lost, {bad_frames} damaged or non-telemetry frames skipped",
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()